@@ -25,6 +25,7 @@ namespace llvm {
 class BlockFrequencyInfo;
 class Function;
 class Module;
+class PolyhedralAccessInfo;
 class ProfileSummaryInfo;
 
 /// Direct function to compute a \c ModuleSummaryIndex from a given module.
@@ -33,10 +34,16 @@ class ProfileSummaryInfo;
 /// BlockFrequencyInfo for a given function, that can be provided via
 /// a std::function callback. Otherwise, this routine will manually construct
 /// that information.
+///
+/// The accesses through pointer arguments are only summarized if requested and
+/// the \c PolyhedralAccessInfo for a function is provided via \p
+/// GetPAICallback.
 ModuleSummaryIndex buildModuleSummaryIndex(
     const Module &M,
     std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
-    ProfileSummaryInfo *PSI);
+    ProfileSummaryInfo *PSI,
+    std::function<PolyhedralAccessInfo *(const Function &F)> GetPAICallback =
+        nullptr);
 
 /// Analysis pass to provide the ModuleSummaryIndex object.
 class ModuleSummaryIndexAnalysis
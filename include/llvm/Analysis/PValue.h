@@ -28,6 +28,8 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <memory>
+
 struct isl_id;
 struct isl_ctx;
 struct isl_set;
@@ -67,21 +69,76 @@ public:
                                           const std::string &Suffix);
 };
 
+/// Reference to an isl context.
+///
+/// The default constructor allocates a new context, it is freed once the last
+/// PVCtx referencing it is destroyed. Polyhedral values do not keep their
+/// context alive, their owners have to.
 class PVCtx : public PVBase {
-  isl_ctx *Obj;
+  std::shared_ptr<isl_ctx> Obj;
 
 public:
   PVCtx();
-  PVCtx(isl_ctx *Ctx) : Obj(Ctx) {}
   PVCtx(const PVCtx &Other) : Obj(Other.Obj) {}
 
-  isl_ctx *getIslCtx() const { return Obj; }
+  PVCtx &operator=(const PVCtx &Other) {
+    Obj = Other.Obj;
+    return *this;
+  }
+
+  isl_ctx *getIslCtx() const { return Obj.get(); }
   isl_space *getSpace() const;
 
+  /// Return the number of isl operations performed in this context so far.
+  unsigned long getNumOperations() const;
+
   std::string str() const;
   operator bool() const { return Obj != nullptr; }
 };
 
+/// Scoped limit for the number of isl operations performed in a context.
+///
+/// While the guard is active isl errors do not abort, the failing operations
+/// return null objects instead. Once the limit is exceeded all operations fail
+/// until the outermost guard is destroyed. Guards nested in an active guard
+/// for the same context are inactive and do not change the budget, unless
+/// they are independent. An independent guard suspends the enclosing one, its
+/// operations and errors are not accounted to it.
+class PVMaxOperationsGuard {
+  isl_ctx *IslCtx;
+
+  /// The on-error behaviour of the context before the guard was activated.
+  int OldOnError;
+
+  /// The operation limit and the error of the context before the guard was
+  /// activated.
+  unsigned long OldMaxOperations;
+  int OldError;
+
+  /// The number of operations performed when the guard was activated.
+  unsigned long StartOperations;
+
+  /// Flag to indicate this guard set the operation limit.
+  bool Active;
+
+public:
+  /// Limit the operations in @p Ctx to @p MaxOperations, 0 means unlimited.
+  /// If @p Independent is set, an enclosing limit is suspended.
+  PVMaxOperationsGuard(const PVCtx &Ctx, unsigned long MaxOperations,
+                       bool Independent = false);
+  ~PVMaxOperationsGuard();
+
+  /// Return true if this guard set the operation limit.
+  bool isActive() const { return Active; }
+
+  /// Return true if the operation limit was exceeded.
+  bool hasQuotaExceeded() const;
+
+  /// Return true if an isl operation failed, e.g., because the operation
+  /// limit was exceeded.
+  bool hasFailed() const;
+};
+
 
 class PVId : public PVBase {
   friend class PVAff;
@@ -120,6 +177,16 @@ public:
   friend struct PVLess<PVId>;
 };
 
+/// An affine constraint over parameters, thus
+///   Constant + sum(Coefficient * Parameter) >= 0
+/// or, for equalities,
+///   Constant + sum(Coefficient * Parameter) == 0.
+struct PVConstraint {
+  SmallVector<std::pair<PVId, int64_t>, 4> Terms;
+  int64_t Constant = 0;
+  bool IsEquality = false;
+};
+
 class PVSet : public PVBase {
   friend class PVAff;
   friend class PVMap;
@@ -207,6 +274,11 @@ public:
   PVSet &preimage(const PVAff &PWA);
   PVSet &projectParameter(const PVId &Id);
 
+  /// Return the minimum (maximum) value of the input dimension @p Dim as a
+  /// function of the parameters or a null PVAff if it is unbounded.
+  PVAff getDimMin(unsigned Dim) const;
+  PVAff getDimMax(unsigned Dim) const;
+
   PVSet &getNextIteration(unsigned Dim);
   PVSet &getNextIterations(unsigned Dim);
 
@@ -214,6 +286,14 @@ public:
   void getParameters(SmallVectorImpl<PVId> &Parameters) const;
   void getParameters(SmallVectorImpl<llvm::Value *> &Parameters) const;
 
+  /// Decompose this parameter set into a disjunction (@p Disjuncts) of
+  /// conjunctions of affine parameter constraints.
+  ///
+  /// @returns False if the set has dimensions, existentially quantified
+  ///          variables or coefficients that do not fit into 64 bit.
+  bool getParameterConstraints(
+      SmallVectorImpl<SmallVector<PVConstraint, 4>> &Disjuncts) const;
+
   static PVSet empty(const PVBase &Base);
   static PVSet empty(const PVBase &Base, unsigned Dims);
   static PVSet universe(const PVBase &Base);
@@ -275,10 +355,32 @@ public:
   /// @returns A reference to this object (*this).
   PVMap &intersectDomain(const PVSet &Dom);
 
+  /// Restrict the parameters to the values in the parameter set @p Params.
+  PVMap &intersectParams(const PVSet &Params);
+
   PVMap &intersect(const PVMap &Other);
 
   PVMap &addToOutputDimension(const PVMap &Other, unsigned Dim);
 
+  /// Swap the input and output dimensions of this map.
+  PVMap &reverse();
+
+  /// Compose this map with @p PM, thus (PM o this).
+  PVMap &applyRange(const PVMap &PM);
+
+  PVMap &addInputDims(unsigned Dims);
+  PVMap &dropInputDimsFrom(unsigned Dim);
+  PVMap &dropOutputDimsFrom(unsigned Dim);
+
+  /// Require input and output dimension @p Dim to be equal.
+  PVMap &equateInputAndOutputDim(unsigned Dim);
+
+  /// Require input dimension @p Dim to be less than output dimension @p Dim.
+  PVMap &orderInputBeforeOutputDim(unsigned Dim);
+
+  /// Return the set of differences between output and input dimensions.
+  PVSet getDeltas() const;
+
   int getParameterPosition(const PVId &Id) const;
   void eliminateParameter(unsigned Pos);
   void eliminateParameter(const PVId &Id);
@@ -435,6 +537,12 @@ public:
   PVAff &equateInputDim(unsigned Dim, const PVId &Id);
   PVAff &setInputLowerBound(unsigned Dim, int64_t Value);
 
+  /// Replace the parameters @p Ids by the values @p Values.
+  ///
+  /// This PVAff cannot have input dimensions. The result has as many input
+  /// dimensions as the value in @p Values with the most input dimensions.
+  PVAff &substituteParameters(ArrayRef<PVId> Ids, ArrayRef<PVAff> Values);
+
   PVAff &setInputId(const PVId &Id);
   PVAff &setOutputId(const PVId &Id);
 
@@ -446,7 +554,23 @@ public:
   PVSet zeroSet() const;
   PVSet nonZeroSet() const;
 
+  /// Return the set of values this function evaluates to, thus its image.
+  PVSet getValueSet() const;
+
+  /// Decompose this function into an affine expression of the parameters.
+  ///
+  /// @returns False if this function has input dimensions, multiple pieces or
+  ///          non-integral coefficients. Otherwise @p Expr contains the
+  ///          constant and the parameter terms, IsEquality is not used.
+  bool getParameterExpression(PVConstraint &Expr) const;
+
   PVAff getParameterCoeff(const PVId &Id);
+
+  /// Return the coefficient of the input dimension @p Dim as piece-wise
+  /// constant function on the domain of this function, or a null PVAff if it
+  /// is not an affine coefficient in all pieces.
+  PVAff getInputDimCoeff(unsigned Dim) const;
+
   PVAff perPiecePHIEvolution(const PVId &Id, int LD,
                              PVSet &NegationSet) const;
   PVAff moveOneIteration(unsigned Dim);
@@ -82,6 +82,7 @@ namespace llvm {
   FunctionPass *createPolyhedralValueInfoWrapperPass();
   FunctionPass *createPolyhedralAccessInfoWrapperPass();
   FunctionPass *createPolyhedralDependenceInfoWrapperPass();
+  ImmutablePass *createPolyhedralFunctionSummariesWrapperPass();
 
   // Print module-level debug info metadata in human-readable form.
   ModulePass *createModuleDebugInfoPrinterPass();
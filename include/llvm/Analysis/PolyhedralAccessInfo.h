@@ -12,10 +12,14 @@
 #ifndef POLYHEDRAL_ACCESS_INFO_H
 #define POLYHEDRAL_ACCESS_INFO_H
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Analysis/PValue.h"
+#include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/Analysis/PolyhedralUtils.h"
 
 #include <set>
@@ -38,8 +42,7 @@ public:
     AK_READ_WRITE, ///< Used for calls and intrinsics that have multiple effects.
   };
 
-  PACC(Value &Pointer, PEXP &PE, PVId Id, AccessKind AccKind);
-  ~PACC();
+  PACC(Instruction &Inst, Value &Pointer, PVId Id, AccessKind AccKind);
 
   const PEXP *getPEXP() const { return &PE; }
 
@@ -64,11 +67,12 @@ private:
 
   PVId Id;
 
-  ///
-  /// Note: The ownership of PE is with this PACC!
-  PEXP &PE;
+  /// The access function, owned by this PACC.
+  PEXP PE;
 
   AccessKind AccKind;
+
+  friend class PolyhedralAccessInfo;
 };
 
 /// Summary of PACCs in a certain code region (e.g., a Function).
@@ -112,6 +116,10 @@ public:
 
     DenseMap<const PACC *, PVMap> AccessMultiDimMap;
 
+    /// The accesses for which the multi-dimensional map is an
+    /// over-approximation, e.g., because parameters had to be eliminated.
+    SmallPtrSet<const PACC *, 4> MayAccesses;
+
     PVMap MayReadMap;
 
     PVMap MustReadMap;
@@ -240,7 +248,21 @@ class PolyhedralAccessInfo {
 
   PolyhedralExpressionBuilder &PEBuilder;
 
-  DenseMap<Instruction *, PACC *> AccessMap;
+  /// Mapping from scoped instructions to their polyhedral access.
+  using AccessMapKey = std::pair<Instruction *, Loop *>;
+  DenseMap<AccessMapKey, PACC *> AccessMap;
+
+  /// Arena for the PACCs in the AccessMap and the destroyed ones in
+  /// FreePACCs, whose memory is reused for new accesses.
+  BumpPtrAllocator PACCAllocator;
+  SmallVector<PACC *, 8> FreePACCs;
+
+  /// Allocate a new PACC in the arena.
+  PACC *createPACC(Instruction &Inst, Value &Pointer, PVId Id,
+                   PACC::AccessKind AccKind);
+
+  /// Destroy @p PA and reuse its memory for new accesses.
+  void destroyPACC(PACC *PA);
 
   const PACC *getAsAccess(Instruction &Inst, Value &Pointer, bool IsWrite, Loop *Scope = nullptr);
 
@@ -248,11 +270,37 @@ public:
   /// Constructor
   PolyhedralAccessInfo(PolyhedralValueInfo &PI, LoopInfo &LI);
 
+  PolyhedralAccessInfo(PolyhedralAccessInfo &&PAI)
+      : PI(PAI.PI), LI(PAI.LI), PEBuilder(PAI.PEBuilder),
+        AccessMap(std::move(PAI.AccessMap)),
+        PACCAllocator(std::move(PAI.PACCAllocator)),
+        FreePACCs(std::move(PAI.FreePACCs)) {
+    PAI.AccessMap.clear();
+    PAI.FreePACCs.clear();
+  }
+
   ~PolyhedralAccessInfo();
 
   /// Clear all cached information.
   void releaseMemory();
 
+  /// Forget all cached accesses in the loop nest rooted at @p L as well as the
+  /// polyhedral values they are build from, e.g., because the loop nest is
+  /// going to be transformed.
+  void forgetLoop(const Loop &L);
+
+  /// Forget all cached accesses, and the polyhedral values, that refer to one
+  /// of the @p Values or @p Loops. Only the pointers are compared, thus this
+  /// can be used after a transformation deleted some of them.
+  void forget(const SmallPtrSetImpl<const Value *> &Values,
+              const SmallPtrSetImpl<const Loop *> &Loops);
+
+  /// Handle invalidation events in the new pass manager. The accesses are kept
+  /// if the analysis was preserved explicitly and the underlying polyhedral
+  /// value info is kept as well.
+  bool invalidate(Function &F, const PreservedAnalyses &PA,
+                  FunctionAnalysisManager::Invalidator &Inv);
+
   PolyhedralValueInfo &getPolyhedralValueInfo() { return PI; }
 
   const PACC *getAsAccess(LoadInst *LI, Loop *Scope = nullptr);
@@ -268,6 +316,14 @@ public:
   PACCSummary *getAccessSummary(Function &F,
                                 PACCSummary::SummaryScopeKind Kind);
 
+  /// Summarize the accesses of @p F through its pointer arguments in the
+  /// compact form stored in the module summary index, one entry per pointer
+  /// argument. Arguments that may be captured are read and written anywhere.
+  ///
+  /// @returns False if not all accesses of @p F are known.
+  bool getParamAccesses(Function &F,
+                        std::vector<FunctionSummary::ParamAccess> &ParamAccesses);
+
   void extractComputations(Function &F);
   void detectKnownComputations(Function &F);
 
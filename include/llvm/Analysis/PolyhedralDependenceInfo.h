@@ -7,11 +7,20 @@
 //
 //===----------------------------------------------------------------------===//
 //
+// Memory based dependence analysis on top of the polyhedral access summaries
+// (PACCSummary). For each pair of accesses to the same array the analysis
+// computes the iterations that touch the same element, splits them by the
+// loop level that carries the dependence and derives the dependence distances
+// for all loops common to both accesses.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef POLYHEDRAL_DEPENDENCE_INFO_H
 #define POLYHEDRAL_DEPENDENCE_INFO_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
@@ -21,10 +30,19 @@ namespace llvm {
 
 class Loop;
 class LoopInfo;
+class PACC;
+class PACCSummary;
 class PolyhedralValueInfo;
 class PolyhedralAccessInfo;
 
 /// Representation of a polyhedral dependence.
+///
+/// A dependence connects a source access (Src) with a target access (Tgt) that
+/// touches the same memory later in the execution, at least one of them being
+/// a write. The dependence is expressed for the loops common to both accesses,
+/// starting at the root of the analyzed loop nest (level 1). Each dependence is
+/// carried by exactly one level, or it is loop independent (level 0) in which
+/// case the source precedes the target in one iteration of the common loops.
 class PDEP {
 public:
 
@@ -34,6 +52,73 @@ public:
     DK_WAW,
   };
 
+  /// The direction of a dependence at one level, in terms of the sign of the
+  /// (target - source) distance.
+  enum DirectionKind {
+    /// The distance is zero.
+    DIR_EQ,
+    /// The distance is positive.
+    DIR_LT,
+    /// The distance is negative.
+    DIR_GT,
+    /// The distance is unknown or has a different sign for different
+    /// iterations or parameter values.
+    DIR_ALL,
+  };
+
+  PDEP(const PACC &Src, const PACC &Tgt, DependenceKind DepKind,
+       unsigned Level, const PVMap &DepMap, const PVSet &DistanceSet,
+       bool IsLexicallyForward, bool IsExact);
+
+  /// Return the source and target access of this dependence.
+  ///{
+  const PACC *getSource() const { return &Src; }
+  const PACC *getTarget() const { return &Tgt; }
+  ///}
+
+  /// Return the kind of this dependence.
+  DependenceKind getKind() const { return DepKind; }
+
+  /// Return true if the dependence relation is not over-approximated.
+  bool isExact() const { return IsExact; }
+
+  /// Return true if the source precedes the target in one iteration of the
+  /// common loops, thus if the order is kept when iterations are executed in
+  /// lock-step.
+  bool isLexicallyForward() const { return IsLexicallyForward; }
+
+  /// Return the level carrying this dependence, or 0 if it is loop
+  /// independent.
+  unsigned getLevel() const { return Level; }
+
+  /// Return true if this dependence is not carried by any loop.
+  bool isLoopIndependent() const { return Level == 0; }
+
+  /// Return the number of loops common to the source and the target.
+  unsigned getNumCommonLevels() const {
+    return DistanceSet.getNumInputDimensions();
+  }
+
+  /// Return the map from source to target iterations.
+  const PVMap &getDependenceMap() const { return DepMap; }
+
+  /// Return the set of (target - source) distance vectors of the common loops.
+  const PVSet &getDistanceSet() const { return DistanceSet; }
+
+  /// Return the minimal/maximal distance at @p Level (starting at 1), or a
+  /// null PVAff if the distance is unbounded in that direction.
+  ///{
+  PVAff getMinDistance(unsigned Level) const;
+  PVAff getMaxDistance(unsigned Level) const;
+  ///}
+
+  /// Return the distance at @p Level if it is a fixed (possibly parametric)
+  /// value, otherwise a null PVAff.
+  PVAff getDistance(unsigned Level) const;
+
+  /// Return the direction of the dependence at @p Level (starting at 1).
+  DirectionKind getDirection(unsigned Level) const;
+
   /// Print this polyhedral representation to @p OS.
   void print(raw_ostream &OS) const;
 
@@ -42,29 +127,151 @@ public:
 
 private:
 
-  bool IsExact;
+  const PACC &Src;
+  const PACC &Tgt;
 
   DependenceKind DepKind;
+
+  unsigned Level;
+
+  /// The map from source iterations to target iterations.
+  PVMap DepMap;
+
+  /// The distance vectors for all common loops.
+  PVSet DistanceSet;
+
+  bool IsLexicallyForward;
+
+  bool IsExact;
 };
 
 class PolyhedralDependenceInfo {
+public:
+  /// The dependences between the accesses in a loop nest.
+  struct LoopDependences {
+    ~LoopDependences();
 
+    /// The access summary the dependences are derived from.
+    PACCSummary *PS = nullptr;
+
+    /// The number of loops surrounding the loop nest. They are the leading
+    /// input dimensions of the access maps in PS.
+    unsigned NumOuterLoops = 0;
+
+    /// Flag to indicate the loop contains accesses we cannot describe, thus
+    /// the dependences are incomplete.
+    bool HasUnknownAccesses = false;
+
+    /// The parameter values for which an access function or iteration domain
+    /// in the loop is not exactly described, e.g., because a zero extended
+    /// value would be negative. The dependences and everything derived from
+    /// them only hold for parameter values outside of this set.
+    PVSet InvalidContext;
+
+    /// Pairs of distinct base pointers that are accessed in the loop, written
+    /// at least once, and that might alias. Dependences between accesses to
+    /// different base pointers are not part of the Dependences vector.
+    SmallVector<std::pair<Value *, Value *>, 4> MayAliasBasePointers;
+
+    /// The dependences between accesses to the same base pointer.
+    SmallVector<PDEP *, 8> Dependences;
+  };
+
+  /// The strides of an access in the innermost dimension of the accessed
+  /// (delinearized) array.
+  struct AccessStride {
+    const PACC *PA;
+
+    /// The size of the accessed elements in bytes.
+    uint64_t ElementSize;
+
+    /// The byte stride of the access in the innermost array dimension for the
+    /// loops surrounding it, starting at the root of the loop nest. Strides
+    /// that are not constant are None, the vector is empty if the access
+    /// function is not exactly known.
+    SmallVector<Optional<int64_t>, 4> Strides;
+  };
+
+private:
   /// The PolyhedralAccessInfo used to get access information.
   PolyhedralAccessInfo &PAI;
 
   LoopInfo &LI;
 
+  /// Mapping from loop nest roots to the dependences in them.
+  DenseMap<const Loop *, LoopDependences *> LoopDependenceMap;
+
+  /// Compute the dependences for the loop nest rooted at @p L.
+  LoopDependences *computeDependences(Loop &L);
+
 public:
   /// Constructor
   PolyhedralDependenceInfo(PolyhedralAccessInfo &PAI, LoopInfo &LI);
 
+  PolyhedralDependenceInfo(PolyhedralDependenceInfo &&PDI)
+      : PAI(PDI.PAI), LI(PDI.LI),
+        LoopDependenceMap(std::move(PDI.LoopDependenceMap)) {
+    PDI.LoopDependenceMap.clear();
+  }
+
   ~PolyhedralDependenceInfo();
 
+  /// Return the dependences in the loop nest rooted at @p L.
+  const LoopDependences &getDependences(Loop &L);
+
+  /// Return true if the dependences in the loop nest rooted at @p L are known
+  /// completely and hold for all parameter values, thus if there are no
+  /// unknown accesses, no possibly aliasing base pointers and the invalid
+  /// context is empty.
+  bool hasExactDependences(Loop &L);
+
+  /// Collect the innermost dimension strides of all accesses in the loop nest
+  /// rooted at @p L in @p Strides. The strides of accesses that are not exactly
+  /// described for all parameter values are left empty.
+  ///
+  /// @returns False if the loop nest contains accesses we cannot describe.
+  bool getInnermostDimStrides(Loop &L, SmallVectorImpl<AccessStride> &Strides);
+
+  /// Compute the number of consecutive iterations of the innermost loop @p L
+  /// that can be executed in lock-step without violating a dependence.
+  ///
+  /// @param SafeWidth Set to the minimal distance of the dependences that
+  ///                  restrict lock-step execution, as a piece-wise function of
+  ///                  the parameters. It is undefined for parameter values
+  ///                  that do not induce such a dependence and null if there
+  ///                  is no restriction at all. Parameter values in the invalid
+  ///                  context of the dependences are not considered.
+  ///
+  /// @returns False if the dependences of @p L are not completely known.
+  bool getParametricSafeVectorWidth(Loop &L, PVAff &SafeWidth);
+
+  /// Return the parameter values for which the execution of @p VF consecutive
+  /// iterations of the innermost loop @p L in lock-step violates a dependence,
+  /// including the invalid context of the dependences. Returns a null set if
+  /// the dependences of @p L are not completely known.
+  PVSet getUnsafeVectorWidthCondition(Loop &L, unsigned VF);
+
+  /// Return the maximal number of consecutive iterations of the innermost loop
+  /// @p L that can be executed in lock-step without violating a dependence.
+  /// Returns 1 if no such number greater one is known and UINT_MAX if there is
+  /// no limit.
+  unsigned getMaxSafeVectorWidth(Loop &L);
+
   bool isVectorizableLoop(llvm::Loop &L);
 
+  /// Forget the dependences of all loop nests that contain or are contained in
+  /// @p L as well as the underlying access and value information, e.g., before
+  /// @p L is transformed.
+  void forgetLoop(const Loop &L);
+
   /// Clear all cached information.
   void releaseMemory();
 
+  /// Handle invalidation events in the new pass manager. The dependences are
+  /// kept only if they and the access info they are based on are preserved.
+  bool invalidate(Function &F, const PreservedAnalyses &PA,
+                  FunctionAnalysisManager::Invalidator &Inv);
+
   /// Print some statistics to @p OS.
   void print(raw_ostream &OS) const;
   void dump() const;
@@ -77,7 +284,8 @@ class PolyhedralDependenceInfoWrapperPass : public FunctionPass {
 
 public:
   static char ID;
-  PolyhedralDependenceInfoWrapperPass() : FunctionPass(ID) {}
+  PolyhedralDependenceInfoWrapperPass()
+      : FunctionPass(ID), PDI(nullptr), F(nullptr) {}
 
   /// Return the PolyhedralDependenceInfo object for the current function.
   PolyhedralDependenceInfo &getPolyhedralDependenceInfo() {
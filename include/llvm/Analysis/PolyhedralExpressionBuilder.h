@@ -12,8 +12,10 @@
 #ifndef POLYHEDRAL_EXPRESSION_BUILDER_H
 #define POLYHEDRAL_EXPRESSION_BUILDER_H
 
+#include "llvm/Analysis/PolyhedralStats.h"
 #include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/Support/Allocator.h"
 
 namespace llvm {
 
@@ -37,11 +39,43 @@ class PolyhedralValueInfoCache final {
   /// Mapping from parameter values to their unique id.
   DenseMap<Value *, PVId> ParameterMap;
 
+  /// Arena for all PEXPs of this cache, they are freed with the cache.
+  BumpPtrAllocator PEXPAllocator;
+
+  /// PEXPs that were forgotten but might still be referenced, e.g., by a query
+  /// in progress. They are recycled by recycleForgottenPEXPs.
+  SmallVector<PEXP *, 16> ForgottenPEXPs;
+
+  /// Destroyed PEXPs in the arena whose memory is reused for new ones.
+  SmallVector<PEXP *, 16> FreePEXPs;
+
+  /// The number of PEXPs allocated in the arena and the number of times the
+  /// memory of a forgotten one was reused.
+  unsigned NumAllocatedPEXPs = 0;
+  unsigned NumRecycledPEXPs = 0;
+
+  /// Allocate a new PEXP for @p V in @p Scope in the arena.
+  PEXP *createPEXP(Value *V, Loop *Scope) {
+    if (!FreePEXPs.empty()) {
+      NumRecycledPEXPs++;
+      return new (FreePEXPs.pop_back_val()) PEXP(V, Scope);
+    }
+    NumAllocatedPEXPs++;
+    return new (PEXPAllocator.Allocate<PEXP>()) PEXP(V, Scope);
+  }
+
+  /// Forget @p PE, it is recycled once no query is in progress.
+  void forgetPEXP(PEXP *PE) {
+    if (PE)
+      ForgottenPEXPs.push_back(PE);
+  }
+
   /// Return or create and cache a PEXP for @p BB in @p Scope.
   PEXP *getOrCreateDomain(BasicBlock &BB, Loop *Scope) {
     auto *&PE = DomainMap[{&BB, Scope}];
+    PolyhedralStats::recordCacheLookup(PolyhedralStats::AK_VALUE, PE);
     if (!PE)
-      PE = new PEXP(&BB, Scope);
+      PE = createPEXP(&BB, Scope);
 
     // Verify the internal state
     assert(PE == lookup(BB, Scope));
@@ -51,8 +85,9 @@ class PolyhedralValueInfoCache final {
   /// Return or create and cache a PEXP for @p V in @p Scope.
   PEXP *getOrCreatePEXP(Value &V, Loop *Scope) {
     auto *&PE = ValueMap[{&V, Scope}];
+    PolyhedralStats::recordCacheLookup(PolyhedralStats::AK_VALUE, PE);
     if (!PE)
-      PE = new PEXP(&V, Scope);
+      PE = createPEXP(&V, Scope);
 
     // Verify the internal state
     assert(PE == lookup(V, Scope));
@@ -62,8 +97,9 @@ class PolyhedralValueInfoCache final {
   /// Create or return a PEXP for the backedge taken count of @p L in @p Scope.
   PEXP *getOrCreateBackedgeTakenCount(const Loop &L, Loop *Scope) {
     auto *&PE = LoopMap[{&L, Scope}];
+    PolyhedralStats::recordCacheLookup(PolyhedralStats::AK_VALUE, PE);
     if (!PE)
-      PE = new PEXP(L.getHeader(), Scope);
+      PE = createPEXP(L.getHeader(), Scope);
 
     // Verify the internal state
     assert(PE == lookup(L, Scope));
@@ -80,6 +116,9 @@ class PolyhedralValueInfoCache final {
 public:
   ~PolyhedralValueInfoCache();
 
+  /// Print the number of allocated PEXPs and the memory used by this cache.
+  void printAllocationStatistics(raw_ostream &OS) const;
+
   /// Return the cached polyhedral representation of @p V in @p Scope, if any.
   PEXP *lookup(Value &V, Loop *Scope) { return ValueMap.lookup({&V, Scope}); }
 
@@ -94,15 +133,46 @@ public:
   }
 
   /// Forget the value for @p BB in @p Scope. Returns true if there was one.
+  /// The PEXP itself stays valid until recycleForgottenPEXPs is called.
   bool forget(BasicBlock &BB, Loop *Scope) {
-    return DomainMap.erase({&BB, Scope});
+    auto It = DomainMap.find({&BB, Scope});
+    if (It == DomainMap.end())
+      return false;
+    forgetPEXP(It->second);
+    DomainMap.erase(It);
+    return true;
   }
 
   /// Forget the value for @p V in @p Scope. Returns true if there was one.
+  /// The PEXP itself stays valid until recycleForgottenPEXPs is called.
   bool forget(Value &V, Loop *Scope) {
-    return ValueMap.erase({&V, Scope});
+    auto It = ValueMap.find({&V, Scope});
+    if (It == ValueMap.end())
+      return false;
+    forgetPEXP(It->second);
+    ValueMap.erase(It);
+    return true;
   }
 
+  /// Destroy the forgotten PEXPs and reuse their memory for new ones. This
+  /// must not be called while a query is in progress or a forgotten PEXP is
+  /// still referenced.
+  void recycleForgottenPEXPs();
+
+  /// Forget all cached values, domains, backedge taken counts and parameters
+  /// that refer to one of the @p Values or @p Loops, either as key or as
+  /// parameter of the cached PEXP. Only the pointers are compared, thus the
+  /// values and loops may have been deleted already. The PEXPs themselves stay
+  /// valid until recycleForgottenPEXPs is called.
+  ///
+  /// @returns The number of forgotten cache entries.
+  unsigned forget(const SmallPtrSetImpl<const Value *> &Values,
+                  const SmallPtrSetImpl<const Loop *> &Loops);
+
+  /// Return true if @p PE is parametric in one of the @p Values.
+  static bool isParametricIn(const PEXP &PE,
+                             const SmallPtrSetImpl<const Value *> &Values);
+
   /// Iterators for polyhedral representation of values.
   ///{
   using iterator = decltype(ValueMap)::iterator;
@@ -144,9 +214,24 @@ class PolyhedralExpressionBuilder
 
   Loop *Scope;
 
-  PolyhedralValueInfo &PI;
+  /// The polyhedral value info this builder belongs to. It is updated when
+  /// the owning PolyhedralValueInfo is moved, e.g., into an analysis manager.
+  PolyhedralValueInfo *PI;
   PolyhedralValueInfoCache PIC;
 
+  /// Flag to indicate that PEXPs initialized in the current query are tracked.
+  bool TrackQueryPEXPs;
+
+  /// The PEXPs initialized during the current (bounded) query.
+  SmallVector<PEXP *, 32> QueryPEXPs;
+
+  /// Remember @p PE if it is going to be initialized in the current query.
+  PEXP *trackQueryPEXP(PEXP *PE) {
+    if (TrackQueryPEXPs && !PE->isInitialized())
+      QueryPEXPs.push_back(PE);
+    return PE;
+  }
+
   PEXP *visit(Constant &I);
   PEXP *visit(ConstantInt &I);
   PEXP *visitParameter(Value &V);
@@ -157,7 +242,7 @@ class PolyhedralExpressionBuilder
   PVAff getOne(const PVAff &RefPWA) { return PVAff(RefPWA.getDomain(), 1); }
 
   PEXP *getOrCreatePEXP(Value &V) {
-    PEXP *PE = PIC.getOrCreatePEXP(V, Scope);
+    PEXP *PE = trackQueryPEXP(PIC.getOrCreatePEXP(V, Scope));
     assert(PE && PIC.lookup(V, Scope));
     assert(PE->getScope() == Scope && PE->getValue() == &V);
 
@@ -165,7 +250,7 @@ class PolyhedralExpressionBuilder
     auto *I = dyn_cast<Instruction>(&V);
     Loop *OuterScope = Scope ? Scope->getParentLoop() : nullptr;
     while (!I || (OuterScope && !OuterScope->contains(I))) {
-      PEXP *OuterPE = PIC.getOrCreatePEXP(V, OuterScope);
+      PEXP *OuterPE = trackQueryPEXP(PIC.getOrCreatePEXP(V, OuterScope));
 
       // If we found an initialized value we will not find an uninitialized one
       // later.
@@ -186,14 +271,14 @@ class PolyhedralExpressionBuilder
   }
 
   PEXP *getOrCreateDomain(BasicBlock &BB) {
-    PEXP *PE = PIC.getOrCreateDomain(BB, Scope);
+    PEXP *PE = trackQueryPEXP(PIC.getOrCreateDomain(BB, Scope));
     assert(PE && PIC.lookup(BB, Scope));
     assert(PE->getScope() == Scope && PE->getValue() == &BB);
 
     // Initialize the PEXP for this block for other scopes as well.
     Loop *OuterScope = Scope ? Scope->getParentLoop() : nullptr;
     while (OuterScope && OuterScope->contains(&BB)) {
-      PEXP *OuterPE = PIC.getOrCreateDomain(BB, OuterScope);
+      PEXP *OuterPE = trackQueryPEXP(PIC.getOrCreateDomain(BB, OuterScope));
 
       // If we found an initialized value we will not find an uninitialized one
       // later.
@@ -251,7 +336,19 @@ class PolyhedralExpressionBuilder
 
 public:
   PolyhedralExpressionBuilder(PolyhedralValueInfo &PI)
-      : Scope(nullptr), PI(PI) {}
+      : Scope(nullptr), PI(&PI), TrackQueryPEXPs(false) {}
+
+  /// Make @p NewPI the polyhedral value info this builder belongs to.
+  void setPolyhedralValueInfo(PolyhedralValueInfo &NewPI) { PI = &NewPI; }
+
+  /// Track all PEXPs initialized from now on until finishQueryTracking() is
+  /// called.
+  void startQueryTracking();
+
+  /// Stop tracking initialized PEXPs. If @p Invalidate is set, all PEXPs
+  /// initialized since startQueryTracking() are invalidated, e.g., because
+  /// they were build from incomplete isl objects.
+  void finishQueryTracking(bool Invalidate);
 
   PolyhedralValueInfoCache& getPolyhedralValueInfoCache() { return PIC; }
   const PolyhedralValueInfoCache &getPolyhedralValueInfoCache() const {
@@ -275,7 +372,7 @@ public:
 
   PEXP *getBackedgeTakenCount(const Loop &L);
 
-  PVId getParameterId(Value &V) { return PIC.getParameterId(V, PI.getCtx()); }
+  PVId getParameterId(Value &V) { return PIC.getParameterId(V, PI->getCtx()); }
 
   PEXP *getTerminatorPEXP(BasicBlock &BB);
 
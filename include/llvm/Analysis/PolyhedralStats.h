@@ -0,0 +1,85 @@
+//===--- PolyhedralStats.h --- Cost of the polyhedral analyses --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Counters and timers describing the cost of the polyhedral value, access and
+// dependence analyses: queries, cache hit rates, isl operations, pieces per
+// polyhedral expression and wall time. They are collected if -polyhedral-stats
+// is given (or collection is enabled programmatically) and printed together
+// with the other statistics when LLVM is shut down.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef POLYHEDRAL_STATS_H
+#define POLYHEDRAL_STATS_H
+
+#include "llvm/Support/Timer.h"
+
+#include <cstddef>
+
+namespace llvm {
+
+class PVCtx;
+class raw_ostream;
+
+class PolyhedralStats {
+public:
+  /// The analyses statistics are collected for.
+  enum AnalysisKind {
+    AK_VALUE,
+    AK_ACCESS,
+    AK_DEPENDENCE,
+    AK_NUM_ANALYSES,
+  };
+
+  /// Accumulate the wall time and the isl operations of a query to the
+  /// analysis @p Kind while the object is alive. Only the outermost query of
+  /// each analysis is measured, the cost of an analysis includes the cost of
+  /// the analyses it uses.
+  class Query {
+    AnalysisKind Kind;
+    const PVCtx *Ctx;
+
+    /// Flag to indicate this is the outermost query of the analysis.
+    bool Active;
+
+    TimeRecord StartTime;
+    unsigned long StartOperations;
+
+  public:
+    Query(AnalysisKind Kind, const PVCtx &Ctx);
+    ~Query();
+  };
+
+  /// Return true if statistics are collected.
+  static bool isEnabled();
+
+  /// Enable or disable the collection of statistics, e.g., in tools.
+  static void setEnabled(bool Enabled);
+
+  /// Record a lookup in the cache of the analysis @p Kind.
+  static void recordCacheLookup(AnalysisKind Kind, bool Hit);
+
+  /// Record a polyhedral expression with @p NumPieces pieces.
+  static void recordPieces(size_t NumPieces);
+
+  /// Return the accumulated wall time of the analysis @p Kind in seconds.
+  static double getWallTime(AnalysisKind Kind);
+
+  /// Return the accumulated isl operations of the analysis @p Kind.
+  static unsigned long getNumOperations(AnalysisKind Kind);
+
+  /// Print the collected statistics to @p OS.
+  static void print(raw_ostream &OS);
+
+  /// Reset all counters and timers.
+  static void reset();
+};
+
+} // namespace llvm
+#endif
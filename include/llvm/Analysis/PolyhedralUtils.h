@@ -13,10 +13,26 @@
 #define POLYHEDRAL_UTILS_H
 
 #include "llvm/Analysis/PValue.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/IntrinsicInst.h"
 
 namespace llvm {
 
+class Loop;
+
+/// Return true if buildParameterSetCondition can generate code for @p Set.
+///
+/// If @p L is given, all parameters involved in @p Set also need to be
+/// invariant in @p L.
+bool canBuildParameterSetCondition(const PVSet &Set, const Loop *L = nullptr);
+
+/// Generate code at the insertion point of @p Builder that evaluates to true
+/// iff the values of the parameters are contained in the parameter set @p Set.
+///
+/// @returns The i1 condition or nullptr if canBuildParameterSetCondition(Set)
+///          does not hold.
+Value *buildParameterSetCondition(IRBuilder<> &Builder, const PVSet &Set);
+
 template<typename PVType, bool UseGlobalIdx = false>
 struct NVVMRewriter : public PVRewriter<PVType> {
   enum NVVMDim {
@@ -24,15 +24,19 @@
 #define POLYHEDRAL_VALUE_INFO_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/PValue.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Pass.h"
 
 namespace llvm {
 
 class Region;
 class PolyhedralValueInfo;
 class PolyhedralExpressionBuilder;
+class PolyhedralFunctionSummaries;
 
 /// Polyhedral representation of a value (incl. basic block) defined in a scope
 /// and evaluated at a certain program point. The values are expressed with
@@ -199,13 +203,15 @@ private:
 
   friend class PolyhedralValueInfo;
   friend class PolyhedralExpressionBuilder;
+  friend class PolyhedralFunctionSummaries;
 };
 
 
 /// Analysis to create polyhedral abstractions for values, instructions and
 /// iteration domains.
 class PolyhedralValueInfo {
-  /// The (shared) context in which the polyhedral values are build.
+  /// The (shared) context in which the polyhedral values are build. It is
+  /// the first member, thus the last one destroyed.
   PVCtx Ctx;
 
   /// The loop information for the function we are currently analyzing.
@@ -214,15 +220,17 @@ class PolyhedralValueInfo {
   /// The polyhedral expression builder.
   PolyhedralExpressionBuilder *PEBuilder;
 
+  /// The module level summaries used to analyze calls, if any.
+  PolyhedralFunctionSummaries *PFS;
+
   friend class PolyhedralExpressionBuilder;
 
 public:
   /// Constructor
-  PolyhedralValueInfo(PVCtx Ctx, LoopInfo &LI);
-  PolyhedralValueInfo(PolyhedralValueInfo &&PVI)
-      : Ctx(PVI.Ctx), LI(PVI.LI), PEBuilder(PVI.PEBuilder) {
-    PVI.PEBuilder = nullptr;
-  };
+  PolyhedralValueInfo(PVCtx Ctx, LoopInfo &LI,
+                      PolyhedralFunctionSummaries *PFS = nullptr);
+
+  PolyhedralValueInfo(PolyhedralValueInfo &&PVI);
 
   ~PolyhedralValueInfo();
 
@@ -344,13 +352,39 @@ public:
   bool isKnownToHold(Value *LHS, Value *RHS, ICmpInst::Predicate Pred,
                      Instruction *IP = nullptr, Loop *Scope = nullptr);
 
+  /// Collect the loops as well as the basic blocks and instructions of the
+  /// loop nest rooted at @p L, its predecessor and its exit blocks in @p Loops
+  /// and @p Values.
+  static void collectLoopNest(const Loop &L,
+                              SmallPtrSetImpl<const Value *> &Values,
+                              SmallPtrSetImpl<const Loop *> &Loops);
+
+  /// Forget all cached information about the loop nest rooted at @p L, e.g.,
+  /// because it is going to be transformed.
+  void forgetLoop(const Loop &L);
+
+  /// Forget all cached information that refers to one of the @p Values or
+  /// @p Loops. Only the pointers are compared, thus this can be used after a
+  /// transformation deleted some of them, if they were collected before.
+  void forget(const SmallPtrSetImpl<const Value *> &Values,
+              const SmallPtrSetImpl<const Loop *> &Loops);
+
+  /// Handle invalidation events in the new pass manager. The information is
+  /// kept if the analysis was preserved explicitly, which requires the
+  /// transformation to forget what it changed, and the loop info is valid.
+  bool invalidate(Function &F, const PreservedAnalyses &PA,
+                  FunctionAnalysisManager::Invalidator &Inv);
+
+  /// Print the number of allocated PEXPs and the cache size to @p OS.
+  void printAllocationStatistics(raw_ostream &OS) const;
+
   /// Print some statistics to @p OS.
   void print(raw_ostream &OS) const;
 };
 
 /// Wrapper pass for PolyhedralValueInfo on a per-function basis.
 class PolyhedralValueInfoWrapperPass : public FunctionPass {
-  /// The (shared) context in which the polyhedral values are build.
+  /// The context shared by the analyses of all functions this pass is run on.
   PVCtx Ctx;
 
   PolyhedralValueInfo *PI;
@@ -360,6 +394,7 @@ public:
   static char ID;
   PolyhedralValueInfoWrapperPass()
       : FunctionPass(ID), PI(nullptr), F(nullptr) {}
+  ~PolyhedralValueInfoWrapperPass() override;
 
   /// Return the PolyhedralValueInfo object for the current function.
   PolyhedralValueInfo &getPolyhedralValueInfo() {
@@ -384,7 +419,8 @@ class PolyhedralValueInfoAnalysis
   friend AnalysisInfoMixin<PolyhedralValueInfoAnalysis>;
   static AnalysisKey Key;
 
-  /// The (shared) context in which the polyhedral values are build.
+  /// The context shared by the results for all functions in the analysis
+  /// manager. The analysis outlives its results, thus the context as well.
   PVCtx Ctx;
 
 public:
@@ -395,6 +431,99 @@ public:
   Result run(Function &F, FunctionAnalysisManager &AM);
 };
 
+/// Module level cache of polyhedral function summaries.
+///
+/// The summary of a function is the polyhedral representation of its return
+/// value for the maximal (function) scope, expressed only in terms of the
+/// function arguments. Such a summary stays valid as long as the function
+/// exists, independent of the transformations applied to its body, and it
+/// allows to evaluate calls in the polyhedral value analysis of the caller.
+/// Summaries are computed on demand, once per function.
+///
+/// The summaries are only used if -pvi-function-summaries is given. In the new
+/// pass manager the module analysis has to be computed before the function
+/// analyses that use it, e.g., with require<polyhedral-function-summaries>,
+/// which the default optimization pipeline does if the summaries are enabled.
+class PolyhedralFunctionSummaries {
+  /// The summary of a single function.
+  struct FunctionSummary {
+    FunctionSummary(Function &F) : F(&F), ReturnPE(nullptr) {}
+    ~FunctionSummary();
+
+    /// The summarized function, reset if the function is deleted.
+    WeakVH F;
+
+    /// The return value in terms of the arguments of F, if known.
+    PEXP *ReturnPE;
+  };
+
+  /// The context the summaries are build in. Polyhedral value analyses that
+  /// use the summaries have to share it.
+  PVCtx Ctx;
+
+  /// Mapping from functions to their summaries.
+  DenseMap<const Function *, FunctionSummary *> SummaryMap;
+
+  /// Compute the summary of the return value of @p F.
+  PEXP *computeReturnPEXP(Function &F);
+
+public:
+  PolyhedralFunctionSummaries() {}
+  PolyhedralFunctionSummaries(PolyhedralFunctionSummaries &&PFS)
+      : Ctx(PFS.Ctx), SummaryMap(std::move(PFS.SummaryMap)) {
+    PFS.SummaryMap.clear();
+  }
+  ~PolyhedralFunctionSummaries();
+
+  /// Return true if the polyhedral value analysis uses function summaries.
+  static bool isEnabled();
+
+  /// Return the context the summaries are build in.
+  const PVCtx &getCtx() const { return Ctx; }
+
+  /// Return the polyhedral representation of the return value of @p F in
+  /// terms of the arguments of @p F, or nullptr if it is not known.
+  const PEXP *getReturnPEXP(Function &F);
+
+  /// Forget all summaries.
+  void releaseMemory();
+
+  /// Print the summaries to @p OS.
+  void print(raw_ostream &OS) const;
+};
+
+/// Immutable wrapper pass for the PolyhedralFunctionSummaries, thus they
+/// persist for the lifetime of the pass manager.
+class PolyhedralFunctionSummariesWrapperPass : public ImmutablePass {
+  PolyhedralFunctionSummaries PFS;
+
+public:
+  static char ID;
+  PolyhedralFunctionSummariesWrapperPass();
+
+  /// Return the function summaries.
+  PolyhedralFunctionSummaries &getSummaries() { return PFS; }
+
+  virtual void print(raw_ostream &OS, const Module *) const override;
+};
+
+/// Analysis wrapper for the PolyhedralFunctionSummaries in the new pass
+/// manager.
+class PolyhedralFunctionSummariesAnalysis
+    : public AnalysisInfoMixin<PolyhedralFunctionSummariesAnalysis> {
+  friend AnalysisInfoMixin<PolyhedralFunctionSummariesAnalysis>;
+  static AnalysisKey Key;
+
+public:
+  struct Result : public PolyhedralFunctionSummaries {
+    /// Handle invalidation events in the new pass manager.
+    bool invalidate(Module &M, const PreservedAnalyses &PA,
+                    ModuleAnalysisManager::Invalidator &);
+  };
+
+  Result run(Module &M, ModuleAnalysisManager &AM);
+};
+
 /// Stream operators to pretty print polyhedral expressions (PEXP)
 ///
 ///{
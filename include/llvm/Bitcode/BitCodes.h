@@ -32,6 +32,18 @@ static const unsigned BWH_SizeField = 3 * 4;
 static const unsigned BWH_CPUTypeField = 4 * 4;
 static const unsigned BWH_HeaderSize = 5 * 4;
 
+/// Offsets of the fields of the compressed bitcode header, which is followed
+/// by a table of the uncompressed and stored 32-bit sizes of the segments.
+static const unsigned BCZ_MagicField = 0;
+static const unsigned BCZ_CodecField = 4;
+static const unsigned BCZ_SizeField = 8;
+static const unsigned BCZ_NumSegmentsField = 16;
+static const unsigned BCZ_HeaderSize = 20;
+static const unsigned BCZ_SegmentEntrySize = 8;
+
+/// The codecs of compressed bitcode.
+enum BitcodeCompressionCodec { BCZ_LZ4 = 1 };
+
 namespace bitc {
   enum StandardWidths {
     BlockIDWidth   = 8,  // We use VBR-8 for block IDs.
@@ -23,12 +23,15 @@
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <vector>
 namespace llvm {
 
+class BitstreamByteProvider;
 class LLVMContext;
 class Module;
 
@@ -53,6 +56,37 @@ class Module;
     bool HasSummary;
   };
 
+  /// A thread-safe cache of the context-independent data decoded when a
+  /// bitcode module is lazily loaded for ThinLTO importing: the metadata
+  /// strings, the positions of the module-level metadata records and the
+  /// abbreviations needed to read them. Backends importing into different
+  /// contexts can share a cache, so a module that many others import from is
+  /// indexed once rather than once per importing module. The cached data
+  /// refers to the bitcode buffers, which must outlive the cache.
+  class BitcodeImportCache {
+  public:
+    struct MetadataIndex;
+
+    BitcodeImportCache();
+    ~BitcodeImportCache();
+
+    /// Return the index of the metadata block starting at bit \p BitNo of
+    /// \p Buffer, or null if it is not cached yet.
+    std::shared_ptr<const MetadataIndex> lookup(const uint8_t *Buffer,
+                                                uint64_t BitNo);
+
+    /// Cache \p Index for the metadata block starting at bit \p BitNo of
+    /// \p Buffer.
+    void insert(const uint8_t *Buffer, uint64_t BitNo,
+                std::shared_ptr<const MetadataIndex> Index);
+
+  private:
+    std::mutex Mutex;
+    std::map<std::pair<const uint8_t *, uint64_t>,
+             std::shared_ptr<const MetadataIndex>>
+        MetadataIndexes;
+  };
+
   /// Represents a module in a bitcode file.
   class BitcodeModule {
     // This covers the identification (if present) and module blocks.
@@ -68,19 +102,32 @@ class Module;
     // The bitstream location of this module's MODULE_BLOCK.
     uint64_t ModuleBit;
 
+    // Decompresses the bytes of Buffer on demand if the bitcode file is
+    // compressed, owns them and keeps them alive as long as any reader.
+    std::shared_ptr<BitstreamByteProvider> ByteProvider;
+
     BitcodeModule(ArrayRef<uint8_t> Buffer, StringRef ModuleIdentifier,
-                  uint64_t IdentificationBit, uint64_t ModuleBit)
+                  uint64_t IdentificationBit, uint64_t ModuleBit,
+                  std::shared_ptr<BitstreamByteProvider> ByteProvider)
         : Buffer(Buffer), ModuleIdentifier(ModuleIdentifier),
-          IdentificationBit(IdentificationBit), ModuleBit(ModuleBit) {}
+          IdentificationBit(IdentificationBit), ModuleBit(ModuleBit),
+          ByteProvider(std::move(ByteProvider)) {}
 
     // Calls the ctor.
     friend Expected<BitcodeFileContents>
     getBitcodeFileContents(MemoryBufferRef Buffer);
 
-    Expected<std::unique_ptr<Module>> getModuleImpl(LLVMContext &Context,
-                                                    bool MaterializeAll,
-                                                    bool ShouldLazyLoadMetadata,
-                                                    bool IsImporting);
+    // Calls getSummaryImpl.
+    friend Expected<std::unique_ptr<ModuleSummaryIndex>>
+    getLazyModuleSummaryIndex(std::unique_ptr<MemoryBuffer> Buffer);
+
+    Expected<std::unique_ptr<ModuleSummaryIndex>>
+    getSummaryImpl(std::unique_ptr<MemoryBuffer> LazyBuffer);
+
+    Expected<std::unique_ptr<Module>>
+    getModuleImpl(LLVMContext &Context, bool MaterializeAll,
+                  bool ShouldLazyLoadMetadata, bool IsImporting,
+                  BitcodeImportCache *ImportCache = nullptr);
 
   public:
     StringRef getBuffer() const {
@@ -94,10 +141,11 @@ class Module;
     /// Read the bitcode module and prepare for lazy deserialization of function
     /// bodies. If ShouldLazyLoadMetadata is true, lazily load metadata as well.
     /// If IsImporting is true, this module is being parsed for ThinLTO
-    /// importing into another module.
-    Expected<std::unique_ptr<Module>> getLazyModule(LLVMContext &Context,
-                                                    bool ShouldLazyLoadMetadata,
-                                                    bool IsImporting);
+    /// importing into another module, and ImportCache, if not null, is used
+    /// to share the decoded metadata index with other importing modules.
+    Expected<std::unique_ptr<Module>>
+    getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
+                  bool IsImporting, BitcodeImportCache *ImportCache = nullptr);
 
     /// Read the entire bitcode module and return it.
     Expected<std::unique_ptr<Module>> parseModule(LLVMContext &Context);
@@ -148,6 +196,15 @@ class Module;
       std::unique_ptr<MemoryBuffer> &&Buffer, LLVMContext &Context,
       bool ShouldLazyLoadMetadata = false, bool IsImporting = false);
 
+  /// Like getLazyBitcodeModule, except that the context takes ownership of the
+  /// memory buffer, also on error, and the metadata strings read from it refer
+  /// to their characters in the buffer instead of copying them. This avoids
+  /// copying the strings of large debug information up front, in particular
+  /// for memory mapped files. The buffer lives as long as the context.
+  Expected<std::unique_ptr<Module>> getContextOwnedLazyBitcodeModule(
+      std::unique_ptr<MemoryBuffer> Buffer, LLVMContext &Context,
+      bool ShouldLazyLoadMetadata = false, bool IsImporting = false);
+
   /// Read the header of the specified bitcode buffer and extract just the
   /// triple information. If successful, this returns a string. On error, this
   /// returns "".
@@ -186,6 +243,20 @@ class Module;
   getModuleSummaryIndexForFile(StringRef Path,
                                bool IgnoreEmptyThinLTOIndexFile = false);
 
+  /// Parse the specified bitcode buffer, returning the module summary index.
+  /// If the buffer holds a combined index with an index of the summaries,
+  /// the summaries are decoded on first use and the returned index keeps the
+  /// buffer alive.
+  Expected<std::unique_ptr<ModuleSummaryIndex>>
+  getLazyModuleSummaryIndex(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// Like getModuleSummaryIndexForFile, but the summaries of a combined index
+  /// are decoded lazily from the memory mapped file, see
+  /// getLazyModuleSummaryIndex.
+  Expected<std::unique_ptr<ModuleSummaryIndex>>
+  getLazyModuleSummaryIndexForFile(StringRef Path,
+                                   bool IgnoreEmptyThinLTOIndexFile = false);
+
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
   inline bool isBitcodeWrapper(const unsigned char *BufPtr,
@@ -212,12 +283,24 @@ class Module;
            BufPtr[3] == 0xde;
   }
 
+  /// isCompressedBitcode - Return true if the given bytes are the magic bytes
+  /// of a compressed bitcode container, see compressBitcode.
+  inline bool isCompressedBitcode(const unsigned char *BufPtr,
+                                  const unsigned char *BufEnd) {
+    return BufEnd - BufPtr >= 4 &&
+           BufPtr[0] == 'B' &&
+           BufPtr[1] == 'C' &&
+           BufPtr[2] == 'L' &&
+           BufPtr[3] == 'Z';
+  }
+
   /// isBitcode - Return true if the given bytes are the magic bytes for
-  /// LLVM IR bitcode, either with or without a wrapper.
+  /// LLVM IR bitcode, either with or without a wrapper, or compressed.
   inline bool isBitcode(const unsigned char *BufPtr,
                         const unsigned char *BufEnd) {
     return isBitcodeWrapper(BufPtr, BufEnd) ||
-           isRawBitcode(BufPtr, BufEnd);
+           isRawBitcode(BufPtr, BufEnd) ||
+           isCompressedBitcode(BufPtr, BufEnd);
   }
 
   /// SkipBitcodeWrapperHeader - Some systems wrap bc files with a special
@@ -152,6 +152,30 @@ class raw_ostream;
                         const std::map<std::string, GVSummaryMapTy>
                             *ModuleToSummariesForIndex = nullptr);
 
+  /// Compress the bitcode file \p Bitcode into \p Buffer. The result is read
+  /// like bitcode by the bitcode reader, and also lazily: the bitcode is cut
+  /// into segments that are compressed independently and decompressed when
+  /// they are first read. Each large block nested in a module block, such as
+  /// a function, metadata or summary block, is a segment of its own, the rest
+  /// is grouped into segments of moderate size. The container consists of:
+  ///
+  /// struct bcz_header {
+  ///   char Magic[4];           // "BCLZ"
+  ///   uint32_t Codec;          // The compression codec, 1 for LZ4.
+  ///   uint64_t Size;           // The size of the bitcode.
+  ///   uint32_t NumSegments;
+  ///   struct {
+  ///     uint32_t Size;         // The size of the segment.
+  ///     uint32_t StoredSize;   // The size of the compressed segment, or the
+  ///                            // size of the segment if it is stored as is.
+  ///   } Segments[NumSegments];
+  /// };
+  ///
+  /// followed by the stored segments, all in little endian. Bitcode that is
+  /// compressed already is copied as is. The bitcode files written by this
+  /// library are compressed with -compress-bitcode.
+  void compressBitcode(StringRef Bitcode, SmallVectorImpl<char> &Buffer);
+
 } // end namespace llvm
 
 #endif // LLVM_BITCODE_BITCODEWRITER_H
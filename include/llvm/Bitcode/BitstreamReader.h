@@ -75,6 +75,21 @@ public:
   }
 };
 
+/// Provides the bytes of a bitstream that are not available up front, e.g.
+/// because they are decompressed on demand. The cursors reading the bitstream
+/// ask for the bytes they are about to read if they are outside of the range
+/// of bytes made available last.
+class BitstreamByteProvider {
+public:
+  virtual ~BitstreamByteProvider();
+
+  /// Make the bytes [\p Begin, \p End) available and return a range of
+  /// available bytes that contains them. This may be called by several
+  /// threads at once.
+  virtual std::pair<const uint8_t *, const uint8_t *>
+  makeAvailable(const uint8_t *Begin, const uint8_t *End) = 0;
+};
+
 /// This represents a position within a bitstream. There may be multiple
 /// independent cursors reading within one bitstream, each maintaining their
 /// own local state.
@@ -82,6 +97,13 @@ class SimpleBitstreamCursor {
   ArrayRef<uint8_t> BitcodeBytes;
   size_t NextChar = 0;
 
+  /// Provides the bytes on demand if not null.
+  BitstreamByteProvider *ByteProvider = nullptr;
+
+  /// The bytes that can be read without asking ByteProvider.
+  const uint8_t *AvailableBegin = nullptr;
+  const uint8_t *AvailableEnd = nullptr;
+
 public:
   /// This is the current data we have pulled from the stream but have not
   /// returned to the client. This is specifically and intentionally defined to
@@ -102,10 +124,21 @@ public:
 
   SimpleBitstreamCursor() = default;
   explicit SimpleBitstreamCursor(ArrayRef<uint8_t> BitcodeBytes)
-      : BitcodeBytes(BitcodeBytes) {}
+      : BitcodeBytes(BitcodeBytes), AvailableBegin(BitcodeBytes.begin()),
+        AvailableEnd(BitcodeBytes.end()) {}
   explicit SimpleBitstreamCursor(StringRef BitcodeBytes)
-      : BitcodeBytes(reinterpret_cast<const uint8_t *>(BitcodeBytes.data()),
-                     BitcodeBytes.size()) {}
+      : SimpleBitstreamCursor(ArrayRef<uint8_t>(
+            reinterpret_cast<const uint8_t *>(BitcodeBytes.data()),
+            BitcodeBytes.size())) {}
+  /// Read \p BitcodeBytes, which \p ByteProvider makes available on demand.
+  SimpleBitstreamCursor(ArrayRef<uint8_t> BitcodeBytes,
+                        BitstreamByteProvider *ByteProvider)
+      : BitcodeBytes(BitcodeBytes), ByteProvider(ByteProvider) {
+    if (!ByteProvider) {
+      AvailableBegin = BitcodeBytes.begin();
+      AvailableEnd = BitcodeBytes.end();
+    }
+  }
   explicit SimpleBitstreamCursor(MemoryBufferRef BitcodeBytes)
       : SimpleBitstreamCursor(BitcodeBytes.getBuffer()) {}
 
@@ -128,6 +161,8 @@ public:
 
   ArrayRef<uint8_t> getBitcodeBytes() const { return BitcodeBytes; }
 
+  BitstreamByteProvider *getByteProvider() const { return ByteProvider; }
+
   /// Reset the stream to the specified bit number.
   void JumpToBit(uint64_t BitNo) {
     size_t ByteNo = size_t(BitNo/8) & ~(sizeof(word_t)-1);
@@ -145,7 +180,18 @@ public:
 
   /// Get a pointer into the bitstream at the specified byte offset.
   const uint8_t *getPointerToByte(uint64_t ByteNo, uint64_t NumBytes) {
-    return BitcodeBytes.data() + ByteNo;
+    const uint8_t *Ptr = BitcodeBytes.data() + ByteNo;
+    makeAvailable(Ptr, NumBytes);
+    return Ptr;
+  }
+
+  /// Make sure that \p NumBytes bytes at \p Ptr can be read.
+  void makeAvailable(const uint8_t *Ptr, uint64_t NumBytes) {
+    if (LLVM_LIKELY(Ptr >= AvailableBegin && Ptr + NumBytes <= AvailableEnd))
+      return;
+    assert(ByteProvider && "Reading outside of the bitstream");
+    std::tie(AvailableBegin, AvailableEnd) =
+        ByteProvider->makeAvailable(Ptr, Ptr + NumBytes);
   }
 
   /// Get a pointer into the bitstream at the specified bit offset.
@@ -162,15 +208,16 @@ public:
 
     // Read the next word from the stream.
     const uint8_t *NextCharPtr = BitcodeBytes.data() + NextChar;
-    unsigned BytesRead;
-    if (BitcodeBytes.size() >= NextChar + sizeof(word_t)) {
-      BytesRead = sizeof(word_t);
+    unsigned BytesRead = BitcodeBytes.size() >= NextChar + sizeof(word_t)
+                             ? sizeof(word_t)
+                             : BitcodeBytes.size() - NextChar;
+    makeAvailable(NextCharPtr, BytesRead);
+    if (BytesRead == sizeof(word_t)) {
       CurWord =
           support::endian::read<word_t, support::little, support::unaligned>(
               NextCharPtr);
     } else {
       // Short read.
-      BytesRead = BitcodeBytes.size() - NextChar;
       CurWord = 0;
       for (unsigned B = 0; B != BytesRead; ++B)
         CurWord |= uint64_t(NextCharPtr[B]) << (B * 8);
@@ -335,6 +382,9 @@ public:
   BitstreamCursor() = default;
   explicit BitstreamCursor(ArrayRef<uint8_t> BitcodeBytes)
       : SimpleBitstreamCursor(BitcodeBytes) {}
+  BitstreamCursor(ArrayRef<uint8_t> BitcodeBytes,
+                  BitstreamByteProvider *ByteProvider)
+      : SimpleBitstreamCursor(BitcodeBytes, ByteProvider) {}
   explicit BitstreamCursor(StringRef BitcodeBytes)
       : SimpleBitstreamCursor(BitcodeBytes) {}
   explicit BitstreamCursor(MemoryBufferRef BitcodeBytes)
@@ -343,6 +393,7 @@ public:
   using SimpleBitstreamCursor::canSkipToPos;
   using SimpleBitstreamCursor::AtEndOfStream;
   using SimpleBitstreamCursor::getBitcodeBytes;
+  using SimpleBitstreamCursor::getByteProvider;
   using SimpleBitstreamCursor::GetCurrentBitNo;
   using SimpleBitstreamCursor::getCurrentByteNo;
   using SimpleBitstreamCursor::getPointerToByte;
@@ -477,6 +528,18 @@ public:
     return CurAbbrevs[AbbrevNo].get();
   }
 
+  /// Return the abbreviations installed in the current block.
+  ArrayRef<std::shared_ptr<BitCodeAbbrev>> getAbbrevs() const {
+    return CurAbbrevs;
+  }
+
+  /// Install \p Abbrevs in the current block, replacing the ones read so far.
+  /// This allows jumping to any record of a block that another cursor already
+  /// scanned to its end.
+  void setAbbrevs(ArrayRef<std::shared_ptr<BitCodeAbbrev>> Abbrevs) {
+    CurAbbrevs.assign(Abbrevs.begin(), Abbrevs.end());
+  }
+
   /// Read the current record and discard it, returning the code for the record.
   unsigned skipRecord(unsigned AbbrevID);
 
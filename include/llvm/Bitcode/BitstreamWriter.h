@@ -248,6 +248,21 @@ public:
     BlockScope.pop_back();
   }
 
+  /// Emit a block whose contents were written by another BitstreamWriter with
+  /// the same block info. \p Contents starts at the size word that follows
+  /// the header of the block and ends after its END_BLOCK. Past the header a
+  /// block is word aligned and independent of its position and of the
+  /// enclosing block, thus the contents are copied as they are.
+  void EmitBlockContents(unsigned BlockID, unsigned CodeLen,
+                         ArrayRef<char> Contents) {
+    assert(Contents.size() % 4 == 0 && "Not 32-bit aligned");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Out.append(Contents.begin(), Contents.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
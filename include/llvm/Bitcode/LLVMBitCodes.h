@@ -256,6 +256,22 @@ enum GlobalValueSummarySymtabCodes {
   // strings in strtab.
   // [n * name]
   FS_CFI_FUNCTION_DECLS = 18,
+  // The accesses through the pointer arguments of the following function.
+  // Bounds are only present if the respective flag is set, signed values are
+  // sign rotated.
+  // [n x (argno, flags, [constant, numterms, numterms x (argno, coeff)],
+  //                     [constant, numterms, numterms x (argno, coeff)])]
+  FS_PARAM_ACCESSES = 19,
+  // The offset of the FS_COMBINED_INDEX record relative to the end of this
+  // record, split into the low and high 32 bits.
+  // [offset]
+  FS_COMBINED_INDEX_OFFSET = 20,
+  // The position of each summary entry in a combined index, including the
+  // preceding type and access records, to decode the summaries on demand. The
+  // positions are delta encoded, starting at the end of the
+  // FS_COMBINED_INDEX_OFFSET record.
+  // [n x (valueid, modid, bitpos)]
+  FS_COMBINED_INDEX = 21,
 };
 
 enum MetadataCodes {
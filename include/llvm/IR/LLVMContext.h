@@ -30,6 +30,7 @@ enum DiagnosticSeverity : char;
 class Function;
 class Instruction;
 class LLVMContextImpl;
+class MemoryBuffer;
 class Module;
 class OptBisect;
 template <typename T> class SmallVectorImpl;
@@ -318,6 +319,16 @@ public:
   /// \brief Access the object which manages optimization bisection for failure
   /// analysis.
   OptBisect &getOptBisect();
+
+  /// \brief Keep \p Buffer alive as long as the context.
+  ///
+  /// The IR of the context, such as the strings created by
+  /// MDString::getExternal, may then refer to the contents of the buffer.
+  void retainBuffer(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// \brief Return true if the memory of \p Data belongs to a buffer passed
+  /// to retainBuffer.
+  bool isInRetainedBuffer(StringRef Data) const;
 private:
   // Module needs access to the add/removeModule methods.
   friend class Module;
@@ -600,23 +600,42 @@ dyn_extract_or_null(Y &&MD) {
 /// These are used to efficiently contain a byte sequence for metadata.
 /// MDString is always unnamed.
 class MDString : public Metadata {
-  friend class StringMapEntry<MDString>;
+  /// The characters of the string, the length is in SubclassData32. They are
+  /// allocated by the context together with the MDString, or belong to a
+  /// buffer retained by the context for strings created by getExternal.
+  const char *Data;
 
-  StringMapEntry<MDString> *Entry = nullptr;
+  MDString(const char *Data, unsigned Length)
+      : Metadata(MDStringKind, Uniqued), Data(Data) {
+    SubclassData32 = Length;
+  }
 
-  MDString() : Metadata(MDStringKind, Uniqued) {}
+  static MDString *getImpl(LLVMContext &Context, StringRef Str,
+                           bool CopyString);
 
 public:
   MDString(const MDString &) = delete;
   MDString &operator=(MDString &&) = delete;
   MDString &operator=(const MDString &) = delete;
 
-  static MDString *get(LLVMContext &Context, StringRef Str);
+  static MDString *get(LLVMContext &Context, StringRef Str) {
+    return getImpl(Context, Str, /* CopyString */ true);
+  }
   static MDString *get(LLVMContext &Context, const char *Str) {
     return get(Context, Str ? StringRef(Str) : StringRef());
   }
 
-  StringRef getString() const;
+  /// \brief Get the string without copying its characters.
+  ///
+  /// If the string does not exist yet, the new MDString refers to the
+  /// characters of \p Str, which have to live as long as \p Context, e.g. in
+  /// a buffer passed to LLVMContext::retainBuffer. Unlike the characters of
+  /// the strings created by get, they are not followed by a null character.
+  static MDString *getExternal(LLVMContext &Context, StringRef Str) {
+    return getImpl(Context, Str, /* CopyString */ false);
+  }
+
+  StringRef getString() const { return StringRef(Data, SubclassData32); }
 
   unsigned getLength() const { return (unsigned)getString().size(); }
 
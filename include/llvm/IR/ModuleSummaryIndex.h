@@ -68,6 +68,24 @@ class GlobalValueSummary;
 
 using GlobalValueSummaryList = std::vector<std::unique_ptr<GlobalValueSummary>>;
 
+/// Decodes the summaries of a lazily read summary index on first use. Loading
+/// modifies the index, it is not safe to access a lazily read index from
+/// several threads.
+class GlobalValueSummaryLoader {
+public:
+  virtual ~GlobalValueSummaryLoader() = default;
+
+  /// Decode the summaries of the value \p GUID.
+  virtual void loadSummaries(GlobalValue::GUID GUID) = 0;
+
+  /// Decode the summaries of all values which have a summary in the module
+  /// \p ModulePath.
+  virtual void loadModuleSummaries(StringRef ModulePath) = 0;
+
+  /// Decode all summaries which are not yet loaded.
+  virtual void loadAllSummaries() = 0;
+};
+
 struct GlobalValueSummaryInfo {
   /// The GlobalValue corresponding to this summary. This is only used in
   /// per-module summaries.
@@ -77,6 +95,10 @@ struct GlobalValueSummaryInfo {
   /// in the GlobalValueMap. Requires a vector in the case of multiple
   /// COMDAT values of the same name.
   GlobalValueSummaryList SummaryList;
+
+  /// The loader of the summaries in a lazily read index, null once they are
+  /// loaded.
+  GlobalValueSummaryLoader *Loader = nullptr;
 };
 
 /// Map from global value GUID to corresponding summary structures. Use a
@@ -102,6 +124,8 @@ struct ValueInfo {
   const GlobalValue *getValue() const { return Ref->second.GV; }
 
   ArrayRef<std::unique_ptr<GlobalValueSummary>> getSummaryList() const {
+    if (Ref->second.Loader)
+      Ref->second.Loader->loadSummaries(getGUID());
     return Ref->second.SummaryList;
   }
 };
@@ -331,6 +355,47 @@ public:
     unsigned ReadOnly : 1;
     unsigned NoRecurse : 1;
     unsigned ReturnDoesNotAlias : 1;
+    unsigned NoUnwind : 1;
+    /// Properties of the function body ignoring the calls recorded as call
+    /// graph edges. These allow to infer the attributes above on the combined
+    /// call graph of all modules during the thin link.
+    ///{
+    unsigned BodyReadNone : 1;
+    unsigned BodyReadOnly : 1;
+    unsigned BodyNoUnwind : 1;
+    /// Set if every call in the body is either to an intrinsic or recorded as
+    /// a call graph edge, thus there are no indirect or inline assembly calls.
+    unsigned NoUnknownCalls : 1;
+    ///}
+  };
+
+  /// The memory accessed by a function through one of its pointer arguments,
+  /// thus by loads and stores based on the argument. This is a compact form
+  /// of the polyhedral access summary of the function which allows to reason
+  /// about the argument accesses without the function body, e.g., to mark
+  /// arguments that are not written in the thin link.
+  struct ParamAccess {
+    /// An affine function of the integer arguments of the function, given as
+    /// constant and (argument number, coefficient) pairs.
+    struct AffineBound {
+      int64_t Constant = 0;
+      std::vector<std::pair<uint64_t, int64_t>> Terms;
+    };
+
+    /// The number of the pointer argument.
+    uint64_t ArgNo = 0;
+
+    /// Flags to indicate the argument is read or written.
+    bool IsRead = false;
+    bool IsWritten = false;
+
+    /// The first and the last accessed byte relative to the argument, only
+    /// valid if the respective flag is set.
+    ///{
+    bool HasLowerBound = false;
+    bool HasUpperBound = false;
+    AffineBound LowerBound, UpperBound;
+    ///}
   };
 
 private:
@@ -366,6 +431,11 @@ private:
 
   std::unique_ptr<TypeIdInfo> TIdInfo;
 
+  /// The accesses through the pointer arguments, one for each pointer
+  /// argument, if they are completely known. As type identifier related
+  /// information we only allocate space for them if necessary.
+  std::unique_ptr<std::vector<ParamAccess>> ParamAccesses;
+
 public:
   FunctionSummary(GVFlags Flags, unsigned NumInsts, FFlags FunFlags,
                   std::vector<ValueInfo> Refs, std::vector<EdgeTy> CGEdges,
@@ -452,6 +522,33 @@ public:
       TIdInfo = llvm::make_unique<TypeIdInfo>();
     TIdInfo->TypeTests.push_back(Guid);
   }
+
+  /// Return the accesses through the pointer arguments of this function. The
+  /// list is empty if they are not known, otherwise it contains an entry for
+  /// each pointer argument.
+  ArrayRef<ParamAccess> param_accesses() const {
+    if (ParamAccesses)
+      return *ParamAccesses;
+    return {};
+  }
+
+  /// Return the accesses through the pointer argument @p ArgNo or nullptr if
+  /// they are not known.
+  const ParamAccess *getParamAccess(uint64_t ArgNo) const {
+    for (const ParamAccess &PA : param_accesses())
+      if (PA.ArgNo == ArgNo)
+        return &PA;
+    return nullptr;
+  }
+
+  /// Set the accesses through the pointer arguments of this function.
+  void setParamAccesses(std::vector<ParamAccess> NewParamAccesses) {
+    if (NewParamAccesses.empty())
+      ParamAccesses.reset();
+    else
+      ParamAccesses = llvm::make_unique<std::vector<ParamAccess>>(
+          std::move(NewParamAccesses));
+  }
 };
 
 template <> struct DenseMapInfo<FunctionSummary::VFuncId> {
@@ -622,6 +719,9 @@ private:
   std::set<std::string> CfiFunctionDefs;
   std::set<std::string> CfiFunctionDecls;
 
+  /// The loader of the summaries if the index is read lazily.
+  std::unique_ptr<GlobalValueSummaryLoader> SummaryLoader;
+
   // YAML I/O support.
   friend yaml::MappingTraits<ModuleSummaryIndex>;
 
@@ -631,8 +731,16 @@ private:
   }
 
 public:
-  gvsummary_iterator begin() { return GlobalValueMap.begin(); }
-  const_gvsummary_iterator begin() const { return GlobalValueMap.begin(); }
+  // Iterating the index requires all summaries, those of a lazily read index
+  // are loaded first.
+  gvsummary_iterator begin() {
+    loadAllSummaries();
+    return GlobalValueMap.begin();
+  }
+  const_gvsummary_iterator begin() const {
+    loadAllSummaries();
+    return GlobalValueMap.begin();
+  }
   gvsummary_iterator end() { return GlobalValueMap.end(); }
   const_gvsummary_iterator end() const { return GlobalValueMap.end(); }
   size_t size() const { return GlobalValueMap.size(); }
@@ -667,8 +775,32 @@ public:
     return ValueInfo(VP);
   }
 
+  /// Set the loader which decodes the summaries of a lazily read index.
+  void setSummaryLoader(std::unique_ptr<GlobalValueSummaryLoader> Loader) {
+    SummaryLoader = std::move(Loader);
+  }
+
+  /// Return true if the summaries are decoded on first use.
+  bool isLazy() const { return SummaryLoader != nullptr; }
+
+  /// Mark the summaries of \p GUID as not yet loaded by the summary loader of
+  /// the index if \p Pending is true, or as loaded otherwise.
+  void setSummariesPending(GlobalValue::GUID GUID, bool Pending) {
+    assert((!Pending || SummaryLoader) && "Expected a summary loader");
+    getOrInsertValuePtr(GUID)->second.Loader =
+        Pending ? SummaryLoader.get() : nullptr;
+  }
+
+  /// Load all summaries of a lazily read index.
+  void loadAllSummaries() const {
+    if (SummaryLoader)
+      SummaryLoader->loadAllSummaries();
+  }
+
   /// Return the GUID for \p OriginalId in the OidGuidMap.
   GlobalValue::GUID getGUIDFromOriginalID(GlobalValue::GUID OriginalID) const {
+    // The original names are only known for the loaded summaries.
+    loadAllSummaries();
     const auto I = OidGuidMap.find(OriginalID);
     return I == OidGuidMap.end() ? 0 : I->second;
   }
@@ -35,9 +35,12 @@ typedef std::function<void(unsigned Task, std::unique_ptr<MemoryBuffer> MB,
 
 /// Create a local file system cache which uses the given cache directory and
 /// file callback. This function also creates the cache directory if it does not
-/// already exist.
+/// already exist. If UseIndex is true, every hit and insertion is recorded in
+/// the index of the cache directory (see recordCacheAccess()), which lets
+/// pruneCache() prune it without walking the directory.
 Expected<NativeObjectCache> localCache(StringRef CacheDirectoryPath,
-                                       AddBufferFn AddBuffer);
+                                       AddBufferFn AddBuffer,
+                                       bool UseIndex = false);
 
 } // namespace lto
 } // namespace llvm
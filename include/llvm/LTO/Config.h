@@ -52,6 +52,13 @@ struct Config {
   /// Disable entirely the optimizer, including importing for ThinLTO
   bool CodeGenOnly = false;
 
+  /// If this field is nonzero, the regular LTO modules are parsed and their
+  /// symbol resolutions applied on this many threads, each module in its own
+  /// context. Only cloning them into the context of the combined module and
+  /// linking them stays serial. This holds all regular LTO modules in memory
+  /// at once.
+  unsigned RegularLTOLinkThreads = 0;
+
   /// If this field is set, the set of passes run in the middle-end optimizer
   /// will be the one specified by the string. Only works with the new pass
   /// manager as the old one doesn't have this ability.
@@ -79,6 +86,26 @@ struct Config {
   /// Whether to emit optimization remarks with hotness informations.
   bool RemarksWithHotness = false;
 
+  /// If this field is set, the in-process ThinLTO backend reads the measured
+  /// backend times of previous links from this file to start the most
+  /// expensive modules first, and records the times of this link in it.
+  std::string ThinLTOBackendTimesFile;
+
+  /// If this field is set, the import lists of the previous link are read
+  /// from this file, reused for the modules not affected by the changes
+  /// since, and the import lists of this link are written to it.
+  std::string ThinLTOImportListsFile;
+
+  /// If this field is set, the function attributes readnone, readonly,
+  /// nounwind and norecurse are propagated over the combined call graph in
+  /// the thin link and added to the functions in the ThinLTO backends.
+  bool ThinLTOPropagateFunctionAttrs = false;
+
+  /// If this field is set, the wall time, CPU time and peak memory of the
+  /// phases of the link and of each backend task are written to this file in
+  /// the trace event format of the Chrome trace viewer.
+  std::string PhaseReportFile;
+
   /// Whether to emit the pass manager debuggging informations.
   bool DebugPassManager = false;
 
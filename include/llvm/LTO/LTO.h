@@ -31,6 +31,9 @@
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
 
+#include <deque>
+#include <future>
+
 namespace llvm {
 
 class BitcodeModule;
@@ -38,6 +41,7 @@ class Error;
 class LLVMContext;
 class MemoryBufferRef;
 class Module;
+class ThreadPool;
 class Target;
 class raw_pwrite_stream;
 
@@ -77,6 +81,7 @@ setupOptimizationRemarks(LLVMContext &Context, StringRef LTORemarksFilename,
 
 class LTO;
 struct SymbolResolution;
+class PhaseReport;
 class ThinBackendProc;
 
 /// An input file. This is a symbol table wrapper that only exposes the
@@ -195,7 +200,7 @@ typedef std::function<AddStreamFn(unsigned Task, StringRef Key)>
 typedef std::function<std::unique_ptr<ThinBackendProc>(
     Config &C, ModuleSummaryIndex &CombinedIndex,
     StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
-    AddStreamFn AddStream, NativeObjectCache Cache)>
+    AddStreamFn AddStream, NativeObjectCache Cache, PhaseReport *Report)>
     ThinBackend;
 
 /// This ThinBackend runs the individual backend jobs in-process.
@@ -267,6 +272,9 @@ public:
 private:
   Config Conf;
 
+  /// The phases of the link, if Conf.PhaseReportFile is set.
+  std::unique_ptr<PhaseReport> Report;
+
   struct RegularLTOState {
     RegularLTOState(unsigned ParallelCodeGenParallelismLevel, Config &Conf);
     struct CommonResolution {
@@ -291,6 +299,23 @@ private:
       std::vector<GlobalValue *> Keep;
     };
     std::vector<AddedModule> ModsWithSummaries;
+
+    // A regular LTO module that is parsed on the link threads into its own
+    // context, see Config::RegularLTOLinkThreads.
+    struct ParsedModule {
+      std::unique_ptr<LTOLLVMContext> Ctx;
+      AddedModule Mod;
+      Optional<Error> Err;
+      std::shared_future<void> Done;
+    };
+    // The parsed modules without and with summaries, in the order of the
+    // inputs. The former are linked as soon as they are parsed, the latter
+    // after summary-based dead stripping.
+    std::deque<std::unique_ptr<ParsedModule>> ParsedMods;
+    std::deque<std::unique_ptr<ParsedModule>> ParsedModsWithSummaries;
+    // The inputs of the modules being parsed, which own their symbols.
+    std::vector<std::unique_ptr<InputFile>> ParsedInputs;
+    std::unique_ptr<ThreadPool> LinkThreadPool;
   } RegularLTO;
 
   struct ThinLTOState {
@@ -361,11 +386,20 @@ private:
   Error addModule(InputFile &Input, unsigned ModI,
                   const SymbolResolution *&ResI, const SymbolResolution *ResE);
 
+  void addRegularLTOCommons(ArrayRef<InputFile::Symbol> Syms,
+                            const SymbolResolution *ResI);
   Expected<RegularLTOState::AddedModule>
   addRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
-                const SymbolResolution *&ResI, const SymbolResolution *ResE);
+                const SymbolResolution *&ResI, const SymbolResolution *ResE,
+                LLVMContext &Ctx);
+  void parseRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
+                       ArrayRef<SymbolResolution> Res,
+                       RegularLTOState::ParsedModule &PM);
   Error linkRegularLTO(RegularLTOState::AddedModule Mod,
                        bool LivenessFromIndex);
+  Error linkParsedRegularLTO(RegularLTOState::ParsedModule &PM,
+                             bool LivenessFromIndex);
+  Error linkParsedModules(bool Wait);
 
   Error addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
                    const SymbolResolution *&ResI, const SymbolResolution *ResE);
@@ -27,6 +27,7 @@
 
 namespace llvm {
 
+class BitcodeImportCache;
 class BitcodeModule;
 class Error;
 class Module;
@@ -36,16 +37,24 @@ namespace lto {
 
 /// Runs a regular LTO backend. The regular LTO backend can also act as the
 /// regular LTO phase of ThinLTO, which may need to access the combined index.
+/// If Report is not null, the optimization and code generation phases are
+/// recorded in it.
 Error backend(Config &C, AddStreamFn AddStream,
               unsigned ParallelCodeGenParallelismLevel,
-              std::unique_ptr<Module> M, ModuleSummaryIndex &CombinedIndex);
+              std::unique_ptr<Module> M, ModuleSummaryIndex &CombinedIndex,
+              PhaseReport *Report = nullptr);
 
-/// Runs a ThinLTO backend.
+/// Runs a ThinLTO backend. If ImportCache is not null, the data decoded from
+/// the modules in ModuleMap for importing is shared through it with other
+/// backends. If Report is not null, the importing, optimization and code
+/// generation phases are recorded in it.
 Error thinBackend(Config &C, unsigned Task, AddStreamFn AddStream, Module &M,
                   const ModuleSummaryIndex &CombinedIndex,
                   const FunctionImporter::ImportMapTy &ImportList,
                   const GVSummaryMapTy &DefinedGlobals,
-                  MapVector<StringRef, BitcodeModule> &ModuleMap);
+                  MapVector<StringRef, BitcodeModule> &ModuleMap,
+                  BitcodeImportCache *ImportCache = nullptr,
+                  PhaseReport *Report = nullptr);
 }
 }
 
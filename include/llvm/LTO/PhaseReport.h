@@ -0,0 +1,96 @@
+//===-PhaseReport.h - LLVM Link Time Optimizer phase report ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the PhaseReport class, which records the wall time, CPU
+// time and peak memory of the phases of an LTO link and of its backend tasks.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LTO_PHASEREPORT_H
+#define LLVM_LTO_PHASEREPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class raw_ostream;
+
+namespace lto {
+
+/// Records the phases of an LTO link and writes them in the trace event format
+/// of the Chrome trace viewer (chrome://tracing). Each phase is a complete
+/// ("X") event on the thread of its task, with the CPU time of the thread
+/// running it, the peak resident set size of the process at its end and, for
+/// the ThinLTO backend tasks, whether the native object cache was hit.
+///
+/// Phases may be recorded concurrently from several threads.
+class PhaseReport {
+public:
+  /// Whether the native object of a backend task was found in the cache.
+  enum CacheStatus { NotCached, CacheHit, CacheMiss };
+
+  /// Measures a phase from its construction to its destruction. A phase
+  /// without a report does nothing, thus the phases can be instrumented
+  /// unconditionally.
+  class Phase {
+  public:
+    Phase(PhaseReport *Report, StringRef Name, unsigned Task = 0,
+          StringRef ModuleID = "");
+    ~Phase();
+
+    void setCacheStatus(CacheStatus Status) { Cache = Status; }
+
+  private:
+    PhaseReport *Report;
+    std::string Name;
+    std::string ModuleID;
+    unsigned Task;
+    CacheStatus Cache = NotCached;
+    std::chrono::steady_clock::time_point Start;
+    std::chrono::nanoseconds StartCPUTime;
+  };
+
+  PhaseReport();
+
+  /// Write the recorded phases as a JSON trace, ordered by start time.
+  void write(raw_ostream &OS) const;
+
+  /// Write the recorded phases to the file at \p Path.
+  Error writeToFile(StringRef Path) const;
+
+private:
+  struct Event {
+    std::string Name;
+    std::string ModuleID;
+    unsigned Task;
+    CacheStatus Cache;
+    /// Start and duration relative to the creation of the report.
+    std::chrono::microseconds Start;
+    std::chrono::microseconds Duration;
+    std::chrono::microseconds CPUTime;
+    size_t PeakMemory;
+  };
+
+  void addEvent(Event E);
+
+  std::chrono::steady_clock::time_point Start;
+  mutable std::mutex EventsMu;
+  std::vector<Event> Events;
+};
+
+} // end namespace lto
+} // end namespace llvm
+
+#endif
@@ -148,6 +148,7 @@ namespace {
       (void) llvm::createPolyhedralValueTransformerWrapperPass();
       (void) llvm::createPolyhedralAccessInfoWrapperPass();
       (void) llvm::createPolyhedralDependenceInfoWrapperPass();
+      (void) llvm::createPolyhedralFunctionSummariesWrapperPass();
       (void) llvm::createPostDomOnlyPrinterPass();
       (void) llvm::createPostDomPrinterPass();
       (void) llvm::createPostDomOnlyViewerPass();
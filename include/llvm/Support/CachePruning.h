@@ -56,6 +56,12 @@ struct CachePruningPolicy {
   /// systems have a limit on how many files can be contained in a directory
   /// (notably ext4, which is limited to around 6000000 files).
   uint64_t MaxSizeFiles = 1000000;
+
+  /// The interval between walks of the whole cache directory if it has an
+  /// index. Entries that are not recorded in the index, e.g., because they
+  /// were written without -cache-index, are only found and pruned by such a
+  /// walk. A value of 0 walks the directory on every pruning.
+  std::chrono::seconds IndexWalkInterval = std::chrono::hours(24);
 };
 
 /// Parse the given string as a cache pruning policy. Defaults are taken from a
@@ -68,11 +74,22 @@ Expected<CachePruningPolicy> parseCachePruningPolicy(StringRef PolicyStr);
 /// Peform pruning using the supplied policy, returns true if pruning
 /// occured, i.e. if Policy.Interval was expired.
 ///
+/// If the cache directory has an index (see recordCacheAccess()), the sizes
+/// and access times of the entries are taken from it instead of walking the
+/// directory and the index is compacted. Every Policy.IndexWalkInterval the
+/// directory is walked nevertheless and the entries missing from the index
+/// are added to it.
+///
 /// As a safeguard against data loss if the user specifies the wrong directory
 /// as their cache directory, this function will ignore files not matching the
 /// pattern "llvmcache-*".
 bool pruneCache(StringRef Path, CachePruningPolicy Policy);
 
+/// Record in the index of the cache directory \p Path that the entry
+/// \p EntryName of \p Size bytes was just added or used. The index is an
+/// append-only log, so concurrent processes can update it without locking.
+void recordCacheAccess(StringRef Path, StringRef EntryName, uint64_t Size);
+
 } // namespace llvm
 
 #endif
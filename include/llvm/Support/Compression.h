@@ -46,6 +46,25 @@ uint32_t crc32(StringRef Buffer);
 
 }  // End of namespace zlib
 
+/// A fast compressor in the LZ4 block format, bundled with LLVM. It trades
+/// compression ratio for speed, in particular for decompression, and needs no
+/// external library.
+namespace lz4 {
+
+/// Compress \p InputBuffer into \p CompressedBuffer.
+void compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer);
+
+/// Decompress \p InputBuffer into \p UncompressedBuffer, which has room for
+/// the \p UncompressedSize bytes \p InputBuffer has to decompress to.
+Error uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                 size_t UncompressedSize);
+
+Error uncompress(StringRef InputBuffer,
+                 SmallVectorImpl<char> &UncompressedBuffer,
+                 size_t UncompressedSize);
+
+}  // End of namespace lz4
+
 } // End of namespace llvm
 
 #endif
@@ -64,6 +64,15 @@ public:
                            std::chrono::nanoseconds &user_time,
                            std::chrono::nanoseconds &sys_time);
 
+  /// \brief Return the peak resident set size of the process in bytes, or 0 if
+  /// the operating system does not report it.
+  static size_t GetPeakMemoryUsage();
+
+  /// \brief Return the CPU time (user and system) spent by the calling thread,
+  /// or a zero duration if the operating system does not support collecting
+  /// it.
+  static std::chrono::nanoseconds GetThreadCPUTime();
+
   /// This function makes the necessary calls to the operating system to
   /// prevent core files or any other kind of large memory dumps that can
   /// occur when a program fails.
@@ -16,15 +16,19 @@
 #ifndef LLVM_TRANSFORMS_IPO_FUNCTIONATTRS_H
 #define LLVM_TRANSFORMS_IPO_FUNCTIONATTRS_H
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Analysis/CGSCCPassManager.h"
 #include "llvm/Analysis/LazyCallGraph.h"
+#include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/PassManager.h"
 
 namespace llvm {
 
 class AAResults;
 class Function;
+class GlobalValueSummary;
 class Module;
+class ModuleSummaryIndex;
 class Pass;
 
 /// The three kinds of memory access relevant to 'readonly' and
@@ -72,6 +76,26 @@ public:
   PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
 };
 
+/// Propagate the function attributes readnone, readonly, nounwind and
+/// norecurse bottom-up over the call graph of the combined summary \p Index.
+///
+/// Only the copy of a function for which \p isPrevailing returns true is
+/// considered, the attributes it ends up with are recorded in the flags of all
+/// its function summaries. A call to a function without prevailing summary or
+/// with a definition that can be replaced at link time is assumed to have none
+/// of the attributes.
+void thinLTOPropagateFunctionAttrs(
+    ModuleSummaryIndex &Index,
+    function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
+        isPrevailing);
+
+/// Add the function attributes recorded in the summary \p Index to the
+/// definitions and declarations in \p M. Pointer arguments that are not
+/// written according to the summarized parameter accesses of all copies of a
+/// function are marked readonly, or readnone if they are not accessed at all.
+/// Returns true if any function was changed.
+bool thinLTOApplyFunctionAttrs(Module &M, const ModuleSummaryIndex &Index);
+
 } // end namespace llvm
 
 #endif // LLVM_TRANSFORMS_IPO_FUNCTIONATTRS_H
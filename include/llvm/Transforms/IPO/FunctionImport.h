@@ -24,10 +24,12 @@
 #include <system_error>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
 class Module;
+class raw_ostream;
 
 /// The function importer is automatically importing function from other modules
 /// based on the provided summary informations.
@@ -72,6 +74,45 @@ public:
   PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
 };
 
+/// The import lists computed by a previous link, along with what they were
+/// computed from, so that an incremental link only recomputes the import lists
+/// that may be affected by the modules that changed since.
+struct ImportListCache {
+  /// What the import list of a module was computed from.
+  struct ModuleEntry {
+    /// The hash of the module.
+    ModuleHash Hash;
+    /// A hash of the liveness of the globals defined in the module.
+    uint64_t LiveHash = 0;
+    /// The modules with a summary for any of the callees examined.
+    std::vector<std::string> Dependencies;
+    /// The callees examined, including the original names looked up for
+    /// indirect calls.
+    std::vector<GlobalValue::GUID> Examined;
+    /// The import list of the module.
+    FunctionImporter::ImportMapTy ImportList;
+  };
+
+  /// The modules of the link in the order they were added to the index,
+  /// which determines the order of the summary lists.
+  std::vector<std::string> ModuleOrder;
+
+  /// The import options the import lists were computed with.
+  std::string Options;
+
+  StringMap<ModuleEntry> Modules;
+
+  /// The number of import lists reused and recomputed by the last call to
+  /// ComputeCrossModuleImport().
+  unsigned NumReused = 0;
+  unsigned NumComputed = 0;
+
+  /// Read a cache written by write(). A malformed cache reads as an empty one.
+  static ImportListCache read(StringRef Buffer);
+
+  void write(raw_ostream &OS) const;
+};
+
 /// Compute all the imports and exports for every module in the Index.
 ///
 /// \p ModuleToDefinedGVSummaries contains for each Module a map
@@ -84,11 +125,16 @@ public:
 /// \p ExportLists contains for each Module the set of globals (GUID) that will
 /// be imported by another module, or referenced by such a function. I.e. this
 /// is the set of globals that need to be promoted/renamed appropriately.
+///
+/// If \p Cache is not null, the import lists it holds are reused for the
+/// modules not affected by the changes since they were computed, and it is
+/// updated with the import lists of this link.
 void ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists);
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ImportListCache *Cache = nullptr);
 
 /// Compute all the imports for the given module using the Index.
 ///
@@ -40,6 +40,7 @@
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/PriorityWorklist.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/GlobalsModRef.h"
@@ -58,6 +59,8 @@ namespace llvm {
 
 // Forward declarations of an update tracking API used in the pass manager.
 class LPMUpdater;
+class PolyhedralAccessInfo;
+class PolyhedralValueInfo;
 
 // Explicit specialization and instantiation declarations for the pass manager.
 // See the comments on the definition of the specialization for details on how
@@ -134,6 +137,37 @@ inline void appendLoopsToWorklist(RangeT &&Loops,
     PreOrderLoops.clear();
   }
 }
+
+/// Helper to keep the polyhedral analyses in the loop pipeline up to date.
+///
+/// The polyhedral analyses are never computed for the loop passes but they are
+/// looked up in the function analysis manager in case they are cached. The
+/// adaptor passes its function analysis manager \p FAM and, if the analyses
+/// are cached, sets up the proxy through which the nested loop pass managers
+/// find them without \p FAM. The loop nest is recorded before a loop pass runs on it as the
+/// pass might delete parts of it. If the pass does not preserve the polyhedral
+/// analyses the information about the recorded loop nest is forgotten
+/// afterwards, which allows to preserve the remaining information.
+class PolyhedralLoopNestUpdater {
+  /// The cached polyhedral analyses of the function, if any.
+  PolyhedralValueInfo *PVI = nullptr;
+  PolyhedralAccessInfo *PAI = nullptr;
+
+  /// The blocks and instructions of the loop nest.
+  SmallPtrSet<const Value *, 32> Values;
+
+  /// The loops of the loop nest.
+  SmallPtrSet<const Loop *, 4> Loops;
+
+public:
+  PolyhedralLoopNestUpdater(Loop &L, LoopAnalysisManager &AM,
+                            LoopStandardAnalysisResults &AR,
+                            const FunctionAnalysisManager *FAM = nullptr);
+
+  /// Forget the recorded loop nest unless \p PA preserves the polyhedral
+  /// analyses, and mark them as preserved in \p PA afterwards.
+  void update(PreservedAnalyses &PA);
+};
 }
 
 template <typename LoopPassT> class FunctionToLoopPassAdaptor;
@@ -338,10 +372,16 @@ public:
              "Loops must remain in LCSSA form!");
 #endif
 
+      internal::PolyhedralLoopNestUpdater PolyhedralUpdater(*L, LAM, LAR, &AM);
+
       PreservedAnalyses PassPA = Pass.run(*L, LAM, LAR, Updater);
       // FIXME: We should verify the set of analyses relevant to Loop passes
       // are preserved.
 
+      // Keep the cached polyhedral information valid for the rest of the loop
+      // pipeline and beyond.
+      PolyhedralUpdater.update(PassPA);
+
       // If the loop hasn't been deleted, we need to handle invalidation here.
       if (!Updater.skipCurrentLoop())
         // We know that the loop pass couldn't have invalidated any other
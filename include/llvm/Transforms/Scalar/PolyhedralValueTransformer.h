@@ -1,4 +1,4 @@
-//===--- PolyhedralValueTransformer.h -- Polyhedral access analysis ---*- C++ -*-===//
+//===- PolyhedralValueTransformer.h - Polyhedral transforms -----*- C++ -*-===//
 //
 //                     The LLVM Compiler Infrastructure
 //
@@ -7,25 +7,62 @@
 //
 //===----------------------------------------------------------------------===//
 //
+// Transformations driven by the polyhedral value analysis. Conditional
+// branches in loops that are always (or never) taken are folded, conditions
+// that only depend on loop invariant parameters are hoisted out of innermost
+// loops by versioning (unswitching) them. If the polyhedral representation is
+// only valid for some parameter values the loop is versioned on these values
+// first.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef POLYHEDRAL_VALUE_TRANSFORMER_H
 #define POLYHEDRAL_VALUE_TRANSFORMER_H
 
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/PValue.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 namespace llvm {
 
+class DominatorTree;
 class Loop;
 class LoopInfo;
 class PEXP;
 class PolyhedralValueInfo;
 
 class PolyhedralValueTransformer {
-
+public:
+  /// The ways a conditional branch in a loop nest can be simplified.
+  enum ConditionKind {
+    /// The branch condition is true in all iterations it is evaluated.
+    CK_ALWAYS_TAKEN,
+    /// The branch condition is false in all iterations it is evaluated.
+    CK_NEVER_TAKEN,
+    /// The branch condition only depends on values invariant in the loop
+    /// nest, thus it can be evaluated (and hoisted) in front of the loop.
+    CK_HOISTABLE,
+  };
+
+  /// A conditional branch that can be simplified.
+  struct ConditionInfo {
+    BranchInst *BI;
+    ConditionKind Kind;
+
+    /// The parameter values for which the polyhedral representation of the
+    /// condition or its domain is not valid, or a null set if it is always
+    /// valid.
+    PVSet InvalidParameters;
+
+    /// For hoistable conditions, the parameter values for which the condition
+    /// is true.
+    PVSet TakenParameters;
+  };
+
+private:
   /// The PolyhedralValueInfo used to get value information.
   PolyhedralValueInfo &PVI;
 
@@ -33,22 +70,37 @@ class PolyhedralValueTransformer {
 
   LoopInfo &LI;
 
+  DominatorTree &DT;
+
+  /// Classify the conditional branch @p BI in the loop nest rooted at @p Root.
+  ///
+  /// @returns True if @p BI can be simplified, in which case @p CI is filled.
+  bool analyzeCondition(Loop &Root, BranchInst &BI, ConditionInfo &CI);
+
+  /// Simplify the conditions @p CIs of branches in the loop @p L.
+  bool transformConditions(Loop &L, ArrayRef<ConditionInfo> CIs);
+
+  /// Replace the condition of @p BI by the constant @p Taken.
+  void foldCondition(BranchInst &BI, bool Taken);
+
+  /// Version the innermost loop @p L. The copy is executed if the parameters
+  /// are contained in @p CheckSet, evaluated in the preheader of @p L. The
+  /// original values are mapped to the copies in @p VMap.
+  ///
+  /// @returns False if the loop could not be versioned.
+  bool versionLoop(Loop &L, const PVSet &CheckSet, ValueToValueMapTy &VMap);
+
 public:
   /// Constructor
   PolyhedralValueTransformer(PolyhedralValueInfo &PVI, AliasAnalysis &AA,
-                             LoopInfo &LI);
+                             LoopInfo &LI, DominatorTree &DT);
 
   ~PolyhedralValueTransformer();
 
-  bool hoistConditions(Loop &L);
+  /// Fold always and never taken conditions and hoist invariant conditions out
+  /// of innermost loops.
   bool hoistConditions();
 
-  bool checkExpressions(Loop &L);
-  bool checkExpressions();
-
-  bool checkLoopIdioms(Loop &L);
-  bool checkLoopIdioms();
-
   /// Clear all cached information.
   void releaseMemory();
 
@@ -67,7 +119,8 @@ class PolyhedralValueTransformerWrapperPass : public FunctionPass {
 
 public:
   static char ID;
-  PolyhedralValueTransformerWrapperPass() : FunctionPass(ID) {}
+  PolyhedralValueTransformerWrapperPass()
+      : FunctionPass(ID), PVT(nullptr), F(nullptr) {}
 
   /// Return the PolyhedralValueTransformer object for the current function.
   PolyhedralValueTransformer &getPolyhedralValueTransformer() {
@@ -86,5 +139,12 @@ public:
   void dump() const;
 };
 
+/// The PolyhedralValueTransformer as function pass of the new pass manager.
+class PolyhedralValueTransformerPass
+    : public PassInfoMixin<PolyhedralValueTransformerPass> {
+public:
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+};
+
 } // namespace llvm
 #endif
@@ -41,6 +41,7 @@ class DominatorTree;
 class Function;
 class Instruction;
 class InvokeInst;
+class LLVMContext;
 class Loop;
 class LoopInfo;
 class Module;
@@ -60,6 +61,16 @@ std::unique_ptr<Module>
 CloneModule(const Module *M, ValueToValueMapTy &VMap,
             function_ref<bool(const GlobalValue *)> ShouldCloneDefinition);
 
+/// Return an exact copy of the module \p M in the context \p Ctx. Types,
+/// constants, metadata and attributes are re-created in \p Ctx instead of
+/// being serialized and parsed again. \p M is not modified, thus modules that
+/// share a context can be cloned concurrently as long as no other thread
+/// modifies that context at the same time. If \p Ctx uniques debug info types
+/// by ODR, the composite types with an identifier are shared with the modules
+/// already in \p Ctx.
+std::unique_ptr<Module> CloneModuleIntoContext(const Module &M,
+                                               LLVMContext &Ctx);
+
 /// ClonedCodeInfo - This struct can be used to capture information about code
 /// being cloned, while it is being cloned.
 struct ClonedCodeInfo {
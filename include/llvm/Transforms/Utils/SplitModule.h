@@ -18,10 +18,14 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include <memory>
+#include <vector>
 
 namespace llvm {
 
+class Function;
 class Module;
+class ProfileSummaryInfo;
+class raw_ostream;
 
 /// Splits the module M into N linkable partitions. The function ModuleCallback
 /// is called N times passing each individual partition as the MPart argument.
@@ -38,6 +42,43 @@ void SplitModule(
     function_ref<void(std::unique_ptr<Module> MPart)> ModuleCallback,
     bool PreserveLocals = false);
 
+/// Estimate the time it takes to generate code for the function \p F, in
+/// units of instructions. Basic blocks, inline assembly and, if \p PSI is
+/// given, the profile hotness of \p F are taken into account.
+uint64_t estimateCodeGenCost(const Function &F,
+                             ProfileSummaryInfo *PSI = nullptr);
+
+/// Estimate the time it takes to generate code for the module \p M.
+uint64_t estimateCodeGenCost(Module &M);
+
+/// Predicted code generation cost and measured code generation time of the
+/// partitions created by SplitModule, see -split-module-report.
+class SplitModuleReport {
+  struct PartitionInfo {
+    uint64_t PredictedCost = 0;
+    double WallTime = 0;
+  };
+  std::vector<PartitionInfo> Partitions;
+
+public:
+  explicit SplitModuleReport(unsigned N);
+
+  /// Return true if the report was requested.
+  static bool isEnabled();
+
+  /// Record the estimated cost of partition \p I, \p MPart.
+  void setPredictedCost(unsigned I, Module &MPart);
+
+  /// Record the code generation time of partition \p I. Different partitions
+  /// can be recorded concurrently.
+  void setWallTime(unsigned I, double Seconds);
+
+  void print(raw_ostream &OS) const;
+
+  /// Print the report to the info output file if it was requested.
+  void printIfEnabled() const;
+};
+
 } // end namespace llvm
 
 #endif // LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
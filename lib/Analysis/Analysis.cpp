@@ -68,6 +68,7 @@ void llvm::initializeAnalysis(PassRegistry &Registry) {
   initializeObjCARCAAWrapperPassPass(Registry);
   initializeOptimizationRemarkEmitterWrapperPassPass(Registry);
   initializePolyhedralValueInfoWrapperPassPass(Registry);
+  initializePolyhedralFunctionSummariesWrapperPassPass(Registry);
   initializePolyhedralAccessInfoWrapperPassPass(Registry);
   initializePolyhedralDependenceInfoWrapperPassPass(Registry);
   initializePostDominatorTreeWrapperPassPass(Registry);
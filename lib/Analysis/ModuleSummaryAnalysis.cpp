@@ -25,6 +25,7 @@
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/IndirectCallPromotionAnalysis.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PolyhedralAccessInfo.h"
 #include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/Analysis/TypeMetadataUtils.h"
 #include "llvm/IR/Attributes.h"
@@ -49,6 +50,7 @@
 #include "llvm/Object/SymbolicFile.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
@@ -58,6 +60,11 @@ using namespace llvm;
 
 #define DEBUG_TYPE "module-summary-analysis"
 
+static cl::opt<bool> SummarizeParamAccesses(
+    "module-summary-param-accesses", cl::init(false), cl::Hidden,
+    cl::desc("Add the polyhedral accesses through pointer arguments to the "
+             "function summaries"));
+
 // Walk through the operands of a given User via worklist iteration and populate
 // the set of GlobalValue references encountered. Invoked either on an
 // Instruction or a GlobalVariable (which walks its initializer).
@@ -198,6 +205,7 @@ static void addIntrinsicToSummary(
 static void
 computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
                        const Function &F, BlockFrequencyInfo *BFI,
+                       PolyhedralAccessInfo *PAI,
                        ProfileSummaryInfo *PSI, bool HasLocalsInUsedOrAsm,
                        DenseSet<GlobalValue::GUID> &CantBePromoted) {
   // Summary not currently supported for anonymous functions, they should
@@ -221,6 +229,19 @@ computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
   // list.
   findRefEdges(Index, &F, RefEdges, Visited);
 
+  // The effects of the function body apart from the calls recorded as call
+  // graph edges, see FunctionSummary::FFlags.
+  bool BodyReadNone = true, BodyReadOnly = true, BodyNoUnwind = true;
+  bool NoUnknownCalls = true;
+  auto AddCallSiteEffects = [&](ImmutableCallSite CS) {
+    if (!CS.doesNotAccessMemory())
+      BodyReadNone = false;
+    if (!CS.onlyReadsMemory())
+      BodyReadOnly = false;
+    if (!CS.doesNotThrow())
+      BodyNoUnwind = false;
+  };
+
   bool HasInlineAsmMaybeReferencingInternal = false;
   for (const BasicBlock &BB : F)
     for (const Instruction &I : BB) {
@@ -229,8 +250,15 @@ computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
       ++NumInsts;
       findRefEdges(Index, &I, RefEdges, Visited);
       auto CS = ImmutableCallSite(&I);
-      if (!CS)
+      if (!CS) {
+        if (I.mayWriteToMemory())
+          BodyReadNone = BodyReadOnly = false;
+        else if (I.mayReadFromMemory())
+          BodyReadNone = false;
+        if (I.mayThrow())
+          BodyNoUnwind = false;
         continue;
+      }
 
       const auto *CI = dyn_cast<CallInst>(&I);
       // Since we don't know exactly which local values are referenced in inline
@@ -258,6 +286,7 @@ computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
       // intrinsic, or an indirect call with profile data.
       if (CalledFunction) {
         if (CI && CalledFunction->isIntrinsic()) {
+          AddCallSiteEffects(CS);
           addIntrinsicToSummary(
               CI, TypeTests, TypeTestAssumeVCalls, TypeCheckedLoadVCalls,
               TypeTestAssumeConstVCalls, TypeCheckedLoadConstVCalls);
@@ -277,6 +306,10 @@ computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
                            cast<GlobalValue>(CalledValue))]
             .updateHotness(Hotness);
       } else {
+        // Neither inline assembly nor indirect calls have call graph edges
+        // that allow to reason about their effects.
+        AddCallSiteEffects(CS);
+        NoUnknownCalls = false;
         // Skip inline assembly calls.
         if (CI && CI->isInlineAsm())
           continue;
@@ -316,6 +349,11 @@ computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
       F.hasFnAttribute(Attribute::ReadOnly),
       F.hasFnAttribute(Attribute::NoRecurse),
       F.returnDoesNotAlias(),
+      F.doesNotThrow(),
+      BodyReadNone,
+      BodyReadOnly,
+      BodyNoUnwind,
+      NoUnknownCalls,
   };
   auto FuncSummary = llvm::make_unique<FunctionSummary>(
       Flags, NumInsts, FunFlags, RefEdges.takeVector(),
@@ -323,6 +361,12 @@ computeFunctionSummary(ModuleSummaryIndex &Index, const Module &M,
       TypeTestAssumeVCalls.takeVector(), TypeCheckedLoadVCalls.takeVector(),
       TypeTestAssumeConstVCalls.takeVector(),
       TypeCheckedLoadConstVCalls.takeVector());
+
+  if (PAI) {
+    std::vector<FunctionSummary::ParamAccess> ParamAccesses;
+    if (PAI->getParamAccesses(const_cast<Function &>(F), ParamAccesses))
+      FuncSummary->setParamAccesses(std::move(ParamAccesses));
+  }
   if (NonRenamableLocal)
     CantBePromoted.insert(F.getGUID());
   Index.addGlobalValueSummary(F.getName(), std::move(FuncSummary));
@@ -370,7 +414,8 @@ static void setLiveRoot(ModuleSummaryIndex &Index, StringRef Name) {
 ModuleSummaryIndex llvm::buildModuleSummaryIndex(
     const Module &M,
     std::function<BlockFrequencyInfo *(const Function &F)> GetBFICallback,
-    ProfileSummaryInfo *PSI) {
+    ProfileSummaryInfo *PSI,
+    std::function<PolyhedralAccessInfo *(const Function &F)> GetPAICallback) {
   assert(PSI);
   ModuleSummaryIndex Index;
 
@@ -429,7 +474,12 @@ ModuleSummaryIndex llvm::buildModuleSummaryIndex(
                         F->hasFnAttribute(Attribute::ReadNone),
                         F->hasFnAttribute(Attribute::ReadOnly),
                         F->hasFnAttribute(Attribute::NoRecurse),
-                        F->returnDoesNotAlias()},
+                        F->returnDoesNotAlias(),
+                        F->doesNotThrow(),
+                        /* BodyReadNone = */ false,
+                        /* BodyReadOnly = */ false,
+                        /* BodyNoUnwind = */ false,
+                        /* NoUnknownCalls = */ false},
                     ArrayRef<ValueInfo>{}, ArrayRef<FunctionSummary::EdgeTy>{},
                     ArrayRef<GlobalValue::GUID>{},
                     ArrayRef<FunctionSummary::VFuncId>{},
@@ -463,7 +513,11 @@ ModuleSummaryIndex llvm::buildModuleSummaryIndex(
       BFI = BFIPtr.get();
     }
 
-    computeFunctionSummary(Index, M, F, BFI, PSI,
+    PolyhedralAccessInfo *PAI = nullptr;
+    if (SummarizeParamAccesses && GetPAICallback)
+      PAI = GetPAICallback(F);
+
+    computeFunctionSummary(Index, M, F, BFI, PAI, PSI,
                            !LocalsUsed.empty() || HasLocalInlineAsmSymbol,
                            CantBePromoted);
   }
@@ -548,7 +602,11 @@ ModuleSummaryIndexAnalysis::run(Module &M, ModuleAnalysisManager &AM) {
         return &FAM.getResult<BlockFrequencyAnalysis>(
             *const_cast<Function *>(&F));
       },
-      &PSI);
+      &PSI,
+      [&FAM](const Function &F) {
+        return &FAM.getResult<PolyhedralAccessInfoAnalysis>(
+            *const_cast<Function *>(&F));
+      });
 }
 
 char ModuleSummaryIndexWrapperPass::ID = 0;
@@ -556,6 +614,7 @@ char ModuleSummaryIndexWrapperPass::ID = 0;
 INITIALIZE_PASS_BEGIN(ModuleSummaryIndexWrapperPass, "module-summary-analysis",
                       "Module Summary Analysis", false, true)
 INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PolyhedralAccessInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
 INITIALIZE_PASS_END(ModuleSummaryIndexWrapperPass, "module-summary-analysis",
                     "Module Summary Analysis", false, true)
@@ -578,7 +637,12 @@ bool ModuleSummaryIndexWrapperPass::runOnModule(Module &M) {
                          *const_cast<Function *>(&F))
                      .getBFI());
       },
-      &PSI);
+      &PSI,
+      [this](const Function &F) {
+        return &(this->getAnalysis<PolyhedralAccessInfoWrapperPass>(
+                         *const_cast<Function *>(&F))
+                     .getPolyhedralAccessInfo());
+      });
   return false;
 }
 
@@ -591,4 +655,6 @@ void ModuleSummaryIndexWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
   AU.addRequired<BlockFrequencyInfoWrapperPass>();
   AU.addRequired<ProfileSummaryInfoWrapperPass>();
+  if (SummarizeParamAccesses)
+    AU.addRequired<PolyhedralAccessInfoWrapperPass>();
 }
@@ -20,6 +20,8 @@
 #include "isl/constraint.h"
 #include "isl/options.h"
 
+#include <limits>
+
 #define DEBUG_TYPE "pvalue"
 
 using namespace llvm;
@@ -89,10 +91,61 @@ std::string PVBase::str() const {
 
 /* -------------------- PVCtx ------------------------- */
 
-PVCtx::PVCtx() : PVCtx(isl_ctx_alloc()) {
+PVCtx::PVCtx() : Obj(isl_ctx_alloc(), [](isl_ctx *IslCtx) {
+  // Polyhedral values that outlive their context are leaked instead of
+  // aborting the compilation.
+  isl_options_set_on_error(IslCtx, ISL_ON_ERROR_CONTINUE);
+  isl_ctx_free(IslCtx);
+}) {
   isl_options_set_on_error(getIslCtx(), ISL_ON_ERROR_ABORT);
 }
 
+PVMaxOperationsGuard::PVMaxOperationsGuard(const PVCtx &Ctx,
+                                           unsigned long MaxOperations,
+                                           bool Independent)
+    : IslCtx(Ctx.getIslCtx()), OldOnError(ISL_ON_ERROR_ABORT),
+      OldMaxOperations(isl_ctx_get_max_operations(IslCtx)),
+      OldError(isl_error_none), StartOperations(0), Active(false) {
+  if (!MaxOperations || (OldMaxOperations && !Independent))
+    return;
+
+  Active = true;
+  OldError = isl_ctx_last_error(IslCtx);
+  isl_ctx_reset_error(IslCtx);
+  OldOnError = isl_options_get_on_error(IslCtx);
+  isl_options_set_on_error(IslCtx, ISL_ON_ERROR_CONTINUE);
+  // Keep the operation counter running, it is used for statistics.
+  StartOperations = isl_ctx_get_operations(IslCtx);
+  isl_ctx_set_max_operations(IslCtx, StartOperations + MaxOperations);
+}
+
+PVMaxOperationsGuard::~PVMaxOperationsGuard() {
+  if (!Active)
+    return;
+
+  // Restore the state of a suspended guard, the operations performed in the
+  // meantime do not count towards its limit.
+  isl_ctx_reset_error(IslCtx);
+  if (OldError != isl_error_none)
+    isl_ctx_set_error(IslCtx, isl_error(OldError));
+  if (OldMaxOperations)
+    OldMaxOperations += isl_ctx_get_operations(IslCtx) - StartOperations;
+  isl_ctx_set_max_operations(IslCtx, OldMaxOperations);
+  isl_options_set_on_error(IslCtx, OldOnError);
+}
+
+unsigned long PVCtx::getNumOperations() const {
+  return isl_ctx_get_operations(getIslCtx());
+}
+
+bool PVMaxOperationsGuard::hasQuotaExceeded() const {
+  return isl_ctx_last_error(IslCtx) == isl_error_quota;
+}
+
+bool PVMaxOperationsGuard::hasFailed() const {
+  return isl_ctx_last_error(IslCtx) != isl_error_none;
+}
+
 isl_space *PVCtx::getSpace() const {
   return isl_space_set_alloc(getIslCtx(), 0, 0);
 }
@@ -513,6 +566,26 @@ PVSet &PVSet::projectParameter(const PVId &Id) {
   return *this;
 }
 
+PVAff PVSet::getDimMin(unsigned Dim) const {
+  assert(Dim < getNumInputDimensions());
+  if (!isl_set_dim_has_lower_bound(Obj, isl_dim_set, Dim))
+    return PVAff();
+  PVAff Min(isl_set_dim_min(isl_set_copy(Obj), Dim));
+  if (isl_pw_aff_involves_nan(Min.Obj))
+    return PVAff();
+  return Min;
+}
+
+PVAff PVSet::getDimMax(unsigned Dim) const {
+  assert(Dim < getNumInputDimensions());
+  if (!isl_set_dim_has_upper_bound(Obj, isl_dim_set, Dim))
+    return PVAff();
+  PVAff Max(isl_set_dim_max(isl_set_copy(Obj), Dim));
+  if (isl_pw_aff_involves_nan(Max.Obj))
+    return PVAff();
+  return Max;
+}
+
 PVSet &PVSet::getNextIteration(unsigned Dim) {
   isl_map *NIMap = createNextIterationMap(getSpace(), Dim, false);
   Obj = isl_set_apply(Obj, NIMap);
@@ -546,6 +619,74 @@ void PVSet::getParameters(SmallVectorImpl<llvm::Value *> &Parameters) const {
       Parameters.push_back(getParameter(i).getPayloadAs<Value *>());
 }
 
+/// Return @p Val as 64 bit integer in @p Result if possible, free @p Val.
+static bool getInt64Val(isl_val *Val, int64_t &Result) {
+  bool Fits = isl_val_is_int(Val) &&
+              isl_val_cmp_si(Val, std::numeric_limits<long>::max()) < 0 &&
+              isl_val_cmp_si(Val, std::numeric_limits<long>::min()) > 0;
+  if (Fits)
+    Result = isl_val_get_num_si(Val);
+  isl_val_free(Val);
+  return Fits;
+}
+
+namespace {
+struct ConstraintCollector {
+  SmallVectorImpl<SmallVector<PVConstraint, 4>> &Disjuncts;
+  SmallVector<PVId, 8> ParameterIds;
+};
+} // namespace
+
+static isl_stat collectConstraint(isl_constraint *C, void *User) {
+  auto &Collector = *static_cast<ConstraintCollector *>(User);
+  PVConstraint PVC;
+  PVC.IsEquality = isl_constraint_is_equality(C);
+  bool Valid = getInt64Val(isl_constraint_get_constant_val(C), PVC.Constant);
+  for (unsigned i = 0, e = Collector.ParameterIds.size(); Valid && i < e; i++) {
+    int64_t Coeff;
+    Valid = getInt64Val(isl_constraint_get_coefficient_val(C, isl_dim_param, i),
+                        Coeff);
+    if (Valid && Coeff)
+      PVC.Terms.push_back({Collector.ParameterIds[i], Coeff});
+  }
+  isl_constraint_free(C);
+  if (!Valid)
+    return isl_stat_error;
+  Collector.Disjuncts.back().push_back(PVC);
+  return isl_stat_ok;
+}
+
+static isl_stat collectBasicSetConstraints(isl_basic_set *BSet, void *User) {
+  auto &Collector = *static_cast<ConstraintCollector *>(User);
+  isl_stat Stat = isl_stat_error;
+  if (isl_basic_set_dim(BSet, isl_dim_div) == 0) {
+    Collector.Disjuncts.emplace_back();
+    Stat = isl_basic_set_foreach_constraint(BSet, collectConstraint, User);
+  }
+  isl_basic_set_free(BSet);
+  return Stat;
+}
+
+bool PVSet::getParameterConstraints(
+    SmallVectorImpl<SmallVector<PVConstraint, 4>> &Disjuncts) const {
+  if (getNumInputDimensions())
+    return false;
+
+  isl_set *Set = isl_set_copy(Obj);
+  Set = isl_set_detect_equalities(Set);
+  Set = isl_set_remove_redundancies(Set);
+  Set = isl_set_coalesce(Set);
+
+  ConstraintCollector Collector = {Disjuncts, {}};
+  for (unsigned i = 0, e = isl_set_dim(Set, isl_dim_param); i < e; i++)
+    Collector.ParameterIds.push_back(isl_set_get_dim_id(Set, isl_dim_param, i));
+
+  isl_stat Stat =
+      isl_set_foreach_basic_set(Set, collectBasicSetConstraints, &Collector);
+  isl_set_free(Set);
+  return Stat == isl_stat_ok;
+}
+
 std::string PVSet::str() const {
   char *cstr = isl_set_to_str(Obj);
   if (!cstr)
@@ -664,6 +805,11 @@ PVMap &PVMap::intersect(const PVMap &PM) {
   return *this;
 }
 
+PVMap &PVMap::intersectParams(const PVSet &Params) {
+  Obj = isl_map_intersect_params(Obj, isl_set_params(Params));
+  return *this;
+}
+
 PVMap &PVMap::intersectDomain(const PVSet &Dom) {
   auto DomDim = Dom.getNumInputDimensions();
   auto MapDim = getNumInputDimensions();
@@ -852,6 +998,53 @@ PVMap &PVMap::addToOutputDimension(const PVMap &Other, unsigned Dim) {
   return *this;
 }
 
+PVMap &PVMap::reverse() {
+  Obj = isl_map_reverse(Obj);
+  return *this;
+}
+
+PVMap &PVMap::applyRange(const PVMap &PM) {
+  Obj = isl_map_apply_range(Obj, PM);
+  Obj = isl_map_coalesce(Obj);
+  return *this;
+}
+
+PVMap &PVMap::addInputDims(unsigned Dims) {
+  Obj = isl_map_add_dims(Obj, isl_dim_in, Dims);
+  return *this;
+}
+
+PVMap &PVMap::dropInputDimsFrom(unsigned Dim) {
+  if (Dim < getNumInputDimensions())
+    Obj = isl_map_project_out(Obj, isl_dim_in, Dim,
+                              getNumInputDimensions() - Dim);
+  return *this;
+}
+
+PVMap &PVMap::dropOutputDimsFrom(unsigned Dim) {
+  if (Dim < getNumOutputDimensions())
+    Obj = isl_map_project_out(Obj, isl_dim_out, Dim,
+                              getNumOutputDimensions() - Dim);
+  return *this;
+}
+
+PVMap &PVMap::equateInputAndOutputDim(unsigned Dim) {
+  assert(Dim < getNumInputDimensions() && Dim < getNumOutputDimensions());
+  Obj = isl_map_equate(Obj, isl_dim_in, Dim, isl_dim_out, Dim);
+  return *this;
+}
+
+PVMap &PVMap::orderInputBeforeOutputDim(unsigned Dim) {
+  assert(Dim < getNumInputDimensions() && Dim < getNumOutputDimensions());
+  Obj = isl_map_order_lt(Obj, isl_dim_in, Dim, isl_dim_out, Dim);
+  return *this;
+}
+
+PVSet PVMap::getDeltas() const {
+  assert(getNumInputDimensions() == getNumOutputDimensions());
+  return isl_set_coalesce(isl_map_deltas(isl_map_copy(Obj)));
+}
+
 void PVMap::dropUnusedParameters() {
   size_t NumParams = getNumParameters();
   for (size_t i = 0; i < NumParams; i++) {
@@ -1258,32 +1451,38 @@ bool PVAff::isEmpty() const {
   return isl_pw_aff_is_empty(Obj);
 }
 
+/// Add input dimensions to @p PWA until it has @p NumDims of them.
+///
+/// Adding zero dimensions is not a no-op for an expression on a parameter
+/// domain, isl would turn it into an expression on a zero-dimensional set.
+static isl_pw_aff *padInputDims(isl_pw_aff *PWA, unsigned NumDims) {
+  unsigned Dims = isl_pw_aff_dim(PWA, isl_dim_in);
+  if (Dims == NumDims)
+    return PWA;
+  return isl_pw_aff_add_dims(PWA, isl_dim_in, NumDims - Dims);
+}
+
 bool PVAff::isEqual(const PVAff &Aff) const {
-  isl_pw_aff *AffPWA = isl_pw_aff_add_dims(
-      Aff, isl_dim_in, getNumInputDimensions() - Aff.getNumInputDimensions());
+  isl_pw_aff *AffPWA = padInputDims(Aff, getNumInputDimensions());
   return isl_pw_aff_is_equal(Obj, AffPWA);
 }
 
 PVSet PVAff::getEqualDomain(const PVAff &Aff) const {
-  isl_pw_aff *AffPWA = isl_pw_aff_add_dims(
-      Aff, isl_dim_in, getNumInputDimensions() - Aff.getNumInputDimensions());
+  isl_pw_aff *AffPWA = padInputDims(Aff, getNumInputDimensions());
   return isl_pw_aff_eq_set(isl_pw_aff_copy(Obj), AffPWA);
 }
 
 PVSet PVAff::getLessThanDomain(const PVAff &Aff) const {
-  isl_pw_aff *AffPWA = isl_pw_aff_add_dims(
-      Aff, isl_dim_in, getNumInputDimensions() - Aff.getNumInputDimensions());
+  isl_pw_aff *AffPWA = padInputDims(Aff, getNumInputDimensions());
   return isl_pw_aff_lt_set(isl_pw_aff_copy(Obj), AffPWA);
 }
 
 PVSet PVAff::getLessEqualDomain(const PVAff &Aff) const {
-  isl_pw_aff *AffPWA = isl_pw_aff_add_dims(
-      Aff, isl_dim_in, getNumInputDimensions() - Aff.getNumInputDimensions());
+  isl_pw_aff *AffPWA = padInputDims(Aff, getNumInputDimensions());
   return isl_pw_aff_le_set(isl_pw_aff_copy(Obj), AffPWA);
 }
 PVSet PVAff::getGreaterEqualDomain(const PVAff &Aff) const {
-  isl_pw_aff *AffPWA = isl_pw_aff_add_dims(
-      Aff, isl_dim_in, getNumInputDimensions() - Aff.getNumInputDimensions());
+  isl_pw_aff *AffPWA = padInputDims(Aff, getNumInputDimensions());
   return isl_pw_aff_ge_set(isl_pw_aff_copy(Obj), AffPWA);
 }
 
@@ -1319,6 +1518,40 @@ PVAff &PVAff::equateInputDim(unsigned Dim, const PVId &Id) {
   return *this;
 }
 
+PVAff &PVAff::substituteParameters(ArrayRef<PVId> Ids,
+                                   ArrayRef<PVAff> Values) {
+  assert(Ids.size() == Values.size() && "Expected one value per parameter");
+  assert(getNumInputDimensions() == 0 && "Expected no input dimensions");
+  if (Ids.empty())
+    return *this;
+
+  size_t NumDims = 0;
+  for (const PVAff &Value : Values)
+    NumDims = std::max(NumDims, Value.getNumInputDimensions());
+
+  // Turn the parameters into input dimensions and build the function from the
+  // domain of the values to the values of the parameters. The pullback of this
+  // by that function is the result.
+  isl_multi_pw_aff *MPA = nullptr;
+  for (unsigned u = 0, e = Ids.size(); u < e; u++) {
+    int Pos = getParameterPosition(Ids[u]);
+    if (Pos < 0)
+      Obj = isl_pw_aff_insert_dims(Obj, isl_dim_in, u, 1);
+    else
+      Obj = isl_pw_aff_move_dims(Obj, isl_dim_in, u, isl_dim_param, Pos, 1);
+
+    isl_pw_aff *Value = isl_pw_aff_copy(Values[u].Obj);
+    Value = isl_pw_aff_add_dims(Value, isl_dim_in,
+                                NumDims - isl_pw_aff_dim(Value, isl_dim_in));
+    isl_multi_pw_aff *ValueMPA = isl_multi_pw_aff_from_pw_aff(Value);
+    MPA = MPA ? isl_multi_pw_aff_flat_range_product(MPA, ValueMPA) : ValueMPA;
+  }
+
+  Obj = isl_pw_aff_pullback_multi_pw_aff(Obj, MPA);
+  Obj = isl_pw_aff_coalesce(Obj);
+  return *this;
+}
+
 PVAff &PVAff::setInputLowerBound(unsigned Dim,
                                  int64_t Value) {
   auto *Dom = isl_pw_aff_domain(isl_pw_aff_copy(Obj));
@@ -1447,6 +1680,41 @@ PVSet PVAff::nonZeroSet() const {
   return isl_pw_aff_non_zero_set(isl_pw_aff_copy(Obj));
 }
 
+PVSet PVAff::getValueSet() const {
+  isl_set *Set = isl_map_range(isl_map_from_pw_aff(isl_pw_aff_copy(Obj)));
+  return isl_set_coalesce(Set);
+}
+
+static isl_stat getSinglePiece(isl_set *Domain, isl_aff *Aff, void *User) {
+  isl_set_free(Domain);
+  *static_cast<isl_aff **>(User) = Aff;
+  return isl_stat_ok;
+}
+
+bool PVAff::getParameterExpression(PVConstraint &Expr) const {
+  if (!Obj || getNumInputDimensions() || getNumPieces() != 1)
+    return false;
+
+  isl_aff *Aff = nullptr;
+  isl_pw_aff_foreach_piece(Obj, getSinglePiece, &Aff);
+  if (!Aff)
+    return false;
+
+  Expr.Terms.clear();
+  bool Valid = getInt64Val(isl_aff_get_constant_val(Aff), Expr.Constant);
+  for (unsigned i = 0, e = isl_aff_dim(Aff, isl_dim_param); Valid && i < e;
+       i++) {
+    int64_t Coeff;
+    Valid = getInt64Val(isl_aff_get_coefficient_val(Aff, isl_dim_param, i),
+                        Coeff);
+    if (Valid && Coeff)
+      Expr.Terms.push_back({getParameter(i), Coeff});
+  }
+
+  isl_aff_free(Aff);
+  return Valid;
+}
+
 struct ParameterInfo {
   PVAff Coeff;
   int Pos;
@@ -1477,6 +1745,35 @@ PVAff PVAff::getParameterCoeff(const PVId &Id) {
   return PI.Coeff;
 }
 
+struct InputDimInfo {
+  PVAff Coeff;
+  unsigned Dim;
+};
+
+static isl_stat getInputDimAff(isl_set *Domain, isl_aff *Aff, void *User) {
+  auto *IDI = static_cast<InputDimInfo*>(User);
+  // Integer divisions hide the actual dependence on the input dimension.
+  if (isl_aff_dim(Aff, isl_dim_div) > 0) {
+    isl_set_free(Domain);
+    isl_aff_free(Aff);
+    return isl_stat_error;
+  }
+  isl_val *CoeffVal = isl_aff_get_coefficient_val(Aff, isl_dim_in, IDI->Dim);
+  IDI->Coeff.union_add(isl_pw_aff_val_on_domain(Domain, CoeffVal));
+  isl_aff_free(Aff);
+  return isl_stat_ok;
+}
+
+PVAff PVAff::getInputDimCoeff(unsigned Dim) const {
+  assert(Dim < getNumInputDimensions() && "Input dimension out of bounds");
+
+  InputDimInfo IDI = {PVAff(), Dim};
+  if (isl_pw_aff_foreach_piece(Obj, getInputDimAff, &IDI) != isl_stat_ok)
+    return PVAff();
+
+  return IDI.Coeff;
+}
+
 struct EvolutionInfo {
   PVAff PWA;
   int LD;
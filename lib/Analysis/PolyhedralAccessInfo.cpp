@@ -14,6 +14,7 @@
 
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/PolyhedralExpressionBuilder.h"
@@ -33,6 +34,9 @@ using namespace llvm;
 
 #define DEBUG_TYPE "polyhedral-access-info"
 
+STATISTIC(NUM_FORGOTTEN_ACCESSES,
+          "Number of cached polyhedral accesses forgotten incrementally");
+
 raw_ostream &llvm::operator<<(raw_ostream &OS, PACC::AccessKind Kind) {
   switch (Kind) {
   case PACC::AK_READ:
@@ -46,13 +50,9 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, PACC::AccessKind Kind) {
   }
 }
 
-PACC::PACC(Value &Pointer, PEXP &PE, PVId Id, AccessKind AccKind)
+PACC::PACC(Instruction &Inst, Value &Pointer, PVId Id, AccessKind AccKind)
     : BasePointer(Id.getPayloadAs<Value *>()), Pointer(&Pointer), Id(Id),
-      PE(PE), AccKind(AccKind) {
-  PE.getPWA().dropUnusedParameters();
-}
-
-PACC::~PACC() { delete &PE; }
+      PE(&Inst, nullptr), AccKind(AccKind) {}
 
 void PACC::print(raw_ostream &OS) const {
   OS << "PACC [" << *PE.getValue() << "] @ [" << Pointer << "]\n"
@@ -133,7 +133,7 @@ const PEXP *PACCSummary::findMultidimensionalViewSize(
     PVAff PVA = PE->getPWA();
     for (const PVId &ParamId : ParameterVector)
       if (PVA.involvesIdInOutput(ParamId)) {
-        errs() << "Param in pexp: " << *PE << " :: " << ParamId << "\n";
+        DEBUG(dbgs() << "Param in pexp: " << *PE << " :: " << ParamId << "\n");
         ExprParameterMap[ParamId.getPayloadAs<Value *>()].push_back(PE);
       }
     ParameterVector.clear();
@@ -380,21 +380,21 @@ void PACCSummary::finalize(PolyhedralValueInfo &PI,
           PVAff Coeff = LastPWA.getParameterCoeff(PId);
           DEBUG(dbgs() << "Coeff " << Coeff << "\n");
           assert(!Coeff || Coeff.isConstant());
-          //if (!Coeff || Coeff.isEqual(PVAff(Coeff, 0)))
           if (!Coeff)
             continue;
 
-          PVAff &DimPWA = DimPWAs[LastDim - Dim - 1];
-          //if (DimPWA && DimPWA.isConstant()) {
-            //errs() << "DPWA: " << DimPWA << "\n";
-            //errs() << "NPWA: " << It.second->getPWA() << "\n";
-            //continue;
-          //}
-          assert(!DimPWA || DimPWA.isEqual(It.second->getPWA()));
-
+          // Multiple instructions can contribute to the same dimension, e.g.,
+          // if the access function is not simplified, thus the dimension is
+          // the sum of their contributions.
           DEBUG(dbgs() << "Rem: " << It.second->getPWA() << "\n";);
-          DimPWA = It.second->getPWA();
-          DimPWA.multiply(Coeff);
+          PVAff DimTerm = It.second->getPWA();
+          DimTerm.multiply(Coeff);
+
+          PVAff &DimPWA = DimPWAs[LastDim - Dim - 1];
+          if (DimPWA)
+            DimPWA.add(DimTerm);
+          else
+            DimPWA = DimTerm;
 
           const PVAff &Size = AI->DimensionSizes[Dim]->getPWA();
           DEBUG(dbgs() << "Size: " << Size << "\n");
@@ -411,7 +411,8 @@ void PACCSummary::finalize(PolyhedralValueInfo &PI,
         }
       }
 
-      errs() << "DimPWAs: " << DimPWAs.size() << " PAID: " << PA->getId() << "\n";
+      DEBUG(dbgs() << "DimPWAs: " << DimPWAs.size() << " PAID: " << PA->getId()
+                   << "\n");
       PVMap Map(DimPWAs, PA->getId());
       Map.dropUnusedParameters();
       DEBUG(dbgs() << "MAP: " << Map << "\n");
@@ -461,6 +462,8 @@ void PACCSummary::finalize(PolyhedralValueInfo &PI,
       Map.dropUnusedParameters();
 
       AI->AccessMultiDimMap[PA] = Map;
+      if (IsMayAccess)
+        AI->MayAccesses.insert(PA);
 
       if (PA->isWrite()) {
         if (IsMayAccess)
@@ -647,43 +650,108 @@ PolyhedralAccessInfo::PolyhedralAccessInfo(PolyhedralValueInfo &PI,
 PolyhedralAccessInfo::~PolyhedralAccessInfo() { releaseMemory(); }
 
 void PolyhedralAccessInfo::releaseMemory() {
-  DeleteContainerSeconds(AccessMap);
+  for (auto &It : AccessMap)
+    if (It.second)
+      It.second->~PACC();
+  AccessMap.clear();
+  FreePACCs.clear();
+  PACCAllocator.Reset();
+}
+
+PACC *PolyhedralAccessInfo::createPACC(Instruction &Inst, Value &Pointer,
+                                       PVId Id, PACC::AccessKind AccKind) {
+  void *Mem = FreePACCs.empty() ? PACCAllocator.Allocate<PACC>()
+                                : FreePACCs.pop_back_val();
+  return new (Mem) PACC(Inst, Pointer, Id, AccKind);
+}
+
+void PolyhedralAccessInfo::destroyPACC(PACC *PA) {
+  PA->~PACC();
+  FreePACCs.push_back(PA);
+}
+
+void PolyhedralAccessInfo::forgetLoop(const Loop &L) {
+  SmallPtrSet<const Value *, 32> Values;
+  SmallPtrSet<const Loop *, 4> Loops;
+  PolyhedralValueInfo::collectLoopNest(L, Values, Loops);
+  forget(Values, Loops);
+}
+
+void PolyhedralAccessInfo::forget(const SmallPtrSetImpl<const Value *> &Values,
+                                  const SmallPtrSetImpl<const Loop *> &Loops) {
+  for (auto It = AccessMap.begin(), End = AccessMap.end(); It != End; ++It) {
+    PACC *PA = It->second;
+    if (!Values.count(It->first.first) &&
+        !(It->first.second && Loops.count(It->first.second)) &&
+        !(PA && (Values.count(PA->getPointer()) ||
+                 Values.count(PA->getBasePointer()) ||
+                 PolyhedralValueInfoCache::isParametricIn(*PA->getPEXP(),
+                                                          Values))))
+      continue;
+
+    if (PA)
+      destroyPACC(PA);
+    AccessMap.erase(It);
+    NUM_FORGOTTEN_ACCESSES++;
+  }
+
+  PI.forget(Values, Loops);
+}
+
+bool PolyhedralAccessInfo::invalidate(
+    Function &F, const PreservedAnalyses &PA,
+    FunctionAnalysisManager::Invalidator &Inv) {
+  auto PAC = PA.getChecker<PolyhedralAccessInfoAnalysis>();
+  if (!PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>())
+    return true;
+
+  return Inv.invalidate<PolyhedralValueInfoAnalysis>(F, PA) ||
+         Inv.invalidate<LoopAnalysis>(F, PA);
 }
 
 const PACC *PolyhedralAccessInfo::getAsAccess(Instruction &Inst, Value &Pointer,
                                               bool IsWrite, Loop *Scope) {
-  PACC *&AccessPA = AccessMap[&Inst];
+  PolyhedralStats::Query PSQ(PolyhedralStats::AK_ACCESS, PI.getCtx());
+  PACC *&AccessPA = AccessMap[{&Inst, Scope}];
+  PolyhedralStats::recordCacheLookup(PolyhedralStats::AK_ACCESS, AccessPA);
   if (AccessPA)
     return AccessPA;
 
   const PEXP *PointerPE = PI.getPEXP(&Pointer, Scope);
+  if (!PI.isAffine(PointerPE))
+    return nullptr;
 
   SmallVector<Value *, 4> Parameters;
   PI.getParameters(PointerPE, Parameters, false);
 
+  // Without a unique base pointer the access is treated as unknown.
   Value *PtrVal = nullptr;
   for (Value *Parameter : Parameters) {
     if (!Parameter->getType()->isPointerTy())
       continue;
-    assert(!PtrVal && "Found multiple pointer values!");
+    if (PtrVal)
+      return nullptr;
     PtrVal = Parameter;
   }
-  assert(PtrVal && "Did not find pointer value!");
+  if (!PtrVal)
+    return nullptr;
 
   PVId PtrValId = PI.getParameterId(*PtrVal);
 
   const PEXP *PtrValPE = PI.getPEXP(PtrVal, Scope);
 
-  PEXP *AccessPE = new PEXP(&Inst, nullptr);
-  PEBuilder.assign(AccessPE, PointerPE, PtrValPE, PVAff::createSub);
-
   PACC::AccessKind AccKind = IsWrite ? PACC::AK_WRITE : PACC::AK_READ;
+  PACC *PA = createPACC(Inst, Pointer, PtrValId, AccKind);
+
+  PEXP *AccessPE = &PA->PE;
+  PEBuilder.assign(AccessPE, PointerPE, PtrValPE, PVAff::createSub);
 
   const PEXP *Domain = PI.getDomainFor(Inst.getParent(), Scope);
   if (PI.isAffine(Domain))
     AccessPE->getPWA().intersectDomain(Domain->getDomain());
+  AccessPE->getPWA().dropUnusedParameters();
 
-  AccessPA = new PACC(Pointer, *AccessPE, PtrValId, AccKind);
+  AccessPA = PA;
   return AccessPA;
 }
 
@@ -717,6 +785,7 @@ PACCSummary *
 PolyhedralAccessInfo::getAccessSummary(ArrayRef<BasicBlock *> Blocks,
                                        PACCSummary::SummaryScopeKind Kind,
                                        Loop *Scope) {
+  PolyhedralStats::Query PSQ(PolyhedralStats::AK_ACCESS, PI.getCtx());
 
   PACCSummary::ContainsFuncTy ContainsFn = [=](Instruction *I) {
     return !Scope ||
@@ -744,6 +813,106 @@ PolyhedralAccessInfo::getAccessSummary(ArrayRef<BasicBlock *> Blocks,
   return PS;
 }
 
+/// Translate the parameter expression @p PWA into @p Bound if it only involves
+/// integer arguments of @p F.
+static bool
+getArgumentBound(const Function &F, const PVAff &PWA,
+                 FunctionSummary::ParamAccess::AffineBound &Bound) {
+  PVConstraint Expr;
+  if (!PWA || !PWA.getParameterExpression(Expr))
+    return false;
+
+  Bound.Constant = Expr.Constant;
+  for (auto &Term : Expr.Terms) {
+    auto *Arg = dyn_cast_or_null<Argument>(Term.first.getPayloadAs<Value *>());
+    if (!Arg || Arg->getParent() != &F || !Arg->getType()->isIntegerTy())
+      return false;
+    Bound.Terms.push_back({Arg->getArgNo(), Term.second});
+  }
+  return true;
+}
+
+bool PolyhedralAccessInfo::getParamAccesses(
+    Function &F, std::vector<FunctionSummary::ParamAccess> &ParamAccesses) {
+  if (F.isDeclaration())
+    return false;
+
+  std::unique_ptr<PACCSummary> PS(
+      getAccessSummary(F, PACCSummary::SSK_EXTERNAL));
+
+  // Accesses we cannot describe, e.g., calls, might be based on any argument.
+  if (PS->getNumUnknownReads() || PS->getNumUnknownWrites())
+    return false;
+
+  /// The accessed bytes relative to an argument, as long as they are known.
+  struct ArgumentAccesses {
+    FunctionSummary::ParamAccess PA;
+    PVSet FirstBytes, LastBytes;
+    bool IsBounded = true;
+  };
+  SmallVector<ArgumentAccesses, 8> ArgAccesses(F.arg_size());
+
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  auto AddAccess = [&](const PACC *PA) {
+    auto *Arg = dyn_cast<Argument>(PA->getBasePointer());
+    if (!Arg)
+      return;
+
+    ArgumentAccesses &AA = ArgAccesses[Arg->getArgNo()];
+    AA.PA.IsRead |= PA->isRead();
+    AA.PA.IsWritten |= PA->isWrite();
+
+    const PEXP *PE = PA->getPEXP();
+    if (!AA.IsBounded || !PI.isAffine(PE) || !PI.isAlwaysValid(PE)) {
+      AA.IsBounded = false;
+      return;
+    }
+
+    const PVAff &Offset = PE->getPWA();
+    int64_t Size = getElementSize(PA->getPointer(), DL);
+    AA.FirstBytes.unify(Offset.getValueSet());
+    AA.LastBytes.unify(
+        PVAff::createAdd(Offset, PVAff(Offset, Size - 1)).getValueSet());
+  };
+
+  for (auto It = PS->reads_begin(), End = PS->reads_end(); It != End; It++)
+    AddAccess(*It);
+  for (auto It = PS->writes_begin(), End = PS->writes_end(); It != End; It++)
+    AddAccess(*It);
+
+  for (Argument &Arg : F.args()) {
+    if (!Arg.getType()->isPointerTy())
+      continue;
+
+    ArgumentAccesses &AA = ArgAccesses[Arg.getArgNo()];
+    AA.PA.ArgNo = Arg.getArgNo();
+
+    // A copy of a captured argument might be accessed with a different base
+    // pointer, thus the argument is assumed to be read and written anywhere.
+    if (PointerMayBeCaptured(&Arg, /* ReturnCaptures */ false,
+                             /* StoreCaptures */ true)) {
+      AA.PA.IsRead = AA.PA.IsWritten = true;
+      AA.IsBounded = false;
+    }
+
+    if (AA.IsBounded && AA.FirstBytes && AA.LastBytes) {
+      AA.PA.HasLowerBound =
+          getArgumentBound(F, AA.FirstBytes.getDimMin(0), AA.PA.LowerBound);
+      AA.PA.HasUpperBound =
+          getArgumentBound(F, AA.LastBytes.getDimMax(0), AA.PA.UpperBound);
+    }
+
+    DEBUG(dbgs() << "Argument " << Arg.getName() << " of " << F.getName()
+                 << ": read: " << AA.PA.IsRead
+                 << ", written: " << AA.PA.IsWritten
+                 << ", bounded: " << AA.PA.HasLowerBound << "/"
+                 << AA.PA.HasUpperBound << "\n");
+    ParamAccesses.push_back(std::move(AA.PA));
+  }
+
+  return true;
+}
+
 bool PolyhedralAccessInfo::hasFunctionScope(const PACC *PA) const {
   return PI.hasFunctionScope(PA->getPEXP(), false);
 }
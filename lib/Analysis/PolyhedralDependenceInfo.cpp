@@ -12,11 +12,16 @@
 
 #include "llvm/Analysis/PolyhedralDependenceInfo.h"
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/Analysis/PolyhedralAccessInfo.h"
+#include "llvm/Analysis/PolyhedralStats.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/InstVisitor.h"
@@ -25,6 +30,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <cassert>
 
 using namespace llvm;
@@ -32,10 +38,74 @@ using namespace llvm;
 #define DEBUG_TYPE "polyhedral-dependence-info"
 
 raw_ostream &llvm::operator<<(raw_ostream &OS, PDEP::DependenceKind Kind) {
-  return OS;
+  switch (Kind) {
+  case PDEP::DK_WAR:
+    return OS << "WAR";
+  case PDEP::DK_RAW:
+    return OS << "RAW";
+  case PDEP::DK_WAW:
+    return OS << "WAW";
+  default:
+    llvm_unreachable("Unknown polyhedral dependence kind");
+  }
+}
+
+PDEP::PDEP(const PACC &Src, const PACC &Tgt, DependenceKind DepKind,
+           unsigned Level, const PVMap &DepMap, const PVSet &DistanceSet,
+           bool IsLexicallyForward, bool IsExact)
+    : Src(Src), Tgt(Tgt), DepKind(DepKind), Level(Level), DepMap(DepMap),
+      DistanceSet(DistanceSet), IsLexicallyForward(IsLexicallyForward),
+      IsExact(IsExact) {
+  this->DepMap.dropUnusedParameters();
+  this->DistanceSet.dropUnusedParameters();
+}
+
+PVAff PDEP::getMinDistance(unsigned Level) const {
+  assert(Level > 0 && Level <= getNumCommonLevels());
+  return DistanceSet.getDimMin(Level - 1);
+}
+
+PVAff PDEP::getMaxDistance(unsigned Level) const {
+  assert(Level > 0 && Level <= getNumCommonLevels());
+  return DistanceSet.getDimMax(Level - 1);
+}
+
+PVAff PDEP::getDistance(unsigned Level) const {
+  PVAff MinDistance = getMinDistance(Level);
+  if (!MinDistance)
+    return MinDistance;
+  PVAff MaxDistance = getMaxDistance(Level);
+  if (!MaxDistance || !MinDistance.isEqual(MaxDistance))
+    return PVAff();
+  return MinDistance;
+}
+
+PDEP::DirectionKind PDEP::getDirection(unsigned Level) const {
+  PVAff MinDistance = getMinDistance(Level);
+  PVAff MaxDistance = getMaxDistance(Level);
+  if (!MinDistance || !MaxDistance)
+    return DIR_ALL;
+
+  PVAff Zero(MinDistance.getDomain(), 0);
+  if (MinDistance.getLessEqualDomain(Zero).isEmpty())
+    return DIR_LT;
+  if (MaxDistance.getGreaterEqualDomain(Zero).isEmpty())
+    return DIR_GT;
+  if (MinDistance.isEqual(Zero) && MaxDistance.isEqual(Zero))
+    return DIR_EQ;
+  return DIR_ALL;
 }
 
 void PDEP::print(raw_ostream &OS) const {
+  OS << DepKind << " [";
+  if (isLoopIndependent())
+    OS << "loop independent";
+  else
+    OS << "level " << Level;
+  OS << (IsExact ? ", exact" : ", approximated") << "]\n"
+     << "\t\tfrom: " << *Src.getPEXP()->getValue() << "\n"
+     << "\t\tto:   " << *Tgt.getPEXP()->getValue() << "\n"
+     << "\t\tdistance: " << DistanceSet << "\n";
 }
 
 void PDEP::dump() const { print(dbgs()); }
@@ -53,75 +123,448 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, const PDEP &PD) {
 
 // ------------------------------------------------------------------------- //
 
+PolyhedralDependenceInfo::LoopDependences::~LoopDependences() {
+  DeleteContainerPointers(Dependences);
+  delete PS;
+}
+
 PolyhedralDependenceInfo::PolyhedralDependenceInfo(PolyhedralAccessInfo &PAI, LoopInfo &LI)
     : PAI(PAI), LI(LI) {}
 
 PolyhedralDependenceInfo::~PolyhedralDependenceInfo() { releaseMemory(); }
 
-bool PolyhedralDependenceInfo::isVectorizableLoop(Loop &L) {
-  DEBUG(dbgs() << "CHECK L:");
-  L.dump();
+/// Return the number of loops surrounding @p BB, up to the outermost loop.
+static unsigned getNestDepth(LoopInfo &LI, const Loop &L, BasicBlock *BB) {
+  Loop *BBL = LI.getLoopFor(BB);
+  assert(BBL && L.contains(BBL));
+  return BBL->getLoopDepth();
+}
 
-  if (L.begin() != L.end()) {
-    DEBUG(dbgs() << "PDI: Loop is not innermost. Not vectorizable!\n");
-    return false;
+/// Return the number of loops that contain both @p BB0 and @p BB1, up to the
+/// outermost loop.
+static unsigned getNumCommonLoops(LoopInfo &LI, const Loop &L, BasicBlock *BB0,
+                                  BasicBlock *BB1) {
+  Loop *L0 = LI.getLoopFor(BB0);
+  Loop *L1 = LI.getLoopFor(BB1);
+  while (L0->getLoopDepth() > L1->getLoopDepth())
+    L0 = L0->getParentLoop();
+  while (L1->getLoopDepth() > L0->getLoopDepth())
+    L1 = L1->getParentLoop();
+  while (L0 != L1) {
+    L0 = L0->getParentLoop();
+    L1 = L1->getParentLoop();
   }
+  assert(L0 && L.contains(L0));
+  return L0->getLoopDepth();
+}
+
+static Instruction *getAccessInst(const PACC *PA) {
+  return cast<Instruction>(PA->getPEXP()->getValue());
+}
+
+/// Add the dependences from @p Src to @p Tgt to @p Deps.
+///
+/// @param SrcMap       The iterations -> elements map of @p Src.
+/// @param TgtMap       The iterations -> elements map of @p Tgt.
+/// @param NumOuter     The number of loops surrounding the analyzed loop. Their
+///                     iterations are equal for source and target.
+/// @param NumCommon    The number of loops common to @p Src and @p Tgt,
+///                     including the surrounding ones.
+/// @param SrcBeforeTgt Flag to indicate @p Src precedes @p Tgt in the loop
+///                     body.
+/// @param IsExact      Flag to indicate both maps are exact.
+static void addDependences(const PACC &Src, const PACC &Tgt,
+                           const PVMap &SrcMap, PVMap TgtMap,
+                           unsigned NumOuter, unsigned NumCommon,
+                           bool SrcBeforeTgt, bool IsExact,
+                           SmallVectorImpl<PDEP *> &Deps) {
+  PDEP::DependenceKind DepKind =
+      Src.isWrite() ? (Tgt.isWrite() ? PDEP::DK_WAW : PDEP::DK_RAW)
+                    : PDEP::DK_WAR;
+
+  // All pairs of source and target iterations accessing the same element in
+  // one iteration of the surrounding loops.
+  PVMap DepMap = SrcMap;
+  DepMap.applyRange(TgtMap.reverse());
+  for (unsigned Dim = 0; Dim < NumOuter; Dim++)
+    DepMap.equateInputAndOutputDim(Dim);
+  if (DepMap.isEmpty())
+    return;
+
+  auto AddDependence = [&](unsigned Level, PVMap &LevelMap) {
+    if (LevelMap.isEmpty())
+      return;
+
+    PVMap CommonMap = LevelMap;
+    CommonMap.dropInputDimsFrom(NumCommon);
+    CommonMap.dropOutputDimsFrom(NumCommon);
+    PVSet DistanceSet = CommonMap.getDeltas();
+    DistanceSet.dropFirstInputDims(NumOuter);
+
+    PDEP *Dep = new PDEP(Src, Tgt, DepKind, Level, LevelMap, DistanceSet,
+                         SrcBeforeTgt, IsExact);
+    DEBUG(dbgs() << "New dependence: " << Dep);
+    Deps.push_back(Dep);
+  };
+
+  // The dependences carried by the common loops, thus the source iteration is
+  // executed in an earlier iteration of the loop at that level.
+  for (unsigned Level = 1; NumOuter + Level <= NumCommon; Level++) {
+    PVMap LevelMap = DepMap;
+    for (unsigned Dim = NumOuter; Dim + 1 < NumOuter + Level; Dim++)
+      LevelMap.equateInputAndOutputDim(Dim);
+    LevelMap.orderInputBeforeOutputDim(NumOuter + Level - 1);
+    AddDependence(Level, LevelMap);
+  }
+
+  // The loop independent dependences.
+  if (&Src == &Tgt || !SrcBeforeTgt)
+    return;
+
+  PVMap LevelMap = DepMap;
+  for (unsigned Dim = NumOuter; Dim < NumCommon; Dim++)
+    LevelMap.equateInputAndOutputDim(Dim);
+  AddDependence(0, LevelMap);
+}
+
+PolyhedralDependenceInfo::LoopDependences *
+PolyhedralDependenceInfo::computeDependences(Loop &L) {
+  DEBUG(dbgs() << "Compute dependences for loop: " << L.getName() << "\n");
+  LoopDependences *LD = new LoopDependences();
+
+  // Use the function as scope, thus all loops surrounding the accesses
+  // (including L and the loops around it) are represented as input dimensions
+  // of the access maps. In the scope of the parent of L, values that vary in
+  // the surrounding loops would be unrelated parameters instead.
+  LD->NumOuterLoops = L.getLoopDepth() - 1;
 
   SmallVector<BasicBlock *, 32> Blocks;
   Blocks.append(L.block_begin(), L.block_end());
-  const PACCSummary *PS =
-      PAI.getAccessSummary(Blocks, PACCSummary::SSK_COMPLETE, &L);
-  PS->dump();
+  LD->PS = PAI.getAccessSummary(Blocks, PACCSummary::SSK_COMPLETE);
+  const PACCSummary &PS = *LD->PS;
+  DEBUG(PS.dump(&PAI.getPolyhedralValueInfo()));
+
+  if (PS.getNumUnknownReads() || PS.getNumUnknownWrites()) {
+    DEBUG(dbgs() << "PDI: Loop contains unknown accesses. Dependences are "
+                    "incomplete!\n");
+    LD->HasUnknownAccesses = true;
+  }
+
+  // Number the memory accesses in program order for one iteration of the loop
+  // nest, thus in reverse post order of the loop blocks.
+  DenseMap<const Instruction *, unsigned> ProgramOrder;
+  LoopBlocksDFS DFS(&L);
+  DFS.perform(&LI);
+  unsigned Position = 0;
+  for (BasicBlock *BB : make_range(DFS.beginRPO(), DFS.endRPO()))
+    for (Instruction &I : *BB)
+      if (I.mayReadOrWriteMemory())
+        ProgramOrder[&I] = Position++;
+
+  auto ComesBefore = [&](const PACC *PA0, const PACC *PA1) {
+    return ProgramOrder.lookup(getAccessInst(PA0)) <
+           ProgramOrder.lookup(getAccessInst(PA1));
+  };
+
+  // Collect the accesses per base pointer in program order. The base pointers
+  // are ordered by their first access to get deterministic results.
+  using ArrayAccessesTy = std::pair<Value *, SmallVector<const PACC *, 8>>;
+  SmallVector<ArrayAccessesTy, 8> ArrayAccesses;
+  for (const auto &ArrayInfoMapIt : PS) {
+    const PACCSummary::ArrayInfo *AI = ArrayInfoMapIt.getSecond();
+    ArrayAccesses.push_back({ArrayInfoMapIt.getFirst(), {}});
+    auto &Accesses = ArrayAccesses.back().second;
+    for (const auto &AccessIt : AI->AccessMultiDimMap)
+      Accesses.push_back(AccessIt.first);
+    std::sort(Accesses.begin(), Accesses.end(), ComesBefore);
+  }
+  ArrayAccesses.erase(remove_if(ArrayAccesses,
+                                [](const ArrayAccessesTy &AA) {
+                                  return AA.second.empty();
+                                }),
+                      ArrayAccesses.end());
+  std::sort(ArrayAccesses.begin(), ArrayAccesses.end(),
+            [&](const ArrayAccessesTy &AA0, const ArrayAccessesTy &AA1) {
+              return ComesBefore(AA0.second.front(), AA1.second.front());
+            });
+
+  // Accesses to different base pointers are not related in the access
+  // summary. Remember the ones that might alias.
+  auto IsWritten = [](const ArrayAccessesTy &AA) {
+    return any_of(AA.second, [](const PACC *PA) { return PA->isWrite(); });
+  };
+  for (unsigned u = 0, e = ArrayAccesses.size(); u < e; u++)
+    for (unsigned v = u + 1; v < e; v++) {
+      if (!IsWritten(ArrayAccesses[u]) && !IsWritten(ArrayAccesses[v]))
+        continue;
+      Value *BP0 = ArrayAccesses[u].first, *BP1 = ArrayAccesses[v].first;
+      if (isIdentifiedObject(BP0) && isIdentifiedObject(BP1))
+        continue;
+      DEBUG(dbgs() << "PDI: Base pointers " << BP0->getName() << " and "
+                   << BP1->getName() << " may alias!\n");
+      LD->MayAliasBasePointers.push_back({BP0, BP1});
+    }
+
+  // The access functions and iteration domains are only exact where the
+  // expressions they are built from are valid. Collect the parameter values
+  // for which this is not the case for some access and compute the
+  // dependences only for the remaining ones.
+  PolyhedralValueInfo &PI = PAI.getPolyhedralValueInfo();
+  LD->InvalidContext = PVSet::empty(PI.getCtx());
+  auto AddInvalidContext = [&](const PEXP *PE) {
+    if (!PE || !PE->getInvalidDomain())
+      return;
+    PVSet InvalidDomain = PE->getInvalidDomain();
+    LD->InvalidContext.unify(InvalidDomain.dropDimsFrom(0));
+  };
+  for (const ArrayAccessesTy &AA : ArrayAccesses)
+    for (const PACC *PA : AA.second) {
+      AddInvalidContext(PA->getPEXP());
+      AddInvalidContext(PI.getDomainFor(getAccessInst(PA)->getParent()));
+    }
+  LD->InvalidContext.dropUnusedParameters();
+  PVSet ValidContext = LD->InvalidContext;
+  ValidContext.complement();
+
+  for (const ArrayAccessesTy &AA : ArrayAccesses) {
+    const PACCSummary::ArrayInfo *AI = PS.getArrayInfoForPointer(AA.first);
+    const auto &Accesses = AA.second;
+
+    // Make sure the access maps have one input dimension per surrounding loop.
+    // Missing dimensions are added unconstrained which over-approximates the
+    // accessed elements.
+    DenseMap<const PACC *, PVMap> AccessMaps;
+    SmallPtrSet<const PACC *, 8> ApproximatedAccesses(AI->MayAccesses.begin(),
+                                                      AI->MayAccesses.end());
+    for (const PACC *PA : Accesses) {
+      PVMap Map = AI->AccessMultiDimMap.lookup(PA);
+      unsigned Depth = getNestDepth(LI, L, getAccessInst(PA)->getParent());
+      if (Map.getNumInputDimensions() < Depth) {
+        Map.addInputDims(Depth - Map.getNumInputDimensions());
+        ApproximatedAccesses.insert(PA);
+      }
+      Map.intersectParams(ValidContext);
+      AccessMaps[PA] = Map;
+    }
+
+    for (const PACC *Src : Accesses) {
+      Instruction *SrcInst = getAccessInst(Src);
+      for (const PACC *Tgt : Accesses) {
+        if (!Src->isWrite() && !Tgt->isWrite())
+          continue;
+
+        Instruction *TgtInst = getAccessInst(Tgt);
+        unsigned NumCommon = getNumCommonLoops(LI, L, SrcInst->getParent(),
+                                               TgtInst->getParent());
+        bool SrcBeforeTgt =
+            ProgramOrder.lookup(SrcInst) < ProgramOrder.lookup(TgtInst);
+        bool IsExact = !ApproximatedAccesses.count(Src) &&
+                       !ApproximatedAccesses.count(Tgt);
+        addDependences(*Src, *Tgt, AccessMaps[Src], AccessMaps[Tgt],
+                       LD->NumOuterLoops, NumCommon, SrcBeforeTgt, IsExact,
+                       LD->Dependences);
+      }
+    }
+  }
+
+  return LD;
+}
+
+const PolyhedralDependenceInfo::LoopDependences &
+PolyhedralDependenceInfo::getDependences(Loop &L) {
+  PolyhedralStats::Query PSQ(PolyhedralStats::AK_DEPENDENCE,
+                             PAI.getPolyhedralValueInfo().getCtx());
+  LoopDependences *&LD = LoopDependenceMap[&L];
+  PolyhedralStats::recordCacheLookup(PolyhedralStats::AK_DEPENDENCE, LD);
+  if (!LD)
+    LD = computeDependences(L);
+  return *LD;
+}
+
+bool PolyhedralDependenceInfo::hasExactDependences(Loop &L) {
+  const LoopDependences &LD = getDependences(L);
+  return !LD.HasUnknownAccesses && LD.MayAliasBasePointers.empty() &&
+         LD.InvalidContext.isEmpty();
+}
 
-  if (PS->getNumUnknownReads() || PS->getNumUnknownWrites())
+bool PolyhedralDependenceInfo::getInnermostDimStrides(
+    Loop &L, SmallVectorImpl<AccessStride> &Strides) {
+  const LoopDependences &LD = getDependences(L);
+  if (LD.HasUnknownAccesses)
     return false;
 
-  for (const auto &ArrayInfoMapIt : *PS) {
+  PolyhedralValueInfo &PI = PAI.getPolyhedralValueInfo();
+  auto HasInvalidDomain = [](const PEXP *PE) {
+    return PE && PE->getInvalidDomain() && !PE->getInvalidDomain().isEmpty();
+  };
+
+  for (const auto &ArrayInfoMapIt : *LD.PS) {
     const PACCSummary::ArrayInfo *AI = ArrayInfoMapIt.getSecond();
-    PVMap WriteMap = AI->MustWriteMap;
-    WriteMap.union_add(AI->MayWriteMap);
-    if (!WriteMap)
-      continue;
+    for (const auto &AccessIt : AI->AccessMultiDimMap) {
+      const PACC *PA = AccessIt.first;
+      Strides.push_back({PA, AI->ElementSize, {}});
+      if (AI->MayAccesses.count(PA))
+        continue;
+
+      // The access function might not describe the access for all parameter
+      // values, e.g., if a zero extended offset could be negative.
+      if (HasInvalidDomain(PA->getPEXP()) ||
+          HasInvalidDomain(PI.getDomainFor(getAccessInst(PA)->getParent())))
+        continue;
+
+      // The last output dimension is the offset in the innermost dimension,
+      // its input dimension coefficients are the strides of the loops.
+      PVMap Map = AccessIt.second;
+      PVAff Offset = Map.getPVAffForDim(Map.getNumOutputDimensions() - 1);
+      if (!Offset)
+        continue;
+
+      auto &AccessStrides = Strides.back().Strides;
+      for (unsigned d = LD.NumOuterLoops, e = Offset.getNumInputDimensions();
+           d < e; d++) {
+        PVAff Coeff = Offset.getInputDimCoeff(d);
+        if (Coeff && Coeff.isInteger())
+          AccessStrides.push_back(Coeff.getIntegerVal());
+        else
+          AccessStrides.push_back(None);
+      }
+    }
+  }
 
-    PVMap ReadMap = AI->MustReadMap;
-    ReadMap.union_add(AI->MayReadMap);
-    if (!ReadMap)
-      continue;
+  return true;
+}
+
+bool PolyhedralDependenceInfo::getParametricSafeVectorWidth(Loop &L,
+                                                            PVAff &SafeWidth) {
+  SafeWidth = PVAff();
+  if (!L.empty()) {
+    DEBUG(dbgs() << "PDI: Loop is not innermost. Not vectorizable!\n");
+    return false;
+  }
+
+  const LoopDependences &LD = getDependences(L);
+  if (LD.HasUnknownAccesses || !LD.MayAliasBasePointers.empty())
+    return false;
 
-    PVId OffsetId(WriteMap, "Offset");
-    PVMap OffsetMap(OffsetId, PVId(), WriteMap.getOutputId());
-    WriteMap.addToOutputDimension(OffsetMap, 0);
-    PVMap &ReadWriteMap = WriteMap.intersect(ReadMap);
-    if (ReadWriteMap.isEmpty())
+  for (const PDEP *Dep : LD.Dependences) {
+    // Only dependences carried by L restrict the execution of its iterations
+    // in lock-step. If the source precedes the target in the loop body the
+    // order is preserved for any width.
+    if (Dep->getLevel() != 1 || Dep->isLexicallyForward())
       continue;
 
-    PVSet ConflictSet = ReadWriteMap.getParameterSet();
-    ConflictSet.dropUnusedParameters();
-    DEBUG(dbgs() << ConflictSet <<"\n");
-    DEBUG(dbgs() << "Conflicting accesses for " << *ArrayInfoMapIt.getFirst()
-                 << "\n\t => " << ReadWriteMap << "\n");
-    if (!ConflictSet.hasLowerBoundForParam(OffsetId))
+    PVAff MinDistance = Dep->getMinDistance(1);
+    if (!MinDistance) {
+      DEBUG(dbgs() << "PDI: Unbounded distance for " << Dep);
       return false;
+    }
 
-    ConflictSet.minForParam(OffsetId);
-    DEBUG(dbgs() << ConflictSet <<"\n");
+    SafeWidth.union_min(MinDistance);
+  }
 
-    return false;
+  DEBUG(dbgs() << "PDI: Safe vector width for " << L.getName() << ": "
+               << SafeWidth << "\n");
+  return true;
+}
+
+PVSet PolyhedralDependenceInfo::getUnsafeVectorWidthCondition(Loop &L,
+                                                              unsigned VF) {
+  PVAff SafeWidth;
+  if (!getParametricSafeVectorWidth(L, SafeWidth))
+    return PVSet();
+
+  PVSet UnsafeSet = getDependences(L).InvalidContext.getParameterSet();
+  if (SafeWidth) {
+    PVSet NarrowSet =
+        SafeWidth.getLessThanDomain(PVAff(SafeWidth.getDomain(), VF));
+    UnsafeSet.unify(NarrowSet.getParameterSet());
   }
+  UnsafeSet.dropUnusedParameters();
+  return UnsafeSet;
+}
 
-  return false;
+unsigned PolyhedralDependenceInfo::getMaxSafeVectorWidth(Loop &L) {
+  PVAff SafeWidth;
+  if (!getParametricSafeVectorWidth(L, SafeWidth))
+    return 1;
+  if (!getDependences(L).InvalidContext.isEmpty()) {
+    DEBUG(dbgs() << "PDI: Dependences are not valid for all parameters\n");
+    return 1;
+  }
+  if (!SafeWidth)
+    return UINT_MAX;
+
+  if (!SafeWidth.isInteger()) {
+    DEBUG(dbgs() << "PDI: Non-constant safe vector width " << SafeWidth
+                 << "\n");
+    return 1;
+  }
+
+  int64_t Distance = SafeWidth.getIntegerVal();
+  assert(Distance > 0 && "Expected positive distance for carried dependence");
+  return uint64_t(Distance) < UINT_MAX ? Distance : UINT_MAX;
+}
+
+bool PolyhedralDependenceInfo::isVectorizableLoop(Loop &L) {
+  return getMaxSafeVectorWidth(L) > 1;
 }
 
+void PolyhedralDependenceInfo::forgetLoop(const Loop &L) {
+  for (auto It = LoopDependenceMap.begin(), End = LoopDependenceMap.end();
+       It != End; It++) {
+    const Loop *Root = It->first;
+    if (!Root->contains(&L) && !L.contains(Root))
+      continue;
+    delete It->second;
+    LoopDependenceMap.erase(It);
+  }
+
+  PAI.forgetLoop(L);
+}
 
 void PolyhedralDependenceInfo::releaseMemory() {
+  DeleteContainerSeconds(LoopDependenceMap);
+}
+
+bool PolyhedralDependenceInfo::invalidate(
+    Function &F, const PreservedAnalyses &PA,
+    FunctionAnalysisManager::Invalidator &Inv) {
+  auto PAC = PA.getChecker<PolyhedralDependenceInfoAnalysis>();
+  if (!PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>())
+    return true;
+
+  return Inv.invalidate<PolyhedralAccessInfoAnalysis>(F, PA) ||
+         Inv.invalidate<LoopAnalysis>(F, PA);
 }
 
 void PolyhedralDependenceInfo::print(raw_ostream &OS) const {
-  auto Loops = LI.getLoopsInPreorder();
-  for (Loop *L : Loops) {
-    bool Vec =
-        const_cast<PolyhedralDependenceInfo *>(this)->isVectorizableLoop(*L);
-    DEBUG(dbgs() << "L: " << L->getName() << " Vec: " << Vec << "\n");
+  auto &PDI = *const_cast<PolyhedralDependenceInfo *>(this);
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    OS << "Loop: " << L->getName() << "\n";
+    const LoopDependences &LD = PDI.getDependences(*L);
+    if (LD.HasUnknownAccesses)
+      OS << "\tUnknown accesses: Yes\n";
+    if (!LD.InvalidContext.isEmpty())
+      OS << "\tInvalid context: " << LD.InvalidContext << "\n";
+    for (auto &BasePointers : LD.MayAliasBasePointers)
+      OS << "\tMay alias: " << BasePointers.first->getName() << ", "
+         << BasePointers.second->getName() << "\n";
+    if (LD.Dependences.empty())
+      OS << "\tDependences: None\n";
+    else
+      OS << "\tDependences:\n";
+    for (const PDEP *Dep : LD.Dependences)
+      OS << "\t - " << Dep;
+
+    if (!L->empty())
+      continue;
+
+    unsigned MaxVF = PDI.getMaxSafeVectorWidth(*L);
+    OS << "\tMax safe vector width: ";
+    if (MaxVF == UINT_MAX)
+      OS << "unlimited\n";
+    else
+      OS << MaxVF << "\n";
   }
 }
 
@@ -158,7 +601,6 @@ bool PolyhedralDependenceInfoWrapperPass::runOnFunction(Function &F) {
 
 void PolyhedralDependenceInfoWrapperPass::print(raw_ostream &OS,
                                                 const Module *M) const {
-  M->dump();
   PDI->print(OS);
 }
 
@@ -31,12 +31,102 @@ STATISTIC(COMPLEX_DOMAIN, "Number of domains to complex");
 // ------------------------------------------------------------------------- //
 
 PolyhedralValueInfoCache::~PolyhedralValueInfoCache() {
-  DeleteContainerSeconds(LoopMap);
-  DeleteContainerSeconds(ValueMap);
-  DeleteContainerSeconds(DomainMap);
+  if (PolyhedralStats::isEnabled())
+    for (const auto &It : ValueMap)
+      if (It.second->getPWA())
+        PolyhedralStats::recordPieces(It.second->getPWA().getNumPieces());
+
+  // The memory of the PEXPs is freed together with the arena, the ones that
+  // were not recycled yet still have to be destroyed.
+  recycleForgottenPEXPs();
+  for (auto &It : DomainMap)
+    It.second->~PEXP();
+  for (auto &It : ValueMap)
+    It.second->~PEXP();
+  for (auto &It : LoopMap)
+    It.second->~PEXP();
   ParameterMap.clear();
 }
 
+void PolyhedralValueInfoCache::recycleForgottenPEXPs() {
+  for (PEXP *PE : ForgottenPEXPs) {
+    PE->~PEXP();
+    FreePEXPs.push_back(PE);
+  }
+  ForgottenPEXPs.clear();
+}
+
+void PolyhedralValueInfoCache::printAllocationStatistics(
+    raw_ostream &OS) const {
+  size_t MapBytes = DomainMap.getMemorySize() + ValueMap.getMemorySize() +
+                    LoopMap.getMemorySize() + ParameterMap.getMemorySize();
+  OS << "PEXPs allocated: " << NumAllocatedPEXPs << " ("
+     << NumAllocatedPEXPs * sizeof(PEXP) << " bytes in the arena)\n";
+  OS << "PEXPs recycled: " << NumRecycledPEXPs << ", free: "
+     << FreePEXPs.size() + ForgottenPEXPs.size() << "\n";
+  OS << "Cached domains: " << DomainMap.size()
+     << ", values: " << ValueMap.size()
+     << ", backedge taken counts: " << LoopMap.size()
+     << ", parameters: " << ParameterMap.size() << "\n";
+  OS << "Cache map memory: " << MapBytes << " bytes\n";
+}
+
+bool PolyhedralValueInfoCache::isParametricIn(
+    const PEXP &PE, const SmallPtrSetImpl<const Value *> &Values) {
+  SmallVector<Value *, 8> Parameters;
+  if (PE.getPWA())
+    PE.getPWA().getParameters(Parameters);
+  if (PE.getInvalidDomain())
+    PE.getInvalidDomain().getParameters(Parameters);
+  if (PE.getKnownDomain())
+    PE.getKnownDomain().getParameters(Parameters);
+  return any_of(Parameters,
+                [&](Value *Parameter) { return Values.count(Parameter); });
+}
+
+unsigned
+PolyhedralValueInfoCache::forget(const SmallPtrSetImpl<const Value *> &Values,
+                                 const SmallPtrSetImpl<const Loop *> &Loops) {
+  unsigned NumForgotten = 0;
+
+  auto IsForgotten = [&](const Loop *Scope, const PEXP *PE) {
+    return (Scope && Loops.count(Scope)) || isParametricIn(*PE, Values);
+  };
+
+  for (auto It = DomainMap.begin(), End = DomainMap.end(); It != End; ++It)
+    if (Values.count(It->first.first) ||
+        IsForgotten(It->first.second, It->second)) {
+      forgetPEXP(It->second);
+      DomainMap.erase(It);
+      NumForgotten++;
+    }
+
+  for (auto It = ValueMap.begin(), End = ValueMap.end(); It != End; ++It)
+    if (Values.count(It->first.first) ||
+        IsForgotten(It->first.second, It->second)) {
+      forgetPEXP(It->second);
+      ValueMap.erase(It);
+      NumForgotten++;
+    }
+
+  for (auto It = LoopMap.begin(), End = LoopMap.end(); It != End; ++It)
+    if (Loops.count(It->first.first) ||
+        IsForgotten(It->first.second, It->second)) {
+      forgetPEXP(It->second);
+      LoopMap.erase(It);
+      NumForgotten++;
+    }
+
+  for (auto It = ParameterMap.begin(), End = ParameterMap.end(); It != End;
+       ++It)
+    if (Values.count(It->first)) {
+      ParameterMap.erase(It);
+      NumForgotten++;
+    }
+
+  return NumForgotten;
+}
+
 std::string PolyhedralValueInfoCache::getParameterNameForValue(Value &V) {
   std::string CudaName = NVVMRewriter<PVAff>::getCudaIntrinsicName(&V);
   if (!CudaName.empty())
@@ -151,7 +241,7 @@ bool PolyhedralExpressionBuilder::assign(PEXP *PE, const PEXP *LHSPE,
 PEXP *PolyhedralExpressionBuilder::getBackedgeTakenCount(const Loop &L) {
   assert(&L != Scope);
 
-  PEXP *PE = PIC.getOrCreateBackedgeTakenCount(L, Scope);
+  PEXP *PE = trackQueryPEXP(PIC.getOrCreateBackedgeTakenCount(L, Scope));
   if (PE->isInitialized())
     return PE;
 
@@ -162,7 +252,7 @@ PEXP *PolyhedralExpressionBuilder::getBackedgeTakenCount(const Loop &L) {
 
   // TODO: Allow (and skip) non-affine latch domains for under-approximations,
   // thus a minimal trip count.
-  if (!PI.isAffine(HeaderBBPE)) {
+  if (!PI->isAffine(HeaderBBPE)) {
     DEBUG(dbgs() << "Header " << HeaderBB->getName()
                  << " has a non-affine domain.\n");
     return PE->invalidate();
@@ -173,7 +263,7 @@ PEXP *PolyhedralExpressionBuilder::getBackedgeTakenCount(const Loop &L) {
   // TODO: Allow latch domains that do not have the proper scope for
   // both under and over-approximations, thus a minimal and maximal trip
   // count.
-  if (!PI.hasScope(HeaderBBPE, Scope, false)) {
+  if (!PI->hasScope(HeaderBBPE, Scope, false)) {
     DEBUG(dbgs() << "Header  " << HeaderBB->getName()
                   << " has a loop dependent domain.\n");
     return PE->invalidate();
@@ -235,7 +325,7 @@ bool PolyhedralExpressionBuilder::getEdgeCondition(PVSet &EdgeCondition,
                                                    BasicBlock &PredBB,
                                                    BasicBlock &BB) {
   unsigned PredLD = getRelativeLoopDepth(&PredBB);
-  EdgeCondition = PVSet::universe(PI.getCtx());
+  EdgeCondition = PVSet::universe(PI->getCtx());
   EdgeCondition.addInputDims(PredLD);
 
   auto &TI = *PredBB.getTerminator();
@@ -245,7 +335,7 @@ bool PolyhedralExpressionBuilder::getEdgeCondition(PVSet &EdgeCondition,
   }
 
   auto *TermPE = getTerminatorPEXP(PredBB);
-  if (!TermPE || PI.isNonAffine(TermPE)) {
+  if (!TermPE || PI->isNonAffine(TermPE)) {
     DEBUG(dbgs() << "Terminator of " << PredBB.getName() << " is non-affine ["<<TermPE<<"]!\n");
     return false;
   }
@@ -292,17 +382,17 @@ PEXP *PolyhedralExpressionBuilder::getDomain(BasicBlock &BB) {
   if (&BB.getParent()->getEntryBlock() == &BB) {
     DEBUG(dbgs() << "Universe domain for entry [" << BB.getName() << "]\n");
     NUM_DOMAINS++;
-    return PE->setDomain(PVSet::universe(PI.getCtx()));
+    return PE->setDomain(PVSet::universe(PI->getCtx()));
   }
 
-  auto *L = PI.LI.getLoopFor(&BB);
+  auto *L = PI->LI.getLoopFor(&BB);
   bool IsLoopHeader = L && L->getHeader() == &BB;
 
   if (Scope && (!Scope->contains(&BB) || (Scope == L && IsLoopHeader))) {
     DEBUG(dbgs() << "Universe domain for outside block [" << BB.getName()
                  << "] [" << (Scope ? Scope->getName() : "<max>") << "]\n");
     NUM_DOMAINS++;
-    return PE->setDomain(PVSet::universe(PI.getCtx()));
+    return PE->setDomain(PVSet::universe(PI->getCtx()));
   }
 
   if (L) {
@@ -310,7 +400,7 @@ PEXP *PolyhedralExpressionBuilder::getDomain(BasicBlock &BB) {
       DEBUG(dbgs() << "recurse for loop header [" << L->getHeader()->getName()
                    << "] first!\n");
       PEXP *HeaderPE = getDomain(*L->getHeader());
-      if (PI.isNonAffine(HeaderPE))
+      if (PI->isNonAffine(HeaderPE))
         return PE->invalidate();
     //} else if (auto *PL = L->getParentLoop()) {
       //DEBUG(dbgs() << "recurse for parent loop header ["
@@ -337,7 +427,7 @@ PEXP *PolyhedralExpressionBuilder::getDomain(BasicBlock &BB) {
   };
 
   unsigned LD = getRelativeLoopDepth(&BB);
-  PE->setDomain(PVSet::empty(PI.getCtx(), LD), true);
+  PE->setDomain(PVSet::empty(PI->getCtx(), LD), true);
 
   for (auto *PredBB : predecessors(&BB)) {
     DEBUG(dbgs() << " Predecessor: " << PredBB->getName() << "\n");
@@ -413,7 +503,7 @@ PEXP *PolyhedralExpressionBuilder::getDomain(BasicBlock &BB) {
         ExitingBB == &BB ? PE : getDomain(*ExitingBB);
     assert(ExitingBBDomainPE);
 
-    if (PI.isNonAffine(ExitingBBDomainPE)) {
+    if (PI->isNonAffine(ExitingBBDomainPE)) {
       DEBUG(dbgs() << "TODO: Fix exiting bb domain hack for loop domains!");
       ForgetDomainsInLoop(*L);
       return PE->invalidate();
@@ -511,15 +601,15 @@ PEXP *PolyhedralExpressionBuilder::visitOperand(Value &Op, Instruction &I) {
   return PE;
 
   Instruction *OpI = dyn_cast<Instruction>(&Op);
-  Loop *OpL = OpI ? PI.LI.getLoopFor(OpI->getParent()) : nullptr;
-  adjustDomainDimensions(PE->PWA, OpL, PI.LI.getLoopFor(I.getParent()), true);
+  Loop *OpL = OpI ? PI->LI.getLoopFor(OpI->getParent()) : nullptr;
+  adjustDomainDimensions(PE->PWA, OpL, PI->LI.getLoopFor(I.getParent()), true);
   return PE;
 
   if (!OpI) {
     return PE;
   }
 
-  Loop *OpIL = PI.LI.getLoopFor(OpI->getParent());
+  Loop *OpIL = PI->LI.getLoopFor(OpI->getParent());
   unsigned NumDims = PE->getPWA().getNumInputDimensions();
   unsigned NumLeftLoops = 0;
   while (OpIL && NumDims && !OpIL->contains(&I)) {
@@ -530,7 +620,7 @@ PEXP *PolyhedralExpressionBuilder::visitOperand(Value &Op, Instruction &I) {
 
   if (NumLeftLoops) {
     PEXP *OpIDomPE = getDomain(*OpI->getParent());
-    if (PI.isNonAffine(OpIDomPE))
+    if (PI->isNonAffine(OpIDomPE))
       PE->getPWA().dropLastInputDims(NumLeftLoops);
     else {
       PVSet OpIDom = OpIDomPE->getDomain();
@@ -543,6 +633,28 @@ PEXP *PolyhedralExpressionBuilder::visitOperand(Value &Op, Instruction &I) {
   return PE;
 }
 
+void PolyhedralExpressionBuilder::startQueryTracking() {
+  assert(!TrackQueryPEXPs && QueryPEXPs.empty());
+  TrackQueryPEXPs = true;
+}
+
+void PolyhedralExpressionBuilder::finishQueryTracking(bool Invalidate) {
+  assert(TrackQueryPEXPs);
+  TrackQueryPEXPs = false;
+
+  if (Invalidate) {
+    DEBUG(dbgs() << "Invalidate " << QueryPEXPs.size()
+                 << " PEXPs initialized in the query\n");
+    for (PEXP *PE : QueryPEXPs) {
+      PE->invalidate();
+      PE->InvalidDomain = PVSet();
+      PE->KnownDomain = PVSet();
+    }
+  }
+
+  QueryPEXPs.clear();
+}
+
 PEXP *PolyhedralExpressionBuilder::visit(Value &V) {
 
   PEXP *PE = PIC.lookup(V, Scope);
@@ -569,7 +681,14 @@ PEXP *PolyhedralExpressionBuilder::visit(Value &V) {
     PE->invalidate();
   }
 
-  if (PI.isAffine(PE))
+  // If an isl operation failed, e.g., because the operation budget of the
+  // current query is exhausted, the representation is incomplete.
+  if (!PI->isNonAffine(PE) && !PE->getPWA()) {
+    DEBUG(dbgs() << "Invalidate incomplete PE: " << PE << "\n");
+    PE->invalidate();
+  }
+
+  if (PI->isAffine(PE))
     NUM_EXPRESSIONS++;
 
   PE->PWA.dropUnusedParameters();
@@ -589,14 +708,14 @@ PEXP *PolyhedralExpressionBuilder::visit(ConstantInt &I) {
   DEBUG(dbgs() << "Visit CI: " << I << "\n";);
 
   auto *PE = getOrCreatePEXP(I);
-  PE->PWA = PVAff(PI.getCtx(), I.getSExtValue());
+  PE->PWA = PVAff(PI->getCtx(), I.getSExtValue());
   PE->setKind(PEXP::EK_INTEGER);
 
   return PE;
 }
 
 PEXP *PolyhedralExpressionBuilder::createParameter(PEXP *PE) {
-  PE->PWA = PVAff(PI.getParameterId(*PE->getValue()));
+  PE->PWA = PVAff(PI->getParameterId(*PE->getValue()));
   PE->setKind(PEXP::EK_UNKNOWN_VALUE);
 
   NUM_PARAMETERS++;
@@ -620,16 +739,16 @@ unsigned PolyhedralExpressionBuilder::getRelativeLoopDepth(Loop *L) {
 }
 
 unsigned PolyhedralExpressionBuilder::getRelativeLoopDepth(BasicBlock *BB) {
-  Loop *L = PI.LI.getLoopFor(BB);
+  Loop *L = PI->LI.getLoopFor(BB);
   return getRelativeLoopDepth(L);
 }
 
 Loop *PolyhedralExpressionBuilder::getLoopForPE(const PEXP *PE) {
   Value *V = PE->getValue();
   if (auto *I = dyn_cast<Instruction>(V))
-    return PI.LI.getLoopFor(I->getParent());
+    return PI->LI.getLoopFor(I->getParent());
   if (auto *BB = dyn_cast<BasicBlock>(V))
-    return PI.LI.getLoopFor(BB);
+    return PI->LI.getLoopFor(BB);
   return nullptr;
 }
 
@@ -757,10 +876,10 @@ PEXP *PolyhedralExpressionBuilder::getTerminatorPEXP(BasicBlock &BB) {
 PEXP *PolyhedralExpressionBuilder::visitICmpInst(ICmpInst &I) {
 
   auto *LPE = visitOperand(*I.getOperand(0), I);
-  if (PI.isNonAffine(LPE))
+  if (PI->isNonAffine(LPE))
     return visitParameter(I);
   auto *RPE = visitOperand(*I.getOperand(1), I);
-  if (PI.isNonAffine(RPE))
+  if (PI->isNonAffine(RPE))
     return visitParameter(I);
 
   DEBUG(dbgs() << "ICMP: " << I << "\n");
@@ -808,7 +927,7 @@ PolyhedralExpressionBuilder::visitGetElementPtrInst(GetElementPtrInst &I) {
   auto &DL = I.getModule()->getDataLayout();
 
   auto *PtrPE = visitOperand(*I.getPointerOperand(), I);
-  if (PI.isNonAffine(PtrPE))
+  if (PI->isNonAffine(PtrPE))
     return visitParameter(I);
 
   auto *PE = getOrCreatePEXP(I);
@@ -823,11 +942,11 @@ PolyhedralExpressionBuilder::visitGetElementPtrInst(GetElementPtrInst &I) {
   auto *Ty = I.getPointerOperandType();
   for (auto &Op : make_range(I.idx_begin(), I.idx_end())) {
     auto *PEOp = visitOperand(*Op, I);
-    if (PI.isNonAffine(PEOp))
+    if (PI->isNonAffine(PEOp))
       return visitParameter(I);
 
     if (Ty->isStructTy()) {
-      if (!PI.isConstant(PEOp)) {
+      if (!PI->isConstant(PEOp)) {
         DEBUG(dbgs() << "\nTODO: Non constant access to struct ty " << *Ty
                      << " Op: " << *Op << " for " << I << "\n");
         return visitParameter(I);
@@ -913,7 +1032,7 @@ PEXP *PolyhedralExpressionBuilder::visitCastInst(CastInst &I) {
 PEXP *PolyhedralExpressionBuilder::visitSelectInst(SelectInst &I) {
   auto *CondPE = visitOperand(*I.getCondition(), I);
   DEBUG(dbgs() << "\nCondPE: " << CondPE << "\n");
-  if (PI.isNonAffine(CondPE))
+  if (PI->isNonAffine(CondPE))
     return visitParameter(I);
 
   auto *OpTrue = visitOperand(*I.getTrueValue(), I);
@@ -927,20 +1046,20 @@ PEXP *PolyhedralExpressionBuilder::visitSelectInst(SelectInst &I) {
   DEBUG(dbgs() << "CondNonZero: " << CondNonZero << "\n");
 
   auto *PE = getOrCreatePEXP(I);
-  if (!PI.isNonAffine(OpTrue))
+  if (!PI->isNonAffine(OpTrue))
     combine(PE, OpTrue);
 
-  if (!PI.isNonAffine(OpFalse))
+  if (!PI->isNonAffine(OpFalse))
     combine(PE, OpFalse);
 
-  if (PI.isNonAffine(OpTrue)) {
+  if (PI->isNonAffine(OpTrue)) {
     PE->InvalidDomain.unify(CondNonZero);
     PE->PWA = OpFalse->getPWA();
     PE->setKind(OpFalse->getKind());
     return PE;
   }
 
-  if (PI.isNonAffine(OpFalse)) {
+  if (PI->isNonAffine(OpFalse)) {
     PE->InvalidDomain.unify(CondZero);
     PE->PWA = OpTrue->getPWA();
     PE->setKind(OpTrue->getKind());
@@ -958,8 +1077,54 @@ PEXP *PolyhedralExpressionBuilder::visitInvokeInst(InvokeInst &I) {
 }
 
 PEXP *PolyhedralExpressionBuilder::visitCallInst(CallInst &I) {
-  // TODO: Interprocedural support
-  return visitParameter(I);
+  Function *Callee = I.getCalledFunction();
+  if (!PI->PFS || !Callee || !I.getType()->isIntegerTy())
+    return visitParameter(I);
+
+  // The summary describes the return value in terms of the callee arguments.
+  const PEXP *ReturnPE = PI->PFS->getReturnPEXP(*Callee);
+  if (!ReturnPE)
+    return visitParameter(I);
+
+  SmallVector<PVId, 4> ArgIds;
+  ReturnPE->getPWA().getParameters(ArgIds);
+
+  SmallVector<const PEXP *, 4> ArgPEs;
+  for (const PVId &ArgId : ArgIds) {
+    auto *Arg = ArgId.getPayloadAs<Argument *>();
+    assert(Arg->getParent() == Callee);
+
+    auto *ArgPE = visitOperand(*I.getArgOperand(Arg->getArgNo()), I);
+    if (PI->isNonAffine(ArgPE)) {
+      DEBUG(dbgs() << "Call argument " << *Arg << " is not affine: " << ArgPE
+                   << "\n");
+      return visitParameter(I);
+    }
+    ArgPEs.push_back(ArgPE);
+  }
+
+  auto *PE = getOrCreatePEXP(I);
+  PE->setKind(ReturnPE->getKind());
+
+  SmallVector<PVAff, 4> ArgPWAs;
+  for (const PEXP *ArgPE : ArgPEs) {
+    if (!combine(PE, ArgPE))
+      return PE;
+    ArgPWAs.push_back(ArgPE->getPWA());
+  }
+
+  PE->PWA = ReturnPE->getPWA();
+  PE->PWA.substituteParameters(ArgIds, ArgPWAs);
+
+  // Sanity test.
+  unsigned LoopDims = getRelativeLoopDepth(getLoopForPE(PE));
+  unsigned NumDims = PE->PWA.getNumInputDimensions();
+  assert(LoopDims >= NumDims);
+
+  PE->PWA.addInputDims(LoopDims - NumDims);
+
+  DEBUG(dbgs() << "Call " << I << " summarized as " << PE << "\n");
+  return PE;
 }
 
 PEXP *PolyhedralExpressionBuilder::visitConditionalPHINode(PHINode &I) {
@@ -976,7 +1141,7 @@ PEXP *PolyhedralExpressionBuilder::visitConditionalPHINode(PHINode &I) {
     auto *PredOpPE = visit(*I.getIncomingValue(u));
     assert(PredOpPE);
 
-    if (PI.isNonAffine(PredOpPE)) {
+    if (PI->isNonAffine(PredOpPE)) {
       DEBUG(dbgs() << " Incoming operand (no " << u << ") is not affine ["
                    << *I.getIncomingValue(u) << "]\n");
       InvalidOtherwise = true;
@@ -1046,7 +1211,7 @@ PEXP *PolyhedralExpressionBuilder::visitConditionalPHINode(PHINode &I) {
 
 PEXP *PolyhedralExpressionBuilder::visitPHINode(PHINode &I) {
   auto &BB = *I.getParent();
-  Loop *L = PI.LI.getLoopFor(&BB);
+  Loop *L = PI->LI.getLoopFor(&BB);
   bool IsLoopHeader = L && L->getHeader() == &BB;
 
   if (!IsLoopHeader)
@@ -1064,7 +1229,7 @@ PEXP *PolyhedralExpressionBuilder::visitPHINode(PHINode &I) {
   PEXP *ParamPE = PIC.getOrCreatePEXP(I, L);
   assert(ParamPE);
 
-  PVId Id = PI.getParameterId(I);
+  PVId Id = PI->getParameterId(I);
   if (!ParamPE->isInitialized()) {
     ParamPE->PWA = PVAff(Id);
     ParamPE->Kind = PEXP::EK_UNKNOWN_VALUE;
@@ -1127,14 +1292,14 @@ PEXP *PolyhedralExpressionBuilder::visitPHINode(PHINode &I) {
       }
       if (isa<PHINode>(ParameterI) &&
           ParameterI->getParent() == I.getParent()) {
-        const PEXP *ParameterPE = PI.getPEXP(ParameterI, OldScope);
-        if (!PI.isAffine(ParameterPE)) {
+        const PEXP *ParameterPE = PI->getPEXP(ParameterI, OldScope);
+        if (!PI->isAffine(ParameterPE)) {
           DEBUG(dbgs() << "PHI operand is non-affine loop phi: " << *ParameterI
                        << "\n => " << ParameterPE << "\n";);
           setScope(OldScope);
           return visitParameter(I);
         }
-        if (!PI.hasScope(ParameterPE, L, true)) {
+        if (!PI->hasScope(ParameterPE, L, true)) {
           DEBUG(dbgs() << "PHI operand is phi with in loop dependences: "
                        << *ParameterI << "\n => " << ParameterPE << "\n";);
           setScope(OldScope);
@@ -1177,7 +1342,7 @@ PEXP *PolyhedralExpressionBuilder::visitPHINode(PHINode &I) {
     if (!OpAff.isConstant()) {
       DEBUG(dbgs() << "PHI has non constant stride: " << OpPE << "\n\tfor "
                    << *OpVal << "\n");
-      if (!PI.hasScope(*OpVal, L, true)) {
+      if (!PI->hasScope(*OpVal, L, true)) {
         // TODO: This is too strict.
         DEBUG(dbgs() << "  Operand involves instruction in loop! Invalid!\n");
         setScope(OldScope);
@@ -1248,7 +1413,7 @@ PEXP *PolyhedralExpressionBuilder::visitPHINode(PHINode &I) {
 
     auto *OpVal = I.getIncomingValue(u);
     auto *OpPE = visit(*OpVal);
-    if (PI.isNonAffine(OpPE)) {
+    if (PI->isNonAffine(OpPE)) {
       return visitParameter(I);
     }
 
@@ -1293,12 +1458,12 @@ PEXP *PolyhedralExpressionBuilder::visitBinaryOperator(BinaryOperator &I) {
 
   Value *Op0 = I.getOperand(0);
   auto *PEOp0 = visitOperand(*Op0, I);
-  if (PI.isNonAffine(PEOp0))
+  if (PI->isNonAffine(PEOp0))
     return visitParameter(I);
 
   Value *Op1 = I.getOperand(1);
   auto *PEOp1 = visitOperand(*Op1, I);
-  if (PI.isNonAffine(PEOp1))
+  if (PI->isNonAffine(PEOp1))
     return visitParameter(I);
 
   auto *PE = getOrCreatePEXP(I);
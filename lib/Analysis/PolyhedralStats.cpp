@@ -0,0 +1,195 @@
+//===--- PolyhedralStats.cpp --- Cost of the polyhedral analyses ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/PolyhedralStats.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/PValue.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
+#include <memory>
+
+using namespace llvm;
+
+static cl::opt<bool> PolyhedralStatsEnabled(
+    "polyhedral-stats", cl::init(false), cl::Hidden,
+    cl::desc("Collect and print the cost of the polyhedral analyses"));
+
+namespace {
+
+/// The counters of one analysis.
+struct AnalysisCounters {
+  /// The nesting depth of the active queries.
+  unsigned Depth = 0;
+
+  std::atomic<uint64_t> Queries;
+  std::atomic<uint64_t> CacheLookups;
+  std::atomic<uint64_t> CacheHits;
+  std::atomic<uint64_t> Operations;
+  double WallTime = 0;
+
+  AnalysisCounters() { reset(); }
+
+  void reset() {
+    Depth = 0;
+    Queries = CacheLookups = CacheHits = Operations = 0;
+    WallTime = 0;
+  }
+};
+
+/// The statistics of all analyses, printed on shutdown if any were collected.
+struct PolyhedralStatsInfo {
+  bool Enabled = false;
+
+  AnalysisCounters Counters[PolyhedralStats::AK_NUM_ANALYSES];
+
+  std::atomic<uint64_t> NumPEXPs;
+  std::atomic<uint64_t> NumPieces;
+  std::atomic<uint64_t> MaxPieces;
+
+  PolyhedralStatsInfo() { reset(); }
+
+  ~PolyhedralStatsInfo() {
+    if (!hasData())
+      return;
+    std::unique_ptr<raw_ostream> OutStream = CreateInfoOutputFile();
+    print(*OutStream);
+  }
+
+  bool hasData() const {
+    for (const AnalysisCounters &C : Counters)
+      if (C.Queries)
+        return true;
+    return NumPEXPs != 0;
+  }
+
+  void reset() {
+    for (AnalysisCounters &C : Counters)
+      C.reset();
+    NumPEXPs = NumPieces = MaxPieces = 0;
+  }
+
+  void print(raw_ostream &OS) const;
+};
+
+} // end anonymous namespace
+
+static ManagedStatic<PolyhedralStatsInfo> StatsInfo;
+
+static const char *getAnalysisName(unsigned Kind) {
+  switch (Kind) {
+  case PolyhedralStats::AK_VALUE:
+    return "value";
+  case PolyhedralStats::AK_ACCESS:
+    return "access";
+  case PolyhedralStats::AK_DEPENDENCE:
+    return "dependence";
+  default:
+    llvm_unreachable("Unknown polyhedral analysis kind");
+  }
+}
+
+void PolyhedralStatsInfo::print(raw_ostream &OS) const {
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                    ... Polyhedral analysis statistics ...\n"
+     << "===" << std::string(73, '-') << "===\n\n";
+
+  OS << "  Analysis        Queries    Lookups  Hit rate isl operations"
+        "    Wall time\n";
+  for (unsigned Kind = 0; Kind < PolyhedralStats::AK_NUM_ANALYSES; Kind++) {
+    const AnalysisCounters &C = Counters[Kind];
+    double HitRate = C.CacheLookups ? 100.0 * C.CacheHits / C.CacheLookups : 0;
+    OS << format("  %-12s %10llu %10llu %8.1f%% %14llu %11.4fs\n",
+                 getAnalysisName(Kind), (unsigned long long)C.Queries,
+                 (unsigned long long)C.CacheLookups, HitRate,
+                 (unsigned long long)C.Operations, C.WallTime);
+  }
+
+  double PiecesPerPEXP = NumPEXPs ? double(NumPieces) / NumPEXPs : 0;
+  OS << format("\n  %llu polyhedral expressions, %.2f pieces per expression "
+               "(max %llu)\n\n",
+               (unsigned long long)NumPEXPs, PiecesPerPEXP,
+               (unsigned long long)MaxPieces);
+  OS.flush();
+}
+
+PolyhedralStats::Query::Query(AnalysisKind Kind, const PVCtx &Ctx)
+    : Kind(Kind), Ctx(&Ctx), Active(false), StartOperations(0) {
+  if (!isEnabled())
+    return;
+
+  AnalysisCounters &C = StatsInfo->Counters[Kind];
+  C.Queries++;
+  if (C.Depth++)
+    return;
+
+  Active = true;
+  StartOperations = Ctx.getNumOperations();
+  StartTime = TimeRecord::getCurrentTime(true);
+}
+
+PolyhedralStats::Query::~Query() {
+  if (!isEnabled())
+    return;
+
+  AnalysisCounters &C = StatsInfo->Counters[Kind];
+  C.Depth--;
+  if (!Active)
+    return;
+
+  TimeRecord EndTime = TimeRecord::getCurrentTime(false);
+  C.WallTime += EndTime.getWallTime() - StartTime.getWallTime();
+  C.Operations += Ctx->getNumOperations() - StartOperations;
+}
+
+bool PolyhedralStats::isEnabled() {
+  return PolyhedralStatsEnabled || StatsInfo->Enabled;
+}
+
+void PolyhedralStats::setEnabled(bool Enabled) { StatsInfo->Enabled = Enabled; }
+
+void PolyhedralStats::recordCacheLookup(AnalysisKind Kind, bool Hit) {
+  if (!isEnabled())
+    return;
+
+  AnalysisCounters &C = StatsInfo->Counters[Kind];
+  C.CacheLookups++;
+  if (Hit)
+    C.CacheHits++;
+}
+
+void PolyhedralStats::recordPieces(size_t NumPieces) {
+  if (!isEnabled())
+    return;
+
+  StatsInfo->NumPEXPs++;
+  StatsInfo->NumPieces += NumPieces;
+  uint64_t Max = StatsInfo->MaxPieces;
+  while (Max < NumPieces &&
+         !StatsInfo->MaxPieces.compare_exchange_weak(Max, NumPieces))
+    ;
+}
+
+double PolyhedralStats::getWallTime(AnalysisKind Kind) {
+  return StatsInfo->Counters[Kind].WallTime;
+}
+
+unsigned long PolyhedralStats::getNumOperations(AnalysisKind Kind) {
+  return StatsInfo->Counters[Kind].Operations;
+}
+
+void PolyhedralStats::print(raw_ostream &OS) { StatsInfo->print(OS); }
+
+void PolyhedralStats::reset() { StatsInfo->reset(); }
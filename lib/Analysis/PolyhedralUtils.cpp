@@ -12,6 +12,7 @@
 
 #include "llvm/Analysis/PolyhedralUtils.h"
 
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/Analysis/PolyhedralAccessInfo.h"
 
@@ -21,3 +22,77 @@ using namespace llvm;
 
 #define DEBUG_TYPE "polyhedral-utils"
 
+
+using ParameterConstraints = SmallVector<SmallVector<PVConstraint, 4>, 4>;
+
+/// Collect the constraints of @p Set in @p Disjuncts and verify the involved
+/// parameters are integer values that are invariant in @p L (if given).
+static bool getBuildableConstraints(const PVSet &Set, const Loop *L,
+                                    ParameterConstraints &Disjuncts) {
+  if (!Set || !Set.getParameterConstraints(Disjuncts))
+    return false;
+
+  for (const auto &Conjunct : Disjuncts)
+    for (const PVConstraint &C : Conjunct)
+      for (const auto &Term : C.Terms) {
+        Value *V = Term.first.getPayloadAs<Value *>();
+        if (!V || !V->getType()->isIntegerTy() ||
+            V->getType()->getIntegerBitWidth() > 64)
+          return false;
+        if (L && !L->isLoopInvariant(V))
+          return false;
+      }
+
+  return true;
+}
+
+bool llvm::canBuildParameterSetCondition(const PVSet &Set, const Loop *L) {
+  ParameterConstraints Disjuncts;
+  return getBuildableConstraints(Set, L, Disjuncts);
+}
+
+Value *llvm::buildParameterSetCondition(IRBuilder<> &Builder,
+                                        const PVSet &Set) {
+  ParameterConstraints Disjuncts;
+  if (!getBuildableConstraints(Set, nullptr, Disjuncts))
+    return nullptr;
+
+  // The parameters are signed values, evaluate the constraints in 64 bit.
+  Type *Int64Ty = Builder.getInt64Ty();
+  Value *Cond = nullptr;
+  for (const auto &Conjunct : Disjuncts) {
+    Value *ConjunctCond = nullptr;
+    for (const PVConstraint &C : Conjunct) {
+      Value *Expr = nullptr;
+      for (const auto &Term : C.Terms) {
+        Value *V = Term.first.getPayloadAs<Value *>();
+        V = Builder.CreateSExtOrTrunc(V, Int64Ty);
+        if (Term.second != 1)
+          V = Builder.CreateMul(V, ConstantInt::get(Int64Ty, Term.second,
+                                                    /* isSigned */ true));
+        Expr = Expr ? Builder.CreateAdd(Expr, V) : V;
+      }
+      Value *Constant =
+          ConstantInt::get(Int64Ty, C.Constant, /* isSigned */ true);
+      if (!Expr)
+        Expr = Constant;
+      else if (C.Constant)
+        Expr = Builder.CreateAdd(Expr, Constant);
+
+      Value *Zero = ConstantInt::get(Int64Ty, 0);
+      Value *ConstraintCond = C.IsEquality ? Builder.CreateICmpEQ(Expr, Zero)
+                                           : Builder.CreateICmpSGE(Expr, Zero);
+      ConjunctCond = ConjunctCond
+                         ? Builder.CreateAnd(ConjunctCond, ConstraintCond)
+                         : ConstraintCond;
+    }
+
+    // A conjunction without constraints is the universe.
+    if (!ConjunctCond)
+      return Builder.getTrue();
+
+    Cond = Cond ? Builder.CreateOr(Cond, ConjunctCond) : ConjunctCond;
+  }
+
+  return Cond ? Cond : Builder.getFalse();
+}
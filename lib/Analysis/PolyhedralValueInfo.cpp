@@ -15,24 +15,41 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/PolyhedralExpressionBuilder.h"
+#include "llvm/Analysis/PolyhedralStats.h"
 #include "llvm/Analysis/RegionInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include "isl/ast.h"
-#include "isl/ast_build.h"
-
 #include <cassert>
 
 using namespace llvm;
 
 #define DEBUG_TYPE "polyhedral-value-info"
 
+STATISTIC(NUM_QUOTA_EXCEEDED,
+          "Number of queries that exceeded the isl operation budget");
+STATISTIC(NUM_FAILED_QUERIES,
+          "Number of queries that failed for other isl errors");
+STATISTIC(NUM_FORGOTTEN_PEXPS,
+          "Number of cached polyhedral values forgotten incrementally");
+
 static cl::opt<bool> PVIDisable("pvi-disable", cl::init(false), cl::Hidden,
                                 cl::desc("Disable PVI."));
 
+static cl::opt<unsigned> PVIMaxOperations(
+    "pvi-max-operations", cl::init(500000), cl::Hidden,
+    cl::desc("The maximal number of isl operations performed for a single "
+             "polyhedral value query (0 = unlimited). If the limit is "
+             "exceeded, the queried values are treated as non-affine."));
+
+static cl::opt<bool> PVIFunctionSummaries(
+    "pvi-function-summaries", cl::init(false), cl::Hidden,
+    cl::desc("Use module level summaries of the callee return values to "
+             "analyze calls."));
+
 raw_ostream &llvm::operator<<(raw_ostream &OS, PEXP::ExpressionKind Kind) {
   switch (Kind) {
   case PEXP::EK_NONE:
@@ -53,7 +70,7 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, PEXP::ExpressionKind Kind) {
 PEXP *PEXP::setDomain(const PVSet &Domain, bool Overwrite) {
   assert((!PWA || Overwrite) && "PWA already initialized");
   DEBUG(dbgs() << "SetDomain: " << Domain << " for " << Val->getName() << "\n");
-  if (Domain.isComplex()) {
+  if (!Domain || Domain.isComplex()) {
     DEBUG(dbgs() << "Domain too complex!\n");
     return invalidate();
   }
@@ -211,16 +228,65 @@ void PEXP::adjustInvalidAndKnownDomain() {
 
 // ------------------------------------------------------------------------- //
 
-PolyhedralValueInfo::PolyhedralValueInfo(PVCtx Ctx, LoopInfo &LI)
-    : Ctx(Ctx), LI(LI), PEBuilder(new PolyhedralExpressionBuilder(*this)) {
+namespace {
+
+/// Bound the number of isl operations performed for a single query.
+///
+/// Only the outermost query of a context is bounded. If its budget is
+/// exhausted, or an isl operation failed for another reason, all PEXPs
+/// initialized during the query are invalidated as they were build from
+/// incomplete isl objects.
+class BoundedQuery {
+  PVMaxOperationsGuard MaxOpsGuard;
+  PolyhedralExpressionBuilder &PEBuilder;
+
+public:
+  BoundedQuery(const PVCtx &Ctx, PolyhedralExpressionBuilder &PEBuilder)
+      : MaxOpsGuard(Ctx, PVIMaxOperations), PEBuilder(PEBuilder) {
+    if (MaxOpsGuard.isActive())
+      PEBuilder.startQueryTracking();
+  }
+
+  /// Finish the query, has to be called before the result is inspected.
+  void finish() {
+    if (!MaxOpsGuard.isActive())
+      return;
+
+    bool Failed = MaxOpsGuard.hasFailed();
+    if (MaxOpsGuard.hasQuotaExceeded()) {
+      DEBUG(dbgs() << "Query exceeded the isl operation budget!\n");
+      NUM_QUOTA_EXCEEDED++;
+    } else if (Failed) {
+      DEBUG(dbgs() << "Query failed in isl!\n");
+      NUM_FAILED_QUERIES++;
+    }
+
+    PEBuilder.finishQueryTracking(Failed);
+  }
+};
+
+} // end anonymous namespace
+
+PolyhedralValueInfo::PolyhedralValueInfo(PVCtx Ctx, LoopInfo &LI,
+                                         PolyhedralFunctionSummaries *PFS)
+    : Ctx(Ctx), LI(LI), PEBuilder(new PolyhedralExpressionBuilder(*this)),
+      PFS(PFS) {}
+
+PolyhedralValueInfo::PolyhedralValueInfo(PolyhedralValueInfo &&PVI)
+    : Ctx(PVI.Ctx), LI(PVI.LI), PEBuilder(PVI.PEBuilder), PFS(PVI.PFS) {
+  PVI.PEBuilder = nullptr;
+  PEBuilder->setPolyhedralValueInfo(*this);
 }
 
 PolyhedralValueInfo::~PolyhedralValueInfo() { delete PEBuilder; }
 
 const PEXP *PolyhedralValueInfo::getPEXP(Value *V, Loop *Scope, bool Strict,
                                          bool NoAlias) const {
+  PolyhedralStats::Query PSQ(PolyhedralStats::AK_VALUE, Ctx);
+  BoundedQuery BQ(Ctx, *PEBuilder);
   PEBuilder->setScope(Scope);
   PEXP *PE = PEBuilder->visit(*V);
+  BQ.finish();
   if (Strict && !hasScope(PE, Scope, Strict, NoAlias))
     return nullptr;
   return PE;
@@ -228,8 +294,11 @@ const PEXP *PolyhedralValueInfo::getPEXP(Value *V, Loop *Scope, bool Strict,
 
 const PEXP *PolyhedralValueInfo::getDomainFor(BasicBlock *BB, Loop *Scope,
                                               bool Strict, bool NoAlias) const {
+  PolyhedralStats::Query PSQ(PolyhedralStats::AK_VALUE, Ctx);
+  BoundedQuery BQ(Ctx, *PEBuilder);
   PEBuilder->setScope(Scope);
   PEXP *PE = PEBuilder->getDomain(*BB);
+  BQ.finish();
   if (Strict && !hasScope(PE, Scope, Strict, NoAlias))
     return nullptr;
   return PE;
@@ -240,8 +309,11 @@ const PEXP *PolyhedralValueInfo::getBackedgeTakenCount(const Loop &L,
                                                        bool NoAlias) const {
   if (PVIDisable)
     return nullptr;
+  PolyhedralStats::Query PSQ(PolyhedralStats::AK_VALUE, Ctx);
+  BoundedQuery BQ(Ctx, *PEBuilder);
   PEBuilder->setScope(Scope);
   PEXP *PE = PEBuilder->getBackedgeTakenCount(L);
+  BQ.finish();
   if (Strict && !hasScope(PE, Scope, Strict, NoAlias))
     return nullptr;
   return PE;
@@ -497,6 +569,68 @@ bool PolyhedralValueInfo::isKnownToHold(Value *LHS, Value *RHS,
   return FalseDomain.isEmpty();
 }
 
+void PolyhedralValueInfo::collectLoopNest(
+    const Loop &L, SmallPtrSetImpl<const Value *> &Values,
+    SmallPtrSetImpl<const Loop *> &Loops) {
+  SmallVector<const Loop *, 4> Worklist;
+  Worklist.push_back(&L);
+  while (!Worklist.empty()) {
+    const Loop *CurL = Worklist.pop_back_val();
+    Loops.insert(CurL);
+    Worklist.append(CurL->begin(), CurL->end());
+  }
+
+  // Transformations of the loop nest usually change the blocks around it as
+  // well, e.g., code is hoisted into the preheader and exit values are
+  // rewritten, thus they are collected too.
+  SmallVector<BasicBlock *, 8> Blocks(L.block_begin(), L.block_end());
+  if (BasicBlock *Predecessor = L.getLoopPredecessor())
+    Blocks.push_back(Predecessor);
+  L.getExitBlocks(Blocks);
+
+  for (const BasicBlock *BB : Blocks) {
+    Values.insert(BB);
+    for (const Instruction &I : *BB)
+      Values.insert(&I);
+  }
+}
+
+void PolyhedralValueInfo::forgetLoop(const Loop &L) {
+  SmallPtrSet<const Value *, 32> Values;
+  SmallPtrSet<const Loop *, 4> Loops;
+  collectLoopNest(L, Values, Loops);
+  forget(Values, Loops);
+}
+
+void PolyhedralValueInfo::forget(const SmallPtrSetImpl<const Value *> &Values,
+                                 const SmallPtrSetImpl<const Loop *> &Loops) {
+  auto &PVIC = PEBuilder->getPolyhedralValueInfoCache();
+  unsigned NumForgotten = PVIC.forget(Values, Loops);
+  NUM_FORGOTTEN_PEXPS += NumForgotten;
+  DEBUG(dbgs() << "Forgot " << NumForgotten << " cached polyhedral values\n");
+
+  // No query is in progress and the users had to drop the forgotten PEXPs,
+  // thus their memory can be reused.
+  PVIC.recycleForgottenPEXPs();
+}
+
+bool PolyhedralValueInfo::invalidate(
+    Function &F, const PreservedAnalyses &PA,
+    FunctionAnalysisManager::Invalidator &Inv) {
+  auto PAC = PA.getChecker<PolyhedralValueInfoAnalysis>();
+  if (!PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>())
+    return true;
+
+  // The cached information refers to loops and the value info itself keeps a
+  // reference to the loop info.
+  return Inv.invalidate<LoopAnalysis>(F, PA);
+}
+
+void PolyhedralValueInfo::printAllocationStatistics(raw_ostream &OS) const {
+  OS << "\nALLOCATIONS:\n";
+  PEBuilder->getPolyhedralValueInfoCache().printAllocationStatistics(OS);
+}
+
 void PolyhedralValueInfo::print(raw_ostream &OS) const {
   auto &PVIC = PEBuilder->getPolyhedralValueInfoCache();
   OS << "\nDOMAINS:\n";
@@ -512,38 +646,161 @@ void PolyhedralValueInfo::print(raw_ostream &OS) const {
        << ":\n\t" << It.second << "\n";
   }
 
+  printAllocationStatistics(OS);
+}
+
+// ------------------------------------------------------------------------- //
+
+PolyhedralFunctionSummaries::FunctionSummary::~FunctionSummary() {
+  delete ReturnPE;
+}
+
+PolyhedralFunctionSummaries::~PolyhedralFunctionSummaries() {
+  releaseMemory();
+}
+
+void PolyhedralFunctionSummaries::releaseMemory() {
+  DeleteContainerSeconds(SummaryMap);
+}
+
+const PEXP *PolyhedralFunctionSummaries::getReturnPEXP(Function &F) {
+  // A summary is reused unless the function it was computed for was deleted
+  // and another one was allocated at the same address.
+  FunctionSummary *&Summary = SummaryMap[&F];
+  if (Summary && Summary->F == &F)
+    return Summary->ReturnPE;
 
-  PVSet DomS, DomT;
-  for (BasicBlock &BB : *(*LI.begin())->getHeader()->getParent()) {
-    if (BB.getName() == "S")
-      DomS = getDomainFor(&BB)->getDomain();
-    if (BB.getName() == "T")
-      DomT = getDomainFor(&BB)->getDomain();
+  delete Summary;
+  Summary = new FunctionSummary(F);
+
+  // The summary is registered before it is computed, thus recursive calls
+  // will not be summarized. Note that the map might grow in the meantime.
+  FunctionSummary *NewSummary = Summary;
+
+  // The summary is computed with its own operation budget, independent of the
+  // query in the caller that requested it. If the computation fails the
+  // summary is not cached.
+  PVMaxOperationsGuard MaxOpsGuard(Ctx, PVIMaxOperations,
+                                   /* Independent */ true);
+  NewSummary->ReturnPE = computeReturnPEXP(F);
+  if (MaxOpsGuard.isActive() && MaxOpsGuard.hasFailed()) {
+    DEBUG(dbgs() << "Summary of " << F.getName() << " failed in isl!\n");
+    SummaryMap.erase(&F);
+    delete NewSummary;
+    return nullptr;
   }
+  return NewSummary->ReturnPE;
+}
 
-  OS<< "\n\nDomS: " << DomS << "\nDomT: " << DomT <<"\n";
-  DomT = DomT.dropLastInputDims(1);
-  OS<< "DomT: " << DomT <<"\n";
-  PVSet R = DomS;
-  R.subtract(DomT);
-  OS << "R: " << R << " DomS: " << DomS << "\n";
-  R.dropUnusedParameters();
-  DomS.dropUnusedParameters();
-  R = R.simplify(DomS);
-  OS << "R: "<<R<<"\n";
+PEXP *PolyhedralFunctionSummaries::computeReturnPEXP(Function &F) {
+  if (!F.hasExactDefinition() || !F.getReturnType()->isIntegerTy())
+    return nullptr;
 
-  auto *ASTB = isl_ast_build_from_context(isl_set_params(DomS.getObj()));
-  auto *RExp = isl_ast_build_expr_from_set(ASTB, isl_set_params(R.getObj()));
-  isl_ast_expr_dump(RExp);
+  ReturnInst *RI = nullptr;
+  for (BasicBlock &BB : F) {
+    auto *BBRI = dyn_cast<ReturnInst>(BB.getTerminator());
+    if (!BBRI)
+      continue;
+    if (RI) {
+      DEBUG(dbgs() << "Cannot summarize " << F.getName()
+                   << " with multiple returns\n");
+      return nullptr;
+    }
+    RI = BBRI;
+  }
+
+  if (!RI)
+    return nullptr;
+
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  PolyhedralValueInfo PI(Ctx, LI, this);
+
+  const PEXP *PE = PI.getPEXP(RI->getReturnValue());
+  if (!PI.isAffine(PE) || !PI.isAlwaysValid(PE)) {
+    DEBUG(dbgs() << "Cannot summarize " << F.getName() << ": " << PE << "\n");
+    return nullptr;
+  }
+
+  // Only arguments remain valid outside of the function.
+  SmallVector<Value *, 4> Parameters;
+  PI.getParameters(PE, Parameters, /* Recursive */ false);
+  for (Value *Parameter : Parameters) {
+    auto *Arg = dyn_cast<Argument>(Parameter);
+    if (!Arg || Arg->getParent() != &F) {
+      DEBUG(dbgs() << "Cannot summarize " << F.getName()
+                   << " due to parameter " << *Parameter << "\n");
+      return nullptr;
+    }
+  }
+
+  auto *SummaryPE = new PEXP(&F, nullptr);
+  *SummaryPE = *PE;
+  DEBUG(dbgs() << "Summary of " << F.getName() << ": " << SummaryPE << "\n");
+  return SummaryPE;
+}
+
+void PolyhedralFunctionSummaries::print(raw_ostream &OS) const {
+  for (auto &It : SummaryMap) {
+    if (!It.second->F)
+      continue;
+    OS << "Function: " << It.second->F->getName() << "\n";
+    OS << "\t => " << It.second->ReturnPE << "\n";
+  }
+}
+
+char PolyhedralFunctionSummariesWrapperPass::ID = 0;
+
+PolyhedralFunctionSummariesWrapperPass::PolyhedralFunctionSummariesWrapperPass()
+    : ImmutablePass(ID) {
+  initializePolyhedralFunctionSummariesWrapperPassPass(
+      *PassRegistry::getPassRegistry());
+}
+
+void PolyhedralFunctionSummariesWrapperPass::print(raw_ostream &OS,
+                                                   const Module *) const {
+  PFS.print(OS);
+}
+
+ImmutablePass *llvm::createPolyhedralFunctionSummariesWrapperPass() {
+  return new PolyhedralFunctionSummariesWrapperPass();
+}
+
+INITIALIZE_PASS(PolyhedralFunctionSummariesWrapperPass,
+                "polyhedral-function-summaries",
+                "Polyhedral function summaries", false, true)
+
+AnalysisKey PolyhedralFunctionSummariesAnalysis::Key;
+
+bool PolyhedralFunctionSummaries::isEnabled() { return PVIFunctionSummaries; }
+
+bool PolyhedralFunctionSummariesAnalysis::Result::invalidate(
+    Module &M, const PreservedAnalyses &PA,
+    ModuleAnalysisManager::Invalidator &) {
+  // Transformations can change the functions, e.g., their arguments or their
+  // return values, thus the summaries are only kept if explicitly preserved.
+  auto PAC = PA.getChecker<PolyhedralFunctionSummariesAnalysis>();
+  return !PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Module>>();
+}
+
+PolyhedralFunctionSummariesAnalysis::Result
+PolyhedralFunctionSummariesAnalysis::run(Module &M, ModuleAnalysisManager &AM) {
+  return Result();
 }
 
 // ------------------------------------------------------------------------- //
 
 char PolyhedralValueInfoWrapperPass::ID = 0;
 
+PolyhedralValueInfoWrapperPass::~PolyhedralValueInfoWrapperPass() {
+  delete PI;
+}
+
 void PolyhedralValueInfoWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
   AU.addRequiredTransitive<LoopInfoWrapperPass>();
+  if (PVIFunctionSummaries)
+    AU.addRequiredTransitive<PolyhedralFunctionSummariesWrapperPass>();
 }
 
 void PolyhedralValueInfoWrapperPass::releaseMemory() {
@@ -556,8 +813,13 @@ bool PolyhedralValueInfoWrapperPass::runOnFunction(Function &F) {
 
   auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
 
+  PolyhedralFunctionSummaries *PFS = nullptr;
+  if (PVIFunctionSummaries)
+    PFS = &getAnalysis<PolyhedralFunctionSummariesWrapperPass>().getSummaries();
+
+  // Polyhedral values of callees are only compatible if the contexts match.
   delete PI;
-  PI = new PolyhedralValueInfo(Ctx, LI);
+  PI = new PolyhedralValueInfo(PFS ? PFS->getCtx() : Ctx, LI, PFS);
 
   this->F = &F;
 
@@ -566,10 +828,10 @@ bool PolyhedralValueInfoWrapperPass::runOnFunction(Function &F) {
 
 void PolyhedralValueInfoWrapperPass::print(raw_ostream &OS,
                                            const Module *) const {
-  PI->print(OS);
-
-  if (!F)
+  if (!F) {
+    PI->print(OS);
     return;
+  }
 
   PolyhedralValueInfoWrapperPass &PIWP =
       *const_cast<PolyhedralValueInfoWrapperPass *>(this);
@@ -637,6 +899,10 @@ void PolyhedralValueInfoWrapperPass::print(raw_ostream &OS,
       Scope = Scope->getParentLoop();
     } while (true);
   }
+
+  // Print the cache, including the allocations, once all polyhedral values
+  // have been computed.
+  PI->print(OS);
 }
 
 FunctionPass *llvm::createPolyhedralValueInfoWrapperPass() {
@@ -652,11 +918,31 @@ AnalysisKey PolyhedralValueInfoAnalysis::Key;
 PolyhedralValueInfo
 PolyhedralValueInfoAnalysis::run(Function &F, FunctionAnalysisManager &AM) {
   auto &LI = AM.getResult<LoopAnalysis>(F);
-  return PolyhedralValueInfo(Ctx, LI);
+
+  // The summaries are a module analysis, thus they have to be computed
+  // before, e.g., by require<polyhedral-function-summaries>. If they are
+  // invalidated the result has to be invalidated as well.
+  PolyhedralFunctionSummaries *PFS = nullptr;
+  if (PVIFunctionSummaries) {
+    auto &MAMProxy = AM.getResult<ModuleAnalysisManagerFunctionProxy>(F);
+    PFS = MAMProxy.getManager()
+              .getCachedResult<PolyhedralFunctionSummariesAnalysis>(
+                  *F.getParent());
+    if (PFS)
+      MAMProxy.registerOuterAnalysisInvalidation<
+          PolyhedralFunctionSummariesAnalysis, PolyhedralValueInfoAnalysis>();
+    else
+      DEBUG(dbgs() << "Function summaries are not available for "
+                   << F.getName() << "!\n");
+  }
+
+  // Polyhedral values of callees are only compatible if the contexts match.
+  return PolyhedralValueInfo(PFS ? PFS->getCtx() : Ctx, LI, PFS);
 }
 
 INITIALIZE_PASS_BEGIN(PolyhedralValueInfoWrapperPass, "polyhedral-value-info",
                       "Polyhedral value analysis", false, true);
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass);
+INITIALIZE_PASS_DEPENDENCY(PolyhedralFunctionSummariesWrapperPass);
 INITIALIZE_PASS_END(PolyhedralValueInfoWrapperPass, "polyhedral-value-info",
                     "Polyhedral value analysis", false, true)
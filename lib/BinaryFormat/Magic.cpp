@@ -66,7 +66,7 @@ file_magic llvm::identify_magic(StringRef Magic) {
       return file_magic::bitcode;
     break;
   case 'B':
-    if (startswith(Magic, "BC\xC0\xDE"))
+    if (startswith(Magic, "BC\xC0\xDE") || startswith(Magic, "BCLZ"))
       return file_magic::bitcode;
     break;
   case '!':
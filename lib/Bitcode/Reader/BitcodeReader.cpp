@@ -63,6 +63,7 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -70,14 +71,19 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <deque>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <system_error>
@@ -92,6 +98,11 @@ static cl::opt<bool> PrintSummaryGUIDs(
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> MaterializeThreads(
+    "bitcode-materialize-threads", cl::init(0), cl::Hidden,
+    cl::desc("Decode the function blocks on this many threads when a whole "
+             "module is materialized (default = 0, decode them in order)"));
+
 namespace {
 
 enum {
@@ -119,11 +130,156 @@ static bool hasValidBitcodeHeader(BitstreamCursor &Stream) {
   return true;
 }
 
-static Expected<BitstreamCursor> initStream(MemoryBufferRef Buffer) {
+namespace {
+
+/// The bitcode of a compressed bitcode container, see compressBitcode. The
+/// segments are decompressed when a cursor reads them for the first time, so
+/// the function blocks of a lazily loaded module are decompressed when the
+/// functions are materialized.
+class CompressedBitcodeBytes : public BitstreamByteProvider {
+public:
+  /// Read the segment table of the container in \p Buffer, which has to
+  /// outlive the result.
+  static Expected<std::shared_ptr<CompressedBitcodeBytes>>
+  create(MemoryBufferRef Buffer);
+
+  ArrayRef<uint8_t> getBytes() const { return {Bytes.get(), Size}; }
+
+  std::pair<const uint8_t *, const uint8_t *>
+  makeAvailable(const uint8_t *Begin, const uint8_t *End) override;
+
+private:
+  struct Segment {
+    /// The offset of the segment in the bitcode.
+    size_t Begin;
+    size_t Size;
+    /// The compressed segment, or the segment itself if it is as large.
+    StringRef Data;
+  };
+
+  void decompress(unsigned Idx);
+
+  std::vector<Segment> Segments;
+  /// Whether the segments are decompressed, only set with Mutex held.
+  std::unique_ptr<std::atomic<bool>[]> Decompressed;
+  std::mutex Mutex;
+  /// The bitcode, uninitialized until the segments are decompressed.
+  std::unique_ptr<uint8_t[]> Bytes;
+  size_t Size = 0;
+};
+
+} // end anonymous namespace
+
+Expected<std::shared_ptr<CompressedBitcodeBytes>>
+CompressedBitcodeBytes::create(MemoryBufferRef Buffer) {
+  StringRef Data = Buffer.getBuffer();
+  if (Data.size() < BCZ_HeaderSize)
+    return error("Invalid compressed bitcode header");
+  const char *Header = Data.data();
+  if (support::endian::read32le(Header + BCZ_CodecField) != BCZ_LZ4)
+    return error("Unknown bitcode compression codec");
+  uint64_t Size = support::endian::read64le(Header + BCZ_SizeField);
+  uint32_t NumSegments =
+      support::endian::read32le(Header + BCZ_NumSegmentsField);
+  if ((Data.size() - BCZ_HeaderSize) / BCZ_SegmentEntrySize < NumSegments)
+    return error("Invalid compressed bitcode header");
+
+  auto Result = std::make_shared<CompressedBitcodeBytes>();
+  size_t Begin = 0;
+  size_t DataOffset = BCZ_HeaderSize + NumSegments * BCZ_SegmentEntrySize;
+  for (unsigned I = 0; I != NumSegments; ++I) {
+    const char *Entry = Header + BCZ_HeaderSize + I * BCZ_SegmentEntrySize;
+    uint32_t SegmentSize = support::endian::read32le(Entry);
+    uint32_t StoredSize = support::endian::read32le(Entry + 4);
+    // LZ4 expands a byte to at most 255.
+    if (StoredSize > SegmentSize || Data.size() - DataOffset < StoredSize ||
+        Size - Begin < SegmentSize ||
+        SegmentSize > uint64_t(StoredSize) * 255 + 16)
+      return error("Invalid compressed bitcode segment");
+    Result->Segments.push_back(
+        {Begin, SegmentSize, Data.substr(DataOffset, StoredSize)});
+    Begin += SegmentSize;
+    DataOffset += StoredSize;
+  }
+  if (Begin != Size)
+    return error("Invalid compressed bitcode segment");
+
+  Result->Decompressed.reset(new std::atomic<bool>[NumSegments]);
+  for (unsigned I = 0; I != NumSegments; ++I)
+    Result->Decompressed[I].store(false, std::memory_order_relaxed);
+  // The pages of the segments that are never read are not even touched.
+  Result->Bytes.reset(new uint8_t[Size]);
+  Result->Size = Size;
+  return std::move(Result);
+}
+
+void CompressedBitcodeBytes::decompress(unsigned Idx) {
+  if (Decompressed[Idx].load(std::memory_order_acquire))
+    return;
+  std::lock_guard<std::mutex> Lock(Mutex);
+  if (Decompressed[Idx].load(std::memory_order_relaxed))
+    return;
+  const Segment &S = Segments[Idx];
+  char *Out = reinterpret_cast<char *>(Bytes.get() + S.Begin);
+  if (S.Data.size() == S.Size) {
+    memcpy(Out, S.Data.data(), S.Size);
+  } else if (Error Err = lz4::uncompress(S.Data, Out, S.Size)) {
+    // The cursors cannot fail, a corrupt segment reads as zeros, on which the
+    // reader reports malformed bitcode.
+    consumeError(std::move(Err));
+    memset(Out, 0, S.Size);
+  }
+  Decompressed[Idx].store(true, std::memory_order_release);
+}
+
+std::pair<const uint8_t *, const uint8_t *>
+CompressedBitcodeBytes::makeAvailable(const uint8_t *Begin,
+                                      const uint8_t *End) {
+  size_t BeginOffset = Begin - Bytes.get(), EndOffset = End - Bytes.get();
+  assert(BeginOffset <= EndOffset && EndOffset <= Size &&
+         "Reading outside of the bitcode");
+  if (BeginOffset == EndOffset)
+    return {Begin, End};
+
+  // Decompress the segments overlapping [Begin, End).
+  auto First = std::upper_bound(Segments.begin(), Segments.end(), BeginOffset,
+                                [](size_t Offset, const Segment &S) {
+                                  return Offset < S.Begin;
+                                }) -
+               1;
+  auto Last = First;
+  for (;;) {
+    decompress(Last - Segments.begin());
+    if (Last->Begin + Last->Size >= EndOffset)
+      break;
+    ++Last;
+  }
+  return {Bytes.get() + First->Begin, Bytes.get() + Last->Begin + Last->Size};
+}
+
+/// Open a cursor on \p Buffer, which is decompressed by \p ByteProvider if it
+/// is a compressed bitcode container.
+static Expected<BitstreamCursor>
+initStream(MemoryBufferRef Buffer,
+           std::shared_ptr<BitstreamByteProvider> &ByteProvider) {
   const unsigned char *BufPtr = (const unsigned char *)Buffer.getBufferStart();
   const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
 
-  if (Buffer.getBufferSize() & 3)
+  if (isCompressedBitcode(BufPtr, BufEnd)) {
+    Expected<std::shared_ptr<CompressedBitcodeBytes>> BytesOrErr =
+        CompressedBitcodeBytes::create(Buffer);
+    if (!BytesOrErr)
+      return BytesOrErr.takeError();
+    ArrayRef<uint8_t> Bytes = (*BytesOrErr)->getBytes();
+    BufPtr = Bytes.begin();
+    BufEnd = Bytes.end();
+    // The wrapper header is read without a cursor.
+    (*BytesOrErr)->makeAvailable(
+        BufPtr, BufPtr + std::min<size_t>(Bytes.size(), BWH_HeaderSize));
+    ByteProvider = std::move(*BytesOrErr);
+  }
+
+  if ((BufEnd - BufPtr) & 3)
     return error("Invalid bitcode signature");
 
   // If we have a wrapper header, parse it and ignore the non-bc file contents.
@@ -132,7 +288,8 @@ static Expected<BitstreamCursor> initStream(MemoryBufferRef Buffer) {
     if (SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
       return error("Invalid bitcode wrapper header");
 
-  BitstreamCursor Stream(ArrayRef<uint8_t>(BufPtr, BufEnd));
+  BitstreamCursor Stream(ArrayRef<uint8_t>(BufPtr, BufEnd),
+                         ByteProvider.get());
   if (!hasValidBitcodeHeader(Stream))
     return error("Invalid bitcode signature");
 
@@ -437,6 +594,156 @@ BitcodeReaderBase::readNameFromStrtab(ArrayRef<uint64_t> Record) {
 
 namespace {
 
+/// The records of a function block, decoded from the bitstream ahead of the
+/// materialization of the function. Nested blocks are not decoded, only their
+/// position is recorded and they are read from the stream with the body.
+struct DecodedFunctionBlock {
+  struct Entry {
+    /// The record code, or the block ID of a nested block.
+    unsigned Code;
+    bool IsSubBlock;
+    /// The operands of a record are Ops[Begin, End), a nested block starts at
+    /// bit Begin of the stream.
+    uint64_t Begin;
+    uint64_t End;
+  };
+
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+  /// The block could not be decoded. The function is parsed from the stream
+  /// instead, which reports the error.
+  bool Malformed = false;
+};
+
+/// Decodes the function blocks of a module on a pool of threads while the
+/// functions are materialized in order. The threads only read the bitstream,
+/// each with its own cursor. All types, values and metadata are still created
+/// by the materializing thread, which owns the LLVMContext, so no uniquing
+/// table is shared. To bound the memory, only a window of blocks is decoded
+/// ahead of the materialization.
+class FunctionBlockDecoder {
+public:
+  FunctionBlockDecoder(ArrayRef<uint8_t> Bytes,
+                       BitstreamByteProvider *ByteProvider,
+                       BitstreamBlockInfo &BlockInfo, unsigned NumThreads,
+                       std::vector<std::pair<Function *, uint64_t>> Blocks);
+
+  /// Wait for the block of \p F to be decoded and take it. Returns null if
+  /// the block is not decoded ahead or could not be decoded.
+  std::unique_ptr<DecodedFunctionBlock> take(Function *F);
+
+private:
+  void decode(unsigned Idx);
+  void scheduleAhead();
+
+  ArrayRef<uint8_t> Bytes;
+  BitstreamByteProvider *ByteProvider;
+  BitstreamBlockInfo &BlockInfo;
+  std::vector<std::pair<Function *, uint64_t>> Blocks;
+  std::vector<std::unique_ptr<DecodedFunctionBlock>> Decoded;
+  std::vector<std::shared_future<void>> Done;
+  /// The index of the blocks that were not taken yet.
+  DenseMap<Function *, unsigned> Index;
+  unsigned Window;
+  unsigned NumScheduled = 0;
+  unsigned NumInFlight = 0;
+  /// Destroyed first, which waits for the decoding threads.
+  ThreadPool Pool;
+};
+
+} // end anonymous namespace
+
+FunctionBlockDecoder::FunctionBlockDecoder(
+    ArrayRef<uint8_t> Bytes, BitstreamByteProvider *ByteProvider,
+    BitstreamBlockInfo &BlockInfo, unsigned NumThreads,
+    std::vector<std::pair<Function *, uint64_t>> Blocks)
+    : Bytes(Bytes), ByteProvider(ByteProvider), BlockInfo(BlockInfo),
+      Blocks(std::move(Blocks)),
+      Window(4 * NumThreads), Pool(NumThreads) {
+  Decoded.resize(this->Blocks.size());
+  Done.resize(this->Blocks.size());
+  for (unsigned I = 0, E = this->Blocks.size(); I != E; ++I)
+    Index[this->Blocks[I].first] = I;
+  scheduleAhead();
+}
+
+void FunctionBlockDecoder::scheduleAhead() {
+  for (; NumScheduled < Blocks.size() && NumInFlight < Window; ++NumScheduled) {
+    // Skip the blocks taken before they were scheduled.
+    if (!Index.count(Blocks[NumScheduled].first))
+      continue;
+    unsigned Idx = NumScheduled;
+    Decoded[Idx] = llvm::make_unique<DecodedFunctionBlock>();
+    Done[Idx] = Pool.async([this, Idx]() { decode(Idx); });
+    ++NumInFlight;
+  }
+}
+
+void FunctionBlockDecoder::decode(unsigned Idx) {
+  DecodedFunctionBlock &Block = *Decoded[Idx];
+  BitstreamCursor Cursor(Bytes, ByteProvider);
+  Cursor.setBlockInfo(&BlockInfo);
+  if (!Cursor.canSkipToPos(Blocks[Idx].second / 8)) {
+    Block.Malformed = true;
+    return;
+  }
+  Cursor.JumpToBit(Blocks[Idx].second);
+  if (Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID)) {
+    Block.Malformed = true;
+    return;
+  }
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    BitstreamEntry Entry = Cursor.advance();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      Block.Malformed = true;
+      return;
+    case BitstreamEntry::EndBlock:
+      return;
+    case BitstreamEntry::SubBlock:
+      Block.Entries.push_back({Entry.ID, true, Cursor.GetCurrentBitNo(), 0});
+      if (Cursor.SkipBlock()) {
+        Block.Malformed = true;
+        return;
+      }
+      continue;
+    case BitstreamEntry::Record: {
+      Record.clear();
+      unsigned Code = Cursor.readRecord(Entry.ID, Record);
+      Block.Entries.push_back(
+          {Code, false, Block.Ops.size(), Block.Ops.size() + Record.size()});
+      Block.Ops.insert(Block.Ops.end(), Record.begin(), Record.end());
+      continue;
+    }
+    }
+  }
+}
+
+std::unique_ptr<DecodedFunctionBlock> FunctionBlockDecoder::take(Function *F) {
+  auto I = Index.find(F);
+  if (I == Index.end())
+    return nullptr;
+  unsigned Idx = I->second;
+  Index.erase(I);
+
+  // A function materialized out of order, e.g., because of a blockaddress,
+  // is parsed from the stream if its block was not scheduled yet.
+  std::unique_ptr<DecodedFunctionBlock> Block;
+  if (Idx < NumScheduled) {
+    Done[Idx].wait();
+    Block = std::move(Decoded[Idx]);
+    --NumInFlight;
+  }
+  scheduleAhead();
+  if (Block && Block->Malformed)
+    return nullptr;
+  return Block;
+}
+
+namespace {
+
 class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule = nullptr;
@@ -519,12 +826,21 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   bool StripDebugInfo = false;
   TBAAVerifier TBAAVerifyHelper;
 
+  /// Keeps the bytes of compressed bitcode alive while the module is read,
+  /// also by the threads of BlockDecoder.
+  std::shared_ptr<BitstreamByteProvider> ByteProvider;
+
+  /// Decodes the function blocks ahead while the whole module is materialized
+  /// with -bitcode-materialize-threads.
+  std::unique_ptr<FunctionBlockDecoder> BlockDecoder;
+
   std::vector<std::string> BundleTags;
   SmallVector<SyncScope::ID, 8> SSIDs;
 
 public:
   BitcodeReader(BitstreamCursor Stream, StringRef Strtab,
-                StringRef ProducerIdentification, LLVMContext &Context);
+                StringRef ProducerIdentification, LLVMContext &Context,
+                std::shared_ptr<BitstreamByteProvider> ByteProvider);
 
   Error materializeForwardReferencedFunctions();
 
@@ -535,7 +851,8 @@ public:
   /// \brief Main interface to parsing a bitcode buffer.
   /// \returns true if an error occurred.
   Error parseBitcodeInto(Module *M, bool ShouldLazyLoadMetadata = false,
-                         bool IsImporting = false);
+                         bool IsImporting = false,
+                         BitcodeImportCache *ImportCache = nullptr);
 
   static uint64_t decodeSignRotatedValue(uint64_t V);
 
@@ -670,7 +987,8 @@ private:
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   Error rememberAndSkipMetadata();
   Error typeCheckLoadStoreInst(Type *ValType, Type *PtrType);
-  Error parseFunctionBody(Function *F);
+  Error parseFunctionBody(Function *F,
+                          const DecodedFunctionBlock *Decoded = nullptr);
   Error globalCleanup();
   Error resolveGlobalAndIndirectSymbolInits();
   Error parseUseLists();
@@ -726,13 +1044,66 @@ class ModuleSummaryIndexBitcodeReader : public BitcodeReaderBase {
   /// this module by the client.
   unsigned ModuleId;
 
+  /// The version of the summary block being parsed.
+  uint64_t Version = 0;
+  bool IsOldProfileFormat = false;
+
+  // Keep around the last seen summary to be used when we see an optional
+  // "OriginalName" attachement.
+  GlobalValueSummary *LastSeenSummary = nullptr;
+  GlobalValue::GUID LastSeenGUID = 0;
+
+  // We can expect to see any number of type ID information records before
+  // each function summary records; these variables store the information
+  // collected so far so that it can be used to create the summary object.
+  std::vector<GlobalValue::GUID> PendingTypeTests;
+  std::vector<FunctionSummary::VFuncId> PendingTypeTestAssumeVCalls,
+      PendingTypeCheckedLoadVCalls;
+  std::vector<FunctionSummary::ConstVCall> PendingTypeTestAssumeConstVCalls,
+      PendingTypeCheckedLoadConstVCalls;
+  std::vector<FunctionSummary::ParamAccess> PendingParamAccesses;
+
+  /// Whether the summaries of a combined index with an FS_COMBINED_INDEX
+  /// record are decoded on demand rather than while parsing the module.
+  bool Lazy;
+
+  /// Cursor positioned in the summary block, used to decode the summaries on
+  /// demand.
+  BitstreamCursor LazyCursor;
+
+  /// Keeps the bytes of compressed bitcode alive while the summaries are
+  /// decoded on demand, after the BitcodeModule is gone.
+  std::shared_ptr<BitstreamByteProvider> ByteProvider;
+
+  /// The bit position the summary positions are delta encoded from: the end
+  /// of the FS_COMBINED_INDEX_OFFSET record.
+  uint64_t LazyIndexBase = 0;
+
+  /// The bit positions of the summary entries of each value which is not yet
+  /// loaded, and the values with a summary in each module.
+  DenseMap<GlobalValue::GUID, SmallVector<uint64_t, 1>> LazySummaryPos;
+  DenseMap<uint64_t, std::vector<GlobalValue::GUID>> LazyModuleValues;
+
 public:
   ModuleSummaryIndexBitcodeReader(BitstreamCursor Stream, StringRef Strtab,
                                   ModuleSummaryIndex &TheIndex,
-                                  StringRef ModulePath, unsigned ModuleId);
+                                  StringRef ModulePath, unsigned ModuleId,
+                                  bool Lazy = false,
+                                  std::shared_ptr<BitstreamByteProvider>
+                                      ByteProvider = nullptr);
 
   Error parseModule();
 
+  /// Return the values whose summaries are decoded on demand.
+  std::vector<GlobalValue::GUID> getPendingValues() const;
+
+  /// Decode the summaries of \p GUID if they are not yet loaded.
+  Error loadSummaries(GlobalValue::GUID GUID);
+  /// Decode the summaries of the values with a summary in \p Path.
+  Error loadModuleSummaries(StringRef Path);
+  /// Decode all summaries which are not yet loaded.
+  Error loadAllSummaries();
+
 private:
   void setValueGUID(uint64_t ValueID, StringRef ValueName,
                     GlobalValue::LinkageTypes Linkage,
@@ -745,6 +1116,8 @@ private:
                                                     bool IsOldProfileFormat,
                                                     bool HasProfile);
   Error parseEntireSummary(unsigned ID);
+  Error parseSummaryRecord(unsigned BitCode, ArrayRef<uint64_t> Record);
+  Error parseSummaryIndex(ArrayRef<uint64_t> Record);
   Error parseModuleStringTable();
 
   std::pair<ValueInfo, GlobalValue::GUID>
@@ -768,11 +1141,11 @@ std::error_code llvm::errorToErrorCodeAndEmitErrors(LLVMContext &Ctx,
   return std::error_code();
 }
 
-BitcodeReader::BitcodeReader(BitstreamCursor Stream, StringRef Strtab,
-                             StringRef ProducerIdentification,
-                             LLVMContext &Context)
+BitcodeReader::BitcodeReader(
+    BitstreamCursor Stream, StringRef Strtab, StringRef ProducerIdentification,
+    LLVMContext &Context, std::shared_ptr<BitstreamByteProvider> ByteProvider)
     : BitcodeReaderBase(std::move(Stream), Strtab), Context(Context),
-      ValueList(Context) {
+      ValueList(Context), ByteProvider(std::move(ByteProvider)) {
   this->ProducerIdentification = ProducerIdentification;
 }
 
@@ -873,6 +1246,11 @@ static FunctionSummary::FFlags getDecodedFFlags(uint64_t RawFlags) {
   Flags.ReadOnly = (RawFlags >> 1) & 0x1;
   Flags.NoRecurse = (RawFlags >> 2) & 0x1;
   Flags.ReturnDoesNotAlias = (RawFlags >> 3) & 0x1;
+  Flags.NoUnwind = (RawFlags >> 4) & 0x1;
+  Flags.BodyReadNone = (RawFlags >> 5) & 0x1;
+  Flags.BodyReadOnly = (RawFlags >> 6) & 0x1;
+  Flags.BodyNoUnwind = (RawFlags >> 7) & 0x1;
+  Flags.NoUnknownCalls = (RawFlags >> 8) & 0x1;
   return Flags;
 }
 
@@ -3316,10 +3694,12 @@ Error BitcodeReader::parseModule(uint64_t ResumeBit,
 }
 
 Error BitcodeReader::parseBitcodeInto(Module *M, bool ShouldLazyLoadMetadata,
-                                      bool IsImporting) {
+                                      bool IsImporting,
+                                      BitcodeImportCache *ImportCache) {
   TheModule = M;
   MDLoader = MetadataLoader(Stream, *M, ValueList, IsImporting,
-                            [&](unsigned ID) { return getTypeByID(ID); });
+                            [&](unsigned ID) { return getTypeByID(ID); },
+                            ImportCache);
   return parseModule(0, ShouldLazyLoadMetadata);
 }
 
@@ -3337,8 +3717,11 @@ Error BitcodeReader::typeCheckLoadStoreInst(Type *ValType, Type *PtrType) {
 }
 
 /// Lazily parse the specified function body block.
-Error BitcodeReader::parseFunctionBody(Function *F) {
-  if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+/// Parse the body of \p F from the stream, or from the records of its block
+/// if it was decoded ahead.
+Error BitcodeReader::parseFunctionBody(Function *F,
+                                       const DecodedFunctionBlock *Decoded) {
+  if (!Decoded && Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return error("Invalid record");
 
   // Unexpected unresolved metadata when parsing function.
@@ -3371,9 +3754,25 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
 
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
+  unsigned NextDecoded = 0;
 
   while (true) {
-    BitstreamEntry Entry = Stream.advance();
+    BitstreamEntry Entry;
+    if (!Decoded) {
+      Entry = Stream.advance();
+    } else if (NextDecoded == Decoded->Entries.size()) {
+      Entry = BitstreamEntry::getEndBlock();
+    } else {
+      // The nested blocks of a decoded block are still read from the stream.
+      const DecodedFunctionBlock::Entry &DE = Decoded->Entries[NextDecoded];
+      if (DE.IsSubBlock) {
+        ++NextDecoded;
+        Stream.JumpToBit(DE.Begin);
+        Entry = BitstreamEntry::getSubBlock(DE.Code);
+      } else {
+        Entry = BitstreamEntry::getRecord(0);
+      }
+    }
 
     switch (Entry.Kind) {
     case BitstreamEntry::Error:
@@ -3421,7 +3820,15 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     // Read a record.
     Record.clear();
     Instruction *I = nullptr;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode;
+    if (Decoded) {
+      const DecodedFunctionBlock::Entry &DE = Decoded->Entries[NextDecoded++];
+      Record.append(Decoded->Ops.begin() + DE.Begin,
+                    Decoded->Ops.begin() + DE.End);
+      BitCode = DE.Code;
+    } else {
+      BitCode = Stream.readRecord(Entry.ID, Record);
+    }
     switch (BitCode) {
     default: // Default behavior: reject
       return error("Invalid value");
@@ -4674,10 +5081,15 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   if (Error Err = materializeMetadata())
     return Err;
 
-  // Move the bit stream to the saved position of the deferred function body.
-  Stream.JumpToBit(DFII->second);
+  // Move the bit stream to the saved position of the deferred function body,
+  // unless it was decoded ahead.
+  std::unique_ptr<DecodedFunctionBlock> Decoded;
+  if (BlockDecoder)
+    Decoded = BlockDecoder->take(F);
+  if (!Decoded)
+    Stream.JumpToBit(DFII->second);
 
-  if (Error Err = parseFunctionBody(F))
+  if (Error Err = parseFunctionBody(F, Decoded.get()))
     return Err;
   F->setIsMaterializable(false);
 
@@ -4729,12 +5141,30 @@ Error BitcodeReader::materializeModule() {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  // Decode the blocks of the functions whose position is known on the
+  // requested threads.
+  if (MaterializeThreads) {
+    std::vector<std::pair<Function *, uint64_t>> Blocks;
+    for (Function &F : *TheModule) {
+      if (!F.isMaterializable())
+        continue;
+      auto DFII = DeferredFunctionInfo.find(&F);
+      if (DFII != DeferredFunctionInfo.end() && DFII->second)
+        Blocks.push_back(*DFII);
+    }
+    if (Blocks.size() > 1)
+      BlockDecoder = llvm::make_unique<FunctionBlockDecoder>(
+          Stream.getBitcodeBytes(), Stream.getByteProvider(), BlockInfo,
+          MaterializeThreads, std::move(Blocks));
+  }
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Function &F : *TheModule) {
     if (Error Err = materialize(&F))
       return Err;
   }
+  BlockDecoder.reset();
   // At this point, if there are any function bodies, parse the rest of
   // the bits in the module past the last function block we have recorded
   // through either lazy scanning or the VST.
@@ -4782,9 +5212,11 @@ std::vector<StructType *> BitcodeReader::getIdentifiedStructTypes() const {
 
 ModuleSummaryIndexBitcodeReader::ModuleSummaryIndexBitcodeReader(
     BitstreamCursor Cursor, StringRef Strtab, ModuleSummaryIndex &TheIndex,
-    StringRef ModulePath, unsigned ModuleId)
+    StringRef ModulePath, unsigned ModuleId, bool Lazy,
+    std::shared_ptr<BitstreamByteProvider> ByteProvider)
     : BitcodeReaderBase(std::move(Cursor), Strtab), TheIndex(TheIndex),
-      ModulePath(ModulePath), ModuleId(ModuleId) {}
+      ModulePath(ModulePath), ModuleId(ModuleId), Lazy(Lazy),
+      ByteProvider(std::move(ByteProvider)) {}
 
 ModuleSummaryIndex::ModuleInfo *
 ModuleSummaryIndexBitcodeReader::addThisModule() {
@@ -5058,6 +5490,43 @@ std::vector<FunctionSummary::EdgeTy> ModuleSummaryIndexBitcodeReader::makeCallLi
   return Ret;
 }
 
+/// Decode the FS_PARAM_ACCESSES record @p Record into @p ParamAccesses.
+static bool
+parseParamAccesses(ArrayRef<uint64_t> Record,
+                   std::vector<FunctionSummary::ParamAccess> &ParamAccesses) {
+  unsigned I = 0, E = Record.size();
+  auto ParseBound = [&](FunctionSummary::ParamAccess::AffineBound &B) {
+    if (I + 2 > E)
+      return false;
+    B.Constant = BitcodeReader::decodeSignRotatedValue(Record[I++]);
+    uint64_t NumTerms = Record[I++];
+    if (NumTerms > (E - I) / 2)
+      return false;
+    for (uint64_t T = 0; T < NumTerms; T++, I += 2)
+      B.Terms.push_back(
+          {Record[I], BitcodeReader::decodeSignRotatedValue(Record[I + 1])});
+    return true;
+  };
+
+  while (I < E) {
+    if (I + 2 > E)
+      return false;
+    FunctionSummary::ParamAccess PA;
+    PA.ArgNo = Record[I++];
+    uint64_t RawFlags = Record[I++];
+    PA.IsRead = RawFlags & 0x1;
+    PA.IsWritten = RawFlags & 0x2;
+    PA.HasLowerBound = RawFlags & 0x4;
+    PA.HasUpperBound = RawFlags & 0x8;
+    if (PA.HasLowerBound && !ParseBound(PA.LowerBound))
+      return false;
+    if (PA.HasUpperBound && !ParseBound(PA.UpperBound))
+      return false;
+    ParamAccesses.push_back(std::move(PA));
+  }
+  return true;
+}
+
 // Eagerly parse the entire summary block. This populates the GlobalValueSummary
 // objects in the index.
 Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
@@ -5073,27 +5542,13 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
     if (Stream.readRecord(Entry.ID, Record) != bitc::FS_VERSION)
       return error("Invalid Summary Block: version expected");
   }
-  const uint64_t Version = Record[0];
-  const bool IsOldProfileFormat = Version == 1;
+  Version = Record[0];
+  IsOldProfileFormat = Version == 1;
   if (Version < 1 || Version > 4)
     return error("Invalid summary version " + Twine(Version) +
                  ", 1, 2, 3 or 4 expected");
   Record.clear();
 
-  // Keep around the last seen summary to be used when we see an optional
-  // "OriginalName" attachement.
-  GlobalValueSummary *LastSeenSummary = nullptr;
-  GlobalValue::GUID LastSeenGUID = 0;
-
-  // We can expect to see any number of type ID information records before
-  // each function summary records; these variables store the information
-  // collected so far so that it can be used to create the summary object.
-  std::vector<GlobalValue::GUID> PendingTypeTests;
-  std::vector<FunctionSummary::VFuncId> PendingTypeTestAssumeVCalls,
-      PendingTypeCheckedLoadVCalls;
-  std::vector<FunctionSummary::ConstVCall> PendingTypeTestAssumeConstVCalls,
-      PendingTypeCheckedLoadConstVCalls;
-
   while (true) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
 
@@ -5118,258 +5573,407 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
     Record.clear();
     auto BitCode = Stream.readRecord(Entry.ID, Record);
     switch (BitCode) {
-    default: // Default behavior: ignore.
-      break;
-    case bitc::FS_VALUE_GUID: { // [valueid, refguid]
-      uint64_t ValueID = Record[0];
-      GlobalValue::GUID RefGUID = Record[1];
-      ValueIdToValueInfoMap[ValueID] =
-          std::make_pair(TheIndex.getOrInsertValueInfo(RefGUID), RefGUID);
+    // FS_COMBINED_INDEX_OFFSET: [offset]
+    case bitc::FS_COMBINED_INDEX_OFFSET: {
+      if (!Lazy)
+        break;
+      if (Record.size() != 2)
+        return error("Invalid record");
+      // Skip the summary entries, they are decoded on demand through the
+      // FS_COMBINED_INDEX record at the end of the block.
+      uint64_t Offset = Record[0] + (Record[1] << 32);
+      LazyIndexBase = Stream.GetCurrentBitNo();
+      LazyCursor = Stream;
+      Stream.JumpToBit(LazyIndexBase + Offset);
       break;
     }
-    // FS_PERMODULE: [valueid, flags, instcount, fflags, numrefs,
-    //                numrefs x valueid, n x (valueid)]
-    // FS_PERMODULE_PROFILE: [valueid, flags, instcount, fflags, numrefs,
-    //                        numrefs x valueid,
-    //                        n x (valueid, hotness)]
-    case bitc::FS_PERMODULE:
-    case bitc::FS_PERMODULE_PROFILE: {
-      unsigned ValueID = Record[0];
-      uint64_t RawFlags = Record[1];
-      unsigned InstCount = Record[2];
-      uint64_t RawFunFlags = 0;
-      unsigned NumRefs = Record[3];
-      int RefListStartIndex = 4;
-      if (Version >= 4) {
-        RawFunFlags = Record[3];
-        NumRefs = Record[4];
-        RefListStartIndex = 5;
-      }
-
-      auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
-      // The module path string ref set in the summary must be owned by the
-      // index's module string table. Since we don't have a module path
-      // string table section in the per-module index, we create a single
-      // module path string table entry with an empty (0) ID to take
-      // ownership.
-      int CallGraphEdgeStartIndex = RefListStartIndex + NumRefs;
-      assert(Record.size() >= RefListStartIndex + NumRefs &&
-             "Record size inconsistent with number of references");
-      std::vector<ValueInfo> Refs = makeRefList(
-          ArrayRef<uint64_t>(Record).slice(RefListStartIndex, NumRefs));
-      bool HasProfile = (BitCode == bitc::FS_PERMODULE_PROFILE);
-      std::vector<FunctionSummary::EdgeTy> Calls = makeCallList(
-          ArrayRef<uint64_t>(Record).slice(CallGraphEdgeStartIndex),
-          IsOldProfileFormat, HasProfile);
-      auto FS = llvm::make_unique<FunctionSummary>(
-          Flags, InstCount, getDecodedFFlags(RawFunFlags), std::move(Refs),
-          std::move(Calls), std::move(PendingTypeTests),
-          std::move(PendingTypeTestAssumeVCalls),
-          std::move(PendingTypeCheckedLoadVCalls),
-          std::move(PendingTypeTestAssumeConstVCalls),
-          std::move(PendingTypeCheckedLoadConstVCalls));
-      PendingTypeTests.clear();
-      PendingTypeTestAssumeVCalls.clear();
-      PendingTypeCheckedLoadVCalls.clear();
-      PendingTypeTestAssumeConstVCalls.clear();
-      PendingTypeCheckedLoadConstVCalls.clear();
-      auto VIAndOriginalGUID = getValueInfoFromValueId(ValueID);
-      FS->setModulePath(addThisModule()->first());
-      FS->setOriginalName(VIAndOriginalGUID.second);
-      TheIndex.addGlobalValueSummary(VIAndOriginalGUID.first, std::move(FS));
-      break;
-    }
-    // FS_ALIAS: [valueid, flags, valueid]
-    // Aliases must be emitted (and parsed) after all FS_PERMODULE entries, as
-    // they expect all aliasee summaries to be available.
-    case bitc::FS_ALIAS: {
-      unsigned ValueID = Record[0];
-      uint64_t RawFlags = Record[1];
-      unsigned AliaseeID = Record[2];
-      auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
-      auto AS = llvm::make_unique<AliasSummary>(Flags);
-      // The module path string ref set in the summary must be owned by the
-      // index's module string table. Since we don't have a module path
-      // string table section in the per-module index, we create a single
-      // module path string table entry with an empty (0) ID to take
-      // ownership.
-      AS->setModulePath(addThisModule()->first());
-
-      GlobalValue::GUID AliaseeGUID =
-          getValueInfoFromValueId(AliaseeID).first.getGUID();
-      auto AliaseeInModule =
-          TheIndex.findSummaryInModule(AliaseeGUID, ModulePath);
-      if (!AliaseeInModule)
-        return error("Alias expects aliasee summary to be parsed");
-      AS->setAliasee(AliaseeInModule);
-      AS->setAliaseeGUID(AliaseeGUID);
-
-      auto GUID = getValueInfoFromValueId(ValueID);
-      AS->setOriginalName(GUID.second);
-      TheIndex.addGlobalValueSummary(GUID.first, std::move(AS));
-      break;
-    }
-    // FS_PERMODULE_GLOBALVAR_INIT_REFS: [valueid, flags, n x valueid]
-    case bitc::FS_PERMODULE_GLOBALVAR_INIT_REFS: {
-      unsigned ValueID = Record[0];
-      uint64_t RawFlags = Record[1];
-      auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
-      std::vector<ValueInfo> Refs =
-          makeRefList(ArrayRef<uint64_t>(Record).slice(2));
-      auto FS = llvm::make_unique<GlobalVarSummary>(Flags, std::move(Refs));
-      FS->setModulePath(addThisModule()->first());
-      auto GUID = getValueInfoFromValueId(ValueID);
-      FS->setOriginalName(GUID.second);
-      TheIndex.addGlobalValueSummary(GUID.first, std::move(FS));
-      break;
-    }
-    // FS_COMBINED: [valueid, modid, flags, instcount, fflags, numrefs,
-    //               numrefs x valueid, n x (valueid)]
-    // FS_COMBINED_PROFILE: [valueid, modid, flags, instcount, fflags, numrefs,
-    //                       numrefs x valueid, n x (valueid, hotness)]
-    case bitc::FS_COMBINED:
-    case bitc::FS_COMBINED_PROFILE: {
-      unsigned ValueID = Record[0];
-      uint64_t ModuleId = Record[1];
-      uint64_t RawFlags = Record[2];
-      unsigned InstCount = Record[3];
-      uint64_t RawFunFlags = 0;
-      unsigned NumRefs = Record[4];
-      int RefListStartIndex = 5;
-
-      if (Version >= 4) {
-        RawFunFlags = Record[4];
-        NumRefs = Record[5];
-        RefListStartIndex = 6;
-      }
-
-      auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
-      int CallGraphEdgeStartIndex = RefListStartIndex + NumRefs;
-      assert(Record.size() >= RefListStartIndex + NumRefs &&
-             "Record size inconsistent with number of references");
-      std::vector<ValueInfo> Refs = makeRefList(
-          ArrayRef<uint64_t>(Record).slice(RefListStartIndex, NumRefs));
-      bool HasProfile = (BitCode == bitc::FS_COMBINED_PROFILE);
-      std::vector<FunctionSummary::EdgeTy> Edges = makeCallList(
-          ArrayRef<uint64_t>(Record).slice(CallGraphEdgeStartIndex),
-          IsOldProfileFormat, HasProfile);
-      ValueInfo VI = getValueInfoFromValueId(ValueID).first;
-      auto FS = llvm::make_unique<FunctionSummary>(
-          Flags, InstCount, getDecodedFFlags(RawFunFlags), std::move(Refs),
-          std::move(Edges), std::move(PendingTypeTests),
-          std::move(PendingTypeTestAssumeVCalls),
-          std::move(PendingTypeCheckedLoadVCalls),
-          std::move(PendingTypeTestAssumeConstVCalls),
-          std::move(PendingTypeCheckedLoadConstVCalls));
-      PendingTypeTests.clear();
-      PendingTypeTestAssumeVCalls.clear();
-      PendingTypeCheckedLoadVCalls.clear();
-      PendingTypeTestAssumeConstVCalls.clear();
-      PendingTypeCheckedLoadConstVCalls.clear();
-      LastSeenSummary = FS.get();
-      LastSeenGUID = VI.getGUID();
-      FS->setModulePath(ModuleIdMap[ModuleId]);
-      TheIndex.addGlobalValueSummary(VI, std::move(FS));
-      break;
-    }
-    // FS_COMBINED_ALIAS: [valueid, modid, flags, valueid]
-    // Aliases must be emitted (and parsed) after all FS_COMBINED entries, as
-    // they expect all aliasee summaries to be available.
-    case bitc::FS_COMBINED_ALIAS: {
-      unsigned ValueID = Record[0];
-      uint64_t ModuleId = Record[1];
-      uint64_t RawFlags = Record[2];
-      unsigned AliaseeValueId = Record[3];
-      auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
-      auto AS = llvm::make_unique<AliasSummary>(Flags);
-      LastSeenSummary = AS.get();
-      AS->setModulePath(ModuleIdMap[ModuleId]);
-
-      auto AliaseeGUID =
-          getValueInfoFromValueId(AliaseeValueId).first.getGUID();
-      auto AliaseeInModule =
-          TheIndex.findSummaryInModule(AliaseeGUID, AS->modulePath());
-      AS->setAliasee(AliaseeInModule);
-      AS->setAliaseeGUID(AliaseeGUID);
-
-      ValueInfo VI = getValueInfoFromValueId(ValueID).first;
-      LastSeenGUID = VI.getGUID();
-      TheIndex.addGlobalValueSummary(VI, std::move(AS));
-      break;
-    }
-    // FS_COMBINED_GLOBALVAR_INIT_REFS: [valueid, modid, flags, n x valueid]
-    case bitc::FS_COMBINED_GLOBALVAR_INIT_REFS: {
-      unsigned ValueID = Record[0];
-      uint64_t ModuleId = Record[1];
-      uint64_t RawFlags = Record[2];
-      auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
-      std::vector<ValueInfo> Refs =
-          makeRefList(ArrayRef<uint64_t>(Record).slice(3));
-      auto FS = llvm::make_unique<GlobalVarSummary>(Flags, std::move(Refs));
-      LastSeenSummary = FS.get();
-      FS->setModulePath(ModuleIdMap[ModuleId]);
-      ValueInfo VI = getValueInfoFromValueId(ValueID).first;
-      LastSeenGUID = VI.getGUID();
-      TheIndex.addGlobalValueSummary(VI, std::move(FS));
+    // FS_COMBINED_INDEX: [n x (valueid, modid, bitpos)]
+    case bitc::FS_COMBINED_INDEX:
+      if (!Lazy || !LazyIndexBase)
+        break;
+      if (Error Err = parseSummaryIndex(Record))
+        return Err;
       break;
-    }
-    // FS_COMBINED_ORIGINAL_NAME: [original_name]
-    case bitc::FS_COMBINED_ORIGINAL_NAME: {
-      uint64_t OriginalName = Record[0];
-      if (!LastSeenSummary)
-        return error("Name attachment that does not follow a combined record");
-      LastSeenSummary->setOriginalName(OriginalName);
-      TheIndex.addOriginalName(LastSeenGUID, OriginalName);
-      // Reset the LastSeenSummary
-      LastSeenSummary = nullptr;
-      LastSeenGUID = 0;
+    default:
+      if (Error Err = parseSummaryRecord(BitCode, Record))
+        return Err;
       break;
     }
-    case bitc::FS_TYPE_TESTS:
-      assert(PendingTypeTests.empty());
-      PendingTypeTests.insert(PendingTypeTests.end(), Record.begin(),
-                              Record.end());
-      break;
+  }
+  llvm_unreachable("Exit infinite loop");
+}
 
-    case bitc::FS_TYPE_TEST_ASSUME_VCALLS:
-      assert(PendingTypeTestAssumeVCalls.empty());
-      for (unsigned I = 0; I != Record.size(); I += 2)
-        PendingTypeTestAssumeVCalls.push_back({Record[I], Record[I+1]});
-      break;
+// Parse one record of the summary block other than the version and the index
+// of the summaries.
+Error ModuleSummaryIndexBitcodeReader::parseSummaryRecord(
+    unsigned BitCode, ArrayRef<uint64_t> Record) {
+  switch (BitCode) {
+  default: // Default behavior: ignore.
+    break;
+  case bitc::FS_VALUE_GUID: { // [valueid, refguid]
+    uint64_t ValueID = Record[0];
+    GlobalValue::GUID RefGUID = Record[1];
+    ValueIdToValueInfoMap[ValueID] =
+        std::make_pair(TheIndex.getOrInsertValueInfo(RefGUID), RefGUID);
+    break;
+  }
+  // FS_PERMODULE: [valueid, flags, instcount, fflags, numrefs,
+  //                numrefs x valueid, n x (valueid)]
+  // FS_PERMODULE_PROFILE: [valueid, flags, instcount, fflags, numrefs,
+  //                        numrefs x valueid,
+  //                        n x (valueid, hotness)]
+  case bitc::FS_PERMODULE:
+  case bitc::FS_PERMODULE_PROFILE: {
+    unsigned ValueID = Record[0];
+    uint64_t RawFlags = Record[1];
+    unsigned InstCount = Record[2];
+    uint64_t RawFunFlags = 0;
+    unsigned NumRefs = Record[3];
+    int RefListStartIndex = 4;
+    if (Version >= 4) {
+      RawFunFlags = Record[3];
+      NumRefs = Record[4];
+      RefListStartIndex = 5;
+    }
+
+    auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
+    // The module path string ref set in the summary must be owned by the
+    // index's module string table. Since we don't have a module path
+    // string table section in the per-module index, we create a single
+    // module path string table entry with an empty (0) ID to take
+    // ownership.
+    int CallGraphEdgeStartIndex = RefListStartIndex + NumRefs;
+    assert(Record.size() >= RefListStartIndex + NumRefs &&
+           "Record size inconsistent with number of references");
+    std::vector<ValueInfo> Refs = makeRefList(
+        ArrayRef<uint64_t>(Record).slice(RefListStartIndex, NumRefs));
+    bool HasProfile = (BitCode == bitc::FS_PERMODULE_PROFILE);
+    std::vector<FunctionSummary::EdgeTy> Calls = makeCallList(
+        ArrayRef<uint64_t>(Record).slice(CallGraphEdgeStartIndex),
+        IsOldProfileFormat, HasProfile);
+    auto FS = llvm::make_unique<FunctionSummary>(
+        Flags, InstCount, getDecodedFFlags(RawFunFlags), std::move(Refs),
+        std::move(Calls), std::move(PendingTypeTests),
+        std::move(PendingTypeTestAssumeVCalls),
+        std::move(PendingTypeCheckedLoadVCalls),
+        std::move(PendingTypeTestAssumeConstVCalls),
+        std::move(PendingTypeCheckedLoadConstVCalls));
+    PendingTypeTests.clear();
+    PendingTypeTestAssumeVCalls.clear();
+    PendingTypeCheckedLoadVCalls.clear();
+    PendingTypeTestAssumeConstVCalls.clear();
+    PendingTypeCheckedLoadConstVCalls.clear();
+    FS->setParamAccesses(std::move(PendingParamAccesses));
+    PendingParamAccesses.clear();
+    auto VIAndOriginalGUID = getValueInfoFromValueId(ValueID);
+    FS->setModulePath(addThisModule()->first());
+    FS->setOriginalName(VIAndOriginalGUID.second);
+    TheIndex.addGlobalValueSummary(VIAndOriginalGUID.first, std::move(FS));
+    break;
+  }
+  // FS_ALIAS: [valueid, flags, valueid]
+  // Aliases must be emitted (and parsed) after all FS_PERMODULE entries, as
+  // they expect all aliasee summaries to be available.
+  case bitc::FS_ALIAS: {
+    unsigned ValueID = Record[0];
+    uint64_t RawFlags = Record[1];
+    unsigned AliaseeID = Record[2];
+    auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
+    auto AS = llvm::make_unique<AliasSummary>(Flags);
+    // The module path string ref set in the summary must be owned by the
+    // index's module string table. Since we don't have a module path
+    // string table section in the per-module index, we create a single
+    // module path string table entry with an empty (0) ID to take
+    // ownership.
+    AS->setModulePath(addThisModule()->first());
+
+    GlobalValue::GUID AliaseeGUID =
+        getValueInfoFromValueId(AliaseeID).first.getGUID();
+    auto AliaseeInModule =
+        TheIndex.findSummaryInModule(AliaseeGUID, ModulePath);
+    if (!AliaseeInModule)
+      return error("Alias expects aliasee summary to be parsed");
+    AS->setAliasee(AliaseeInModule);
+    AS->setAliaseeGUID(AliaseeGUID);
+
+    auto GUID = getValueInfoFromValueId(ValueID);
+    AS->setOriginalName(GUID.second);
+    TheIndex.addGlobalValueSummary(GUID.first, std::move(AS));
+    break;
+  }
+  // FS_PERMODULE_GLOBALVAR_INIT_REFS: [valueid, flags, n x valueid]
+  case bitc::FS_PERMODULE_GLOBALVAR_INIT_REFS: {
+    unsigned ValueID = Record[0];
+    uint64_t RawFlags = Record[1];
+    auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
+    std::vector<ValueInfo> Refs =
+        makeRefList(ArrayRef<uint64_t>(Record).slice(2));
+    auto FS = llvm::make_unique<GlobalVarSummary>(Flags, std::move(Refs));
+    FS->setModulePath(addThisModule()->first());
+    auto GUID = getValueInfoFromValueId(ValueID);
+    FS->setOriginalName(GUID.second);
+    TheIndex.addGlobalValueSummary(GUID.first, std::move(FS));
+    break;
+  }
+  // FS_COMBINED: [valueid, modid, flags, instcount, fflags, numrefs,
+  //               numrefs x valueid, n x (valueid)]
+  // FS_COMBINED_PROFILE: [valueid, modid, flags, instcount, fflags, numrefs,
+  //                       numrefs x valueid, n x (valueid, hotness)]
+  case bitc::FS_COMBINED:
+  case bitc::FS_COMBINED_PROFILE: {
+    unsigned ValueID = Record[0];
+    uint64_t ModuleId = Record[1];
+    uint64_t RawFlags = Record[2];
+    unsigned InstCount = Record[3];
+    uint64_t RawFunFlags = 0;
+    unsigned NumRefs = Record[4];
+    int RefListStartIndex = 5;
+
+    if (Version >= 4) {
+      RawFunFlags = Record[4];
+      NumRefs = Record[5];
+      RefListStartIndex = 6;
+    }
+
+    auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
+    int CallGraphEdgeStartIndex = RefListStartIndex + NumRefs;
+    assert(Record.size() >= RefListStartIndex + NumRefs &&
+           "Record size inconsistent with number of references");
+    std::vector<ValueInfo> Refs = makeRefList(
+        ArrayRef<uint64_t>(Record).slice(RefListStartIndex, NumRefs));
+    bool HasProfile = (BitCode == bitc::FS_COMBINED_PROFILE);
+    std::vector<FunctionSummary::EdgeTy> Edges = makeCallList(
+        ArrayRef<uint64_t>(Record).slice(CallGraphEdgeStartIndex),
+        IsOldProfileFormat, HasProfile);
+    ValueInfo VI = getValueInfoFromValueId(ValueID).first;
+    auto FS = llvm::make_unique<FunctionSummary>(
+        Flags, InstCount, getDecodedFFlags(RawFunFlags), std::move(Refs),
+        std::move(Edges), std::move(PendingTypeTests),
+        std::move(PendingTypeTestAssumeVCalls),
+        std::move(PendingTypeCheckedLoadVCalls),
+        std::move(PendingTypeTestAssumeConstVCalls),
+        std::move(PendingTypeCheckedLoadConstVCalls));
+    PendingTypeTests.clear();
+    PendingTypeTestAssumeVCalls.clear();
+    PendingTypeCheckedLoadVCalls.clear();
+    PendingTypeTestAssumeConstVCalls.clear();
+    PendingTypeCheckedLoadConstVCalls.clear();
+    FS->setParamAccesses(std::move(PendingParamAccesses));
+    PendingParamAccesses.clear();
+    LastSeenSummary = FS.get();
+    LastSeenGUID = VI.getGUID();
+    FS->setModulePath(ModuleIdMap[ModuleId]);
+    TheIndex.addGlobalValueSummary(VI, std::move(FS));
+    break;
+  }
+  // FS_COMBINED_ALIAS: [valueid, modid, flags, valueid]
+  // Aliases must be emitted (and parsed) after all FS_COMBINED entries, as
+  // they expect all aliasee summaries to be available.
+  case bitc::FS_COMBINED_ALIAS: {
+    unsigned ValueID = Record[0];
+    uint64_t ModuleId = Record[1];
+    uint64_t RawFlags = Record[2];
+    unsigned AliaseeValueId = Record[3];
+    auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
+    auto AS = llvm::make_unique<AliasSummary>(Flags);
+    AS->setModulePath(ModuleIdMap[ModuleId]);
+
+    // In a lazily read index looking up the aliasee may decode its summary,
+    // only remember the alias afterwards.
+    auto AliaseeGUID =
+        getValueInfoFromValueId(AliaseeValueId).first.getGUID();
+    auto AliaseeInModule =
+        TheIndex.findSummaryInModule(AliaseeGUID, AS->modulePath());
+    AS->setAliasee(AliaseeInModule);
+    AS->setAliaseeGUID(AliaseeGUID);
+    LastSeenSummary = AS.get();
+
+    ValueInfo VI = getValueInfoFromValueId(ValueID).first;
+    LastSeenGUID = VI.getGUID();
+    TheIndex.addGlobalValueSummary(VI, std::move(AS));
+    break;
+  }
+  // FS_COMBINED_GLOBALVAR_INIT_REFS: [valueid, modid, flags, n x valueid]
+  case bitc::FS_COMBINED_GLOBALVAR_INIT_REFS: {
+    unsigned ValueID = Record[0];
+    uint64_t ModuleId = Record[1];
+    uint64_t RawFlags = Record[2];
+    auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
+    std::vector<ValueInfo> Refs =
+        makeRefList(ArrayRef<uint64_t>(Record).slice(3));
+    auto FS = llvm::make_unique<GlobalVarSummary>(Flags, std::move(Refs));
+    LastSeenSummary = FS.get();
+    FS->setModulePath(ModuleIdMap[ModuleId]);
+    ValueInfo VI = getValueInfoFromValueId(ValueID).first;
+    LastSeenGUID = VI.getGUID();
+    TheIndex.addGlobalValueSummary(VI, std::move(FS));
+    break;
+  }
+  // FS_COMBINED_ORIGINAL_NAME: [original_name]
+  case bitc::FS_COMBINED_ORIGINAL_NAME: {
+    uint64_t OriginalName = Record[0];
+    if (!LastSeenSummary)
+      return error("Name attachment that does not follow a combined record");
+    LastSeenSummary->setOriginalName(OriginalName);
+    TheIndex.addOriginalName(LastSeenGUID, OriginalName);
+    // Reset the LastSeenSummary
+    LastSeenSummary = nullptr;
+    LastSeenGUID = 0;
+    break;
+  }
+  case bitc::FS_TYPE_TESTS:
+    assert(PendingTypeTests.empty());
+    PendingTypeTests.insert(PendingTypeTests.end(), Record.begin(),
+                            Record.end());
+    break;
 
-    case bitc::FS_TYPE_CHECKED_LOAD_VCALLS:
-      assert(PendingTypeCheckedLoadVCalls.empty());
-      for (unsigned I = 0; I != Record.size(); I += 2)
-        PendingTypeCheckedLoadVCalls.push_back({Record[I], Record[I+1]});
-      break;
+  case bitc::FS_TYPE_TEST_ASSUME_VCALLS:
+    assert(PendingTypeTestAssumeVCalls.empty());
+    for (unsigned I = 0; I != Record.size(); I += 2)
+      PendingTypeTestAssumeVCalls.push_back({Record[I], Record[I+1]});
+    break;
 
-    case bitc::FS_TYPE_TEST_ASSUME_CONST_VCALL:
-      PendingTypeTestAssumeConstVCalls.push_back(
-          {{Record[0], Record[1]}, {Record.begin() + 2, Record.end()}});
-      break;
+  case bitc::FS_TYPE_CHECKED_LOAD_VCALLS:
+    assert(PendingTypeCheckedLoadVCalls.empty());
+    for (unsigned I = 0; I != Record.size(); I += 2)
+      PendingTypeCheckedLoadVCalls.push_back({Record[I], Record[I+1]});
+    break;
 
-    case bitc::FS_TYPE_CHECKED_LOAD_CONST_VCALL:
-      PendingTypeCheckedLoadConstVCalls.push_back(
-          {{Record[0], Record[1]}, {Record.begin() + 2, Record.end()}});
-      break;
+  case bitc::FS_TYPE_TEST_ASSUME_CONST_VCALL:
+    PendingTypeTestAssumeConstVCalls.push_back(
+        {{Record[0], Record[1]}, {Record.begin() + 2, Record.end()}});
+    break;
 
-    case bitc::FS_CFI_FUNCTION_DEFS: {
-      std::set<std::string> &CfiFunctionDefs = TheIndex.cfiFunctionDefs();
-      for (unsigned I = 0; I != Record.size(); I += 2)
-        CfiFunctionDefs.insert(
-            {Strtab.data() + Record[I], static_cast<size_t>(Record[I + 1])});
-      break;
-    }
-    case bitc::FS_CFI_FUNCTION_DECLS: {
-      std::set<std::string> &CfiFunctionDecls = TheIndex.cfiFunctionDecls();
-      for (unsigned I = 0; I != Record.size(); I += 2)
-        CfiFunctionDecls.insert(
-            {Strtab.data() + Record[I], static_cast<size_t>(Record[I + 1])});
-      break;
+  case bitc::FS_TYPE_CHECKED_LOAD_CONST_VCALL:
+    PendingTypeCheckedLoadConstVCalls.push_back(
+        {{Record[0], Record[1]}, {Record.begin() + 2, Record.end()}});
+    break;
+
+  case bitc::FS_PARAM_ACCESSES:
+    assert(PendingParamAccesses.empty());
+    if (!parseParamAccesses(Record, PendingParamAccesses))
+      return error("Invalid record");
+    break;
+
+  case bitc::FS_CFI_FUNCTION_DEFS: {
+    std::set<std::string> &CfiFunctionDefs = TheIndex.cfiFunctionDefs();
+    for (unsigned I = 0; I != Record.size(); I += 2)
+      CfiFunctionDefs.insert(
+          {Strtab.data() + Record[I], static_cast<size_t>(Record[I + 1])});
+    break;
+  }
+  case bitc::FS_CFI_FUNCTION_DECLS: {
+    std::set<std::string> &CfiFunctionDecls = TheIndex.cfiFunctionDecls();
+    for (unsigned I = 0; I != Record.size(); I += 2)
+      CfiFunctionDecls.insert(
+          {Strtab.data() + Record[I], static_cast<size_t>(Record[I + 1])});
+    break;
+  }
+  }
+  return Error::success();
+}
+
+// Parse the index of the summary entries of a combined index, recording the
+// bit position of the entries of each value and marking its summaries as not
+// yet loaded.
+Error ModuleSummaryIndexBitcodeReader::parseSummaryIndex(
+    ArrayRef<uint64_t> Record) {
+  if (Record.size() % 3 != 0)
+    return error("Invalid record");
+  uint64_t BitPos = LazyIndexBase;
+  for (unsigned I = 0, E = Record.size(); I != E; I += 3) {
+    BitPos += Record[I + 2];
+    GlobalValue::GUID GUID = getValueInfoFromValueId(Record[I]).first.getGUID();
+    LazySummaryPos[GUID].push_back(BitPos);
+    auto &Values = LazyModuleValues[Record[I + 1]];
+    if (Values.empty() || Values.back() != GUID)
+      Values.push_back(GUID);
+  }
+  return Error::success();
+}
+
+std::vector<GlobalValue::GUID>
+ModuleSummaryIndexBitcodeReader::getPendingValues() const {
+  std::vector<GlobalValue::GUID> GUIDs;
+  GUIDs.reserve(LazySummaryPos.size());
+  for (auto &I : LazySummaryPos)
+    GUIDs.push_back(I.first);
+  return GUIDs;
+}
+
+Error ModuleSummaryIndexBitcodeReader::loadSummaries(GlobalValue::GUID GUID) {
+  auto I = LazySummaryPos.find(GUID);
+  if (I == LazySummaryPos.end())
+    return Error::success();
+  SmallVector<uint64_t, 1> Positions = std::move(I->second);
+  LazySummaryPos.erase(I);
+  TheIndex.setSummariesPending(GUID, false);
+
+  // Loading an alias loads its aliasee, which reenters here: restore the
+  // position of the cursor once done.
+  uint64_t SavedPos = LazyCursor.GetCurrentBitNo();
+  SmallVector<uint64_t, 64> Record;
+  for (uint64_t BitPos : Positions) {
+    LazyCursor.JumpToBit(BitPos);
+    // Decode the records preceding the summary record (type tests, parameter
+    // accesses) and the summary record itself.
+    while (true) {
+      BitstreamEntry Entry =
+          LazyCursor.advance(BitstreamCursor::AF_DontPopBlockAtEnd);
+      if (Entry.Kind != BitstreamEntry::Record)
+        return error("Malformed block");
+      Record.clear();
+      unsigned BitCode = LazyCursor.readRecord(Entry.ID, Record);
+      if (Error Err = parseSummaryRecord(BitCode, Record))
+        return Err;
+      if (BitCode == bitc::FS_COMBINED ||
+          BitCode == bitc::FS_COMBINED_PROFILE ||
+          BitCode == bitc::FS_COMBINED_GLOBALVAR_INIT_REFS ||
+          BitCode == bitc::FS_COMBINED_ALIAS)
+        break;
     }
+    // The summary record may be followed by its original name, any other
+    // record belongs to the next entry.
+    BitstreamEntry Entry =
+        LazyCursor.advance(BitstreamCursor::AF_DontPopBlockAtEnd);
+    if (Entry.Kind == BitstreamEntry::Record) {
+      Record.clear();
+      if (LazyCursor.readRecord(Entry.ID, Record) ==
+          bitc::FS_COMBINED_ORIGINAL_NAME)
+        if (Error Err =
+                parseSummaryRecord(bitc::FS_COMBINED_ORIGINAL_NAME, Record))
+          return Err;
     }
+    LastSeenSummary = nullptr;
+    LastSeenGUID = 0;
   }
-  llvm_unreachable("Exit infinite loop");
+  LazyCursor.JumpToBit(SavedPos);
+  return Error::success();
+}
+
+Error ModuleSummaryIndexBitcodeReader::loadModuleSummaries(StringRef Path) {
+  for (auto &I : ModuleIdMap) {
+    if (I.second != Path)
+      continue;
+    auto VI = LazyModuleValues.find(I.first);
+    if (VI == LazyModuleValues.end())
+      return Error::success();
+    std::vector<GlobalValue::GUID> GUIDs = std::move(VI->second);
+    LazyModuleValues.erase(VI);
+    for (GlobalValue::GUID GUID : GUIDs)
+      if (Error Err = loadSummaries(GUID))
+        return Err;
+    return Error::success();
+  }
+  return Error::success();
+}
+
+Error ModuleSummaryIndexBitcodeReader::loadAllSummaries() {
+  for (GlobalValue::GUID GUID : getPendingValues())
+    if (Error Err = loadSummaries(GUID))
+      return Err;
+  LazyModuleValues.clear();
+  return Error::success();
 }
 
 // Parse the  module string table block into the Index.
@@ -5506,7 +6110,8 @@ llvm::getBitcodeModuleList(MemoryBufferRef Buffer) {
 
 Expected<BitcodeFileContents>
 llvm::getBitcodeFileContents(MemoryBufferRef Buffer) {
-  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer);
+  std::shared_ptr<BitstreamByteProvider> ByteProvider;
+  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer, ByteProvider);
   if (!StreamOrErr)
     return StreamOrErr.takeError();
   BitstreamCursor &Stream = *StreamOrErr;
@@ -5548,7 +6153,7 @@ llvm::getBitcodeFileContents(MemoryBufferRef Buffer) {
         F.Mods.push_back({Stream.getBitcodeBytes().slice(
                               BCBegin, Stream.getCurrentByteNo() - BCBegin),
                           Buffer.getBufferIdentifier(), IdentificationBit,
-                          ModuleBit});
+                          ModuleBit, ByteProvider});
         continue;
       }
 
@@ -5612,8 +6217,9 @@ llvm::getBitcodeFileContents(MemoryBufferRef Buffer) {
 /// everything.
 Expected<std::unique_ptr<Module>>
 BitcodeModule::getModuleImpl(LLVMContext &Context, bool MaterializeAll,
-                             bool ShouldLazyLoadMetadata, bool IsImporting) {
-  BitstreamCursor Stream(Buffer);
+                             bool ShouldLazyLoadMetadata, bool IsImporting,
+                             BitcodeImportCache *ImportCache) {
+  BitstreamCursor Stream(Buffer, ByteProvider.get());
 
   std::string ProducerIdentification;
   if (IdentificationBit != -1ull) {
@@ -5628,15 +6234,15 @@ BitcodeModule::getModuleImpl(LLVMContext &Context, bool MaterializeAll,
 
   Stream.JumpToBit(ModuleBit);
   auto *R = new BitcodeReader(std::move(Stream), Strtab, ProducerIdentification,
-                              Context);
+                              Context, ByteProvider);
 
   std::unique_ptr<Module> M =
       llvm::make_unique<Module>(ModuleIdentifier, Context);
   M->setMaterializer(R);
 
   // Delay parsing Metadata if ShouldLazyLoadMetadata is true.
-  if (Error Err =
-          R->parseBitcodeInto(M.get(), ShouldLazyLoadMetadata, IsImporting))
+  if (Error Err = R->parseBitcodeInto(M.get(), ShouldLazyLoadMetadata,
+                                     IsImporting, ImportCache))
     return std::move(Err);
 
   if (MaterializeAll) {
@@ -5653,8 +6259,10 @@ BitcodeModule::getModuleImpl(LLVMContext &Context, bool MaterializeAll,
 
 Expected<std::unique_ptr<Module>>
 BitcodeModule::getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
-                             bool IsImporting) {
-  return getModuleImpl(Context, false, ShouldLazyLoadMetadata, IsImporting);
+                             bool IsImporting,
+                             BitcodeImportCache *ImportCache) {
+  return getModuleImpl(Context, false, ShouldLazyLoadMetadata, IsImporting,
+                       ImportCache);
 }
 
 // Parse the specified bitcode buffer and merge the index into CombinedIndex.
@@ -5663,7 +6271,7 @@ BitcodeModule::getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
 // regular LTO modules).
 Error BitcodeModule::readSummary(ModuleSummaryIndex &CombinedIndex,
                                  StringRef ModulePath, uint64_t ModuleId) {
-  BitstreamCursor Stream(Buffer);
+  BitstreamCursor Stream(Buffer, ByteProvider.get());
   Stream.JumpToBit(ModuleBit);
 
   ModuleSummaryIndexBitcodeReader R(std::move(Stream), Strtab, CombinedIndex,
@@ -5672,8 +6280,66 @@ Error BitcodeModule::readSummary(ModuleSummaryIndex &CombinedIndex,
 }
 
 // Parse the specified bitcode buffer, returning the function info index.
+namespace {
+
+/// Decodes the summaries of a lazily read combined index, owning the bitcode
+/// buffer and the reader positioned in its summary block. The reader keeps
+/// the decompressed bytes of compressed bitcode alive.
+class LazySummaryLoader : public GlobalValueSummaryLoader {
+  std::unique_ptr<MemoryBuffer> Buffer;
+  std::unique_ptr<ModuleSummaryIndexBitcodeReader> Reader;
+
+  void check(Error Err) {
+    if (Err)
+      report_fatal_error("Failed to load summaries from " +
+                         Buffer->getBufferIdentifier() + ": " +
+                         toString(std::move(Err)));
+  }
+
+public:
+  LazySummaryLoader(std::unique_ptr<MemoryBuffer> Buffer,
+                    std::unique_ptr<ModuleSummaryIndexBitcodeReader> Reader)
+      : Buffer(std::move(Buffer)), Reader(std::move(Reader)) {}
+
+  void loadSummaries(GlobalValue::GUID GUID) override {
+    check(Reader->loadSummaries(GUID));
+  }
+  void loadModuleSummaries(StringRef ModulePath) override {
+    check(Reader->loadModuleSummaries(ModulePath));
+  }
+  void loadAllSummaries() override { check(Reader->loadAllSummaries()); }
+};
+
+} // end anonymous namespace
+
+Expected<std::unique_ptr<ModuleSummaryIndex>>
+BitcodeModule::getSummaryImpl(std::unique_ptr<MemoryBuffer> LazyBuffer) {
+  BitstreamCursor Stream(Buffer, ByteProvider.get());
+  Stream.JumpToBit(ModuleBit);
+
+  auto Index = llvm::make_unique<ModuleSummaryIndex>();
+  auto R = llvm::make_unique<ModuleSummaryIndexBitcodeReader>(
+      std::move(Stream), Strtab, *Index, ModuleIdentifier, 0,
+      /*Lazy=*/true, ByteProvider);
+
+  if (Error Err = R->parseModule())
+    return std::move(Err);
+
+  // Without an index of the summaries everything was decoded, and nothing
+  // refers to the buffer anymore.
+  std::vector<GlobalValue::GUID> Pending = R->getPendingValues();
+  if (Pending.empty())
+    return std::move(Index);
+
+  Index->setSummaryLoader(
+      llvm::make_unique<LazySummaryLoader>(std::move(LazyBuffer), std::move(R)));
+  for (GlobalValue::GUID GUID : Pending)
+    Index->setSummariesPending(GUID, true);
+  return std::move(Index);
+}
+
 Expected<std::unique_ptr<ModuleSummaryIndex>> BitcodeModule::getSummary() {
-  BitstreamCursor Stream(Buffer);
+  BitstreamCursor Stream(Buffer, ByteProvider.get());
   Stream.JumpToBit(ModuleBit);
 
   auto Index = llvm::make_unique<ModuleSummaryIndex>();
@@ -5688,7 +6354,7 @@ Expected<std::unique_ptr<ModuleSummaryIndex>> BitcodeModule::getSummary() {
 
 // Check if the given bitcode buffer contains a global value summary block.
 Expected<BitcodeLTOInfo> BitcodeModule::getLTOInfo() {
-  BitstreamCursor Stream(Buffer);
+  BitstreamCursor Stream(Buffer, ByteProvider.get());
   Stream.JumpToBit(ModuleBit);
 
   if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
@@ -5753,6 +6419,17 @@ Expected<std::unique_ptr<Module>> llvm::getOwningLazyBitcodeModule(
   return MOrErr;
 }
 
+Expected<std::unique_ptr<Module>> llvm::getContextOwnedLazyBitcodeModule(
+    std::unique_ptr<MemoryBuffer> Buffer, LLVMContext &Context,
+    bool ShouldLazyLoadMetadata, bool IsImporting) {
+  // The metadata loader refers to the strings of retained buffers, so the
+  // buffer has to be retained before reading, even if that fails.
+  MemoryBufferRef BufferRef = Buffer->getMemBufferRef();
+  Context.retainBuffer(std::move(Buffer));
+  return getLazyBitcodeModule(BufferRef, Context, ShouldLazyLoadMetadata,
+                              IsImporting);
+}
+
 Expected<std::unique_ptr<Module>>
 BitcodeModule::parseModule(LLVMContext &Context) {
   return getModuleImpl(Context, true, false, false);
@@ -5770,7 +6447,8 @@ Expected<std::unique_ptr<Module>> llvm::parseBitcodeFile(MemoryBufferRef Buffer,
 }
 
 Expected<std::string> llvm::getBitcodeTargetTriple(MemoryBufferRef Buffer) {
-  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer);
+  std::shared_ptr<BitstreamByteProvider> ByteProvider;
+  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer, ByteProvider);
   if (!StreamOrErr)
     return StreamOrErr.takeError();
 
@@ -5778,7 +6456,8 @@ Expected<std::string> llvm::getBitcodeTargetTriple(MemoryBufferRef Buffer) {
 }
 
 Expected<bool> llvm::isBitcodeContainingObjCCategory(MemoryBufferRef Buffer) {
-  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer);
+  std::shared_ptr<BitstreamByteProvider> ByteProvider;
+  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer, ByteProvider);
   if (!StreamOrErr)
     return StreamOrErr.takeError();
 
@@ -5786,7 +6465,8 @@ Expected<bool> llvm::isBitcodeContainingObjCCategory(MemoryBufferRef Buffer) {
 }
 
 Expected<std::string> llvm::getBitcodeProducerString(MemoryBufferRef Buffer) {
-  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer);
+  std::shared_ptr<BitstreamByteProvider> ByteProvider;
+  Expected<BitstreamCursor> StreamOrErr = initStream(Buffer, ByteProvider);
   if (!StreamOrErr)
     return StreamOrErr.takeError();
 
@@ -5831,3 +6511,27 @@ llvm::getModuleSummaryIndexForFile(StringRef Path,
     return nullptr;
   return getModuleSummaryIndex(**FileOrErr);
 }
+
+Expected<std::unique_ptr<ModuleSummaryIndex>>
+llvm::getLazyModuleSummaryIndex(std::unique_ptr<MemoryBuffer> Buffer) {
+  Expected<BitcodeModule> BM = getSingleModule(Buffer->getMemBufferRef());
+  if (!BM)
+    return BM.takeError();
+
+  return BM->getSummaryImpl(std::move(Buffer));
+}
+
+Expected<std::unique_ptr<ModuleSummaryIndex>>
+llvm::getLazyModuleSummaryIndexForFile(StringRef Path,
+                                       bool IgnoreEmptyThinLTOIndexFile) {
+  // Map the file rather than reading it, the summaries which are never used
+  // are not paged in.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false);
+  if (!FileOrErr)
+    return errorCodeToError(FileOrErr.getError());
+  if (IgnoreEmptyThinLTOIndexFile && !(*FileOrErr)->getBufferSize())
+    return nullptr;
+  return getLazyModuleSummaryIndex(std::move(*FileOrErr));
+}
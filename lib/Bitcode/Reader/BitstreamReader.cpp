@@ -14,6 +14,8 @@
 
 using namespace llvm;
 
+BitstreamByteProvider::~BitstreamByteProvider() = default;
+
 //===----------------------------------------------------------------------===//
 //  BitstreamCursor implementation
 //===----------------------------------------------------------------------===//
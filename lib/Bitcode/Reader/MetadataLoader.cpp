@@ -77,6 +77,7 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <tuple>
@@ -90,6 +91,8 @@ using namespace llvm;
 STATISTIC(NumMDStringLoaded, "Number of MDStrings loaded");
 STATISTIC(NumMDNodeTemporary, "Number of MDNode::Temporary created");
 STATISTIC(NumMDRecordLoaded, "Number of Metadata records loaded");
+STATISTIC(NumMDIndexCacheHits,
+          "Number of lazy-loading metadata indexes found in the import cache");
 
 /// Flag whether we need to import full type definitions for ThinLTO.
 /// Currently needed for Darwin and LLDB.
@@ -421,21 +424,37 @@ class MetadataLoader::MetadataLoaderImpl {
   /// the middle of the metadata block and load any record.
   BitstreamCursor IndexCursor;
 
+  /// Shared cache of the lazy-loading index below, if any.
+  BitcodeImportCache *ImportCache;
+
+  /// The lazy-loading index of the module-level metadata block, possibly
+  /// shared with other loaders of the same bitcode.
+  std::shared_ptr<const BitcodeImportCache::MetadataIndex> LazyIndex;
+
   /// Index that keeps track of MDString values.
-  std::vector<StringRef> MDStringRef;
+  ArrayRef<StringRef> MDStringRef;
 
   /// On-demand loading of a single MDString. Requires the index above to be
   /// populated.
   MDString *lazyLoadOneMDString(unsigned Idx);
 
   /// Index that keeps track of where to find a metadata record in the stream.
-  std::vector<uint64_t> GlobalMetadataBitPosIndex;
+  ArrayRef<uint64_t> GlobalMetadataBitPosIndex;
 
   /// Populate the index above to enable lazily loading of metadata, and load
   /// the named metadata as well as the transitively referenced global
   /// Metadata.
   Expected<bool> lazyLoadModuleMetadataBlock();
 
+  /// Build the lazy-loading index of the module-level metadata block, loading
+  /// the records that cannot be lazy-loaded on the way.
+  Expected<std::shared_ptr<const BitcodeImportCache::MetadataIndex>>
+  buildLazyLoadIndex();
+
+  /// Load a record of the module-level metadata block that cannot be
+  /// lazy-loaded, the named metadata and attachments to global declarations.
+  Error parseEagerMetadataRecord(unsigned AbbrevID, uint64_t BitPos);
+
   /// On-demand loading of a single metadata. Requires the index above to be
   /// populated.
   void lazyLoadOneMetadata(unsigned Idx, PlaceholderQueue &Placeholders);
@@ -459,6 +478,16 @@ class MetadataLoader::MetadataLoaderImpl {
   /// True if metadata is being parsed for a module being ThinLTO imported.
   bool IsImporting = false;
 
+  /// True if the bitcode belongs to a buffer retained by the context, then the
+  /// MDStrings refer to their characters in the buffer instead of copying them.
+  bool ReferenceStrings = false;
+
+  MDString *createMDString(StringRef Str) {
+    if (ReferenceStrings)
+      return MDString::getExternal(Context, Str);
+    return MDString::get(Context, Str);
+  }
+
   Error parseOneMetadata(SmallVectorImpl<uint64_t> &Record, unsigned Code,
                          PlaceholderQueue &Placeholders, StringRef Blob,
                          unsigned &NextMetadataNo);
@@ -625,10 +654,16 @@ public:
   MetadataLoaderImpl(BitstreamCursor &Stream, Module &TheModule,
                      BitcodeReaderValueList &ValueList,
                      std::function<Type *(unsigned)> getTypeByID,
-                     bool IsImporting)
+                     bool IsImporting, BitcodeImportCache *ImportCache)
       : MetadataList(TheModule.getContext()), ValueList(ValueList),
         Stream(Stream), Context(TheModule.getContext()), TheModule(TheModule),
-        getTypeByID(std::move(getTypeByID)), IsImporting(IsImporting) {}
+        getTypeByID(std::move(getTypeByID)), ImportCache(ImportCache),
+        IsImporting(IsImporting) {
+    ArrayRef<uint8_t> Buffer = Stream.getBitcodeBytes();
+    ReferenceStrings = Context.isInRetainedBuffer(
+        StringRef(reinterpret_cast<const char *>(Buffer.data()),
+                  Buffer.size()));
+  }
 
   Error parseMetadata(bool ModuleLevel);
 
@@ -673,9 +708,76 @@ public:
   void upgradeDebugIntrinsics(Function &F) { upgradeDeclareExpressions(F); }
 };
 
+/// The context-independent part of the lazy-loading state of a module-level
+/// metadata block.
+struct BitcodeImportCache::MetadataIndex {
+  /// Whether the block can be lazy-loaded at all.
+  bool IsLazyLoadable = false;
+  std::vector<StringRef> MDStrings;
+  std::vector<uint64_t> GlobalMetadataBitPos;
+  /// The abbrev ID and bit position of the records that have to be loaded in
+  /// every context.
+  std::vector<std::pair<unsigned, uint64_t>> EagerRecords;
+  /// The abbreviations installed at the end of the block.
+  std::vector<std::shared_ptr<BitCodeAbbrev>> Abbrevs;
+};
+
+BitcodeImportCache::BitcodeImportCache() = default;
+BitcodeImportCache::~BitcodeImportCache() = default;
+
+std::shared_ptr<const BitcodeImportCache::MetadataIndex>
+BitcodeImportCache::lookup(const uint8_t *Buffer, uint64_t BitNo) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto I = MetadataIndexes.find(std::make_pair(Buffer, BitNo));
+  if (I == MetadataIndexes.end())
+    return nullptr;
+  return I->second;
+}
+
+void BitcodeImportCache::insert(const uint8_t *Buffer, uint64_t BitNo,
+                                std::shared_ptr<const MetadataIndex> Index) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  MetadataIndexes.insert(
+      std::make_pair(std::make_pair(Buffer, BitNo), std::move(Index)));
+}
+
 Expected<bool>
 MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
   IndexCursor = Stream;
+  const uint8_t *Buffer = Stream.getBitcodeBytes().data();
+  uint64_t BitNo = Stream.GetCurrentBitNo();
+
+  if (ImportCache)
+    LazyIndex = ImportCache->lookup(Buffer, BitNo);
+  if (LazyIndex) {
+    ++NumMDIndexCacheHits;
+    if (!LazyIndex->IsLazyLoadable)
+      return false;
+    // Another loader scanned the block already, only the records that are
+    // never lazy-loaded have to be read again.
+    IndexCursor.setAbbrevs(LazyIndex->Abbrevs);
+    for (auto &Record : LazyIndex->EagerRecords)
+      if (Error Err = parseEagerMetadataRecord(Record.first, Record.second))
+        return std::move(Err);
+  } else {
+    auto IndexOrErr = buildLazyLoadIndex();
+    if (!IndexOrErr)
+      return IndexOrErr.takeError();
+    LazyIndex = std::move(*IndexOrErr);
+    if (ImportCache)
+      ImportCache->insert(Buffer, BitNo, LazyIndex);
+    if (!LazyIndex->IsLazyLoadable)
+      return false;
+  }
+
+  MDStringRef = LazyIndex->MDStrings;
+  GlobalMetadataBitPosIndex = LazyIndex->GlobalMetadataBitPos;
+  return true;
+}
+
+Expected<std::shared_ptr<const BitcodeImportCache::MetadataIndex>>
+MetadataLoader::MetadataLoaderImpl::buildLazyLoadIndex() {
+  auto Index = std::make_shared<BitcodeImportCache::MetadataIndex>();
   SmallVector<uint64_t, 64> Record;
   // Get the abbrevs, and preload record positions to make them lazy-loadable.
   while (true) {
@@ -686,7 +788,9 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
     case BitstreamEntry::Error:
       return error("Malformed block");
     case BitstreamEntry::EndBlock: {
-      return true;
+      Index->IsLazyLoadable = true;
+      Index->Abbrevs = IndexCursor.getAbbrevs();
+      return std::move(Index);
     }
     case BitstreamEntry::Record: {
       // The interesting case.
@@ -701,9 +805,9 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
         Record.clear();
         IndexCursor.readRecord(Entry.ID, Record, &Blob);
         unsigned NumStrings = Record[0];
-        MDStringRef.reserve(NumStrings);
+        Index->MDStrings.reserve(NumStrings);
         auto IndexNextMDString = [&](StringRef Str) {
-          MDStringRef.push_back(Str);
+          Index->MDStrings.push_back(Str);
         };
         if (auto Err = parseMetadataStrings(Record, Blob, IndexNextMDString))
           return std::move(Err);
@@ -734,10 +838,10 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
 
         // Delta unpack
         auto CurrentValue = BeginPos;
-        GlobalMetadataBitPosIndex.reserve(Record.size());
+        Index->GlobalMetadataBitPos.reserve(Record.size());
         for (auto &Elt : Record) {
           CurrentValue += Elt;
-          GlobalMetadataBitPosIndex.push_back(CurrentValue);
+          Index->GlobalMetadataBitPos.push_back(CurrentValue);
         }
         break;
       }
@@ -745,53 +849,13 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
         // We don't expect to get there, the Index is loaded when we encounter
         // the offset.
         return error("Corrupted Metadata block");
-      case bitc::METADATA_NAME: {
-        // Named metadata need to be materialized now and aren't deferred.
-        IndexCursor.JumpToBit(CurrentPos);
-        Record.clear();
-        unsigned Code = IndexCursor.readRecord(Entry.ID, Record);
-        assert(Code == bitc::METADATA_NAME);
-
-        // Read name of the named metadata.
-        SmallString<8> Name(Record.begin(), Record.end());
-        Code = IndexCursor.ReadCode();
-
-        // Named Metadata comes in two parts, we expect the name to be followed
-        // by the node
-        Record.clear();
-        unsigned NextBitCode = IndexCursor.readRecord(Code, Record);
-        assert(NextBitCode == bitc::METADATA_NAMED_NODE);
-        (void)NextBitCode;
-
-        // Read named metadata elements.
-        unsigned Size = Record.size();
-        NamedMDNode *NMD = TheModule.getOrInsertNamedMetadata(Name);
-        for (unsigned i = 0; i != Size; ++i) {
-          // FIXME: We could use a placeholder here, however NamedMDNode are
-          // taking MDNode as operand and not using the Metadata infrastructure.
-          // It is acknowledged by 'TODO: Inherit from Metadata' in the
-          // NamedMDNode class definition.
-          MDNode *MD = MetadataList.getMDNodeFwdRefOrNull(Record[i]);
-          assert(MD && "Invalid record");
-          NMD->addOperand(MD);
-        }
-        break;
-      }
+      case bitc::METADATA_NAME:
       case bitc::METADATA_GLOBAL_DECL_ATTACHMENT: {
-        // FIXME: we need to do this early because we don't materialize global
-        // value explicitly.
-        IndexCursor.JumpToBit(CurrentPos);
-        Record.clear();
-        IndexCursor.readRecord(Entry.ID, Record);
-        if (Record.size() % 2 == 0)
-          return error("Invalid record");
-        unsigned ValueID = Record[0];
-        if (ValueID >= ValueList.size())
-          return error("Invalid record");
-        if (auto *GO = dyn_cast<GlobalObject>(ValueList[ValueID]))
-          if (Error Err = parseGlobalObjectAttachment(
-                  *GO, ArrayRef<uint64_t>(Record).slice(1)))
-            return std::move(Err);
+        // Rewind and load the record, which leaves the cursor after the node
+        // following the name of named metadata.
+        Index->EagerRecords.push_back(std::make_pair(Entry.ID, CurrentPos));
+        if (Error Err = parseEagerMetadataRecord(Entry.ID, CurrentPos))
+          return std::move(Err);
         break;
       }
       case bitc::METADATA_KIND:
@@ -828,9 +892,7 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
       case bitc::METADATA_GLOBAL_VAR_EXPR:
         // We don't expect to see any of these, if we see one, give up on
         // lazy-loading and fallback.
-        MDStringRef.clear();
-        GlobalMetadataBitPosIndex.clear();
-        return false;
+        return std::make_shared<BitcodeImportCache::MetadataIndex>();
       }
       break;
     }
@@ -838,6 +900,59 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
   }
 }
 
+Error MetadataLoader::MetadataLoaderImpl::parseEagerMetadataRecord(
+    unsigned AbbrevID, uint64_t BitPos) {
+  SmallVector<uint64_t, 64> Record;
+  IndexCursor.JumpToBit(BitPos);
+  unsigned Code = IndexCursor.readRecord(AbbrevID, Record);
+  switch (Code) {
+  case bitc::METADATA_NAME: {
+    // Named metadata need to be materialized now and aren't deferred.
+
+    // Read name of the named metadata.
+    SmallString<8> Name(Record.begin(), Record.end());
+    Code = IndexCursor.ReadCode();
+
+    // Named Metadata comes in two parts, we expect the name to be followed
+    // by the node
+    Record.clear();
+    unsigned NextBitCode = IndexCursor.readRecord(Code, Record);
+    assert(NextBitCode == bitc::METADATA_NAMED_NODE);
+    (void)NextBitCode;
+
+    // Read named metadata elements.
+    unsigned Size = Record.size();
+    NamedMDNode *NMD = TheModule.getOrInsertNamedMetadata(Name);
+    for (unsigned i = 0; i != Size; ++i) {
+      // FIXME: We could use a placeholder here, however NamedMDNode are
+      // taking MDNode as operand and not using the Metadata infrastructure.
+      // It is acknowledged by 'TODO: Inherit from Metadata' in the
+      // NamedMDNode class definition.
+      MDNode *MD = MetadataList.getMDNodeFwdRefOrNull(Record[i]);
+      assert(MD && "Invalid record");
+      NMD->addOperand(MD);
+    }
+    return Error::success();
+  }
+  case bitc::METADATA_GLOBAL_DECL_ATTACHMENT: {
+    // FIXME: we need to do this early because we don't materialize global
+    // value explicitly.
+    if (Record.size() % 2 == 0)
+      return error("Invalid record");
+    unsigned ValueID = Record[0];
+    if (ValueID >= ValueList.size())
+      return error("Invalid record");
+    if (auto *GO = dyn_cast<GlobalObject>(ValueList[ValueID]))
+      if (Error Err = parseGlobalObjectAttachment(
+              *GO, ArrayRef<uint64_t>(Record).slice(1)))
+        return Err;
+    return Error::success();
+  }
+  default:
+    return error("Invalid record");
+  }
+}
+
 /// Parse a METADATA_BLOCK. If ModuleLevel is true then we are parsing
 /// module level metadata.
 Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
@@ -916,7 +1031,7 @@ MDString *MetadataLoader::MetadataLoaderImpl::lazyLoadOneMDString(unsigned ID) {
   ++NumMDStringLoaded;
   if (Metadata *MD = MetadataList.lookup(ID))
     return cast<MDString>(MD);
-  auto MDS = MDString::get(Context, MDStringRef[ID]);
+  MDString *MDS = createMDString(MDStringRef[ID]);
   MetadataList.assignValue(MDS, ID);
   return MDS;
 }
@@ -1701,7 +1816,7 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
   case bitc::METADATA_STRINGS: {
     auto CreateNextMDString = [&](StringRef Str) {
       ++NumMDStringLoaded;
-      MetadataList.assignValue(MDString::get(Context, Str), NextMetadataNo);
+      MetadataList.assignValue(createMDString(Str), NextMetadataNo);
       NextMetadataNo++;
     };
     if (Error Err = parseMetadataStrings(Record, Blob, CreateNextMDString))
@@ -1930,9 +2045,11 @@ MetadataLoader::~MetadataLoader() = default;
 MetadataLoader::MetadataLoader(BitstreamCursor &Stream, Module &TheModule,
                                BitcodeReaderValueList &ValueList,
                                bool IsImporting,
-                               std::function<Type *(unsigned)> getTypeByID)
-    : Pimpl(llvm::make_unique<MetadataLoaderImpl>(
-          Stream, TheModule, ValueList, std::move(getTypeByID), IsImporting)) {}
+                               std::function<Type *(unsigned)> getTypeByID,
+                               BitcodeImportCache *ImportCache)
+    : Pimpl(llvm::make_unique<MetadataLoaderImpl>(Stream, TheModule, ValueList,
+                                                  std::move(getTypeByID),
+                                                  IsImporting, ImportCache)) {}
 
 Error MetadataLoader::parseMetadata(bool ModuleLevel) {
   return Pimpl->parseMetadata(ModuleLevel);
@@ -21,6 +21,7 @@
 #include <memory>
 
 namespace llvm {
+class BitcodeImportCache;
 class BitcodeReaderValueList;
 class BitstreamCursor;
 class DISubprogram;
@@ -42,7 +43,8 @@ public:
   ~MetadataLoader();
   MetadataLoader(BitstreamCursor &Stream, Module &TheModule,
                  BitcodeReaderValueList &ValueList, bool IsImporting,
-                 std::function<Type *(unsigned)> getTypeByID);
+                 std::function<Type *(unsigned)> getTypeByID,
+                 BitcodeImportCache *ImportCache = nullptr);
   MetadataLoader &operator=(MetadataLoader &&);
   MetadataLoader(MetadataLoader &&);
 
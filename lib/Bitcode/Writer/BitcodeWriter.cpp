@@ -26,6 +26,8 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/IR/Attributes.h"
@@ -61,14 +63,17 @@
 #include "llvm/Support/AtomicOrdering.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -86,6 +91,21 @@ static cl::opt<unsigned>
                    cl::desc("Number of metadatas above which we emit an index "
                             "to enable lazy-loading"));
 
+static cl::opt<unsigned> SummaryIndexThreshold(
+    "bitcode-summary-index-threshold", cl::Hidden, cl::init(1000),
+    cl::desc("Number of values in a combined summary above which we emit an "
+             "index of the summaries to enable lazy-loading"));
+
+static cl::opt<unsigned> WriteThreads(
+    "bitcode-write-threads", cl::Hidden, cl::init(0),
+    cl::desc("Write the function blocks of a module on this many threads "
+             "(default = 0, write them in order)"));
+
+static cl::opt<bool>
+    CompressBitcode("compress-bitcode", cl::Hidden, cl::init(false),
+                    cl::desc("Write bitcode files compressed, in segments "
+                             "that are decompressed when they are read"));
+
 namespace {
 
 /// These are manifest constants used by the bitcode writer. They do not need to
@@ -231,6 +251,8 @@ private:
   std::map<GlobalValue::GUID, unsigned> &valueIds() { return GUIDToValueIdMap; }
 };
 
+class FunctionBlockWriter;
+
 /// Class to manage the bitcode writing for a module.
 class ModuleBitcodeWriter : public ModuleBitcodeWriterBase {
   /// Pointer to the buffer allocated by caller for bitcode writing.
@@ -264,6 +286,10 @@ public:
   /// Emit the current module to the bitstream.
   void write();
 
+  /// Emit the blocks of the functions claimed from \p Blocks on the thread
+  /// \p Thread, whose stream this writer writes to.
+  void writeFunctionBlocks(FunctionBlockWriter &Blocks, unsigned Thread);
+
 private:
   uint64_t bitcodeStartBit() { return BitcodeStartBit; }
 
@@ -954,6 +980,11 @@ static uint64_t getEncodedFFlags(FunctionSummary::FFlags Flags) {
   RawFlags |= (Flags.ReadOnly << 1);
   RawFlags |= (Flags.NoRecurse << 2);
   RawFlags |= (Flags.ReturnDoesNotAlias << 3);
+  RawFlags |= (Flags.NoUnwind << 4);
+  RawFlags |= (Flags.BodyReadNone << 5);
+  RawFlags |= (Flags.BodyReadOnly << 6);
+  RawFlags |= (Flags.BodyNoUnwind << 7);
+  RawFlags |= (Flags.NoUnknownCalls << 8);
   return RawFlags;
 }
 
@@ -3065,6 +3096,103 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.ExitBlock();
 }
 
+namespace {
+
+/// Writes the function blocks of a module on a pool of threads, for
+/// ModuleBitcodeWriter::write to copy them into its stream in order. Each
+/// thread enumerates the module itself, which numbers the values like the
+/// enumerator of the module writer, and writes the blocks it claims into its
+/// own stream. The threads start right away, thus their enumeration overlaps
+/// the writing of the module level blocks.
+class FunctionBlockWriter {
+public:
+  FunctionBlockWriter(const Module &M, bool ShouldPreserveUseListOrder,
+                      unsigned NumThreads);
+
+  /// Wait for all blocks to be written.
+  void wait() { Pool.wait(); }
+
+  /// The functions with a body, in the order of the module.
+  ArrayRef<const Function *> functions() const { return Functions; }
+
+  /// The contents of the block of the function \p I, as expected by
+  /// BitstreamWriter::EmitBlockContents.
+  ArrayRef<char> getBlockContents(unsigned I) const {
+    const Block &B = Blocks[I];
+    return makeArrayRef(Buffers[B.Thread]).slice(B.Begin, B.End - B.Begin);
+  }
+
+private:
+  friend class ModuleBitcodeWriter;
+
+  struct Block {
+    unsigned Thread;
+    size_t Begin;
+    size_t End;
+  };
+
+  std::vector<const Function *> Functions;
+  /// The position of each function in Functions, plus one.
+  DenseMap<const Function *, unsigned> FunctionIndex;
+  std::vector<Block> Blocks;
+  std::vector<SmallVector<char, 0>> Buffers;
+  std::atomic<unsigned> NextFunction;
+  /// Destroyed first, which waits for the threads.
+  ThreadPool Pool;
+};
+
+} // end anonymous namespace
+
+FunctionBlockWriter::FunctionBlockWriter(const Module &M,
+                                         bool ShouldPreserveUseListOrder,
+                                         unsigned NumThreads)
+    : Buffers(NumThreads), NextFunction(0), Pool(NumThreads) {
+  for (const Function &F : M)
+    if (!F.isDeclaration()) {
+      Functions.push_back(&F);
+      FunctionIndex[&F] = Functions.size();
+    }
+  Blocks.resize(Functions.size());
+
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Pool.async([this, &M, ShouldPreserveUseListOrder, T]() {
+      StringTableBuilder StrtabBuilder(StringTableBuilder::RAW);
+      BitstreamWriter Stream(Buffers[T]);
+      ModuleBitcodeWriter Writer(&M, Buffers[T], StrtabBuilder, Stream,
+                                 ShouldPreserveUseListOrder,
+                                 /*Index=*/nullptr, /*GenerateHash=*/false);
+      Writer.writeFunctionBlocks(*this, T);
+    });
+}
+
+void ModuleBitcodeWriter::writeFunctionBlocks(FunctionBlockWriter &Blocks,
+                                              unsigned Thread) {
+  // The blocks use the standard abbreviations.
+  writeBlockInfo();
+
+  DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
+  while (true) {
+    unsigned I = Blocks.NextFunction++;
+    if (I >= Blocks.Functions.size())
+      return;
+
+    // The use-list orders are stacked in the order of the functions. Drop the
+    // ones of the module and of the functions claimed by other threads.
+    while (!VE.UseListOrders.empty() &&
+           Blocks.FunctionIndex.lookup(VE.UseListOrders.back().F) <= I)
+      VE.UseListOrders.pop_back();
+
+    // At the top level of the stream, the header of a block fits in one word.
+    assert(Stream.GetCurrentBitNo() % 32 == 0 && "Not 32-bit aligned");
+    assert(Stream.GetAbbrevIDWidth() + bitc::BlockIDWidth +
+                   bitc::CodeLenWidth <= 32 &&
+           "Block header does not fit in one word");
+    size_t Begin = Buffer.size() + 4;
+    writeFunction(*Blocks.Functions[I], FunctionToBitcodeIndex);
+    Blocks.Blocks[I] = {Thread, Begin, Buffer.size()};
+  }
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 void ModuleBitcodeWriter::writeBlockInfo() {
   // We only want to emit block info records for blocks that have multiple
@@ -3353,6 +3481,35 @@ static void writeFunctionTypeMetadataRecords(BitstreamWriter &Stream,
                      FS->type_checked_load_const_vcalls());
 }
 
+/// Write the pointer argument accesses record that needs to appear before a
+/// function summary entry (whether per-module or combined).
+static void writeFunctionParamAccessRecord(BitstreamWriter &Stream,
+                                           FunctionSummary *FS) {
+  if (FS->param_accesses().empty())
+    return;
+
+  SmallVector<uint64_t, 64> Record;
+  auto WriteBound = [&](const FunctionSummary::ParamAccess::AffineBound &B) {
+    emitSignedInt64(Record, B.Constant);
+    Record.push_back(B.Terms.size());
+    for (auto &Term : B.Terms) {
+      Record.push_back(Term.first);
+      emitSignedInt64(Record, Term.second);
+    }
+  };
+
+  for (auto &PA : FS->param_accesses()) {
+    Record.push_back(PA.ArgNo);
+    Record.push_back(PA.IsRead | (PA.IsWritten << 1) |
+                     (PA.HasLowerBound << 2) | (PA.HasUpperBound << 3));
+    if (PA.HasLowerBound)
+      WriteBound(PA.LowerBound);
+    if (PA.HasUpperBound)
+      WriteBound(PA.UpperBound);
+  }
+  Stream.EmitRecord(bitc::FS_PARAM_ACCESSES, Record);
+}
+
 // Helper to emit a single function summary record.
 void ModuleBitcodeWriterBase::writePerModuleFunctionSummaryRecord(
     SmallVector<uint64_t, 64> &NameVals, GlobalValueSummary *Summary,
@@ -3362,6 +3519,7 @@ void ModuleBitcodeWriterBase::writePerModuleFunctionSummaryRecord(
 
   FunctionSummary *FS = cast<FunctionSummary>(Summary);
   writeFunctionTypeMetadataRecords(Stream, FS);
+  writeFunctionParamAccessRecord(Stream, FS);
 
   NameVals.push_back(getEncodedGVSummaryFlags(FS->flags()));
   NameVals.push_back(FS->instCount());
@@ -3536,7 +3694,11 @@ void ModuleBitcodeWriterBase::writePerModuleGlobalValueSummary() {
 
 /// Emit the combined summary section into the combined index file.
 void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
-  Stream.EnterSubblock(bitc::GLOBALVAL_SUMMARY_BLOCK_ID, 3);
+  // We only emit an index of the summaries if we have more than a given
+  // (naive) threshold of values, otherwise it is not worth it. Its two
+  // abbreviations need a wider abbreviation id.
+  bool EmitIndex = GUIDToValueIdMap.size() > SummaryIndexThreshold;
+  Stream.EnterSubblock(bitc::GLOBALVAL_SUMMARY_BLOCK_ID, EmitIndex ? 4 : 3);
   Stream.EmitRecord(bitc::FS_VERSION, ArrayRef<uint64_t>{INDEX_VERSION});
 
   for (const auto &GVI : valueIds()) {
@@ -3591,6 +3753,39 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));   // valueid
   unsigned FSAliasAbbrev = Stream.EmitAbbrev(std::move(Abbv));
 
+  uint64_t IndexOffsetRecordBitPos = 0;
+  unsigned FSIndexAbbrev = 0;
+  if (EmitIndex) {
+    Abbv = std::make_shared<BitCodeAbbrev>();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FS_COMBINED_INDEX_OFFSET));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    unsigned FSIndexOffsetAbbrev = Stream.EmitAbbrev(std::move(Abbv));
+
+    Abbv = std::make_shared<BitCodeAbbrev>();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FS_COMBINED_INDEX));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+    FSIndexAbbrev = Stream.EmitAbbrev(std::move(Abbv));
+
+    // Write a placeholder for the offset of the index, which is written after
+    // the summaries so that it can include the position of each of them.
+    uint64_t Vals[] = {0, 0};
+    Stream.EmitRecord(bitc::FS_COMBINED_INDEX_OFFSET, Vals,
+                      FSIndexOffsetAbbrev);
+    IndexOffsetRecordBitPos = Stream.GetCurrentBitNo();
+  }
+
+  // The value id, module id and position of each summary for the index.
+  std::vector<uint64_t> IndexPos;
+  auto AddIndexPos = [&](unsigned ValueId, const GlobalValueSummary &S) {
+    if (!EmitIndex)
+      return;
+    IndexPos.push_back(ValueId);
+    IndexPos.push_back(Index.getModuleId(S.modulePath()));
+    IndexPos.push_back(Stream.GetCurrentBitNo());
+  };
+
   // The aliases are emitted as a post-pass, and will point to the value
   // id of the aliasee. Save them in a vector for post-processing.
   SmallVector<AliasSummary *, 64> Aliases;
@@ -3631,6 +3826,8 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
       return;
     }
 
+    AddIndexPos(*ValueId, *S);
+
     if (auto *VS = dyn_cast<GlobalVarSummary>(S)) {
       NameVals.push_back(*ValueId);
       NameVals.push_back(Index.getModuleId(VS->modulePath()));
@@ -3652,6 +3849,7 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
 
     auto *FS = cast<FunctionSummary>(S);
     writeFunctionTypeMetadataRecords(Stream, FS);
+    writeFunctionParamAccessRecord(Stream, FS);
 
     NameVals.push_back(*ValueId);
     NameVals.push_back(Index.getModuleId(FS->modulePath()));
@@ -3726,6 +3924,7 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
   for (auto *AS : Aliases) {
     auto AliasValueId = SummaryToValueIdMap[AS];
     assert(AliasValueId);
+    AddIndexPos(AliasValueId, *AS);
     NameVals.push_back(AliasValueId);
     NameVals.push_back(Index.getModuleId(AS->modulePath()));
     NameVals.push_back(getEncodedGVSummaryFlags(AS->flags()));
@@ -3739,6 +3938,20 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
     MaybeEmitOriginalName(*AS);
   }
 
+  if (EmitIndex) {
+    // Backpatch the forward reference so that the reader can skip the
+    // summaries, and emit the delta encoded index.
+    Stream.BackpatchWord64(IndexOffsetRecordBitPos - 64,
+                           Stream.GetCurrentBitNo() - IndexOffsetRecordBitPos);
+    uint64_t PreviousValue = IndexOffsetRecordBitPos;
+    for (unsigned I = 2, E = IndexPos.size(); I < E; I += 3) {
+      uint64_t Delta = IndexPos[I] - PreviousValue;
+      PreviousValue = IndexPos[I];
+      IndexPos[I] = Delta;
+    }
+    Stream.EmitRecord(bitc::FS_COMBINED_INDEX, IndexPos, FSIndexAbbrev);
+  }
+
   if (!Index.cfiFunctionDefs().empty()) {
     for (auto &S : Index.cfiFunctionDefs()) {
       NameVals.push_back(StrtabBuilder.add(S));
@@ -3806,6 +4019,15 @@ void ModuleBitcodeWriter::writeModuleHash(size_t BlockStartPos) {
 }
 
 void ModuleBitcodeWriter::write() {
+  // Write the function blocks on other threads while the module level blocks
+  // are written.
+  std::unique_ptr<FunctionBlockWriter> FunctionBlocks;
+  if (WriteThreads && std::count_if(M.begin(), M.end(), [](const Function &F) {
+        return !F.isDeclaration();
+      }) > 1)
+    FunctionBlocks = llvm::make_unique<FunctionBlockWriter>(
+        M, VE.shouldPreserveUseListOrder(), WriteThreads);
+
   writeIdentificationBlock(Stream);
 
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
@@ -3849,9 +4071,20 @@ void ModuleBitcodeWriter::write() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
-  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
-    if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+  if (FunctionBlocks) {
+    FunctionBlocks->wait();
+    for (unsigned I = 0, E = FunctionBlocks->functions().size(); I != E; ++I) {
+      FunctionToBitcodeIndex[FunctionBlocks->functions()[I]] =
+          Stream.GetCurrentBitNo();
+      Stream.EmitBlockContents(bitc::FUNCTION_BLOCK_ID, 4,
+                               FunctionBlocks->getBlockContents(I));
+    }
+    FunctionBlocks.reset();
+  } else {
+    for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
+      if (!F->isDeclaration())
+        writeFunction(*F, FunctionToBitcodeIndex);
+  }
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -4039,6 +4272,146 @@ void BitcodeWriter::writeIndex(
   IndexWriter.write();
 }
 
+/// The block bodies at least this large are compressed on their own, the
+/// smaller ones together with the bytes around them, in segments of about
+/// CompressedSegmentSize bytes.
+static const size_t MinBlockSegmentSize = 2048;
+static const size_t CompressedSegmentSize = 64 * 1024;
+/// The segment sizes are 32-bit.
+static const size_t MaxSegmentSize = 1 << 30;
+
+/// Append the byte ranges of the bodies of the blocks nested in the module
+/// blocks of \p Bitcode to \p Bodies. Stops at anything unexpected, the rest
+/// of the bitcode is then compressed without regard to its blocks.
+static void
+findModuleSubBlockBodies(ArrayRef<uint8_t> Bitcode,
+                         std::vector<std::pair<size_t, size_t>> &Bodies) {
+  const uint8_t *BufPtr = Bitcode.begin();
+  const uint8_t *BufEnd = Bitcode.end();
+  if (isBitcodeWrapper(BufPtr, BufEnd) &&
+      SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
+    return;
+  if (!isRawBitcode(BufPtr, BufEnd))
+    return;
+  size_t Offset = BufPtr - Bitcode.begin();
+  BitstreamCursor Stream(ArrayRef<uint8_t>(BufPtr, BufEnd));
+  Stream.JumpToBit(32);
+
+  Optional<BitstreamBlockInfo> BlockInfo;
+  while (Stream.getCurrentByteNo() + 8 < Stream.getBitcodeBytes().size()) {
+    BitstreamEntry Entry = Stream.advance();
+    if (Entry.Kind != BitstreamEntry::SubBlock)
+      return;
+    if (Entry.ID != bitc::MODULE_BLOCK_ID) {
+      if (Stream.SkipBlock())
+        return;
+      continue;
+    }
+    if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
+      return;
+
+    while (true) {
+      Entry = Stream.advance();
+      if (Entry.Kind == BitstreamEntry::EndBlock)
+        break;
+      if (Entry.Kind == BitstreamEntry::Error)
+        return;
+      if (Entry.Kind == BitstreamEntry::Record) {
+        Stream.skipRecord(Entry.ID);
+        continue;
+      }
+      if (Entry.ID == bitc::BLOCKINFO_BLOCK_ID) {
+        BlockInfo = Stream.ReadBlockInfoBlock();
+        if (!BlockInfo)
+          return;
+        Stream.setBlockInfo(&*BlockInfo);
+        continue;
+      }
+      unsigned NumWords;
+      if (Stream.EnterSubBlock(Entry.ID, &NumWords))
+        return;
+      size_t Begin = Stream.getCurrentByteNo();
+      size_t End = Begin + size_t(NumWords) * 4;
+      if (!Stream.canSkipToPos(End))
+        return;
+      Stream.JumpToBit(End * 8);
+      Stream.ReadBlockEnd();
+      Bodies.push_back({Offset + Begin, Offset + End});
+    }
+  }
+}
+
+void llvm::compressBitcode(StringRef Bitcode, SmallVectorImpl<char> &Buffer) {
+  if (isCompressedBitcode(Bitcode.bytes_begin(), Bitcode.bytes_end())) {
+    Buffer.assign(Bitcode.begin(), Bitcode.end());
+    return;
+  }
+
+  std::vector<std::pair<size_t, size_t>> Bodies;
+  findModuleSubBlockBodies(
+      ArrayRef<uint8_t>(Bitcode.bytes_begin(), Bitcode.bytes_end()), Bodies);
+
+  // The ends of the segments.
+  std::vector<size_t> Cuts;
+  size_t SegmentBegin = 0;
+  auto CutAt = [&](size_t Offset) {
+    for (; Offset - SegmentBegin > MaxSegmentSize;
+         SegmentBegin += MaxSegmentSize)
+      Cuts.push_back(SegmentBegin + MaxSegmentSize);
+    if (Offset > SegmentBegin) {
+      Cuts.push_back(Offset);
+      SegmentBegin = Offset;
+    }
+  };
+  for (const auto &Body : Bodies) {
+    if (Body.second - Body.first >= MinBlockSegmentSize) {
+      CutAt(Body.first);
+      CutAt(Body.second);
+    } else if (Body.first - SegmentBegin >= CompressedSegmentSize) {
+      CutAt(Body.first);
+    }
+  }
+  CutAt(Bitcode.size());
+
+  Buffer.clear();
+  Buffer.resize(BCZ_HeaderSize + Cuts.size() * BCZ_SegmentEntrySize);
+  memcpy(&Buffer[BCZ_MagicField], "BCLZ", 4);
+  support::endian::write32le(&Buffer[BCZ_CodecField], BCZ_LZ4);
+  support::endian::write64le(&Buffer[BCZ_SizeField], Bitcode.size());
+  support::endian::write32le(&Buffer[BCZ_NumSegmentsField], Cuts.size());
+
+  SmallVector<char, 0> Compressed;
+  size_t Begin = 0;
+  for (unsigned I = 0, E = Cuts.size(); I != E; ++I) {
+    StringRef Segment = Bitcode.slice(Begin, Cuts[I]);
+    lz4::compress(Segment, Compressed);
+    // Segments that do not get smaller are stored as is.
+    StringRef Stored = Segment;
+    if (Compressed.size() < Segment.size())
+      Stored = StringRef(Compressed.data(), Compressed.size());
+    char *Entry = &Buffer[BCZ_HeaderSize + I * BCZ_SegmentEntrySize];
+    support::endian::write32le(Entry, Segment.size());
+    support::endian::write32le(Entry + 4, Stored.size());
+    Buffer.append(Stored.begin(), Stored.end());
+    Begin = Cuts[I];
+  }
+
+  // Keep the size a multiple of 4, like the size of bitcode.
+  Buffer.resize(alignTo(Buffer.size(), 4), 0);
+}
+
+/// Write the bitcode file in \p Buffer to \p Out, compressed with
+/// -compress-bitcode.
+static void writeBitcodeBuffer(ArrayRef<char> Buffer, raw_ostream &Out) {
+  if (!CompressBitcode) {
+    Out.write(Buffer.data(), Buffer.size());
+    return;
+  }
+  SmallVector<char, 0> Compressed;
+  compressBitcode(StringRef(Buffer.data(), Buffer.size()), Compressed);
+  Out.write(Compressed.data(), Compressed.size());
+}
+
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
@@ -4064,7 +4437,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
     emitDarwinBCHeaderAndTrailer(Buffer, TT);
 
   // Write the generated bitstream to "Out".
-  Out.write((char*)&Buffer.front(), Buffer.size());
+  writeBitcodeBuffer(Buffer, Out);
 }
 
 void IndexBitcodeWriter::write() {
@@ -4095,7 +4468,7 @@ void llvm::WriteIndexToFile(
   Writer.writeIndex(&Index, ModuleToSummariesForIndex);
   Writer.writeStrtab();
 
-  Out.write((char *)&Buffer.front(), Buffer.size());
+  writeBitcodeBuffer(Buffer, Out);
 }
 
 namespace {
@@ -4256,5 +4629,5 @@ void llvm::WriteThinLinkBitcodeToFile(const Module *M, raw_ostream &Out,
   Writer.writeSymtab();
   Writer.writeStrtab();
 
-  Out.write((char *)&Buffer.front(), Buffer.size());
+  writeBitcodeBuffer(Buffer, Out);
 }
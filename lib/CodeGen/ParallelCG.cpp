@@ -12,15 +12,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/ParallelCG.h"
-#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
-#include "llvm/Support/ErrorOr.h"
-#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
 using namespace llvm;
@@ -49,51 +48,57 @@ std::unique_ptr<Module> llvm::splitCodeGen(
     return M;
   }
 
+  // Collect all partitions first. Once SplitModule is done their shared
+  // context is no longer modified, thus they can be cloned into separate
+  // contexts concurrently.
+  std::vector<std::unique_ptr<Module>> Parts;
+  SplitModule(std::move(M), OSs.size(),
+              [&](std::unique_ptr<Module> MPart) {
+                if (!BCOSs.empty()) {
+                  WriteBitcodeToFile(MPart.get(), *BCOSs[Parts.size()]);
+                  BCOSs[Parts.size()]->flush();
+                }
+                Parts.push_back(std::move(MPart));
+              },
+              PreserveLocals);
+
+  SplitModuleReport Report(Parts.size());
+  if (SplitModuleReport::isEnabled())
+    for (unsigned I = 0, E = Parts.size(); I != E; ++I)
+      Report.setPredictedCost(I, *Parts[I]);
+
+  std::vector<std::unique_ptr<LLVMContext>> Contexts(Parts.size());
+  std::vector<std::unique_ptr<Module>> PartsInCtx(Parts.size());
+
   // Create ThreadPool in nested scope so that threads will be joined
   // on destruction.
   {
     ThreadPool CodegenThreadPool(OSs.size());
-    int ThreadCount = 0;
 
-    SplitModule(
-        std::move(M), OSs.size(),
-        [&](std::unique_ptr<Module> MPart) {
-          // We want to clone the module in a new context to multi-thread the
-          // codegen. We do it by serializing partition modules to bitcode
-          // (while still on the main thread, in order to avoid data races) and
-          // spinning up new threads which deserialize the partitions into
-          // separate contexts.
-          // FIXME: Provide a more direct way to do this in LLVM.
-          SmallString<0> BC;
-          raw_svector_ostream BCOS(BC);
-          WriteBitcodeToFile(MPart.get(), BCOS);
+    // Clone the partitions into new contexts to multi-thread the codegen.
+    for (unsigned I = 0, E = Parts.size(); I != E; ++I)
+      CodegenThreadPool.async([&, I]() {
+        Contexts[I] = llvm::make_unique<LLVMContext>();
+        PartsInCtx[I] = CloneModuleIntoContext(*Parts[I], *Contexts[I]);
+      });
+    CodegenThreadPool.wait();
 
-          if (!BCOSs.empty()) {
-            BCOSs[ThreadCount]->write(BC.begin(), BC.size());
-            BCOSs[ThreadCount]->flush();
-          }
+    // The original partitions are not needed anymore. Free them on this thread
+    // as their context is shared.
+    Parts.clear();
 
-          llvm::raw_pwrite_stream *ThreadOS = OSs[ThreadCount++];
-          // Enqueue the task
-          CodegenThreadPool.async(
-              [TMFactory, FileType, ThreadOS](const SmallString<0> &BC) {
-                LLVMContext Ctx;
-                Expected<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
-                    MemoryBufferRef(StringRef(BC.data(), BC.size()),
-                                    "<split-module>"),
-                    Ctx);
-                if (!MOrErr)
-                  report_fatal_error("Failed to read bitcode");
-                std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
-
-                codegen(MPartInCtx.get(), *ThreadOS, TMFactory, FileType);
-              },
-              // Pass BC using std::move to ensure that it get moved rather than
-              // copied into the thread's context.
-              std::move(BC));
-        },
-        PreserveLocals);
+    for (unsigned I = 0, E = PartsInCtx.size(); I != E; ++I)
+      CodegenThreadPool.async([&, I]() {
+        TimeRecord Start = TimeRecord::getCurrentTime(true);
+        codegen(PartsInCtx[I].get(), *OSs[I], TMFactory, FileType);
+        TimeRecord End = TimeRecord::getCurrentTime(false);
+        Report.setWallTime(I, End.getWallTime() - Start.getWallTime());
+        PartsInCtx[I].reset();
+        Contexts[I].reset();
+      });
   }
 
+  Report.printIfEnabled();
+
   return {};
 }
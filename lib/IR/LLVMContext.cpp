@@ -24,6 +24,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
 #include <cstdlib>
@@ -107,6 +108,18 @@ void LLVMContext::removeModule(Module *M) {
   pImpl->OwnedModules.erase(M);
 }
 
+void LLVMContext::retainBuffer(std::unique_ptr<MemoryBuffer> Buffer) {
+  pImpl->RetainedBuffers.push_back(std::move(Buffer));
+}
+
+bool LLVMContext::isInRetainedBuffer(StringRef Data) const {
+  return any_of(pImpl->RetainedBuffers,
+                [&](const std::unique_ptr<MemoryBuffer> &Buffer) {
+                  return Data.begin() >= Buffer->getBufferStart() &&
+                         Data.end() <= Buffer->getBufferEnd();
+                });
+}
+
 //===----------------------------------------------------------------------===//
 // Recoverable Backend Errors
 //===----------------------------------------------------------------------===//
@@ -443,19 +443,31 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 // MDString implementation.
 //
 
-MDString *MDString::get(LLVMContext &Context, StringRef Str) {
-  auto &Store = Context.pImpl->MDStringCache;
-  auto I = Store.try_emplace(Str);
-  auto &MapEntry = I.first->getValue();
-  if (!I.second)
-    return &MapEntry;
-  MapEntry.Entry = &*I.first;
-  return &MapEntry;
-}
-
-StringRef MDString::getString() const {
-  assert(Entry && "Expected to find string map entry");
-  return Entry->first();
+MDString *MDString::getImpl(LLVMContext &Context, StringRef Str,
+                            bool CopyString) {
+  LLVMContextImpl *pImpl = Context.pImpl;
+  CachedHashStringRef Key(Str);
+  auto I = pImpl->MDStringCache.find(Key);
+  if (I != pImpl->MDStringCache.end())
+    return I->second;
+
+  // Allocate a copy of the characters right after the MDString.
+  size_t AllocSize = sizeof(MDString) + (CopyString ? Str.size() + 1 : 0);
+  void *Mem = pImpl->MDStringAllocator.Allocate(AllocSize, alignof(MDString));
+  const char *Data = Str.data();
+  if (CopyString) {
+    char *Chars = reinterpret_cast<char *>(Mem) + sizeof(MDString);
+    if (!Str.empty())
+      memcpy(Chars, Str.data(), Str.size());
+    Chars[Str.size()] = '\0';
+    Data = Chars;
+  }
+  auto *MDS = new (Mem) MDString(Data, Str.size());
+
+  // The key has to refer to the characters of the MDString, not to Str.
+  pImpl->MDStringCache.insert(
+      std::make_pair(CachedHashStringRef(MDS->getString(), Key.hash()), MDS));
+  return MDS;
 }
 
 //===----------------------------------------------------------------------===//
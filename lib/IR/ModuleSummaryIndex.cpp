@@ -20,7 +20,13 @@ using namespace llvm;
 // (GUID -> Summary).
 void ModuleSummaryIndex::collectDefinedFunctionsForModule(
     StringRef ModulePath, GVSummaryMapTy &GVSummaryMap) const {
-  for (auto &GlobalList : *this) {
+  // Only decode the summaries of the values defined in the module, the values
+  // which are not loaded afterwards have no summary in the module.
+  if (SummaryLoader)
+    SummaryLoader->loadModuleSummaries(ModulePath);
+  for (auto &GlobalList : GlobalValueMap) {
+    if (GlobalList.second.Loader)
+      continue;
     auto GUID = GlobalList.first;
     for (auto &GlobSummary : GlobalList.second.SummaryList) {
       auto *Summary = dyn_cast_or_null<FunctionSummary>(GlobSummary.get());
@@ -13,6 +13,7 @@
 
 #include "llvm/LTO/Caching.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -23,7 +24,8 @@ using namespace llvm;
 using namespace llvm::lto;
 
 Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
-                                            AddBufferFn AddBuffer) {
+                                            AddBufferFn AddBuffer,
+                                            bool UseIndex) {
   if (std::error_code EC = sys::fs::create_directories(CacheDirectoryPath))
     return errorCodeToError(EC);
 
@@ -36,6 +38,9 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
     ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
         MemoryBuffer::getFile(EntryPath);
     if (MBOrErr) {
+      if (UseIndex)
+        recordCacheAccess(CacheDirectoryPath, sys::path::filename(EntryPath),
+                          (*MBOrErr)->getBufferSize());
       AddBuffer(Task, std::move(*MBOrErr), EntryPath);
       return AddStreamFn();
     }
@@ -51,13 +56,14 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
       sys::fs::TempFile TempFile;
       std::string EntryPath;
       unsigned Task;
+      bool UseIndex;
 
       CacheStream(std::unique_ptr<raw_pwrite_stream> OS, AddBufferFn AddBuffer,
                   sys::fs::TempFile TempFile, std::string EntryPath,
-                  unsigned Task)
+                  unsigned Task, bool UseIndex)
           : NativeObjectStream(std::move(OS)), AddBuffer(std::move(AddBuffer)),
             TempFile(std::move(TempFile)), EntryPath(std::move(EntryPath)),
-            Task(Task) {}
+            Task(Task), UseIndex(UseIndex) {}
 
       ~CacheStream() {
         // Make sure the stream is closed before committing it.
@@ -103,6 +109,10 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
                              TempFile.TmpName + " to " + EntryPath + ": " +
                              toString(std::move(E)) + "\n");
 
+        if (UseIndex)
+          recordCacheAccess(sys::path::parent_path(EntryPath),
+                            sys::path::filename(EntryPath),
+                            (*MBOrErr)->getBufferSize());
         AddBuffer(Task, std::move(*MBOrErr), EntryPath);
       }
     };
@@ -121,7 +131,7 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
       // This CacheStream will move the temporary file into the cache when done.
       return llvm::make_unique<CacheStream>(
           llvm::make_unique<raw_fd_ostream>(Temp->FD, /* ShouldClose */ false),
-          AddBuffer, std::move(*Temp), EntryPath.str(), Task);
+          AddBuffer, std::move(*Temp), EntryPath.str(), Task, UseIndex);
     };
   };
 }
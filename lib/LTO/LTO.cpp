@@ -23,9 +23,12 @@
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/LTO/LTOBackend.h"
+#include "llvm/LTO/PhaseReport.h"
 #include "llvm/Linker/IRMover.h"
 #include "llvm/Object/IRObjectFile.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -34,12 +37,15 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/VCSRevision.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/FunctionAttrs.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
 #include <set>
@@ -132,6 +138,7 @@ static void computeCacheKey(
   AddString(Conf.AAPipeline);
   AddString(Conf.OverrideTriple);
   AddString(Conf.DefaultTriple);
+  AddUnsigned(Conf.ThinLTOPropagateFunctionAttrs);
 
   // Include the hash for the current module
   auto ModHash = Index.getModuleHash(ModuleID);
@@ -175,6 +182,25 @@ static void computeCacheKey(
       UsedCfiDecls.insert(ValueGUID);
   };
 
+  // The function attributes propagated in the thin link are applied to the
+  // definitions and to the declarations of the called functions, and so are
+  // the attributes of their pointer arguments.
+  auto AddFunctionAttrs = [&](ValueInfo VI) {
+    if (!Conf.ThinLTOPropagateFunctionAttrs)
+      return;
+    for (auto &S : VI.getSummaryList())
+      if (auto *FS = dyn_cast<FunctionSummary>(S->getBaseObject())) {
+        const FunctionSummary::FFlags &Flags = FS->fflags();
+        AddUnsigned(Flags.ReadNone | (Flags.ReadOnly << 1) |
+                    (Flags.NoRecurse << 2) | (Flags.NoUnwind << 3));
+        AddUnsigned(FS->param_accesses().size());
+        for (auto &PA : FS->param_accesses()) {
+          AddUint64(PA.ArgNo);
+          AddUnsigned(PA.IsRead | (PA.IsWritten << 1));
+        }
+      }
+  };
+
   auto AddUsedThings = [&](GlobalValueSummary *GS) {
     if (!GS) return;
     for (const ValueInfo &VI : GS->refs())
@@ -190,8 +216,10 @@ static void computeCacheKey(
         UsedTypeIds.insert(TT.VFunc.GUID);
       for (auto &TT : FS->type_checked_load_const_vcalls())
         UsedTypeIds.insert(TT.VFunc.GUID);
-      for (auto &ET : FS->calls())
+      for (auto &ET : FS->calls()) {
         AddUsedCfiGlobal(ET.first.getGUID());
+        AddFunctionAttrs(ET.first);
+      }
     }
   };
 
@@ -201,6 +229,7 @@ static void computeCacheKey(
     GlobalValue::LinkageTypes Linkage = GS.second->linkage();
     Hasher.update(
         ArrayRef<uint8_t>((const uint8_t *)&Linkage, sizeof(Linkage)));
+    AddFunctionAttrs(Index.getValueInfo(GS.first));
     AddUsedCfiGlobal(GS.first);
     AddUsedThings(GS.second);
   }
@@ -398,10 +427,25 @@ LTO::LTO(Config Conf, ThinBackend Backend,
          unsigned ParallelCodeGenParallelismLevel)
     : Conf(std::move(Conf)),
       RegularLTO(ParallelCodeGenParallelismLevel, this->Conf),
-      ThinLTO(std::move(Backend)) {}
+      ThinLTO(std::move(Backend)) {
+  if (!this->Conf.PhaseReportFile.empty())
+    Report = llvm::make_unique<PhaseReport>();
+  if (this->Conf.RegularLTOLinkThreads)
+    RegularLTO.LinkThreadPool =
+        llvm::make_unique<ThreadPool>(this->Conf.RegularLTOLinkThreads);
+}
 
-// Requires a destructor for MapVector<BitcodeModule>.
-LTO::~LTO() = default;
+LTO::~LTO() {
+  // The parsing threads refer to this object. If the link was abandoned, the
+  // errors of the modules not linked are dropped.
+  if (RegularLTO.LinkThreadPool)
+    RegularLTO.LinkThreadPool->wait();
+  for (auto *Mods : {&RegularLTO.ParsedMods,
+                     &RegularLTO.ParsedModsWithSummaries})
+    for (auto &PM : *Mods)
+      if (PM->Err)
+        consumeError(std::move(*PM->Err));
+}
 
 // Add the symbols in the given module to the GlobalResolutions map, and resolve
 // their partitions.
@@ -476,13 +520,28 @@ Error LTO::add(std::unique_ptr<InputFile> Input,
   if (RegularLTO.CombinedModule->getTargetTriple().empty())
     RegularLTO.CombinedModule->setTargetTriple(Input->getTargetTriple());
 
+  // The modules queued for parsing refer to the symbols of the input. Take
+  // ownership of it before the first one is queued, an error in a later
+  // module must not free the input while the queued ones are parsed.
+  InputFile &In = *Input;
+  size_t NumParsedMods =
+      RegularLTO.ParsedMods.size() + RegularLTO.ParsedModsWithSummaries.size();
+  if (RegularLTO.LinkThreadPool)
+    RegularLTO.ParsedInputs.push_back(std::move(Input));
+
   const SymbolResolution *ResI = Res.begin();
-  for (unsigned I = 0; I != Input->Mods.size(); ++I)
-    if (Error Err = addModule(*Input, I, ResI, Res.end()))
+  for (unsigned I = 0; I != In.Mods.size(); ++I)
+    if (Error Err = addModule(In, I, ResI, Res.end()))
       return Err;
 
+  // Inputs without modules to parse are not needed anymore.
+  if (RegularLTO.LinkThreadPool &&
+      NumParsedMods == RegularLTO.ParsedMods.size() +
+                           RegularLTO.ParsedModsWithSummaries.size())
+    RegularLTO.ParsedInputs.pop_back();
+
   assert(ResI == Res.end());
-  return Error::success();
+  return linkParsedModules(/*Wait=*/false);
 }
 
 Error LTO::addModule(InputFile &Input, unsigned ModI,
@@ -493,6 +552,7 @@ Error LTO::addModule(InputFile &Input, unsigned ModI,
     return LTOInfo.takeError();
 
   BitcodeModule BM = Input.Mods[ModI];
+  PhaseReport::Phase Phase(Report.get(), "add", 0, BM.getModuleIdentifier());
   auto ModSyms = Input.module_symbols(ModI);
   addModuleToGlobalRes(ModSyms, {ResI, ResE},
                        LTOInfo->IsThinLTO ? ThinLTO.ModuleMap.size() + 1 : 0,
@@ -501,8 +561,31 @@ Error LTO::addModule(InputFile &Input, unsigned ModI,
   if (LTOInfo->IsThinLTO)
     return addThinLTO(BM, ModSyms, ResI, ResE);
 
+  addRegularLTOCommons(ModSyms, ResI);
+
+  if (RegularLTO.LinkThreadPool) {
+    // Regular LTO module summaries are added to a dummy module that represents
+    // the combined regular LTO module.
+    if (LTOInfo->HasSummary)
+      if (Error Err = BM.readSummary(ThinLTO.CombinedIndex, "", -1ull))
+        return Err;
+
+    auto &Mods = LTOInfo->HasSummary ? RegularLTO.ParsedModsWithSummaries
+                                     : RegularLTO.ParsedMods;
+    Mods.push_back(llvm::make_unique<RegularLTOState::ParsedModule>());
+    RegularLTOState::ParsedModule &PM = *Mods.back();
+    std::vector<SymbolResolution> ModRes(ResI, ResI + ModSyms.size());
+    ResI += ModSyms.size();
+    PM.Done = RegularLTO.LinkThreadPool->async(
+        [this, BM, ModSyms, &PM](const std::vector<SymbolResolution> &ModRes) {
+          parseRegularLTO(BM, ModSyms, ModRes, PM);
+        },
+        std::move(ModRes));
+    return Error::success();
+  }
+
   Expected<RegularLTOState::AddedModule> ModOrErr =
-      addRegularLTO(BM, ModSyms, ResI, ResE);
+      addRegularLTO(BM, ModSyms, ResI, ResE, RegularLTO.Ctx);
   if (!ModOrErr)
     return ModOrErr.takeError();
 
@@ -547,16 +630,34 @@ handleNonPrevailingComdat(GlobalValue &GV,
     GO->setComdat(nullptr);
 }
 
-// Add a regular LTO object to the link.
+// Common resolution: collect the maximum size/alignment over all commons.
+// We also record if we see an instance of a common as prevailing, so that
+// if none is prevailing we can ignore it later.
+void LTO::addRegularLTOCommons(ArrayRef<InputFile::Symbol> Syms,
+                               const SymbolResolution *ResI) {
+  for (const InputFile::Symbol &Sym : Syms) {
+    SymbolResolution Res = *ResI++;
+    if (!Sym.isCommon())
+      continue;
+    // FIXME: We should figure out what to do about commons defined by asm.
+    // For now they aren't reported correctly by ModuleSymbolTable.
+    auto &CommonRes = RegularLTO.Commons[Sym.getIRName()];
+    CommonRes.Size = std::max(CommonRes.Size, Sym.getCommonSize());
+    CommonRes.Align = std::max(CommonRes.Align, Sym.getCommonAlignment());
+    CommonRes.Prevailing |= Res.Prevailing;
+  }
+}
+
+// Add a regular LTO object to the link, loading it into Ctx.
 // The resulting module needs to be linked into the combined LTO module with
 // linkRegularLTO.
 Expected<LTO::RegularLTOState::AddedModule>
 LTO::addRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
                    const SymbolResolution *&ResI,
-                   const SymbolResolution *ResE) {
+                   const SymbolResolution *ResE, LLVMContext &Ctx) {
   RegularLTOState::AddedModule Mod;
   Expected<std::unique_ptr<Module>> MOrErr =
-      BM.getLazyModule(RegularLTO.Ctx, /*ShouldLazyLoadMetadata*/ true,
+      BM.getLazyModule(Ctx, /*ShouldLazyLoadMetadata*/ true,
                        /*IsImporting*/ false);
   if (!MOrErr)
     return MOrErr.takeError();
@@ -641,18 +742,6 @@ LTO::addRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
       // Set the 'local' flag based on the linker resolution for this symbol.
       GV->setDSOLocal(Res.FinalDefinitionInLinkageUnit);
     }
-    // Common resolution: collect the maximum size/alignment over all commons.
-    // We also record if we see an instance of a common as prevailing, so that
-    // if none is prevailing we can ignore it later.
-    if (Sym.isCommon()) {
-      // FIXME: We should figure out what to do about commons defined by asm.
-      // For now they aren't reported correctly by ModuleSymbolTable.
-      auto &CommonRes = RegularLTO.Commons[Sym.getIRName()];
-      CommonRes.Size = std::max(CommonRes.Size, Sym.getCommonSize());
-      CommonRes.Align = std::max(CommonRes.Align, Sym.getCommonAlignment());
-      CommonRes.Prevailing |= Res.Prevailing;
-    }
-
   }
   if (!M.getComdatSymbolTable().empty())
     for (GlobalValue &GV : M.global_values())
@@ -688,6 +777,93 @@ Error LTO::linkRegularLTO(RegularLTOState::AddedModule Mod,
                                 /* IsPerformingImport */ false);
 }
 
+// Drop the definitions that the IRMover will not link from a module: the ones
+// that are neither kept, local nor the base object of an alias.
+static void dropUnlinkedDefinitions(Module &M, ArrayRef<GlobalValue *> Keep) {
+  DenseSet<const GlobalValue *> Linked;
+  Linked.insert(Keep.begin(), Keep.end());
+  for (GlobalAlias &GA : M.aliases())
+    if (const GlobalObject *GO = GA.getBaseObject())
+      Linked.insert(GO);
+
+  for (Function &F : M.functions())
+    if (!F.isDeclaration() && !F.hasLocalLinkage() && !Linked.count(&F)) {
+      F.deleteBody();
+      F.setComdat(nullptr);
+    }
+  for (GlobalVariable &GV : M.globals())
+    if (!GV.isDeclaration() && !GV.hasLocalLinkage() && !Linked.count(&GV)) {
+      GV.setInitializer(nullptr);
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+      GV.setComdat(nullptr);
+    }
+}
+
+// Parse a regular LTO module into its own context on a link thread and apply
+// the symbol resolutions to it. The definitions that will not be linked are
+// dropped before the function bodies are materialized.
+void LTO::parseRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
+                          ArrayRef<SymbolResolution> Res,
+                          RegularLTOState::ParsedModule &PM) {
+  PM.Ctx = llvm::make_unique<LTOLLVMContext>(Conf);
+  const SymbolResolution *ResI = Res.begin();
+  Expected<RegularLTOState::AddedModule> ModOrErr =
+      addRegularLTO(BM, Syms, ResI, Res.end(), *PM.Ctx);
+  if (!ModOrErr) {
+    PM.Err = ModOrErr.takeError();
+    return;
+  }
+  PM.Mod = std::move(*ModOrErr);
+
+  dropUnlinkedDefinitions(*PM.Mod.M, PM.Mod.Keep);
+  if (Error Err = PM.Mod.M->materializeAll())
+    PM.Err = std::move(Err);
+}
+
+// Link a module parsed on a link thread. It is cloned into the context of the
+// combined module first, the kept values are found in the clone by name.
+Error LTO::linkParsedRegularLTO(RegularLTOState::ParsedModule &PM,
+                                bool LivenessFromIndex) {
+  PM.Done.wait();
+  if (PM.Err)
+    return std::move(*PM.Err);
+
+  RegularLTOState::AddedModule Mod;
+  Mod.M = CloneModuleIntoContext(*PM.Mod.M, RegularLTO.Ctx);
+  for (GlobalValue *GV : PM.Mod.Keep) {
+    assert(GV->hasName() && "Kept values are found by name");
+    Mod.Keep.push_back(Mod.M->getNamedValue(GV->getName()));
+  }
+
+  // Freeing the private module and context costs about as much as cloning it,
+  // thus it is left to the link threads.
+  Module *M = PM.Mod.M.release();
+  LTOLLVMContext *Ctx = PM.Ctx.release();
+  RegularLTO.LinkThreadPool->async([M, Ctx]() {
+    delete M;
+    delete Ctx;
+  });
+
+  return linkRegularLTO(std::move(Mod), LivenessFromIndex);
+}
+
+// Link the parsed modules without summaries in the order of the inputs. Unless
+// Wait is set, stop at the first one that is still being parsed.
+Error LTO::linkParsedModules(bool Wait) {
+  auto &Mods = RegularLTO.ParsedMods;
+  while (!Mods.empty()) {
+    if (!Wait && Mods.front()->Done.wait_for(std::chrono::seconds(0)) !=
+                     std::future_status::ready)
+      break;
+    std::unique_ptr<RegularLTOState::ParsedModule> PM =
+        std::move(Mods.front());
+    Mods.pop_front();
+    if (Error Err = linkParsedRegularLTO(*PM, /*LivenessFromIndex=*/false))
+      return Err;
+  }
+  return Error::success();
+}
+
 // Add a ThinLTO module to the link.
 Error LTO::addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
                       const SymbolResolution *&ResI,
@@ -753,18 +929,38 @@ Error LTO::run(AddStreamFn AddStream, NativeObjectCache Cache) {
           GlobalValue::dropLLVMManglingEscape(Res.second.IRName)));
   }
 
-  computeDeadSymbols(ThinLTO.CombinedIndex, GUIDPreservedSymbols);
+  {
+    PhaseReport::Phase Phase(Report.get(), "dead-symbols");
+    computeDeadSymbols(ThinLTO.CombinedIndex, GUIDPreservedSymbols);
+  }
 
-  if (auto E = runRegularLTO(AddStream))
-    return E;
-  return runThinLTO(AddStream, Cache);
+  Error Result = runRegularLTO(AddStream);
+  if (!Result)
+    Result = runThinLTO(AddStream, Cache);
+  if (!Result && Report)
+    Result = Report->writeToFile(Conf.PhaseReportFile);
+  return Result;
 }
 
 Error LTO::runRegularLTO(AddStreamFn AddStream) {
-  for (auto &M : RegularLTO.ModsWithSummaries)
-    if (Error Err = linkRegularLTO(std::move(M),
-                                   /*LivenessFromIndex=*/true))
+  {
+    PhaseReport::Phase Phase(Report.get(), "link");
+    if (Error Err = linkParsedModules(/*Wait=*/true))
       return Err;
+    while (!RegularLTO.ParsedModsWithSummaries.empty()) {
+      std::unique_ptr<RegularLTOState::ParsedModule> PM =
+          std::move(RegularLTO.ParsedModsWithSummaries.front());
+      RegularLTO.ParsedModsWithSummaries.pop_front();
+      if (Error Err = linkParsedRegularLTO(*PM, /*LivenessFromIndex=*/true))
+        return Err;
+    }
+    RegularLTO.ParsedInputs.clear();
+
+    for (auto &M : RegularLTO.ModsWithSummaries)
+      if (Error Err = linkRegularLTO(std::move(M),
+                                     /*LivenessFromIndex=*/true))
+        return Err;
+  }
 
   // Make sure commons have the right size/alignment: we kept the largest from
   // all the prevailing when adding the inputs, and we apply it here.
@@ -823,7 +1019,8 @@ Error LTO::runRegularLTO(AddStreamFn AddStream) {
       return Error::success();
   }
   return backend(Conf, AddStream, RegularLTO.ParallelCodeGenParallelismLevel,
-                 std::move(RegularLTO.CombinedModule), ThinLTO.CombinedIndex);
+                 std::move(RegularLTO.CombinedModule), ThinLTO.CombinedIndex,
+                 Report.get());
 }
 
 /// This class defines the interface to the ThinLTO backend.
@@ -832,12 +1029,15 @@ protected:
   Config &Conf;
   ModuleSummaryIndex &CombinedIndex;
   const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries;
+  PhaseReport *Report;
 
 public:
   ThinBackendProc(Config &Conf, ModuleSummaryIndex &CombinedIndex,
-                  const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries)
+                  const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
+                  PhaseReport *Report)
       : Conf(Conf), CombinedIndex(CombinedIndex),
-        ModuleToDefinedGVSummaries(ModuleToDefinedGVSummaries) {}
+        ModuleToDefinedGVSummaries(ModuleToDefinedGVSummaries),
+        Report(Report) {}
 
   virtual ~ThinBackendProc() {}
   virtual Error start(
@@ -849,6 +1049,25 @@ public:
   virtual Error wait() = 0;
 };
 
+/// Return the number of instructions of the functions defined in
+/// @p DefinedGlobals plus the ones imported according to @p ImportList.
+static uint64_t
+getBackendInstCount(const ModuleSummaryIndex &Index,
+                    const GVSummaryMapTy &DefinedGlobals,
+                    const FunctionImporter::ImportMapTy &ImportList) {
+  uint64_t InstCount = 0;
+  for (auto &Def : DefinedGlobals)
+    if (auto *FS = dyn_cast<FunctionSummary>(Def.second))
+      InstCount += FS->instCount();
+  for (auto &FromModule : ImportList)
+    for (auto &Import : FromModule.second)
+      if (GlobalValueSummary *S =
+              Index.findSummaryInModule(Import.first, FromModule.first()))
+        if (auto *FS = dyn_cast<FunctionSummary>(S))
+          InstCount += FS->instCount();
+  return InstCount;
+}
+
 namespace {
 class InProcessThinBackend : public ThinBackendProc {
   ThreadPool BackendThreadPool;
@@ -861,13 +1080,41 @@ class InProcessThinBackend : public ThinBackendProc {
   Optional<Error> Err;
   std::mutex ErrMu;
 
+  /// The data decoded from the modules imported from, shared by all backend
+  /// threads.
+  BitcodeImportCache ImportCache;
+
+  /// A backend job that was started but not yet scheduled.
+  struct BackendJob {
+    unsigned Task;
+    BitcodeModule BM;
+    const FunctionImporter::ImportMapTy *ImportList;
+    const FunctionImporter::ExportSetTy *ExportList;
+    const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> *ResolvedODR;
+    const GVSummaryMapTy *DefinedGlobals;
+    MapVector<StringRef, BitcodeModule> *ModuleMap;
+    uint64_t InstCount;
+    double Cost;
+  };
+  std::vector<BackendJob> Jobs;
+
+  /// The measured wall time (in seconds) of the backend jobs of this and
+  /// previous links, by module identifier.
+  StringMap<double> BackendTimes;
+  std::mutex BackendTimesMu;
+
+  void readBackendTimes();
+  void writeBackendTimes();
+  void scheduleJob(const BackendJob &Job);
+
 public:
   InProcessThinBackend(
       Config &Conf, ModuleSummaryIndex &CombinedIndex,
       unsigned ThinLTOParallelismLevel,
       const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
-      AddStreamFn AddStream, NativeObjectCache Cache)
-      : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries),
+      AddStreamFn AddStream, NativeObjectCache Cache, PhaseReport *Report)
+      : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries,
+                        Report),
         BackendThreadPool(ThinLTOParallelismLevel),
         AddStream(std::move(AddStream)), Cache(std::move(Cache)) {
     // Create a mapping from type identifier GUIDs to type identifier summaries.
@@ -882,6 +1129,7 @@ public:
     for (auto &Name : CombinedIndex.cfiFunctionDecls())
       CfiFunctionDecls.insert(
           GlobalValue::getGUID(GlobalValue::dropLLVMManglingEscape(Name)));
+    readBackendTimes();
   }
 
   Error runThinLTOBackendThread(
@@ -893,14 +1141,30 @@ public:
       const GVSummaryMapTy &DefinedGlobals,
       MapVector<StringRef, BitcodeModule> &ModuleMap,
       const TypeIdSummariesByGuidTy &TypeIdSummariesByGuid) {
-    auto RunThinBackend = [&](AddStreamFn AddStream) {
-      LTOLLVMContext BackendContext(Conf);
-      Expected<std::unique_ptr<Module>> MOrErr = BM.parseModule(BackendContext);
-      if (!MOrErr)
-        return MOrErr.takeError();
-
-      return thinBackend(Conf, Task, AddStream, **MOrErr, CombinedIndex,
-                         ImportList, DefinedGlobals, ModuleMap);
+    PhaseReport::Phase Phase(Report, "backend", Task,
+                             BM.getModuleIdentifier());
+    auto RunThinBackend = [&](AddStreamFn AddStream) -> Error {
+      TimeRecord Start = TimeRecord::getCurrentTime(true);
+      {
+        LTOLLVMContext BackendContext(Conf);
+        Expected<std::unique_ptr<Module>> MOrErr =
+            BM.parseModule(BackendContext);
+        if (!MOrErr)
+          return MOrErr.takeError();
+
+        if (Error E = thinBackend(Conf, Task, AddStream, **MOrErr,
+                                  CombinedIndex, ImportList, DefinedGlobals,
+                                  ModuleMap, &ImportCache, Report))
+          return E;
+      }
+      TimeRecord End = TimeRecord::getCurrentTime(false);
+
+      // Cache hits are not recorded, they say nothing about the cost of the
+      // module once it changes.
+      std::unique_lock<std::mutex> L(BackendTimesMu);
+      BackendTimes[BM.getModuleIdentifier()] =
+          End.getWallTime() - Start.getWallTime();
+      return Error::success();
     };
 
     auto ModuleID = BM.getModuleIdentifier();
@@ -917,9 +1181,12 @@ public:
     computeCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList, ExportList,
                     ResolvedODR, DefinedGlobals, TypeIdSummariesByGuid,
                     CfiFunctionDefs, CfiFunctionDecls);
-    if (AddStreamFn CacheAddStream = Cache(Task, Key))
+    if (AddStreamFn CacheAddStream = Cache(Task, Key)) {
+      Phase.setCacheStatus(PhaseReport::CacheMiss);
       return RunThinBackend(CacheAddStream);
+    }
 
+    Phase.setCacheStatus(PhaseReport::CacheHit);
     return Error::success();
   }
 
@@ -933,34 +1200,51 @@ public:
     assert(ModuleToDefinedGVSummaries.count(ModulePath));
     const GVSummaryMapTy &DefinedGlobals =
         ModuleToDefinedGVSummaries.find(ModulePath)->second;
-    BackendThreadPool.async(
-        [=](BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
-            const FunctionImporter::ImportMapTy &ImportList,
-            const FunctionImporter::ExportSetTy &ExportList,
-            const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>
-                &ResolvedODR,
-            const GVSummaryMapTy &DefinedGlobals,
-            MapVector<StringRef, BitcodeModule> &ModuleMap,
-            const TypeIdSummariesByGuidTy &TypeIdSummariesByGuid) {
-          Error E = runThinLTOBackendThread(
-              AddStream, Cache, Task, BM, CombinedIndex, ImportList, ExportList,
-              ResolvedODR, DefinedGlobals, ModuleMap, TypeIdSummariesByGuid);
-          if (E) {
-            std::unique_lock<std::mutex> L(ErrMu);
-            if (Err)
-              Err = joinErrors(std::move(*Err), std::move(E));
-            else
-              Err = std::move(E);
-          }
-        },
-        BM, std::ref(CombinedIndex), std::ref(ImportList), std::ref(ExportList),
-        std::ref(ResolvedODR), std::ref(DefinedGlobals), std::ref(ModuleMap),
-        std::ref(TypeIdSummariesByGuid));
+
+    // The jobs are only scheduled once all of them are known, thus the most
+    // expensive ones can be started first.
+    uint64_t InstCount =
+        getBackendInstCount(CombinedIndex, DefinedGlobals, ImportList);
+    Jobs.push_back({Task, BM, &ImportList, &ExportList, &ResolvedODR,
+                    &DefinedGlobals, &ModuleMap, InstCount, 0});
     return Error::success();
   }
 
   Error wait() override {
+    // Predict the cost of the jobs by the measured time of previous links. For
+    // modules without history, scale the instruction count by the average
+    // time per instruction of the ones with history.
+    double KnownTime = 0, KnownInsts = 0;
+    for (BackendJob &Job : Jobs) {
+      auto It = BackendTimes.find(Job.BM.getModuleIdentifier());
+      if (It == BackendTimes.end())
+        continue;
+      KnownTime += It->second;
+      KnownInsts += Job.InstCount;
+    }
+    bool UseHistory = KnownTime > 0 && KnownInsts > 0;
+    for (BackendJob &Job : Jobs) {
+      Job.Cost = Job.InstCount;
+      if (!UseHistory)
+        continue;
+      auto It = BackendTimes.find(Job.BM.getModuleIdentifier());
+      Job.Cost = It != BackendTimes.end() ? It->second
+                                          : Job.InstCount * KnownTime /
+                                                KnownInsts;
+    }
+
+    // Start the most expensive jobs first, they would otherwise determine the
+    // tail of the link.
+    std::stable_sort(Jobs.begin(), Jobs.end(),
+                     [](const BackendJob &A, const BackendJob &B) {
+                       return A.Cost > B.Cost;
+                     });
+    for (const BackendJob &Job : Jobs)
+      scheduleJob(Job);
+    Jobs.clear();
+
     BackendThreadPool.wait();
+    writeBackendTimes();
     if (Err)
       return std::move(*Err);
     else
@@ -969,13 +1253,92 @@ public:
 };
 } // end anonymous namespace
 
+void InProcessThinBackend::scheduleJob(const BackendJob &Job) {
+  BackendThreadPool.async(
+      [=](BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
+          const FunctionImporter::ImportMapTy &ImportList,
+          const FunctionImporter::ExportSetTy &ExportList,
+          const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>
+              &ResolvedODR,
+          const GVSummaryMapTy &DefinedGlobals,
+          MapVector<StringRef, BitcodeModule> &ModuleMap,
+          const TypeIdSummariesByGuidTy &TypeIdSummariesByGuid) {
+        Error E = runThinLTOBackendThread(
+            AddStream, Cache, Job.Task, BM, CombinedIndex, ImportList,
+            ExportList, ResolvedODR, DefinedGlobals, ModuleMap,
+            TypeIdSummariesByGuid);
+        if (E) {
+          std::unique_lock<std::mutex> L(ErrMu);
+          if (Err)
+            Err = joinErrors(std::move(*Err), std::move(E));
+          else
+            Err = std::move(E);
+        }
+      },
+      Job.BM, std::ref(CombinedIndex), std::cref(*Job.ImportList),
+      std::cref(*Job.ExportList), std::cref(*Job.ResolvedODR),
+      std::cref(*Job.DefinedGlobals), std::ref(*Job.ModuleMap),
+      std::cref(TypeIdSummariesByGuid));
+}
+
+// The backend times file has one line per module: the wall time in seconds
+// followed by a tab and the module identifier.
+void InProcessThinBackend::readBackendTimes() {
+  if (Conf.ThinLTOBackendTimesFile.empty())
+    return;
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(Conf.ThinLTOBackendTimesFile);
+  // The history is only a hint, ignore it if it cannot be read.
+  if (!MBOrErr)
+    return;
+
+  SmallVector<StringRef, 64> Lines;
+  (*MBOrErr)->getBuffer().split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines) {
+    StringRef Time, ModuleID;
+    std::tie(Time, ModuleID) = Line.split('\t');
+    double Seconds;
+    if (ModuleID.empty() || Time.getAsDouble(Seconds) || Seconds < 0)
+      continue;
+    BackendTimes[ModuleID] = Seconds;
+  }
+}
+
+void InProcessThinBackend::writeBackendTimes() {
+  if (Conf.ThinLTOBackendTimesFile.empty() || BackendTimes.empty())
+    return;
+
+  // Write to a temporary file first so concurrent links never see a partial
+  // history.
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Conf.ThinLTOBackendTimesFile + ".%%%%%%", FD,
+                                TempPath))
+    return;
+
+  std::vector<StringRef> ModuleIDs;
+  for (auto &Entry : BackendTimes)
+    ModuleIDs.push_back(Entry.first());
+  std::sort(ModuleIDs.begin(), ModuleIDs.end());
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (StringRef ModuleID : ModuleIDs)
+      OS << format("%.6f", BackendTimes[ModuleID]) << '\t' << ModuleID << '\n';
+  }
+  if (sys::fs::rename(TempPath, Conf.ThinLTOBackendTimesFile))
+    sys::fs::remove(TempPath);
+}
+
 ThinBackend lto::createInProcessThinBackend(unsigned ParallelismLevel) {
   return [=](Config &Conf, ModuleSummaryIndex &CombinedIndex,
              const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
-             AddStreamFn AddStream, NativeObjectCache Cache) {
+             AddStreamFn AddStream, NativeObjectCache Cache,
+             PhaseReport *Report) {
     return llvm::make_unique<InProcessThinBackend>(
         Conf, CombinedIndex, ParallelismLevel, ModuleToDefinedGVSummaries,
-        AddStream, Cache);
+        AddStream, Cache, Report);
   };
 }
 
@@ -1012,8 +1375,9 @@ public:
       Config &Conf, ModuleSummaryIndex &CombinedIndex,
       const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
       std::string OldPrefix, std::string NewPrefix, bool ShouldEmitImportsFiles,
-      std::string LinkedObjectsFileName)
-      : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries),
+      std::string LinkedObjectsFileName, PhaseReport *Report)
+      : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries,
+                        Report),
         OldPrefix(OldPrefix), NewPrefix(NewPrefix),
         ShouldEmitImportsFiles(ShouldEmitImportsFiles),
         LinkedObjectsFileName(LinkedObjectsFileName) {}
@@ -1025,6 +1389,7 @@ public:
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
       MapVector<StringRef, BitcodeModule> &ModuleMap) override {
     StringRef ModulePath = BM.getModuleIdentifier();
+    PhaseReport::Phase Phase(Report, "write-index", Task, ModulePath);
     std::string NewModulePath =
         getThinLTOOutputFile(ModulePath, OldPrefix, NewPrefix);
 
@@ -1065,13 +1430,30 @@ ThinBackend lto::createWriteIndexesThinBackend(std::string OldPrefix,
                                                std::string LinkedObjectsFile) {
   return [=](Config &Conf, ModuleSummaryIndex &CombinedIndex,
              const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
-             AddStreamFn AddStream, NativeObjectCache Cache) {
+             AddStreamFn AddStream, NativeObjectCache Cache,
+             PhaseReport *Report) {
     return llvm::make_unique<WriteIndexesThinBackend>(
         Conf, CombinedIndex, ModuleToDefinedGVSummaries, OldPrefix, NewPrefix,
-        ShouldEmitImportsFiles, LinkedObjectsFile);
+        ShouldEmitImportsFiles, LinkedObjectsFile, Report);
   };
 }
 
+/// Write \p ImportCache to \p Path, through a temporary file so concurrent
+/// links never see a partial cache.
+static void writeImportListCache(StringRef Path,
+                                 const ImportListCache &ImportCache) {
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + ".%%%%%%", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    ImportCache.write(OS);
+  }
+  if (sys::fs::rename(TempPath, Path))
+    sys::fs::remove(TempPath);
+}
+
 Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
   if (ThinLTO.ModuleMap.empty())
     return Error::success();
@@ -1102,9 +1484,41 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
       ThinLTO.ModuleMap.size());
   StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>> ResolvedODR;
 
-  if (Conf.OptLevel > 0)
-    ComputeCrossModuleImport(ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
-                             ImportLists, ExportLists);
+  auto isPrevailing = [&](GlobalValue::GUID GUID,
+                          const GlobalValueSummary *S) {
+    return ThinLTO.PrevailingModuleForGUID[GUID] == S->modulePath();
+  };
+
+  if (Conf.OptLevel > 0) {
+    {
+      PhaseReport::Phase Phase(Report.get(), "import-lists");
+      if (Conf.ThinLTOImportListsFile.empty()) {
+        ComputeCrossModuleImport(ThinLTO.CombinedIndex,
+                                 ModuleToDefinedGVSummaries, ImportLists,
+                                 ExportLists);
+      } else {
+        // The import lists of the previous link are only a hint, ignore them if
+        // they cannot be read.
+        ImportListCache ImportCache;
+        ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+            MemoryBuffer::getFile(Conf.ThinLTOImportListsFile);
+        if (MBOrErr)
+          ImportCache = ImportListCache::read((*MBOrErr)->getBuffer());
+        ComputeCrossModuleImport(ThinLTO.CombinedIndex,
+                                 ModuleToDefinedGVSummaries, ImportLists,
+                                 ExportLists, &ImportCache);
+        writeImportListCache(Conf.ThinLTOImportListsFile, ImportCache);
+      }
+    }
+
+    // Propagate the function attributes before the weak definitions are
+    // resolved, the linkage of the non-prevailing copies does not tell anymore
+    // whether the definition may be replaced.
+    if (Conf.ThinLTOPropagateFunctionAttrs) {
+      PhaseReport::Phase Phase(Report.get(), "function-attrs");
+      thinLTOPropagateFunctionAttrs(ThinLTO.CombinedIndex, isPrevailing);
+    }
+  }
 
   // Figure out which symbols need to be internalized. This also needs to happen
   // at -O0 because summary-based DCE is implemented using internalization, and
@@ -1139,23 +1553,25 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
             ExportList->second.count(GUID)) ||
            ExportedGUIDs.count(GUID);
   };
-  thinLTOInternalizeAndPromoteInIndex(ThinLTO.CombinedIndex, isExported);
+  {
+    PhaseReport::Phase Phase(Report.get(), "internalize");
+    thinLTOInternalizeAndPromoteInIndex(ThinLTO.CombinedIndex, isExported);
+  }
 
-  auto isPrevailing = [&](GlobalValue::GUID GUID,
-                          const GlobalValueSummary *S) {
-    return ThinLTO.PrevailingModuleForGUID[GUID] == S->modulePath();
-  };
   auto recordNewLinkage = [&](StringRef ModuleIdentifier,
                               GlobalValue::GUID GUID,
                               GlobalValue::LinkageTypes NewLinkage) {
     ResolvedODR[ModuleIdentifier][GUID] = NewLinkage;
   };
-  thinLTOResolveWeakForLinkerInIndex(ThinLTO.CombinedIndex, isPrevailing,
-                                     recordNewLinkage);
+  {
+    PhaseReport::Phase Phase(Report.get(), "resolve-weak");
+    thinLTOResolveWeakForLinkerInIndex(ThinLTO.CombinedIndex, isPrevailing,
+                                       recordNewLinkage);
+  }
 
   std::unique_ptr<ThinBackendProc> BackendProc =
       ThinLTO.Backend(Conf, ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
-                      AddStream, Cache);
+                      AddStream, Cache, Report.get());
 
   // Tasks 0 through ParallelCodeGenParallelismLevel-1 are reserved for combined
   // module and parallel code generation partitions.
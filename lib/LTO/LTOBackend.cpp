@@ -25,6 +25,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/LTO/LTO.h"
+#include "llvm/LTO/PhaseReport.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Object/ModuleSymbolTable.h"
 #include "llvm/Passes/PassBuilder.h"
@@ -32,10 +33,13 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/FunctionAttrs.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
@@ -287,50 +291,65 @@ void codegen(Config &Conf, TargetMachine *TM, AddStreamFn AddStream,
 
 void splitCodeGen(Config &C, TargetMachine *TM, AddStreamFn AddStream,
                   unsigned ParallelCodeGenParallelismLevel,
-                  std::unique_ptr<Module> Mod) {
-  ThreadPool CodegenThreadPool(ParallelCodeGenParallelismLevel);
-  unsigned ThreadCount = 0;
+                  std::unique_ptr<Module> Mod, PhaseReport *Phases) {
   const Target *T = &TM->getTarget();
 
-  SplitModule(
-      std::move(Mod), ParallelCodeGenParallelismLevel,
-      [&](std::unique_ptr<Module> MPart) {
-        // We want to clone the module in a new context to multi-thread the
-        // codegen. We do it by serializing partition modules to bitcode
-        // (while still on the main thread, in order to avoid data races) and
-        // spinning up new threads which deserialize the partitions into
-        // separate contexts.
-        // FIXME: Provide a more direct way to do this in LLVM.
-        SmallString<0> BC;
-        raw_svector_ostream BCOS(BC);
-        WriteBitcodeToFile(MPart.get(), BCOS);
-
-        // Enqueue the task
-        CodegenThreadPool.async(
-            [&](const SmallString<0> &BC, unsigned ThreadId) {
-              LTOLLVMContext Ctx(C);
-              Expected<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
-                  MemoryBufferRef(StringRef(BC.data(), BC.size()), "ld-temp.o"),
-                  Ctx);
-              if (!MOrErr)
-                report_fatal_error("Failed to read bitcode");
-              std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
-
-              std::unique_ptr<TargetMachine> TM =
-                  createTargetMachine(C, T, *MPartInCtx);
-
-              codegen(C, TM.get(), AddStream, ThreadId, *MPartInCtx);
-            },
-            // Pass BC using std::move to ensure that it get moved rather than
-            // copied into the thread's context.
-            std::move(BC), ThreadCount++);
-      },
-      false);
+  // Collect all partitions first. Once SplitModule is done their shared
+  // context is no longer modified, thus they can be cloned into separate
+  // contexts concurrently.
+  std::vector<std::unique_ptr<Module>> Parts;
+  SplitModule(std::move(Mod), ParallelCodeGenParallelismLevel,
+              [&](std::unique_ptr<Module> MPart) {
+                Parts.push_back(std::move(MPart));
+              },
+              false);
+
+  SplitModuleReport Report(Parts.size());
+  if (SplitModuleReport::isEnabled())
+    for (unsigned I = 0, E = Parts.size(); I != E; ++I)
+      Report.setPredictedCost(I, *Parts[I]);
+
+  std::vector<std::unique_ptr<LTOLLVMContext>> Contexts(Parts.size());
+  std::vector<std::unique_ptr<Module>> PartsInCtx(Parts.size());
+
+  ThreadPool CodegenThreadPool(ParallelCodeGenParallelismLevel);
+
+  // Clone the partitions into new contexts to multi-thread the codegen.
+  for (unsigned ThreadId = 0, E = Parts.size(); ThreadId != E; ++ThreadId)
+    CodegenThreadPool.async([&, ThreadId]() {
+      Contexts[ThreadId] = llvm::make_unique<LTOLLVMContext>(C);
+      PartsInCtx[ThreadId] =
+          CloneModuleIntoContext(*Parts[ThreadId], *Contexts[ThreadId]);
+    });
+  CodegenThreadPool.wait();
+
+  // The original partitions are not needed anymore. Free them on this thread
+  // as their context is shared.
+  Parts.clear();
+
+  for (unsigned ThreadId = 0, E = PartsInCtx.size(); ThreadId != E;
+       ++ThreadId)
+    CodegenThreadPool.async([&, ThreadId]() {
+      Module &MPartInCtx = *PartsInCtx[ThreadId];
+      std::unique_ptr<TargetMachine> TM =
+          createTargetMachine(C, T, MPartInCtx);
+
+      TimeRecord Start = TimeRecord::getCurrentTime(true);
+      {
+        PhaseReport::Phase Phase(Phases, "codegen", ThreadId);
+        codegen(C, TM.get(), AddStream, ThreadId, MPartInCtx);
+      }
+      TimeRecord End = TimeRecord::getCurrentTime(false);
+      Report.setWallTime(ThreadId, End.getWallTime() - Start.getWallTime());
+      PartsInCtx[ThreadId].reset();
+      Contexts[ThreadId].reset();
+    });
 
   // Because the inner lambda (which runs in a worker thread) captures our local
   // variables, we need to wait for the worker threads to terminate before we
   // can leave the function scope.
   CodegenThreadPool.wait();
+  Report.printIfEnabled();
 }
 
 Expected<const Target *> initAndLookupTarget(Config &C, Module &Mod) {
@@ -361,7 +380,7 @@ finalizeOptimizationRemarks(std::unique_ptr<ToolOutputFile> DiagOutputFile) {
 Error lto::backend(Config &C, AddStreamFn AddStream,
                    unsigned ParallelCodeGenParallelismLevel,
                    std::unique_ptr<Module> Mod,
-                   ModuleSummaryIndex &CombinedIndex) {
+                   ModuleSummaryIndex &CombinedIndex, PhaseReport *Report) {
   Expected<const Target *> TOrErr = initAndLookupTarget(C, *Mod);
   if (!TOrErr)
     return TOrErr.takeError();
@@ -376,6 +395,7 @@ Error lto::backend(Config &C, AddStreamFn AddStream,
   auto DiagnosticOutputFile = std::move(*DiagFileOrErr);
 
   if (!C.CodeGenOnly) {
+    PhaseReport::Phase Phase(Report, "opt");
     if (!opt(C, TM.get(), 0, *Mod, /*IsThinLTO=*/false,
              /*ExportSummary=*/&CombinedIndex, /*ImportSummary=*/nullptr)) {
       finalizeOptimizationRemarks(std::move(DiagnosticOutputFile));
@@ -384,10 +404,11 @@ Error lto::backend(Config &C, AddStreamFn AddStream,
   }
 
   if (ParallelCodeGenParallelismLevel == 1) {
+    PhaseReport::Phase Phase(Report, "codegen");
     codegen(C, TM.get(), AddStream, 0, *Mod);
   } else {
     splitCodeGen(C, TM.get(), AddStream, ParallelCodeGenParallelismLevel,
-                 std::move(Mod));
+                 std::move(Mod), Report);
   }
   finalizeOptimizationRemarks(std::move(DiagnosticOutputFile));
   return Error::success();
@@ -397,7 +418,8 @@ Error lto::thinBackend(Config &Conf, unsigned Task, AddStreamFn AddStream,
                        Module &Mod, const ModuleSummaryIndex &CombinedIndex,
                        const FunctionImporter::ImportMapTy &ImportList,
                        const GVSummaryMapTy &DefinedGlobals,
-                       MapVector<StringRef, BitcodeModule> &ModuleMap) {
+                       MapVector<StringRef, BitcodeModule> &ModuleMap,
+                       BitcodeImportCache *ImportCache, PhaseReport *Report) {
   Expected<const Target *> TOrErr = initAndLookupTarget(Conf, Mod);
   if (!TOrErr)
     return TOrErr.takeError();
@@ -405,6 +427,7 @@ Error lto::thinBackend(Config &Conf, unsigned Task, AddStreamFn AddStream,
   std::unique_ptr<TargetMachine> TM = createTargetMachine(Conf, *TOrErr, Mod);
 
   if (Conf.CodeGenOnly) {
+    PhaseReport::Phase Phase(Report, "codegen", Task);
     codegen(Conf, TM.get(), AddStream, Task, Mod);
     return Error::success();
   }
@@ -412,6 +435,11 @@ Error lto::thinBackend(Config &Conf, unsigned Task, AddStreamFn AddStream,
   if (Conf.PreOptModuleHook && !Conf.PreOptModuleHook(Task, Mod))
     return Error::success();
 
+  // Apply the attributes propagated in the thin link while the GUIDs of the
+  // local functions are not yet changed by the promotion.
+  if (Conf.ThinLTOPropagateFunctionAttrs)
+    thinLTOApplyFunctionAttrs(Mod, CombinedIndex);
+
   renameModuleForThinLTO(Mod, CombinedIndex);
 
   thinLTOResolveWeakForLinkerModule(Mod, DefinedGlobals);
@@ -431,22 +459,34 @@ Error lto::thinBackend(Config &Conf, unsigned Task, AddStreamFn AddStream,
            "ODR Type uniquing should be enabled on the context");
     auto I = ModuleMap.find(Identifier);
     assert(I != ModuleMap.end());
-    return I->second.getLazyModule(Mod.getContext(),
-                                   /*ShouldLazyLoadMetadata=*/true,
-                                   /*IsImporting*/ true);
+    Expected<std::unique_ptr<Module>> MOrErr = I->second.getLazyModule(
+        Mod.getContext(), /*ShouldLazyLoadMetadata=*/true,
+        /*IsImporting*/ true, ImportCache);
+    // The imported functions and the declarations they introduce take the
+    // attributes of the source module.
+    if (MOrErr && Conf.ThinLTOPropagateFunctionAttrs)
+      thinLTOApplyFunctionAttrs(**MOrErr, CombinedIndex);
+    return MOrErr;
   };
 
-  FunctionImporter Importer(CombinedIndex, ModuleLoader);
-  if (Error Err = Importer.importFunctions(Mod, ImportList).takeError())
-    return Err;
+  {
+    PhaseReport::Phase Phase(Report, "import", Task);
+    FunctionImporter Importer(CombinedIndex, ModuleLoader);
+    if (Error Err = Importer.importFunctions(Mod, ImportList).takeError())
+      return Err;
+  }
 
   if (Conf.PostImportModuleHook && !Conf.PostImportModuleHook(Task, Mod))
     return Error::success();
 
-  if (!opt(Conf, TM.get(), Task, Mod, /*IsThinLTO=*/true,
-           /*ExportSummary=*/nullptr, /*ImportSummary=*/&CombinedIndex))
-    return Error::success();
+  {
+    PhaseReport::Phase Phase(Report, "opt", Task);
+    if (!opt(Conf, TM.get(), Task, Mod, /*IsThinLTO=*/true,
+             /*ExportSummary=*/nullptr, /*ImportSummary=*/&CombinedIndex))
+      return Error::success();
+  }
 
+  PhaseReport::Phase Phase(Report, "codegen", Task);
   codegen(Conf, TM.get(), AddStream, Task, Mod);
   return Error::success();
 }
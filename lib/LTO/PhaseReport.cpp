@@ -0,0 +1,124 @@
+//===-PhaseReport.cpp - LLVM Link Time Optimizer phase report -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the phase report of LTO links.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/PhaseReport.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::lto;
+using namespace std::chrono;
+
+PhaseReport::PhaseReport() : Start(steady_clock::now()) {}
+
+PhaseReport::Phase::Phase(PhaseReport *Report, StringRef Name, unsigned Task,
+                          StringRef ModuleID)
+    : Report(Report), Task(Task) {
+  if (!Report)
+    return;
+  this->Name = Name;
+  this->ModuleID = ModuleID;
+  Start = steady_clock::now();
+  StartCPUTime = sys::Process::GetThreadCPUTime();
+}
+
+PhaseReport::Phase::~Phase() {
+  if (!Report)
+    return;
+  steady_clock::time_point End = steady_clock::now();
+  nanoseconds EndCPUTime = sys::Process::GetThreadCPUTime();
+
+  Event E;
+  E.Name = std::move(Name);
+  E.ModuleID = std::move(ModuleID);
+  E.Task = Task;
+  E.Cache = Cache;
+  E.Start = duration_cast<microseconds>(Start - Report->Start);
+  E.Duration = duration_cast<microseconds>(End - Start);
+  E.CPUTime = duration_cast<microseconds>(EndCPUTime - StartCPUTime);
+  E.PeakMemory = sys::Process::GetPeakMemoryUsage();
+  Report->addEvent(std::move(E));
+}
+
+void PhaseReport::addEvent(Event E) {
+  std::lock_guard<std::mutex> Lock(EventsMu);
+  Events.push_back(std::move(E));
+}
+
+static void printJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void PhaseReport::write(raw_ostream &OS) const {
+  std::lock_guard<std::mutex> Lock(EventsMu);
+
+  std::vector<const Event *> Sorted;
+  for (const Event &E : Events)
+    Sorted.push_back(&E);
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const Event *A, const Event *B) {
+                     return A->Start < B->Start;
+                   });
+
+  // The thread of each task is named after it. Task 0 also holds the phases
+  // of the link itself.
+  DenseSet<unsigned> Tasks;
+  OS << "{\"traceEvents\":[\n";
+  bool First = true;
+  for (const Event *E : Sorted) {
+    if (Tasks.insert(E->Task).second) {
+      OS << (First ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\","
+         << "\"pid\":0,\"tid\":" << E->Task << ",\"args\":{\"name\":\"task "
+         << E->Task << "\"}}";
+      First = false;
+    }
+    OS << ",\n{\"name\":";
+    printJSONString(OS, E->Name);
+    OS << ",\"cat\":\"lto\",\"ph\":\"X\",\"pid\":0,\"tid\":" << E->Task
+       << ",\"ts\":" << E->Start.count() << ",\"dur\":" << E->Duration.count()
+       << ",\"args\":{\"cpu_us\":" << E->CPUTime.count()
+       << ",\"peak_rss_kb\":" << E->PeakMemory / 1024;
+    if (!E->ModuleID.empty()) {
+      OS << ",\"module\":";
+      printJSONString(OS, E->ModuleID);
+    }
+    if (E->Cache != NotCached)
+      OS << ",\"cache\":\"" << (E->Cache == CacheHit ? "hit" : "miss") << '"';
+    OS << "}}";
+  }
+  OS << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+Error PhaseReport::writeToFile(StringRef Path) const {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC)
+    return make_error<StringError>(
+        "cannot open the phase report " + Path + ": " + EC.message(), EC);
+  write(OS);
+  return Error::success();
+}
@@ -42,6 +42,8 @@
 #include "llvm/Analysis/ModuleSummaryAnalysis.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/PolyhedralAccessInfo.h"
+#include "llvm/Analysis/PolyhedralDependenceInfo.h"
 #include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/Analysis/RegionInfo.h"
@@ -126,6 +128,7 @@
 #include "llvm/Transforms/Scalar/NaryReassociate.h"
 #include "llvm/Transforms/Scalar/NewGVN.h"
 #include "llvm/Transforms/Scalar/PartiallyInlineLibCalls.h"
+#include "llvm/Transforms/Scalar/PolyhedralValueTransformer.h"
 #include "llvm/Transforms/Scalar/Reassociate.h"
 #include "llvm/Transforms/Scalar/RewriteStatepointsForGC.h"
 #include "llvm/Transforms/Scalar/SCCP.h"
@@ -177,6 +180,11 @@ static cl::opt<bool> EnableGVNSink(
     "enable-npm-gvn-sink", cl::init(false), cl::Hidden,
     cl::desc("Enable the GVN hoisting pass for the new PM (default = off)"));
 
+static cl::opt<bool> EnablePolyhedralValueTransformer(
+    "enable-npm-polyhedral-value-transformer", cl::init(false), cl::Hidden,
+    cl::desc("Enable the polyhedral condition folding and hoisting pass for "
+             "the new PM (default = off)"));
+
 static Regex DefaultAliasRegex(
     "^(default|thinlto-pre-link|thinlto|lto-pre-link|lto)<(O[0123sz])>$");
 
@@ -731,6 +739,13 @@ PassBuilder::buildModuleOptimizationPipeline(OptimizationLevel Level,
   for (auto &C : VectorizerStartEPCallbacks)
     C(OptimizePM, Level);
 
+  // Fold and hoist loop conditions based on the polyhedral value analysis.
+  // The folded branches are removed before the loops are rotated again.
+  if (EnablePolyhedralValueTransformer) {
+    OptimizePM.addPass(PolyhedralValueTransformerPass());
+    OptimizePM.addPass(SimplifyCFGPass());
+  }
+
   // First rotate loops that may have been un-rotated by prior passes.
   OptimizePM.addPass(
       createFunctionToLoopPassAdaptor(LoopRotatePass(), DebugLogging));
@@ -809,6 +824,12 @@ PassBuilder::buildModuleOptimizationPipeline(OptimizationLevel Level,
   // inserting redudnancies into the progrem. This even includes SimplifyCFG.
   OptimizePM.addPass(SpeculateAroundPHIsPass());
 
+  // The polyhedral value analysis of the loop optimizations above can only
+  // use the function summaries if they are available.
+  if (PolyhedralFunctionSummaries::isEnabled())
+    MPM.addPass(
+        RequireAnalysisPass<PolyhedralFunctionSummariesAnalysis, Module>());
+
   // Add the core optimizing pipeline.
   MPM.addPass(createModuleToFunctionPassAdaptor(std::move(OptimizePM)));
 
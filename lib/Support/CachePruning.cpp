@@ -13,10 +13,12 @@
 
 #include "llvm/Support/CachePruning.h"
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -34,6 +36,100 @@ static void writeTimestampFile(StringRef TimestampFile) {
   raw_fd_ostream Out(TimestampFile.str(), EC, sys::fs::F_None);
 }
 
+/// Return the path of the index of the cache directory \p Path.
+static SmallString<128> getIndexFile(StringRef Path) {
+  SmallString<128> IndexFile(Path);
+  sys::path::append(IndexFile, "llvmcache.index");
+  return IndexFile;
+}
+
+namespace {
+/// The most recent access to a cache entry recorded in the index.
+struct IndexEntry {
+  uint64_t AccessTime;
+  uint64_t Size;
+};
+} // end anonymous namespace
+
+/// Parse the index \p Index, which has one line per access to an entry: the
+/// access time in seconds since the epoch, the size of the entry and its file
+/// name, separated by spaces. Malformed lines are ignored.
+static void parseIndex(StringRef Index, StringMap<IndexEntry> &Entries) {
+  SmallVector<StringRef, 64> Lines;
+  Index.split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines) {
+    StringRef Time, Size, Name;
+    std::tie(Time, Line) = Line.split(' ');
+    std::tie(Size, Name) = Line.split(' ');
+    IndexEntry Entry;
+    if (Time.getAsInteger(10, Entry.AccessTime) ||
+        Size.getAsInteger(10, Entry.Size) || !Name.startswith("llvmcache-") ||
+        Name.find_first_of("/\\") != StringRef::npos)
+      continue;
+    IndexEntry &Latest = Entries[Name];
+    if (Entry.AccessTime >= Latest.AccessTime)
+      Latest = Entry;
+  }
+}
+
+static void writeIndexLine(raw_ostream &OS, StringRef Name,
+                           const IndexEntry &Entry) {
+  OS << Entry.AccessTime << ' ' << Entry.Size << ' ' << Name << '\n';
+}
+
+void llvm::recordCacheAccess(StringRef Path, StringRef EntryName,
+                             uint64_t Size) {
+  using namespace std::chrono;
+  SmallString<128> IndexFile = getIndexFile(Path);
+  int FD;
+  if (sys::fs::openFileForWrite(IndexFile, FD, sys::fs::F_Append))
+    return;
+
+  // The line is written with a single write() to a file opened for appending,
+  // so it is not interleaved with the lines of other processes.
+  IndexEntry Entry = {
+      static_cast<uint64_t>(
+          duration_cast<seconds>(system_clock::now().time_since_epoch())
+              .count()),
+      Size};
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  writeIndexLine(OS, EntryName, Entry);
+}
+
+/// Replace the index \p IndexFile, of which the first \p ParsedSize bytes
+/// were parsed into \p Entries, with the entries in \p Entries followed by
+/// the lines appended since.
+static void compactIndex(StringRef IndexFile, uint64_t ParsedSize,
+                         const StringMap<IndexEntry> &Entries) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> IndexOrErr =
+      MemoryBuffer::getFile(IndexFile, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false);
+  // Another process compacted the index meanwhile.
+  if (!IndexOrErr || (*IndexOrErr)->getBufferSize() < ParsedSize)
+    return;
+
+  int FD;
+  SmallString<128> TempFile;
+  if (sys::fs::createUniqueFile(IndexFile + ".%%%%%%", FD, TempFile))
+    return;
+
+  // Write the entries sorted by name for determinism.
+  std::vector<StringRef> Names;
+  for (auto &Entry : Entries)
+    Names.push_back(Entry.first());
+  std::sort(Names.begin(), Names.end());
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (StringRef Name : Names)
+      writeIndexLine(OS, Name, Entries.lookup(Name));
+    OS << (*IndexOrErr)->getBuffer().drop_front(ParsedSize);
+  }
+  // Lines appended between reading the index again and the rename are lost.
+  // The entries they describe are only pruned once they are used again.
+  if (sys::fs::rename(TempFile, IndexFile))
+    sys::fs::remove(TempFile);
+}
+
 static Expected<std::chrono::seconds> parseDuration(StringRef Duration) {
   if (Duration.empty())
     return make_error<StringError>("Duration must not be empty",
@@ -117,6 +213,11 @@ llvm::parseCachePruningPolicy(StringRef PolicyStr) {
       if (Value.getAsInteger(0, Policy.MaxSizeFiles))
         return make_error<StringError>("'" + Value + "' not an integer",
                                        inconvertibleErrorCode());
+    } else if (Key == "index_walk_interval") {
+      auto DurationOrErr = parseDuration(Value);
+      if (!DurationOrErr)
+        return DurationOrErr.takeError();
+      Policy.IndexWalkInterval = *DurationOrErr;
     } else {
       return make_error<StringError>("Unknown key: '" + Key + "'",
                                      inconvertibleErrorCode());
@@ -189,41 +290,106 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
   std::set<std::pair<uint64_t, std::string>> FileSizes;
   uint64_t TotalSize = 0;
 
-  // Walk the entire directory cache, looking for unused files.
-  std::error_code EC;
-  SmallString<128> CachePathNative;
-  sys::path::native(Path, CachePathNative);
-  // Walk all of the files within this directory.
-  for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
-       File != FileEnd && !EC; File.increment(EC)) {
-    // Ignore any files not beginning with the string "llvmcache-". This
-    // includes the timestamp file as well as any files created by the user.
-    // This acts as a safeguard against data loss if the user specifies the
-    // wrong directory as their cache directory.
-    if (!sys::path::filename(File->path()).startswith("llvmcache-"))
-      continue;
-
-    // Look at this file. If we can't stat it, there's nothing interesting
-    // there.
-    ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
-    if (!StatusOrErr) {
-      DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
-      continue;
-    }
-
-    // If the file hasn't been used recently enough, delete it
-    const auto FileAccessTime = StatusOrErr->getLastAccessedTime();
+  // Either delete an entry that hasn't been used recently enough, or add it
+  // to the list of size-based pruning.
+  auto VisitEntry = [&](StringRef EntryPath,
+                        sys::TimePoint<> FileAccessTime,
+                        uint64_t Size) -> bool {
     auto FileAge = CurrentTime - FileAccessTime;
     if (Policy.Expiration != seconds(0) && FileAge > Policy.Expiration) {
-      DEBUG(dbgs() << "Remove " << File->path() << " ("
+      DEBUG(dbgs() << "Remove " << EntryPath << " ("
                    << duration_cast<seconds>(FileAge).count() << "s old)\n");
-      sys::fs::remove(File->path());
-      continue;
+      sys::fs::remove(EntryPath);
+      return false;
     }
 
-    // Leave it here for now, but add it to the list of size-based pruning.
-    TotalSize += StatusOrErr->getSize();
-    FileSizes.insert({StatusOrErr->getSize(), std::string(File->path())});
+    TotalSize += Size;
+    FileSizes.insert({Size, EntryPath});
+    return true;
+  };
+
+  SmallString<128> IndexFile = getIndexFile(Path);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> IndexOrErr =
+      MemoryBuffer::getFile(IndexFile, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false);
+  StringMap<IndexEntry> IndexEntries;
+  bool WalkDirectory = true;
+  if (IndexOrErr) {
+    parseIndex((*IndexOrErr)->getBuffer(), IndexEntries);
+
+    // The index knows the size and last use of the entries recorded in it,
+    // the directory is only walked from time to time to find the others.
+    SmallString<128> WalkTimestampFile(Path);
+    sys::path::append(WalkTimestampFile, "llvmcache.walk");
+    sys::fs::file_status WalkStatus;
+    if (!sys::fs::status(WalkTimestampFile, WalkStatus) &&
+        CurrentTime - WalkStatus.getLastModificationTime() <=
+            Policy.IndexWalkInterval)
+      WalkDirectory = false;
+    else
+      writeTimestampFile(WalkTimestampFile);
+  }
+
+  if (!WalkDirectory) {
+    for (auto I = IndexEntries.begin(), E = IndexEntries.end(); I != E;) {
+      auto Entry = I++;
+      SmallString<128> EntryPath(Path);
+      sys::path::append(EntryPath, Entry->first());
+      auto AccessTime = sys::TimePoint<>(seconds(Entry->second.AccessTime));
+      if (!VisitEntry(EntryPath, AccessTime, Entry->second.Size))
+        IndexEntries.erase(Entry);
+    }
+  } else {
+    // The entries found in the directory, which replace the ones in the index
+    // so that entries removed by other means are dropped from it.
+    StringMap<IndexEntry> WalkedEntries;
+
+    // Walk the entire directory cache, looking for unused files.
+    std::error_code EC;
+    SmallString<128> CachePathNative;
+    sys::path::native(Path, CachePathNative);
+    // Walk all of the files within this directory.
+    for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
+         File != FileEnd && !EC; File.increment(EC)) {
+      // Ignore any files not beginning with the string "llvmcache-". This
+      // includes the timestamp file as well as any files created by the user.
+      // This acts as a safeguard against data loss if the user specifies the
+      // wrong directory as their cache directory.
+      StringRef Name = sys::path::filename(File->path());
+      if (!Name.startswith("llvmcache-"))
+        continue;
+
+      // Prefer the last use recorded in the index, the access time of the
+      // file is not updated on noatime mounts.
+      auto IndexIt = IndexEntries.find(Name);
+      if (IndexIt != IndexEntries.end()) {
+        auto AccessTime =
+            sys::TimePoint<>(seconds(IndexIt->second.AccessTime));
+        if (VisitEntry(File->path(), AccessTime, IndexIt->second.Size))
+          WalkedEntries[Name] = IndexIt->second;
+        continue;
+      }
+
+      // Look at this file. If we can't stat it, there's nothing interesting
+      // there.
+      ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
+      if (!StatusOrErr) {
+        DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
+        continue;
+      }
+
+      sys::TimePoint<> AccessTime = StatusOrErr->getLastAccessedTime();
+      if (VisitEntry(File->path(), AccessTime, StatusOrErr->getSize())) {
+        IndexEntry Entry = {
+            static_cast<uint64_t>(
+                duration_cast<seconds>(AccessTime.time_since_epoch()).count()),
+            StatusOrErr->getSize()};
+        WalkedEntries[Name] = Entry;
+      }
+    }
+
+    if (IndexOrErr)
+      IndexEntries = std::move(WalkedEntries);
   }
 
   auto FileAndSize = FileSizes.rbegin();
@@ -232,6 +398,7 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
   auto RemoveCacheFile = [&]() {
     // Remove the file.
     sys::fs::remove(FileAndSize->second);
+    IndexEntries.erase(sys::path::filename(FileAndSize->second));
     // Update size
     TotalSize -= FileAndSize->first;
     NumFiles--;
@@ -271,5 +438,10 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
     while (TotalSize > TotalSizeTarget && FileAndSize != FileSizes.rend())
       RemoveCacheFile();
   }
+
+  // Drop the lines of the removed entries and the repeated accesses from the
+  // index.
+  if (IndexOrErr)
+    compactIndex(IndexFile, (*IndexOrErr)->getBufferSize(), IndexEntries);
   return true;
 }
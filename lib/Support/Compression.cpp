@@ -14,10 +14,15 @@
 #include "llvm/Support/Compression.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
 #if LLVM_ENABLE_ZLIB == 1 && HAVE_ZLIB_H
 #include <zlib.h>
 #endif
@@ -119,3 +124,160 @@ uint32_t zlib::crc32(StringRef Buffer) {
 }
 #endif
 
+
+// The LZ4 block format is a sequence of literal runs, each but the last
+// followed by a match, which copies bytes from up to 64 KiB back. A sequence
+// starts with a token of 4 bits of literal length and 4 bits of match length,
+// where 15 means that more length bytes follow. The last 5 bytes are always
+// literals and the last match starts at least 12 bytes before the end.
+static const size_t LZ4MinMatch = 4;
+static const size_t LZ4LastLiterals = 5;
+static const size_t LZ4MatchFindLimit = 12;
+static const size_t LZ4MaxDistance = 65535;
+static const unsigned LZ4HashLog = 14;
+
+static void writeLZ4Length(SmallVectorImpl<char> &Out, size_t Length) {
+  for (; Length >= 255; Length -= 255)
+    Out.push_back(char(255));
+  Out.push_back(char(Length));
+}
+
+static void writeLZ4Sequence(SmallVectorImpl<char> &Out,
+                             const uint8_t *Literals, size_t NumLiterals,
+                             size_t MatchLength, size_t Distance) {
+  unsigned Token = std::min<size_t>(NumLiterals, 15) << 4;
+  if (MatchLength)
+    Token |= std::min<size_t>(MatchLength - LZ4MinMatch, 15);
+  Out.push_back(char(Token));
+  if (NumLiterals >= 15)
+    writeLZ4Length(Out, NumLiterals - 15);
+  Out.append(Literals, Literals + NumLiterals);
+  if (!MatchLength)
+    return;
+  Out.push_back(char(Distance & 0xff));
+  Out.push_back(char(Distance >> 8));
+  if (MatchLength - LZ4MinMatch >= 15)
+    writeLZ4Length(Out, MatchLength - LZ4MinMatch - 15);
+}
+
+void lz4::compress(StringRef InputBuffer,
+                   SmallVectorImpl<char> &CompressedBuffer) {
+  CompressedBuffer.clear();
+  CompressedBuffer.reserve(InputBuffer.size() + InputBuffer.size() / 255 + 16);
+  const uint8_t *Begin = InputBuffer.bytes_begin();
+  const uint8_t *End = InputBuffer.bytes_end();
+  const uint8_t *Anchor = Begin;
+
+  if (InputBuffer.size() > LZ4MatchFindLimit) {
+    // The last position a match was seen at for each hash of 4 bytes.
+    std::vector<uint32_t> Table(1 << LZ4HashLog, 0);
+    const uint8_t *MatchLimit = End - LZ4LastLiterals;
+    const uint8_t *SearchLimit = End - LZ4MatchFindLimit;
+    const uint8_t *P = Begin;
+    while (P <= SearchLimit) {
+      uint32_t Seq = support::endian::read32le(P);
+      uint32_t Hash = (Seq * 2654435761U) >> (32 - LZ4HashLog);
+      const uint8_t *Candidate = Begin + Table[Hash];
+      Table[Hash] = uint32_t(P - Begin);
+      if (Candidate >= P || size_t(P - Candidate) > LZ4MaxDistance ||
+          support::endian::read32le(Candidate) != Seq) {
+        // Step faster through data that does not compress.
+        P += 1 + ((P - Anchor) >> 6);
+        continue;
+      }
+
+      const uint8_t *MatchEnd = P + LZ4MinMatch;
+      const uint8_t *C = Candidate + LZ4MinMatch;
+      while (MatchEnd < MatchLimit && *MatchEnd == *C) {
+        ++MatchEnd;
+        ++C;
+      }
+      writeLZ4Sequence(CompressedBuffer, Anchor, P - Anchor, MatchEnd - P,
+                       P - Candidate);
+      P = Anchor = MatchEnd;
+    }
+  }
+  writeLZ4Sequence(CompressedBuffer, Anchor, End - Anchor, 0, 0);
+}
+
+static Error createLZ4Error(StringRef Err) {
+  return make_error<StringError>(Twine("lz4 error: ") + Err,
+                                 inconvertibleErrorCode());
+}
+
+/// Add the length bytes at \p In to \p Length, return false if the input
+/// ends before them.
+static bool readLZ4Length(const uint8_t *&In, const uint8_t *InEnd,
+                          size_t &Length) {
+  uint8_t Byte;
+  do {
+    if (In == InEnd)
+      return false;
+    Byte = *In++;
+    Length += Byte;
+  } while (Byte == 255);
+  return true;
+}
+
+Error lz4::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                      size_t UncompressedSize) {
+  const uint8_t *In = InputBuffer.bytes_begin();
+  const uint8_t *InEnd = InputBuffer.bytes_end();
+  uint8_t *OutBegin = reinterpret_cast<uint8_t *>(UncompressedBuffer);
+  uint8_t *Out = OutBegin;
+  uint8_t *OutEnd = OutBegin + UncompressedSize;
+
+  while (true) {
+    if (In == InEnd)
+      return createLZ4Error("truncated input");
+    unsigned Token = *In++;
+    size_t NumLiterals = Token >> 4;
+    if (NumLiterals == 15 && !readLZ4Length(In, InEnd, NumLiterals))
+      return createLZ4Error("truncated input");
+    if (size_t(InEnd - In) < NumLiterals)
+      return createLZ4Error("truncated input");
+    if (size_t(OutEnd - Out) < NumLiterals)
+      return createLZ4Error("output too small");
+    if (NumLiterals)
+      memcpy(Out, In, NumLiterals);
+    In += NumLiterals;
+    Out += NumLiterals;
+
+    // Only the last sequence has no match.
+    if (In == InEnd)
+      break;
+    if (InEnd - In < 2)
+      return createLZ4Error("truncated input");
+    size_t Distance = In[0] | (size_t(In[1]) << 8);
+    In += 2;
+    if (!Distance || Distance > size_t(Out - OutBegin))
+      return createLZ4Error("invalid match distance");
+    size_t MatchLength = Token & 15;
+    if (MatchLength == 15 && !readLZ4Length(In, InEnd, MatchLength))
+      return createLZ4Error("truncated input");
+    MatchLength += LZ4MinMatch;
+    if (size_t(OutEnd - Out) < MatchLength)
+      return createLZ4Error("output too small");
+
+    const uint8_t *Match = Out - Distance;
+    if (Distance >= MatchLength) {
+      memcpy(Out, Match, MatchLength);
+      Out += MatchLength;
+    } else {
+      // The match overlaps the bytes it produces.
+      for (size_t I = 0; I != MatchLength; ++I)
+        *Out++ = *Match++;
+    }
+  }
+
+  if (Out != OutEnd)
+    return createLZ4Error("output size mismatch");
+  return Error::success();
+}
+
+Error lz4::uncompress(StringRef InputBuffer,
+                      SmallVectorImpl<char> &UncompressedBuffer,
+                      size_t UncompressedSize) {
+  UncompressedBuffer.resize(UncompressedSize);
+  return uncompress(InputBuffer, UncompressedBuffer.data(), UncompressedSize);
+}
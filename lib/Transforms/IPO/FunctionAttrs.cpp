@@ -14,6 +14,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO/FunctionAttrs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
@@ -43,6 +45,7 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Use.h"
@@ -74,6 +77,18 @@ STATISTIC(NumReadOnlyArg, "Number of arguments marked readonly");
 STATISTIC(NumNoAlias, "Number of function returns marked noalias");
 STATISTIC(NumNonNullReturn, "Number of function returns marked nonnull");
 STATISTIC(NumNoRecurse, "Number of functions marked as norecurse");
+STATISTIC(NumThinLinkReadNone,
+          "Number of function summaries marked readnone in the thin link");
+STATISTIC(NumThinLinkReadOnly,
+          "Number of function summaries marked readonly in the thin link");
+STATISTIC(NumThinLinkNoUnwind,
+          "Number of function summaries marked nounwind in the thin link");
+STATISTIC(NumThinLinkNoRecurse,
+          "Number of function summaries marked norecurse in the thin link");
+STATISTIC(NumThinLinkReadNoneArg,
+          "Number of arguments marked readnone based on the summary index");
+STATISTIC(NumThinLinkReadOnlyArg,
+          "Number of arguments marked readonly based on the summary index");
 
 // FIXME: This is disabled by default to avoid exposing security vulnerabilities
 // in C/C++ code compiled by clang:
@@ -1366,3 +1381,357 @@ ReversePostOrderFunctionAttrsPass::run(Module &M, ModuleAnalysisManager &AM) {
   PA.preserve<CallGraphAnalysis>();
   return PA;
 }
+
+using IsPrevailingFn =
+    function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>;
+
+namespace {
+
+/// A node of the call graph of the combined summary index. The children of a
+/// value are the callees of its prevailing function summary, the root node has
+/// all values as children to make every value reachable.
+struct SummaryCallGraphNode {
+  ValueInfo VI;
+  std::vector<SummaryCallGraphNode *> Callees;
+};
+
+struct SummaryCallGraph {
+  SummaryCallGraphNode Root;
+  DenseMap<ValueInfo, SummaryCallGraphNode *> Nodes;
+
+  SummaryCallGraph(const ModuleSummaryIndex &Index,
+                   IsPrevailingFn isPrevailing);
+  ~SummaryCallGraph() { DeleteContainerSeconds(Nodes); }
+
+  SummaryCallGraphNode *getOrCreateNode(ValueInfo VI) {
+    SummaryCallGraphNode *&Node = Nodes[VI];
+    if (!Node) {
+      Node = new SummaryCallGraphNode();
+      Node->VI = VI;
+    }
+    return Node;
+  }
+};
+
+} // end anonymous namespace
+
+/// Return the function summary of the base object of \p S if its definition
+/// cannot be replaced at link time, thus if it describes the function that is
+/// eventually called.
+static FunctionSummary *getKnownFunctionSummary(GlobalValueSummary *S) {
+  if (GlobalValue::isInterposableLinkage(S->linkage()))
+    return nullptr;
+  auto *FS = dyn_cast<FunctionSummary>(S->getBaseObject());
+  if (!FS || GlobalValue::isInterposableLinkage(FS->linkage()))
+    return nullptr;
+  return FS;
+}
+
+/// Return the known function summary of the copy of \p VI selected by the
+/// linker, or null if there is none. The other copies of a linkonce_odr or
+/// weak_odr function may have been optimized differently and need not have
+/// the attributes of the prevailing one.
+static FunctionSummary *
+getPrevailingFunctionSummary(ValueInfo VI, IsPrevailingFn isPrevailing) {
+  auto SummaryList = VI.getSummaryList();
+  // A local function is not subject to symbol resolution.
+  if (SummaryList.size() == 1 &&
+      GlobalValue::isLocalLinkage(SummaryList.front()->linkage()))
+    return getKnownFunctionSummary(SummaryList.front().get());
+  for (auto &S : SummaryList)
+    if (isPrevailing(VI.getGUID(), S.get()))
+      return getKnownFunctionSummary(S.get());
+  return nullptr;
+}
+
+SummaryCallGraph::SummaryCallGraph(const ModuleSummaryIndex &Index,
+                                   IsPrevailingFn isPrevailing) {
+  for (auto &I : Index) {
+    ValueInfo VI(&I);
+    SummaryCallGraphNode *Node = getOrCreateNode(VI);
+    Root.Callees.push_back(Node);
+    if (FunctionSummary *FS = getPrevailingFunctionSummary(VI, isPrevailing))
+      for (auto &Call : FS->calls())
+        Node->Callees.push_back(getOrCreateNode(Call.first));
+  }
+}
+
+namespace llvm {
+
+template <> struct GraphTraits<SummaryCallGraphNode *> {
+  using NodeRef = SummaryCallGraphNode *;
+  using ChildIteratorType = std::vector<SummaryCallGraphNode *>::iterator;
+
+  static NodeRef getEntryNode(SummaryCallGraphNode *N) { return N; }
+  static ChildIteratorType child_begin(NodeRef N) { return N->Callees.begin(); }
+  static ChildIteratorType child_end(NodeRef N) { return N->Callees.end(); }
+};
+
+template <>
+struct GraphTraits<SummaryCallGraph *>
+    : public GraphTraits<SummaryCallGraphNode *> {
+  static NodeRef getEntryNode(SummaryCallGraph *CG) { return &CG->Root; }
+};
+
+} // end namespace llvm
+
+/// The function attributes that are propagated during the thin link.
+enum SummaryAttrKind { SAK_ReadNone, SAK_ReadOnly, SAK_NoUnwind };
+
+/// Return true if the attribute \p Kind is set in the function summary
+/// \p Flags, either for the whole function or, if \p Body is true, only for
+/// the function body without the calls.
+static bool hasSummaryAttr(const FunctionSummary::FFlags &Flags,
+                           SummaryAttrKind Kind, bool Body) {
+  switch (Kind) {
+  case SAK_ReadNone:
+    return Body ? Flags.BodyReadNone : Flags.ReadNone;
+  case SAK_ReadOnly:
+    return Body ? Flags.BodyReadOnly : (Flags.ReadNone || Flags.ReadOnly);
+  case SAK_NoUnwind:
+    return Body ? Flags.BodyNoUnwind : Flags.NoUnwind;
+  }
+  llvm_unreachable("Unknown summary attribute kind");
+}
+
+static void setSummaryAttr(FunctionSummary::FFlags &Flags,
+                           SummaryAttrKind Kind) {
+  switch (Kind) {
+  case SAK_ReadNone:
+    Flags.ReadNone = true;
+    break;
+  case SAK_ReadOnly:
+    Flags.ReadOnly = true;
+    break;
+  case SAK_NoUnwind:
+    Flags.NoUnwind = true;
+    break;
+  }
+}
+
+/// Return true if all summaries of \p VI are known and have the attribute
+/// \p Kind, or only the body has it if \p Body is true.
+static bool valueHasSummaryAttr(ValueInfo VI, SummaryAttrKind Kind,
+                                bool Body) {
+  if (VI.getSummaryList().empty())
+    return false;
+  for (auto &S : VI.getSummaryList()) {
+    FunctionSummary *FS = getKnownFunctionSummary(S.get());
+    if (!FS || !hasSummaryAttr(FS->fflags(), Kind, Body))
+      return false;
+  }
+  return true;
+}
+
+/// Return true if the prevailing summary of \p VI is known and has the
+/// attribute \p Kind, or only the body has it if \p Body is true.
+static bool prevailingHasSummaryAttr(ValueInfo VI, SummaryAttrKind Kind,
+                                     bool Body, IsPrevailingFn isPrevailing) {
+  FunctionSummary *FS = getPrevailingFunctionSummary(VI, isPrevailing);
+  return FS && hasSummaryAttr(FS->fflags(), Kind, Body);
+}
+
+/// Return true if the attribute \p Kind holds for all values in the strongly
+/// connected component \p SCC of the summary call graph. As for the function
+/// bodies the attribute is optimistically assumed for the calls within the
+/// component.
+static bool sccHasSummaryAttr(ArrayRef<SummaryCallGraphNode *> SCC,
+                              SummaryAttrKind Kind,
+                              IsPrevailingFn isPrevailing) {
+  SmallPtrSet<SummaryCallGraphNode *, 8> SCCNodes(SCC.begin(), SCC.end());
+  for (SummaryCallGraphNode *Node : SCC) {
+    if (prevailingHasSummaryAttr(Node->VI, Kind, /* Body = */ false,
+                                 isPrevailing))
+      continue;
+    if (!prevailingHasSummaryAttr(Node->VI, Kind, /* Body = */ true,
+                                  isPrevailing))
+      return false;
+    for (SummaryCallGraphNode *Callee : Node->Callees)
+      if (!SCCNodes.count(Callee) &&
+          !prevailingHasSummaryAttr(Callee->VI, Kind, /* Body = */ false,
+                                    isPrevailing))
+        return false;
+  }
+  return true;
+}
+
+/// Return true if the single value in \p SCC does not recurse.
+static bool sccDoesNotRecurse(ArrayRef<SummaryCallGraphNode *> SCC,
+                              IsPrevailingFn isPrevailing) {
+  if (SCC.size() != 1)
+    return false;
+  SummaryCallGraphNode *Node = SCC.front();
+  FunctionSummary *FS = getPrevailingFunctionSummary(Node->VI, isPrevailing);
+  if (!FS)
+    return false;
+  if (FS->fflags().NoRecurse)
+    return true;
+  if (!FS->fflags().NoUnknownCalls)
+    return false;
+  for (auto &Call : FS->calls()) {
+    if (Call.first.getGUID() == Node->VI.getGUID())
+      return false;
+    FunctionSummary *CalleeFS =
+        getPrevailingFunctionSummary(Call.first, isPrevailing);
+    if (!CalleeFS || !CalleeFS->fflags().NoRecurse)
+      return false;
+  }
+  return true;
+}
+
+void llvm::thinLTOPropagateFunctionAttrs(ModuleSummaryIndex &Index,
+                                         IsPrevailingFn isPrevailing) {
+  SummaryCallGraph CG(Index, isPrevailing);
+
+  const SummaryAttrKind Kinds[] = {SAK_ReadNone, SAK_ReadOnly, SAK_NoUnwind};
+  for (scc_iterator<SummaryCallGraph *> I = scc_begin(&CG); !I.isAtEnd();
+       ++I) {
+    const std::vector<SummaryCallGraphNode *> &SCC = *I;
+    // The root node forms a component of its own which is visited last.
+    if (!SCC.front()->VI)
+      continue;
+
+    for (SummaryAttrKind Kind : Kinds) {
+      if (!sccHasSummaryAttr(SCC, Kind, isPrevailing))
+        continue;
+      for (SummaryCallGraphNode *Node : SCC) {
+        FunctionSummary::FFlags &Flags =
+            getPrevailingFunctionSummary(Node->VI, isPrevailing)->fflags();
+        if (hasSummaryAttr(Flags, Kind, /* Body = */ false))
+          continue;
+        setSummaryAttr(Flags, Kind);
+        if (Kind == SAK_ReadNone)
+          ++NumThinLinkReadNone;
+        else if (Kind == SAK_ReadOnly)
+          ++NumThinLinkReadOnly;
+        else
+          ++NumThinLinkNoUnwind;
+      }
+    }
+
+    if (sccDoesNotRecurse(SCC, isPrevailing)) {
+      FunctionSummary::FFlags &Flags =
+          getPrevailingFunctionSummary(SCC.front()->VI, isPrevailing)
+              ->fflags();
+      if (!Flags.NoRecurse) {
+        Flags.NoRecurse = true;
+        ++NumThinLinkNoRecurse;
+      }
+    }
+  }
+
+  // The backends do not know which copy prevails. Give every copy the
+  // attributes of the prevailing one, or none if it is unknown.
+  for (auto &I : Index) {
+    ValueInfo VI(&I);
+    FunctionSummary *PrevailingFS =
+        getPrevailingFunctionSummary(VI, isPrevailing);
+    for (auto &S : VI.getSummaryList()) {
+      auto *FS = dyn_cast<FunctionSummary>(S.get());
+      if (!FS || FS == PrevailingFS)
+        continue;
+      FunctionSummary::FFlags &Flags = FS->fflags();
+      Flags.ReadNone = PrevailingFS && PrevailingFS->fflags().ReadNone;
+      Flags.ReadOnly = PrevailingFS && PrevailingFS->fflags().ReadOnly;
+      Flags.NoUnwind = PrevailingFS && PrevailingFS->fflags().NoUnwind;
+      Flags.NoRecurse = PrevailingFS && PrevailingFS->fflags().NoRecurse;
+    }
+  }
+}
+
+/// Determine if the pointer argument \p ArgNo of \p VI is read or written in
+/// any of its copies. Returns false if the accesses through the argument are
+/// not summarized for all of them.
+static bool getSummaryParamAccess(ValueInfo VI, unsigned ArgNo, bool &IsRead,
+                                  bool &IsWritten) {
+  if (VI.getSummaryList().empty())
+    return false;
+  IsRead = IsWritten = false;
+  for (auto &S : VI.getSummaryList()) {
+    FunctionSummary *FS = getKnownFunctionSummary(S.get());
+    const FunctionSummary::ParamAccess *PA =
+        FS ? FS->getParamAccess(ArgNo) : nullptr;
+    if (!PA)
+      return false;
+    IsRead |= PA->IsRead;
+    IsWritten |= PA->IsWritten;
+  }
+  return true;
+}
+
+bool llvm::thinLTOApplyFunctionAttrs(Module &M,
+                                     const ModuleSummaryIndex &Index) {
+  bool Changed = false;
+  for (Function &F : M) {
+    // The attributes of a definition that can be replaced at link time are
+    // not necessarily the ones of the function that is eventually called.
+    if (!F.isDeclaration() && F.isInterposable())
+      continue;
+    ValueInfo VI = Index.getValueInfo(F.getGUID());
+    if (!VI)
+      continue;
+
+    auto HasAttr = [&](SummaryAttrKind Kind) {
+      return valueHasSummaryAttr(VI, Kind, /* Body = */ false);
+    };
+    bool NoRecurse = !VI.getSummaryList().empty();
+    for (auto &S : VI.getSummaryList()) {
+      FunctionSummary *FS = getKnownFunctionSummary(S.get());
+      if (!FS || !FS->fflags().NoRecurse)
+        NoRecurse = false;
+    }
+
+    if (HasAttr(SAK_ReadNone) && !F.doesNotAccessMemory()) {
+      F.removeFnAttr(Attribute::ReadOnly);
+      F.removeFnAttr(Attribute::WriteOnly);
+      F.removeFnAttr(Attribute::ArgMemOnly);
+      F.removeFnAttr(Attribute::InaccessibleMemOnly);
+      F.removeFnAttr(Attribute::InaccessibleMemOrArgMemOnly);
+      F.setDoesNotAccessMemory();
+      Changed = true;
+    } else if (HasAttr(SAK_ReadOnly) && !F.onlyReadsMemory()) {
+      // A function which only reads and only writes memory does not access
+      // memory at all.
+      if (F.hasFnAttribute(Attribute::WriteOnly)) {
+        F.removeFnAttr(Attribute::WriteOnly);
+        F.removeFnAttr(Attribute::ArgMemOnly);
+        F.removeFnAttr(Attribute::InaccessibleMemOnly);
+        F.removeFnAttr(Attribute::InaccessibleMemOrArgMemOnly);
+        F.setDoesNotAccessMemory();
+      } else {
+        F.setOnlyReadsMemory();
+      }
+      Changed = true;
+    }
+    if (HasAttr(SAK_NoUnwind) && !F.doesNotThrow()) {
+      F.setDoesNotThrow();
+      Changed = true;
+    }
+    if (NoRecurse && !F.doesNotRecurse()) {
+      F.setDoesNotRecurse();
+      Changed = true;
+    }
+
+    // Pointer arguments that are not written through, as summarized from the
+    // polyhedral accesses of the function body.
+    for (Argument &Arg : F.args()) {
+      bool IsRead, IsWritten;
+      if (!Arg.getType()->isPointerTy() ||
+          Arg.hasAttribute(Attribute::ReadNone) ||
+          !getSummaryParamAccess(VI, Arg.getArgNo(), IsRead, IsWritten) ||
+          IsWritten)
+        continue;
+      if (!IsRead) {
+        Arg.removeAttr(Attribute::ReadOnly);
+        Arg.addAttr(Attribute::ReadNone);
+        ++NumThinLinkReadNoneArg;
+        Changed = true;
+      } else if (!Arg.hasAttribute(Attribute::ReadOnly)) {
+        Arg.addAttr(Attribute::ReadOnly);
+        ++NumThinLinkReadOnlyArg;
+        Changed = true;
+      }
+    }
+  }
+  return Changed;
+}
@@ -42,12 +42,15 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
 #include <cassert>
 #include <memory>
 #include <set>
@@ -64,6 +67,8 @@ STATISTIC(NumImportedFunctions, "Number of functions imported");
 STATISTIC(NumImportedModules, "Number of modules imported from");
 STATISTIC(NumDeadSymbols, "Number of dead stripped symbols in index");
 STATISTIC(NumLiveSymbols, "Number of live symbols in index");
+STATISTIC(NumReusedImportLists,
+          "Number of import lists reused from a previous link");
 
 /// Limit on instruction count of imported functions.
 static cl::opt<unsigned> ImportInstrLimit(
@@ -218,6 +223,12 @@ namespace {
 using EdgeInfo = std::tuple<const FunctionSummary *, unsigned /* Threshold */,
                             GlobalValue::GUID>;
 
+/// What the import list of a module is computed from, see ImportListCache.
+struct ImportDependencies {
+  StringSet<> Modules;
+  DenseSet<GlobalValue::GUID> Examined;
+};
+
 } // anonymous namespace
 
 static ValueInfo
@@ -243,15 +254,23 @@ static void computeImportForFunction(
     const unsigned Threshold, const GVSummaryMapTy &DefinedGVSummaries,
     SmallVectorImpl<EdgeInfo> &Worklist,
     FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
+    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr,
+    ImportDependencies *Deps = nullptr) {
   for (auto &Edge : Summary.calls()) {
     ValueInfo VI = Edge.first;
     DEBUG(dbgs() << " edge -> " << VI.getGUID() << " Threshold:" << Threshold
                  << "\n");
 
+    if (Deps)
+      Deps->Examined.insert(VI.getGUID());
     VI = updateValueInfoForIndirectCalls(Index, VI);
     if (!VI)
       continue;
+    if (Deps) {
+      Deps->Examined.insert(VI.getGUID());
+      for (auto &CalleeSummary : VI.getSummaryList())
+        Deps->Modules.insert(CalleeSummary->modulePath());
+    }
 
     if (DefinedGVSummaries.count(VI.getGUID())) {
       DEBUG(dbgs() << "ignored! Target already in destination module.\n");
@@ -343,7 +362,8 @@ static void computeImportForFunction(
 static void ComputeImportForModule(
     const GVSummaryMapTy &DefinedGVSummaries, const ModuleSummaryIndex &Index,
     FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
+    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr,
+    ImportDependencies *Deps = nullptr) {
   // Worklist contains the list of function imported in this module, for which
   // we will analyse the callees and may import further down the callgraph.
   SmallVector<EdgeInfo, 128> Worklist;
@@ -363,7 +383,7 @@ static void ComputeImportForModule(
     DEBUG(dbgs() << "Initialize import for " << GVSummary.first << "\n");
     computeImportForFunction(*FuncSummary, Index, ImportInstrLimit,
                              DefinedGVSummaries, Worklist, ImportList,
-                             ExportLists);
+                             ExportLists, Deps);
   }
 
   // Process the newly imported functions and add callees to the worklist.
@@ -381,7 +401,161 @@ static void ComputeImportForModule(
       continue;
 
     computeImportForFunction(*Summary, Index, Threshold, DefinedGVSummaries,
-                             Worklist, ImportList, ExportLists);
+                             Worklist, ImportList, ExportLists, Deps);
+  }
+}
+
+/// Return the import options in the form recorded in an ImportListCache.
+static std::string getImportOptions() {
+  std::string Options;
+  raw_string_ostream OS(Options);
+  OS << ImportInstrLimit << ' ' << format("%g", ImportInstrFactor.getValue())
+     << ' ' << format("%g", ImportHotInstrFactor.getValue()) << ' '
+     << format("%g", ImportHotMultiplier.getValue()) << ' '
+     << format("%g", ImportCriticalMultiplier.getValue()) << ' '
+     << format("%g", ImportColdMultiplier.getValue());
+  return OS.str();
+}
+
+/// Return a hash of the liveness of \p DefinedGVSummaries.
+static uint64_t getLiveHash(const ModuleSummaryIndex &Index,
+                            const GVSummaryMapTy &DefinedGVSummaries) {
+  SmallVector<uint64_t, 64> Live;
+  for (auto &GVSummary : DefinedGVSummaries)
+    if (Index.isGlobalValueLive(GVSummary.second))
+      Live.push_back(GVSummary.first);
+  return xxHash64(StringRef(reinterpret_cast<const char *>(Live.data()),
+                            Live.size() * sizeof(uint64_t)));
+}
+
+/// Return true if the import list cached in \p Entry is still valid for the
+/// module defining \p DefinedGVSummaries. It is if neither the module, nor the
+/// modules with summaries for the callees examined changed, and none of the
+/// changed modules defines any of these callees now.
+static bool
+isImportListReusable(const ModuleSummaryIndex &Index,
+                     const GVSummaryMapTy &DefinedGVSummaries,
+                     const ImportListCache::ModuleEntry &Entry,
+                     const StringSet<> &ChangedModules,
+                     const DenseSet<GlobalValue::GUID> &ChangedDefinitions) {
+  if (Entry.LiveHash != getLiveHash(Index, DefinedGVSummaries))
+    return false;
+  for (auto &Dependency : Entry.Dependencies)
+    if (ChangedModules.count(Dependency))
+      return false;
+  for (GlobalValue::GUID GUID : Entry.Examined)
+    if (ChangedDefinitions.count(GUID))
+      return false;
+  return true;
+}
+
+/// Add to \p ExportLists the exports made by importing \p ImportList, as
+/// computeImportForFunction() does.
+static void
+addExportsForImportList(const ModuleSummaryIndex &Index,
+                        const FunctionImporter::ImportMapTy &ImportList,
+                        StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+  for (auto &FromModule : ImportList) {
+    auto &ExportList = ExportLists[FromModule.first()];
+    for (auto &Import : FromModule.second) {
+      ExportList.insert(Import.first);
+      GlobalValueSummary *Summary =
+          Index.findSummaryInModule(Import.first, FromModule.first());
+      if (!Summary)
+        continue;
+      auto *FS = cast<FunctionSummary>(Summary->getBaseObject());
+      for (auto &Edge : FS->calls())
+        ExportList.insert(Edge.first.getGUID());
+      for (auto &Ref : FS->refs())
+        ExportList.insert(Ref.getGUID());
+    }
+  }
+}
+
+ImportListCache ImportListCache::read(StringRef Buffer) {
+  ImportListCache Cache;
+  ModuleEntry *Entry = nullptr;
+  SmallVector<StringRef, 64> Lines;
+  Buffer.split(Lines, '\n', -1, false);
+  if (Lines.empty() || Lines[0] != "import lists v1")
+    return ImportListCache();
+
+  for (StringRef Line : makeArrayRef(Lines).drop_front()) {
+    StringRef Kind, Rest;
+    std::tie(Kind, Rest) = Line.split('\t');
+    if (Kind == "options") {
+      Cache.Options = Rest;
+    } else if (Kind == "order") {
+      Cache.ModuleOrder.push_back(Rest);
+    } else if (Kind == "module") {
+      SmallVector<StringRef, 7> Fields;
+      Rest.split(Fields, '\t');
+      if (Fields.size() != 7)
+        return ImportListCache();
+      Entry = &Cache.Modules[Fields[0]];
+      for (unsigned I = 0; I != 5; ++I)
+        if (Fields[I + 1].getAsInteger(16, Entry->Hash[I]))
+          return ImportListCache();
+      if (Fields[6].getAsInteger(16, Entry->LiveHash))
+        return ImportListCache();
+    } else if (Entry && Kind == "dep") {
+      Entry->Dependencies.push_back(Rest);
+    } else if (Entry && Kind == "examined") {
+      SmallVector<StringRef, 64> GUIDs;
+      Rest.split(GUIDs, ' ', -1, false);
+      for (StringRef Str : GUIDs) {
+        GlobalValue::GUID GUID;
+        if (Str.getAsInteger(10, GUID))
+          return ImportListCache();
+        Entry->Examined.push_back(GUID);
+      }
+    } else if (Entry && Kind == "import") {
+      SmallVector<StringRef, 3> Fields;
+      Rest.split(Fields, '\t');
+      GlobalValue::GUID GUID;
+      unsigned Threshold;
+      if (Fields.size() != 3 || Fields[1].getAsInteger(10, GUID) ||
+          Fields[2].getAsInteger(10, Threshold))
+        return ImportListCache();
+      Entry->ImportList[Fields[0]][GUID] = Threshold;
+    } else {
+      return ImportListCache();
+    }
+  }
+  return Cache;
+}
+
+void ImportListCache::write(raw_ostream &OS) const {
+  OS << "import lists v1\n";
+  OS << "options\t" << Options << '\n';
+  for (auto &Path : ModuleOrder)
+    OS << "order\t" << Path << '\n';
+
+  // Write the modules sorted by name for determinism.
+  std::vector<StringRef> Paths;
+  for (auto &Entry : Modules)
+    Paths.push_back(Entry.first());
+  std::sort(Paths.begin(), Paths.end());
+  for (StringRef Path : Paths) {
+    const ModuleEntry &Entry = Modules.find(Path)->second;
+    OS << "module\t" << Path;
+    for (uint32_t Word : Entry.Hash)
+      OS << '\t' << format_hex_no_prefix(Word, 8);
+    OS << '\t' << format_hex_no_prefix(Entry.LiveHash, 16) << '\n';
+    for (auto &Dependency : Entry.Dependencies)
+      OS << "dep\t" << Dependency << '\n';
+    OS << "examined\t";
+    for (GlobalValue::GUID GUID : Entry.Examined)
+      OS << GUID << ' ';
+    OS << '\n';
+    std::vector<StringRef> FromModules;
+    for (auto &FromModule : Entry.ImportList)
+      FromModules.push_back(FromModule.first());
+    std::sort(FromModules.begin(), FromModules.end());
+    for (StringRef FromModule : FromModules)
+      for (auto &Import : Entry.ImportList.find(FromModule)->second)
+        OS << "import\t" << FromModule << '\t' << Import.first << '\t'
+           << Import.second << '\n';
   }
 }
 
@@ -390,16 +564,99 @@ void llvm::ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ImportListCache *Cache) {
+  StringSet<> ChangedModules;
+  DenseSet<GlobalValue::GUID> ChangedDefinitions;
+  if (Cache) {
+    Cache->NumReused = Cache->NumComputed = 0;
+
+    // The order of the modules determines the order of the summary lists, in
+    // which the callees are selected. Start over if it changed, e.g. because
+    // modules were added or removed, or if the options changed.
+    std::vector<std::pair<uint64_t, StringRef>> Order;
+    for (auto &ModulePath : Index.modulePaths())
+      Order.push_back({ModulePath.second.first, ModulePath.first()});
+    std::sort(Order.begin(), Order.end());
+    std::vector<std::string> ModuleOrder;
+    for (auto &Module : Order)
+      ModuleOrder.push_back(Module.second);
+    std::string Options = getImportOptions();
+    if (ModuleOrder != Cache->ModuleOrder || Options != Cache->Options)
+      Cache->Modules.clear();
+    Cache->ModuleOrder = std::move(ModuleOrder);
+    Cache->Options = std::move(Options);
+
+    // Modules without a hash are always considered changed.
+    for (auto &ModulePath : Index.modulePaths()) {
+      const ModuleHash &Hash = ModulePath.second.second;
+      auto Entry = Cache->Modules.find(ModulePath.first());
+      if (Entry != Cache->Modules.end() && Entry->second.Hash == Hash &&
+          any_of(Hash, [](uint32_t Word) { return Word != 0; }))
+        continue;
+      ChangedModules.insert(ModulePath.first());
+      auto DefinedGVSummaries =
+          ModuleToDefinedGVSummaries.find(ModulePath.first());
+      if (DefinedGVSummaries == ModuleToDefinedGVSummaries.end())
+        continue;
+      for (auto &GVSummary : DefinedGVSummaries->second) {
+        ChangedDefinitions.insert(GVSummary.first);
+        ChangedDefinitions.insert(GVSummary.second->getOriginalName());
+      }
+    }
+  }
+
   // For each module that has function defined, compute the import/export lists.
   for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
     auto &ImportList = ImportLists[DefinedGVSummaries.first()];
+    if (Cache) {
+      auto Entry = Cache->Modules.find(DefinedGVSummaries.first());
+      if (Entry != Cache->Modules.end() &&
+          !ChangedModules.count(DefinedGVSummaries.first()) &&
+          isImportListReusable(Index, DefinedGVSummaries.second,
+                               Entry->second, ChangedModules,
+                               ChangedDefinitions)) {
+        DEBUG(dbgs() << "Reusing import for Module '"
+                     << DefinedGVSummaries.first() << "'\n");
+        ImportList = Entry->second.ImportList;
+        addExportsForImportList(Index, ImportList, ExportLists);
+        ++Cache->NumReused;
+        ++NumReusedImportLists;
+        continue;
+      }
+    }
+
     DEBUG(dbgs() << "Computing import for Module '"
                  << DefinedGVSummaries.first() << "'\n");
+    ImportDependencies Deps;
     ComputeImportForModule(DefinedGVSummaries.second, Index, ImportList,
-                           &ExportLists);
+                           &ExportLists, Cache ? &Deps : nullptr);
+    if (!Cache)
+      continue;
+
+    ++Cache->NumComputed;
+    auto &Entry = Cache->Modules[DefinedGVSummaries.first()];
+    Entry = ImportListCache::ModuleEntry();
+    auto ModulePath = Index.modulePaths().find(DefinedGVSummaries.first());
+    if (ModulePath != Index.modulePaths().end())
+      Entry.Hash = ModulePath->second.second;
+    Entry.LiveHash = getLiveHash(Index, DefinedGVSummaries.second);
+    for (auto &Dependency : Deps.Modules)
+      Entry.Dependencies.push_back(Dependency.first());
+    std::sort(Entry.Dependencies.begin(), Entry.Dependencies.end());
+    Entry.Examined.assign(Deps.Examined.begin(), Deps.Examined.end());
+    std::sort(Entry.Examined.begin(), Entry.Examined.end());
+    Entry.ImportList = ImportList;
   }
 
+  // Forget the modules that are no longer part of the link.
+  if (Cache)
+    for (auto I = Cache->Modules.begin(), E = Cache->Modules.end(); I != E;) {
+      auto Entry = I++;
+      if (!ModuleToDefinedGVSummaries.count(Entry->first()))
+        Cache->Modules.erase(Entry);
+    }
+
   // When computing imports we added all GUIDs referenced by anything
   // imported from the module to its ExportList. Now we prune each ExportList
   // of any not defined in that module. This is more efficient than checking
@@ -861,8 +1118,10 @@ Expected<bool> FunctionImporter::importFunctions(
 static bool doImportingForModule(Module &M) {
   if (SummaryFile.empty())
     report_fatal_error("error: -function-import requires -summary-file\n");
+  // Only the summaries of the values the module refers to are needed to
+  // compute its imports, decode them on demand.
   Expected<std::unique_ptr<ModuleSummaryIndex>> IndexPtrOrErr =
-      getModuleSummaryIndexForFile(SummaryFile);
+      getLazyModuleSummaryIndexForFile(SummaryFile);
   if (!IndexPtrOrErr) {
     logAllUnhandledErrors(IndexPtrOrErr.takeError(), errs(),
                           "Error loading file '" + SummaryFile + "': ");
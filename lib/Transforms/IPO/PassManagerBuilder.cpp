@@ -144,6 +144,11 @@ static cl::opt<bool> EnableGVNSink(
     "enable-gvn-sink", cl::init(false), cl::Hidden,
     cl::desc("Enable the GVN sinking pass (default = off)"));
 
+static cl::opt<bool> EnablePolyhedralValueTransformer(
+    "enable-polyhedral-value-transformer", cl::init(false), cl::Hidden,
+    cl::desc("Enable the polyhedral condition folding and hoisting pass "
+             "(default = off)"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -590,7 +595,13 @@ void PassManagerBuilder::populateModulePassManager(
   MPM.add(createFloat2IntPass());
 
   addExtensionsToPM(EP_VectorizerStart, MPM);
-  //MPM.add(createPolyhedralValueTransformerWrapperPass());
+
+  // Fold and hoist loop conditions based on the polyhedral value analysis.
+  // The folded branches are removed before the loops are rotated again.
+  if (EnablePolyhedralValueTransformer) {
+    MPM.add(createPolyhedralValueTransformerWrapperPass());
+    MPM.add(createCFGSimplificationPass());
+  }
 
   // Re-rotate loops in all our loop nests. These may have fallout out of
   // rotated form due to GVN or other transformations, and the vectorizer relies
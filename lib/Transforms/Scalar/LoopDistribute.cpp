@@ -40,7 +40,11 @@
 #include "llvm/Analysis/LoopAccessAnalysis.h"
 #include "llvm/Analysis/LoopAnalysisManager.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/PolyhedralAccessInfo.h"
+#include "llvm/Analysis/PolyhedralDependenceInfo.h"
+#include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
@@ -102,6 +106,12 @@ static cl::opt<unsigned> PragmaDistributeSCEVCheckThreshold(
         "The maximum number of SCEV checks allowed for Loop "
         "Distribution for loop marked with #pragma loop distribute(enable)"));
 
+static cl::opt<bool> UsePolyhedralDependences(
+    "loop-distribute-use-polyhedral-dependences", cl::Hidden,
+    cl::desc("Use the polyhedral dependences, if they are complete, instead "
+             "of the loop access analysis to find unsafe dependences"),
+    cl::init(false));
+
 static cl::opt<bool> EnableLoopDistribute(
     "enable-loop-distribute", cl::Hidden,
     cl::desc("Enable the new, experimental LoopDistribution Pass"),
@@ -615,6 +625,23 @@ public:
       }
   }
 
+  /// \brief Initialize from the pairs of instruction indices (in program
+  /// order) that are connected by a backward dependence.
+  MemoryInstructionDependences(
+      const SmallVectorImpl<Instruction *> &Instructions,
+      ArrayRef<std::pair<unsigned, unsigned>> BackwardDependences) {
+    Accesses.append(Instructions.begin(), Instructions.end());
+
+    DEBUG(dbgs() << "Backward dependences:\n");
+    for (auto &Dep : BackwardDependences) {
+      ++Accesses[Dep.first].NumUnsafeDependencesStartOrEnd;
+      --Accesses[Dep.second].NumUnsafeDependencesStartOrEnd;
+
+      DEBUG(dbgs() << "  " << *Instructions[Dep.first] << " -> \n  "
+                   << *Instructions[Dep.second] << "\n");
+    }
+  }
+
 private:
   AccessesType Accesses;
 };
@@ -623,8 +650,9 @@ private:
 class LoopDistributeForLoop {
 public:
   LoopDistributeForLoop(Loop *L, Function *F, LoopInfo *LI, DominatorTree *DT,
-                        ScalarEvolution *SE, OptimizationRemarkEmitter *ORE)
-      : L(L), F(F), LI(LI), DT(DT), SE(SE), ORE(ORE) {
+                        ScalarEvolution *SE, OptimizationRemarkEmitter *ORE,
+                        PolyhedralDependenceInfo *PDI)
+      : L(L), F(F), LI(LI), DT(DT), SE(SE), ORE(ORE), PDI(PDI) {
     setForced();
   }
 
@@ -643,18 +671,45 @@ public:
 
     BasicBlock *PH = L->getLoopPreheader();
 
-    // LAA will check that we only have a single exiting block.
-    LAI = &GetLAA(*L);
-
-    // Currently, we only distribute to isolate the part of the loop with
-    // dependence cycles to enable partial vectorization.
-    if (LAI->canVectorizeMemory())
-      return fail("MemOpsCanBeVectorized",
-                  "memory operations are safe for vectorization");
-
-    auto *Dependences = LAI->getDepChecker().getDependences();
-    if (!Dependences || Dependences->empty())
-      return fail("NoUnsafeDeps", "no unsafe dependences to isolate");
+    // The memory instructions in program order and the (program ordered)
+    // pairs of them that are connected by backward dependences.
+    SmallVector<Instruction *, 16> MemInstrs;
+    SmallVector<std::pair<unsigned, unsigned>, 8> BackwardDeps;
+
+    // If the polyhedral dependences are complete they are exact for the
+    // delinearized accesses and no run-time checks are required.
+    bool UsesPolyhedralDependences =
+        PDI && collectPolyhedralDependences(MemInstrs, BackwardDeps);
+
+    if (UsesPolyhedralDependences) {
+      // The versioning and the partitions rely on the same loop shape LAA
+      // requires, thus check what canAnalyzeLoop checks for the LAA path.
+      if (L->getExitingBlock() != L->getLoopLatch())
+        return fail("CFGNotUnderstood",
+                    "loop control flow is not understood by analyzer");
+      if (isa<SCEVCouldNotCompute>(SE->getBackedgeTakenCount(L)))
+        return fail("CantComputeNumberOfIterations",
+                    "could not determine number of loop iterations");
+
+      if (BackwardDeps.empty())
+        return fail("NoUnsafeDeps", "no unsafe dependences to isolate");
+    } else {
+      MemInstrs.clear();
+      BackwardDeps.clear();
+
+      // LAA will check that we only have a single exiting block.
+      LAI = &GetLAA(*L);
+
+      // Currently, we only distribute to isolate the part of the loop with
+      // dependence cycles to enable partial vectorization.
+      if (LAI->canVectorizeMemory())
+        return fail("MemOpsCanBeVectorized",
+                    "memory operations are safe for vectorization");
+
+      auto *Dependences = LAI->getDepChecker().getDependences();
+      if (!Dependences || Dependences->empty())
+        return fail("NoUnsafeDeps", "no unsafe dependences to isolate");
+    }
 
     InstPartitionContainer Partitions(L, LI, DT);
 
@@ -677,9 +732,12 @@ public:
     // NumUnsafeDependencesActive > 0 indicates this situation and in this case
     // we just keep assigning to the same cyclic partition until
     // NumUnsafeDependencesActive reaches 0.
-    const MemoryDepChecker &DepChecker = LAI->getDepChecker();
-    MemoryInstructionDependences MID(DepChecker.getMemoryInstructions(),
-                                     *Dependences);
+    MemoryInstructionDependences MID =
+        UsesPolyhedralDependences
+            ? MemoryInstructionDependences(MemInstrs, BackwardDeps)
+            : MemoryInstructionDependences(
+                  LAI->getDepChecker().getMemoryInstructions(),
+                  *LAI->getDepChecker().getDependences());
 
     int NumUnsafeDependencesActive = 0;
     for (auto &InstDep : MID) {
@@ -733,14 +791,19 @@ public:
     }
 
     // Don't distribute the loop if we need too many SCEV run-time checks.
-    const SCEVUnionPredicate &Pred = LAI->getPSE().getUnionPredicate();
-    if (Pred.getComplexity() > (IsForced.getValueOr(false)
-                                    ? PragmaDistributeSCEVCheckThreshold
-                                    : DistributeSCEVCheckThreshold))
+    if (!UsesPolyhedralDependences &&
+        LAI->getPSE().getUnionPredicate().getComplexity() >
+            (IsForced.getValueOr(false) ? PragmaDistributeSCEVCheckThreshold
+                                        : DistributeSCEVCheckThreshold))
       return fail("TooManySCEVRuntimeChecks",
                   "too many SCEV run-time checks needed.\n");
 
     DEBUG(dbgs() << "\nDistributing loop: " << *L << "\n");
+    // The polyhedral information about the loop is invalidated by the
+    // distribution.
+    if (PDI)
+      PDI->forgetLoop(*L);
+
     // We're done forming the partitions set up the reverse mapping from
     // instructions to partitions.
     Partitions.setupPartitionIdOnInstructions();
@@ -752,20 +815,23 @@ public:
       SplitBlock(PH, PH->getTerminator(), DT, LI);
 
     // If we need run-time checks, version the loop now.
-    auto PtrToPartition = Partitions.computePartitionSetForPointers(*LAI);
-    const auto *RtPtrChecking = LAI->getRuntimePointerChecking();
-    const auto &AllChecks = RtPtrChecking->getChecks();
-    auto Checks = includeOnlyCrossPartitionChecks(AllChecks, PtrToPartition,
-                                                  RtPtrChecking);
-
-    if (!Pred.isAlwaysTrue() || !Checks.empty()) {
-      DEBUG(dbgs() << "\nPointers:\n");
-      DEBUG(LAI->getRuntimePointerChecking()->printChecks(dbgs(), Checks));
-      LoopVersioning LVer(*LAI, L, LI, DT, SE, false);
-      LVer.setAliasChecks(std::move(Checks));
-      LVer.setSCEVChecks(LAI->getPSE().getUnionPredicate());
-      LVer.versionLoop(DefsUsedOutside);
-      LVer.annotateLoopWithNoAlias();
+    if (!UsesPolyhedralDependences) {
+      const SCEVUnionPredicate &Pred = LAI->getPSE().getUnionPredicate();
+      auto PtrToPartition = Partitions.computePartitionSetForPointers(*LAI);
+      const auto *RtPtrChecking = LAI->getRuntimePointerChecking();
+      const auto &AllChecks = RtPtrChecking->getChecks();
+      auto Checks = includeOnlyCrossPartitionChecks(AllChecks, PtrToPartition,
+                                                    RtPtrChecking);
+
+      if (!Pred.isAlwaysTrue() || !Checks.empty()) {
+        DEBUG(dbgs() << "\nPointers:\n");
+        DEBUG(LAI->getRuntimePointerChecking()->printChecks(dbgs(), Checks));
+        LoopVersioning LVer(*LAI, L, LI, DT, SE, false);
+        LVer.setAliasChecks(std::move(Checks));
+        LVer.setSCEVChecks(LAI->getPSE().getUnionPredicate());
+        LVer.versionLoop(DefsUsedOutside);
+        LVer.annotateLoopWithNoAlias();
+      }
     }
 
     // Create identical copies of the original loop for each partition and hook
@@ -834,6 +900,49 @@ public:
   const Optional<bool> &isForced() const { return IsForced; }
 
 private:
+  /// \brief Collect the loads and stores of the loop in program order in
+  /// \p MemInstrs and the backward dependences between them according to the
+  /// polyhedral dependences in \p BackwardDeps.
+  ///
+  /// A dependence is backward if it is carried by the loop and its target
+  /// does not follow its source in the loop body.
+  ///
+  /// \returns False if the polyhedral dependences are not complete or do not
+  /// hold for all parameter values.
+  bool collectPolyhedralDependences(
+      SmallVectorImpl<Instruction *> &MemInstrs,
+      SmallVectorImpl<std::pair<unsigned, unsigned>> &BackwardDeps) {
+    if (!PDI->hasExactDependences(*L))
+      return false;
+    const auto &LD = PDI->getDependences(*L);
+
+    DenseMap<const Instruction *, unsigned> ProgramOrder;
+    LoopBlocksDFS DFS(L);
+    DFS.perform(LI);
+    for (BasicBlock *BB : make_range(DFS.beginRPO(), DFS.endRPO()))
+      for (Instruction &I : *BB) {
+        if (!I.mayReadOrWriteMemory())
+          continue;
+        auto *Ld = dyn_cast<LoadInst>(&I);
+        auto *St = dyn_cast<StoreInst>(&I);
+        if (!(Ld && Ld->isSimple()) && !(St && St->isSimple()))
+          return false;
+        ProgramOrder[&I] = MemInstrs.size();
+        MemInstrs.push_back(&I);
+      }
+
+    for (const PDEP *Dep : LD.Dependences) {
+      if (Dep->isLoopIndependent() || Dep->isLexicallyForward())
+        continue;
+      unsigned Src = ProgramOrder.lookup(
+          cast<Instruction>(Dep->getSource()->getPEXP()->getValue()));
+      unsigned Tgt = ProgramOrder.lookup(
+          cast<Instruction>(Dep->getTarget()->getPEXP()->getValue()));
+      BackwardDeps.push_back({std::min(Src, Tgt), std::max(Src, Tgt)});
+    }
+    return true;
+  }
+
   /// \brief Filter out checks between pointers from the same partition.
   ///
   /// \p PtrToPartition contains the partition number for pointers.  Partition
@@ -895,6 +1004,7 @@ private:
   DominatorTree *DT;
   ScalarEvolution *SE;
   OptimizationRemarkEmitter *ORE;
+  PolyhedralDependenceInfo *PDI;
 
   /// \brief Indicates whether distribution is forced to be enabled/disabled for
   /// the loop.
@@ -910,7 +1020,8 @@ private:
 /// Shared implementation between new and old PMs.
 static bool runImpl(Function &F, LoopInfo *LI, DominatorTree *DT,
                     ScalarEvolution *SE, OptimizationRemarkEmitter *ORE,
-                    std::function<const LoopAccessInfo &(Loop &)> &GetLAA) {
+                    std::function<const LoopAccessInfo &(Loop &)> &GetLAA,
+                    PolyhedralDependenceInfo *PDI) {
   // Build up a worklist of inner-loops to vectorize. This is necessary as the
   // act of distributing a loop creates new loops and can invalidate iterators
   // across the loops.
@@ -925,7 +1036,7 @@ static bool runImpl(Function &F, LoopInfo *LI, DominatorTree *DT,
   // Now walk the identified inner loops.
   bool Changed = false;
   for (Loop *L : Worklist) {
-    LoopDistributeForLoop LDL(L, &F, LI, DT, SE, ORE);
+    LoopDistributeForLoop LDL(L, &F, LI, DT, SE, ORE, PDI);
 
     // If distribution was forced for the specific loop to be
     // enabled/disabled, follow that.  Otherwise use the global flag.
@@ -960,8 +1071,12 @@ public:
     auto *ORE = &getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
     std::function<const LoopAccessInfo &(Loop &)> GetLAA =
         [&](Loop &L) -> const LoopAccessInfo & { return LAA->getInfo(&L); };
+    auto *PDI = UsePolyhedralDependences
+                    ? &getAnalysis<PolyhedralDependenceInfoWrapperPass>()
+                           .getPolyhedralDependenceInfo()
+                    : nullptr;
 
-    return runImpl(F, LI, DT, SE, ORE, GetLAA);
+    return runImpl(F, LI, DT, SE, ORE, GetLAA, PDI);
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
@@ -972,6 +1087,8 @@ public:
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+    if (UsePolyhedralDependences)
+      AU.addRequired<PolyhedralDependenceInfoWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
   }
 };
@@ -999,7 +1116,11 @@ PreservedAnalyses LoopDistributePass::run(Function &F,
     return LAM.getResult<LoopAccessAnalysis>(L, AR);
   };
 
-  bool Changed = runImpl(F, &LI, &DT, &SE, &ORE, GetLAA);
+  auto *PDI = UsePolyhedralDependences
+                  ? &AM.getResult<PolyhedralDependenceInfoAnalysis>(F)
+                  : nullptr;
+
+  bool Changed = runImpl(F, &LI, &DT, &SE, &ORE, GetLAA, PDI);
   if (!Changed)
     return PreservedAnalyses::all();
   PreservedAnalyses PA;
@@ -1020,6 +1141,7 @@ INITIALIZE_PASS_DEPENDENCY(LoopAccessLegacyAnalysis)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PolyhedralDependenceInfoWrapperPass)
 INITIALIZE_PASS_END(LoopDistributeLegacy, LDIST_NAME, ldist_name, false, false)
 
 FunctionPass *llvm::createLoopDistributePass() { return new LoopDistributeLegacy(); }
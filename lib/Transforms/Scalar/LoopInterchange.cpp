@@ -13,6 +13,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -20,6 +21,7 @@
 #include "llvm/Analysis/DependenceAnalysis.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/PolyhedralDependenceInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/IR/BasicBlock.h"
@@ -54,6 +56,11 @@ static cl::opt<int> LoopInterchangeCostThreshold(
     "loop-interchange-threshold", cl::init(0), cl::Hidden,
     cl::desc("Interchange if you gain more than this number"));
 
+static cl::opt<bool> UsePolyhedralInfo(
+    "loop-interchange-use-polyhedral-info", cl::init(false), cl::Hidden,
+    cl::desc("Use the polyhedral dependences and the strides of the "
+             "delinearized accesses to check legality and profitability"));
+
 namespace {
 
 using LoopVector = SmallVector<Loop *, 8>;
@@ -61,6 +68,13 @@ using LoopVector = SmallVector<Loop *, 8>;
 // TODO: Check if we can use a sparse matrix here.
 using CharMatrix = std::vector<std::vector<char>>;
 
+/// The innermost dimension strides of the accesses in a loop nest together
+/// with the position of the loops in the nest before any interchange.
+struct PolyhedralStrideInfo {
+  SmallVector<PolyhedralDependenceInfo::AccessStride, 8> Strides;
+  DenseMap<const Loop *, unsigned> LoopLevels;
+};
+
 } // end anonymous namespace
 
 // Maximum number of dependencies that can be handled in the dependency matrix.
@@ -179,6 +193,56 @@ static bool populateDependencyMatrix(CharMatrix &DepMatrix, unsigned Level,
   return true;
 }
 
+/// Populate @p DepMatrix with the direction vectors of the polyhedral
+/// dependences in the loop nest rooted at @p L. A positive distance
+/// (the target is executed in a later iteration) is represented as '<'.
+///
+/// @returns False if the dependences are not completely known or do not hold
+/// for all parameter values.
+static bool populatePolyhedralDependencyMatrix(CharMatrix &DepMatrix,
+                                               unsigned Level, Loop *L,
+                                               PolyhedralDependenceInfo *PDI) {
+  if (!PDI->hasExactDependences(*L)) {
+    DEBUG(dbgs() << "Polyhedral dependences are incomplete or not valid for "
+                    "all parameter values\n");
+    return false;
+  }
+  const auto &LD = PDI->getDependences(*L);
+
+  for (const PDEP *Dep : LD.Dependences) {
+    DEBUG(dbgs() << "Found polyhedral dependence " << Dep);
+    std::vector<char> DepVector;
+    for (unsigned II = 1, E = Dep->getNumCommonLevels(); II <= E; ++II) {
+      switch (Dep->getDirection(II)) {
+      case PDEP::DIR_EQ:
+        DepVector.push_back('=');
+        break;
+      case PDEP::DIR_LT:
+        DepVector.push_back('<');
+        break;
+      case PDEP::DIR_GT:
+        DepVector.push_back('>');
+        break;
+      case PDEP::DIR_ALL:
+        DepVector.push_back('*');
+        break;
+      }
+    }
+    while (DepVector.size() < Level)
+      DepVector.push_back('I');
+
+    DepMatrix.push_back(DepVector);
+    if (DepMatrix.size() > MaxMemInstrCount) {
+      DEBUG(dbgs() << "Cannot handle more than " << MaxMemInstrCount
+                   << " dependencies inside loop\n");
+      return false;
+    }
+  }
+
+  // We don't have a DepMatrix to check legality return false.
+  return !DepMatrix.empty();
+}
+
 // A loop is moved from index 'from' to an index 'to'. Update the Dependence
 // matrix by exchanging the two columns.
 static void interChangeDependencies(CharMatrix &DepMatrix, unsigned FromIndx,
@@ -371,8 +435,9 @@ private:
 class LoopInterchangeProfitability {
 public:
   LoopInterchangeProfitability(Loop *Outer, Loop *Inner, ScalarEvolution *SE,
-                               OptimizationRemarkEmitter *ORE)
-      : OuterLoop(Outer), InnerLoop(Inner), SE(SE), ORE(ORE) {}
+                               OptimizationRemarkEmitter *ORE,
+                               const PolyhedralStrideInfo *PSI = nullptr)
+      : OuterLoop(Outer), InnerLoop(Inner), SE(SE), ORE(ORE), PSI(PSI) {}
 
   /// Check if the loop interchange is profitable.
   bool isProfitable(unsigned InnerLoopId, unsigned OuterLoopId,
@@ -381,6 +446,11 @@ public:
 private:
   int getInstrOrderCost();
 
+  /// Compute the cost based on the innermost dimension strides of the
+  /// delinearized accesses. Accesses that are consecutive in the inner but
+  /// not in the outer loop are a good order, the reverse a bad one.
+  int getPolyhedralOrderCost();
+
   Loop *OuterLoop;
   Loop *InnerLoop;
 
@@ -389,6 +459,9 @@ private:
 
   /// Interface to emit optimization remarks.
   OptimizationRemarkEmitter *ORE;
+
+  /// The polyhedral access strides, if available.
+  const PolyhedralStrideInfo *PSI;
 };
 
 /// LoopInterchangeTransform interchanges the loop.
@@ -434,6 +507,7 @@ struct LoopInterchange : public FunctionPass {
   ScalarEvolution *SE = nullptr;
   LoopInfo *LI = nullptr;
   DependenceInfo *DI = nullptr;
+  PolyhedralDependenceInfo *PDI = nullptr;
   DominatorTree *DT = nullptr;
   bool PreserveLCSSA;
 
@@ -452,6 +526,10 @@ struct LoopInterchange : public FunctionPass {
     AU.addRequired<DependenceAnalysisWrapperPass>();
     AU.addRequiredID(LoopSimplifyID);
     AU.addRequiredID(LCSSAID);
+    // Loop simplification and LCSSA do not preserve the polyhedral dependences,
+    // thus they have to be scheduled first.
+    if (UsePolyhedralInfo)
+      AU.addRequired<PolyhedralDependenceInfoWrapperPass>();
     AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
   }
 
@@ -462,6 +540,9 @@ struct LoopInterchange : public FunctionPass {
     SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
     LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
     DI = &getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    if (UsePolyhedralInfo)
+      PDI = &getAnalysis<PolyhedralDependenceInfoWrapperPass>()
+                 .getPolyhedralDependenceInfo();
     auto *DTWP = getAnalysisIfAvailable<DominatorTreeWrapperPass>();
     DT = DTWP ? &DTWP->getDomTree() : nullptr;
     ORE = &getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
@@ -528,10 +609,16 @@ struct LoopInterchange : public FunctionPass {
 
     CharMatrix DependencyMatrix;
     Loop *OuterMostLoop = *(LoopList.begin());
-    if (!populateDependencyMatrix(DependencyMatrix, LoopNestDepth,
-                                  OuterMostLoop, DI)) {
-      DEBUG(dbgs() << "Populating dependency matrix failed\n");
-      return false;
+    bool UsesPolyhedralInfo =
+        PDI && populatePolyhedralDependencyMatrix(
+                   DependencyMatrix, LoopNestDepth, OuterMostLoop, PDI);
+    if (!UsesPolyhedralInfo) {
+      DependencyMatrix.clear();
+      if (!populateDependencyMatrix(DependencyMatrix, LoopNestDepth,
+                                    OuterMostLoop, DI)) {
+        DEBUG(dbgs() << "Populating dependency matrix failed\n");
+        return false;
+      }
     }
 #ifdef DUMP_DEP_MATRICIES
     DEBUG(dbgs() << "Dependence before interchange\n");
@@ -561,11 +648,21 @@ struct LoopInterchange : public FunctionPass {
       return false;
     }
 
+    // The strides are computed before any loop is interchanged, the loops are
+    // identified by their original position in the nest.
+    PolyhedralStrideInfo PSI;
+    bool HasStrideInfo =
+        UsesPolyhedralInfo &&
+        PDI->getInnermostDimStrides(*OuterMostLoop, PSI.Strides);
+    for (unsigned i = 0; i < LoopNestDepth; i++)
+      PSI.LoopLevels[LoopList[i]] = i;
+
     unsigned SelecLoopId = selectLoopForInterchange(LoopList);
     // Move the selected loop outwards to the best possible position.
     for (unsigned i = SelecLoopId; i > 0; i--) {
       bool Interchanged =
-          processLoop(LoopList, i, i - 1, LoopNestExit, DependencyMatrix);
+          processLoop(LoopList, i, i - 1, LoopNestExit, DependencyMatrix,
+                      HasStrideInfo ? &PSI : nullptr);
       if (!Interchanged)
         return Changed;
       // Loops interchanged reflect the same in LoopList
@@ -585,7 +682,8 @@ struct LoopInterchange : public FunctionPass {
 
   bool processLoop(LoopVector LoopList, unsigned InnerLoopId,
                    unsigned OuterLoopId, BasicBlock *LoopNestExit,
-                   std::vector<std::vector<char>> &DependencyMatrix) {
+                   std::vector<std::vector<char>> &DependencyMatrix,
+                   const PolyhedralStrideInfo *PSI) {
     DEBUG(dbgs() << "Processing Inner Loop Id = " << InnerLoopId
                  << " and OuterLoopId = " << OuterLoopId << "\n");
     Loop *InnerLoop = LoopList[InnerLoopId];
@@ -598,7 +696,7 @@ struct LoopInterchange : public FunctionPass {
       return false;
     }
     DEBUG(dbgs() << "Loops are legal to interchange\n");
-    LoopInterchangeProfitability LIP(OuterLoop, InnerLoop, SE, ORE);
+    LoopInterchangeProfitability LIP(OuterLoop, InnerLoop, SE, ORE, PSI);
     if (!LIP.isProfitable(InnerLoopId, OuterLoopId, DependencyMatrix)) {
       DEBUG(dbgs() << "Interchanging loops not profitable\n");
       return false;
@@ -611,6 +709,11 @@ struct LoopInterchange : public FunctionPass {
              << "Loop interchanged with enclosing loop.";
     });
 
+    // The polyhedral information of the loop nest is invalidated by the
+    // interchange.
+    if (PDI)
+      PDI->forgetLoop(*OuterLoop);
+
     LoopInterchangeTransform LIT(OuterLoop, InnerLoop, SE, LI, DT,
                                  LoopNestExit, LIL.hasInnerLoopReduction());
     LIT.transform();
@@ -1103,6 +1206,36 @@ static bool isProfitableForVectorization(unsigned InnerLoopId,
   return true;
 }
 
+int LoopInterchangeProfitability::getPolyhedralOrderCost() {
+  unsigned InnerLevel = PSI->LoopLevels.lookup(InnerLoop);
+  unsigned OuterLevel = PSI->LoopLevels.lookup(OuterLoop);
+  unsigned MaxLevel = std::max(InnerLevel, OuterLevel);
+
+  // An access is consecutive in a loop if successive iterations touch
+  // adjacent elements.
+  auto IsConsecutive = [](int64_t Stride, uint64_t ElementSize) {
+    return Stride != 0 && uint64_t(std::abs(Stride)) <= ElementSize;
+  };
+
+  unsigned GoodOrder = 0, BadOrder = 0;
+  for (const auto &AS : PSI->Strides) {
+    if (AS.Strides.size() <= MaxLevel)
+      continue;
+    const Optional<int64_t> &InnerStride = AS.Strides[InnerLevel];
+    const Optional<int64_t> &OuterStride = AS.Strides[OuterLevel];
+    if (!InnerStride || !OuterStride)
+      continue;
+
+    bool InnerConsecutive = IsConsecutive(*InnerStride, AS.ElementSize);
+    bool OuterConsecutive = IsConsecutive(*OuterStride, AS.ElementSize);
+    if (InnerConsecutive && !OuterConsecutive)
+      GoodOrder++;
+    else if (OuterConsecutive && !InnerConsecutive)
+      BadOrder++;
+  }
+  return GoodOrder - BadOrder;
+}
+
 bool LoopInterchangeProfitability::isProfitable(unsigned InnerLoopId,
                                                 unsigned OuterLoopId,
                                                 CharMatrix &DepMatrix) {
@@ -1114,7 +1247,10 @@ bool LoopInterchangeProfitability::isProfitable(unsigned InnerLoopId,
   // This is rough cost estimation algorithm. It counts the good and bad order
   // of induction variables in the instruction and allows reordering if number
   // of bad orders is more than good.
-  int Cost = getInstrOrderCost();
+  //
+  // If available, the strides of the delinearized polyhedral accesses are used
+  // instead as they also describe accesses to parametric sized arrays.
+  int Cost = PSI ? getPolyhedralOrderCost() : getInstrOrderCost();
   DEBUG(dbgs() << "Cost = " << Cost << "\n");
   if (Cost < -LoopInterchangeCostThreshold)
     return true;
@@ -1420,6 +1556,7 @@ INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LCSSAWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PolyhedralDependenceInfoWrapperPass)
 
 INITIALIZE_PASS_END(LoopInterchange, "loop-interchange",
                     "Interchanges loops for cache reuse", false, false)
@@ -9,6 +9,8 @@
 
 #include "llvm/Transforms/Scalar/LoopPassManager.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PolyhedralAccessInfo.h"
+#include "llvm/Analysis/PolyhedralValueInfo.h"
 
 using namespace llvm;
 
@@ -34,8 +36,14 @@ PassManager<Loop, LoopAnalysisManager, LoopStandardAnalysisResults &,
     if (DebugLogging)
       dbgs() << "Running pass: " << Pass->name() << " on " << L;
 
+    internal::PolyhedralLoopNestUpdater PolyhedralUpdater(L, AM, AR);
+
     PreservedAnalyses PassPA = Pass->run(L, AM, AR, U);
 
+    // Forget the polyhedral information about the loop nest if it was changed
+    // such that later passes do not see stale information.
+    PolyhedralUpdater.update(PassPA);
+
     // If the loop was deleted, abort the run and return to the outer walk.
     if (U.skipCurrentLoop()) {
       PA.intersect(std::move(PassPA));
@@ -80,6 +88,49 @@ PassManager<Loop, LoopAnalysisManager, LoopStandardAnalysisResults &,
 }
 }
 
+internal::PolyhedralLoopNestUpdater::PolyhedralLoopNestUpdater(
+    Loop &L, LoopAnalysisManager &AM, LoopStandardAnalysisResults &AR,
+    const FunctionAnalysisManager *FAM) {
+  // Only the adaptor can look at the function analyses directly, the nested
+  // loop pass managers go through the proxy if the adaptor has set it up.
+  if (!FAM) {
+    auto *FAMProxy = AM.getCachedResult<FunctionAnalysisManagerLoopProxy>(L);
+    if (!FAMProxy)
+      return;
+    FAM = &FAMProxy->getManager();
+  }
+
+  Function &F = *L.getHeader()->getParent();
+  PVI = FAM->getCachedResult<PolyhedralValueInfoAnalysis>(F);
+  if (!PVI)
+    return;
+
+  PAI = FAM->getCachedResult<PolyhedralAccessInfoAnalysis>(F);
+  AM.getResult<FunctionAnalysisManagerLoopProxy>(L, AR);
+  PolyhedralValueInfo::collectLoopNest(L, Values, Loops);
+}
+
+void internal::PolyhedralLoopNestUpdater::update(PreservedAnalyses &PA) {
+  if (!PVI)
+    return;
+
+  auto PAC = PA.getChecker<PolyhedralValueInfoAnalysis>();
+  if (!PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>()) {
+    if (PAI)
+      PAI->forget(Values, Loops);
+    else
+      PVI->forget(Values, Loops);
+  } else if (PAI) {
+    auto PAIC = PA.getChecker<PolyhedralAccessInfoAnalysis>();
+    if (!PAIC.preserved() && !PAIC.preservedSet<AllAnalysesOn<Function>>())
+      PAI->forget(Values, Loops);
+  }
+
+  PA.preserve<PolyhedralValueInfoAnalysis>();
+  if (PAI)
+    PA.preserve<PolyhedralAccessInfoAnalysis>();
+}
+
 PrintLoopPass::PrintLoopPass() : OS(dbgs()) {}
 PrintLoopPass::PrintLoopPass(raw_ostream &OS, const std::string &Banner)
     : OS(OS), Banner(Banner) {}
@@ -7,14 +7,20 @@
 //
 //===----------------------------------------------------------------------===//
 //
+// Simplify the conditional branches in loops with the polyhedral value
+// analysis. Branches that are always or never taken in the iterations they are
+// evaluated in are folded, branches that only depend on loop invariant
+// parameters are hoisted out of innermost loops by versioning them. If the
+// polyhedral representation of a condition is only valid for some parameter
+// values the loop is versioned on these values first.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/Scalar/PolyhedralValueTransformer.h"
 
 #include "llvm/ADT/Statistic.h"
-#include "llvm/Analysis/AliasSetTracker.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PolyhedralUtils.h"
 #include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -25,6 +31,9 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
 
 #include <cassert>
 
@@ -32,303 +41,331 @@ using namespace llvm;
 
 #define DEBUG_TYPE "polyhedral-value-transformer"
 
-STATISTIC(NUM_PARTIALLY_VALID_CONDITIONS, "Number of partially valid conditions");
-STATISTIC(NUM_ALWAYS_VALID_CONDITIONS, "Number of always valid conditions");
-STATISTIC(NUM_PARTIALLY_VALID_CONDITION_DOMAINS, "Number of partially valid condition domains");
 STATISTIC(NUM_CONDITIONS_IN_LOOP, "Number of conditions in loops");
 STATISTIC(NUM_LATCH_CONDITIONS, "Number of latch conditions");
 STATISTIC(NUM_EXIT_CONDITIONS, "Number of exit conditions");
-STATISTIC(NUM_ALWAYS_VALID_CONDITION_DOMAINS, "Number of always valid condition domains");
-STATISTIC(NUM_HOISTABLE_CONDITIONS, "Number of hoistable (always valid) conditions");
-STATISTIC(NUM_HOISTABLE_LATCH_CONDITIONS, "Number of hoistable (always valid) latch conditions");
-STATISTIC(NUM_HOISTABLE_EXIT_CONDITIONS, "Number of hoistable (always valid) exit conditions");
-STATISTIC(NUM_ALWAYS_TAKEN_CONDITIONS, "Number of always taken (always valid) conditions");
-STATISTIC(NUM_ALWAYS_TAKEN_LATCH_CONDITIONS, "Number of always taken (always valid) latch conditions");
-STATISTIC(NUM_ALWAYS_TAKEN_EXIT_CONDITIONS, "Number of always taken (always valid) exit conditions");
-STATISTIC(NUM_NEVER_TAKEN_CONDITIONS, "Number of never taken (always valid) conditions");
-STATISTIC(NUM_NEVER_TAKEN_LATCH_CONDITIONS, "Number of never taken (always valid) latch conditions");
-STATISTIC(NUM_NEVER_TAKEN_EXIT_CONDITIONS, "Number of never taken (always valid) exit conditions");
-STATISTIC(NUM_PARTIALLY_HOISTABLE_CONDITIONS, "Number of hoistable (partially valid) conditions");
-STATISTIC(NUM_PARTIALLY_HOISTABLE_LATCH_CONDITIONS, "Number of hoistable (partially valid) latch conditions");
-STATISTIC(NUM_PARTIALLY_HOISTABLE_EXIT_CONDITIONS, "Number of hoistable (partially valid) exit conditions");
-STATISTIC(NUM_PARTIALLY_ALWAYS_TAKEN_CONDITIONS, "Number of always taken (partially valid) conditions");
-STATISTIC(NUM_PARTIALLY_ALWAYS_TAKEN_LATCH_CONDITIONS, "Number of always taken (partially valid) latch conditions");
-STATISTIC(NUM_PARTIALLY_ALWAYS_TAKEN_EXIT_CONDITIONS, "Number of always taken (partially valid) exit conditions");
-STATISTIC(NUM_PARTIALLY_NEVER_TAKEN_CONDITIONS, "Number of never taken (partially valid) conditions");
-STATISTIC(NUM_PARTIALLY_NEVER_TAKEN_LATCH_CONDITIONS, "Number of never taken (partially valid) latch conditions");
-STATISTIC(NUM_PARTIALLY_NEVER_TAKEN_EXIT_CONDITIONS, "Number of never taken (partially valid) exit conditions");
-
-STATISTIC(NUM_INT_DIFF, "Number of integer differences");
-STATISTIC(NUM_CST_DIFF, "Number of constant differences");
-STATISTIC(NUM_ONE_LOOP_DIFF, "Number of differences involving one loop");
-STATISTIC(NUM_ONE_LOOP_DIFF_ONE_PARAM, "Number of differences involving one loop and one param");
-
-static cl::opt<bool> PVTEnabled("pvt", cl::desc("Enable pvt"), cl::init(false),
-                                cl::ZeroOrMore);
+STATISTIC(NUM_ALWAYS_VALID_CONDITIONS, "Number of always valid simplifiable conditions");
+STATISTIC(NUM_PARTIALLY_VALID_CONDITIONS, "Number of partially valid simplifiable conditions");
+STATISTIC(NUM_HOISTABLE_CONDITIONS, "Number of hoistable conditions");
+STATISTIC(NUM_ALWAYS_TAKEN_CONDITIONS, "Number of always taken conditions");
+STATISTIC(NUM_NEVER_TAKEN_CONDITIONS, "Number of never taken conditions");
+STATISTIC(NUM_FOLDED_CONDITIONS, "Number of folded conditions");
+STATISTIC(NUM_VERSIONED_LOOPS, "Number of loops versioned on valid parameters");
+STATISTIC(NUM_UNSWITCHED_LOOPS, "Number of loops unswitched on hoisted conditions");
+
+static cl::opt<unsigned> PVTVersioningThreshold(
+    "pvt-versioning-threshold", cl::init(100), cl::Hidden,
+    cl::desc("The maximal number of instructions in a loop that is versioned "
+             "by the polyhedral value transformer"));
 
 // ------------------------------------------------------------------------- //
 
 PolyhedralValueTransformer::PolyhedralValueTransformer(
-    PolyhedralValueInfo &PVI, AliasAnalysis &AA, LoopInfo &LI)
-    : PVI(PVI), AA(AA), LI(LI) {}
+    PolyhedralValueInfo &PVI, AliasAnalysis &AA, LoopInfo &LI,
+    DominatorTree &DT)
+    : PVI(PVI), AA(AA), LI(LI), DT(DT) {}
 
 PolyhedralValueTransformer::~PolyhedralValueTransformer() { releaseMemory(); }
 
-bool PolyhedralValueTransformer::hoistConditions(Loop &L) {
-  errs() << "CHECK Loop: " << L.getName() << "\n";
-
-  for (BasicBlock *BB : L.blocks()) {
-    errs() << "  CHECK BB: " << BB->getName() << "\n";
-    TerminatorInst *TI = BB->getTerminator();
-    BranchInst *BI = dyn_cast<BranchInst>(TI);
-    if (!BI || BI->getNumSuccessors() == 1)
-      continue;
-    NUM_CONDITIONS_IN_LOOP++;
-
-    bool IsExit = false, IsLatch = false;
-    if (LI.getLoopFor(BB) != LI.getLoopFor(BI->getSuccessor(0)) ||
-        LI.getLoopFor(BB) != LI.getLoopFor(BI->getSuccessor(1)))
-      IsExit = true;
-    if ((LI.isLoopHeader(BI->getSuccessor(0)) &&
-          LI.getLoopFor(BI->getSuccessor(0))->contains(BB)) ||
-        (LI.isLoopHeader(BI->getSuccessor(1)) &&
-          LI.getLoopFor(BI->getSuccessor(1))->contains(BB)))
-      IsLatch = true;
-
-    NUM_EXIT_CONDITIONS += IsExit;
-    NUM_LATCH_CONDITIONS += IsLatch;
-
-    Value *Condition = BI->getCondition();
-    const PEXP *ConditionPEXP = PVI.getPEXP(Condition, L.getParentLoop());
-    if (!ConditionPEXP || !PVI.isAffine(ConditionPEXP) || !PVI.hasScope(ConditionPEXP, L.getParentLoop(), false))
-      continue;
+/// Return @p Set with @p Dims input dimensions, thus with the missing inner
+/// ones added, or a null set if @p Set has more dimensions.
+static PVSet alignInputDims(PVSet Set, unsigned Dims) {
+  unsigned SetDims = Set.getNumInputDimensions();
+  if (SetDims > Dims)
+    return PVSet();
+  if (SetDims < Dims)
+    Set.addInputDims(Dims - SetDims);
+  return Set;
+}
 
-    const PEXP *DomainPEXP = PVI.getDomainFor(BB, L.getParentLoop());
-    if (!DomainPEXP || !PVI.isAffine(DomainPEXP) || !PVI.hasScope(DomainPEXP, L.getParentLoop(), false))
-      continue;
-    bool ValidCond = PVI.isAlwaysValid(ConditionPEXP);
-    if (ValidCond) {
-      NUM_ALWAYS_VALID_CONDITIONS++;
-    } else {
-      NUM_PARTIALLY_VALID_CONDITIONS++;
-    }
-    bool DomainCond = PVI.isAlwaysValid(DomainPEXP);
-    if (DomainCond) {
-      NUM_ALWAYS_VALID_CONDITION_DOMAINS++;
-    } else {
-      NUM_PARTIALLY_VALID_CONDITION_DOMAINS++;
-    }
+bool PolyhedralValueTransformer::analyzeCondition(Loop &Root, BranchInst &BI,
+                                                  ConditionInfo &CI) {
+  Value *Condition = BI.getCondition();
+  if (isa<Constant>(Condition))
+    return false;
+
+  BasicBlock *BB = BI.getParent();
+  const PEXP *ConditionPEXP = PVI.getPEXP(Condition, nullptr);
+  if (!ConditionPEXP || !PVI.isAffine(ConditionPEXP))
+    return false;
+
+  const PEXP *DomainPEXP = PVI.getDomainFor(BB, nullptr);
+  if (!DomainPEXP || !PVI.isAffine(DomainPEXP))
+    return false;
+
+  // Parameters defined in the loop nest can change during its execution, only
+  // reason about values that are fixed.
+  SmallVector<Value *, 8> Parameters;
+  PVI.getParameters(ConditionPEXP, Parameters);
+  PVI.getParameters(DomainPEXP, Parameters);
+  for (Value *V : Parameters)
+    if (!Root.isLoopInvariant(V))
+      return false;
+
+  unsigned Dims = LI.getLoopDepth(BB);
+  PVSet Domain = alignInputDims(DomainPEXP->getDomain(), Dims);
+  if (!Domain || Domain.isEmpty())
+    return false;
+
+  const PVAff &ConditionPWA = ConditionPEXP->getPWA();
+  PVSet TakenSet = alignInputDims(ConditionPWA.nonZeroSet(), Dims);
+  PVSet NotTakenSet = alignInputDims(ConditionPWA.zeroSet(), Dims);
+  if (!TakenSet || !NotTakenSet)
+    return false;
+  TakenSet.intersect(Domain);
+  NotTakenSet.intersect(Domain);
+
+  // Give up if the condition is not described for all iterations.
+  PVSet UnknownSet = Domain;
+  UnknownSet.subtract(TakenSet);
+  UnknownSet.subtract(NotTakenSet);
+  if (!UnknownSet.isEmpty())
+    return false;
+
+  PVSet InvalidDomain;
+  if (!PVI.isAlwaysValid(ConditionPEXP)) {
+    InvalidDomain =
+        alignInputDims(ConditionPEXP->getInvalidDomain(), Dims);
+    if (!InvalidDomain)
+      return false;
+    InvalidDomain.intersect(Domain);
+  }
+  if (!PVI.isAlwaysValid(DomainPEXP)) {
+    PVSet DomainInvalidDomain =
+        alignInputDims(DomainPEXP->getInvalidDomain(), Dims);
+    if (!DomainInvalidDomain)
+      return false;
+    if (InvalidDomain)
+      InvalidDomain.unify(DomainInvalidDomain);
+    else
+      InvalidDomain = DomainInvalidDomain;
+  }
 
+  CI.BI = &BI;
+  if (InvalidDomain && !InvalidDomain.isEmpty()) {
+    CI.InvalidParameters = InvalidDomain.getParameterSet();
+    if (CI.InvalidParameters.isUniverse())
+      return false;
+  }
 
-    PVAff ConditionPVAff = ConditionPEXP->getPWA();
-    errs() << "VALID CONDITION PVAFF: " << ConditionPVAff << " for : " << *Condition << "\n";
-    errs() << "VALID CONDITION DOMAIN: " << DomainPEXP << " for : " << BB->getName() << "\n";
-    ConditionPVAff.intersectDomain(DomainPEXP->getDomain());
-    errs() << "VALID CONDITION PVAFF: " << ConditionPVAff << " for : " << *Condition << "\n";
-
-    unsigned DepthDiff = LI.getLoopFor(BB)->getLoopDepth() - L.getLoopDepth();
-    ConditionPVAff.dropLastInputDims(DepthDiff + 1);
-    errs() << "WITHOUT LAST " << DepthDiff + 1 << " DIMS: " << ConditionPVAff << "\n";
-
-    PVSet NotTakenConditions = ConditionPVAff.zeroSet();
-    errs() << "NOT TAKEN CONDITIONS " << NotTakenConditions << "\n";
-
-    if (ValidCond && DomainCond) {
-      if (NotTakenConditions.isEmpty()) {
-        NUM_ALWAYS_TAKEN_CONDITIONS++;
-        NUM_ALWAYS_TAKEN_EXIT_CONDITIONS += IsExit;
-        NUM_ALWAYS_TAKEN_LATCH_CONDITIONS += IsLatch;
-      } else if (NotTakenConditions.isUniverse()) {
-        NUM_NEVER_TAKEN_CONDITIONS++;
-        NUM_NEVER_TAKEN_EXIT_CONDITIONS += IsExit;
-        NUM_NEVER_TAKEN_LATCH_CONDITIONS += IsLatch;
-      } else {
-        NUM_HOISTABLE_CONDITIONS++;
-        NUM_HOISTABLE_EXIT_CONDITIONS += IsExit;
-        NUM_HOISTABLE_LATCH_CONDITIONS += IsLatch;
-        BI->getDebugLoc().print(errs());
-      }
-    } else {
-      if (NotTakenConditions.isEmpty()) {
-        NUM_PARTIALLY_ALWAYS_TAKEN_CONDITIONS++;
-        NUM_PARTIALLY_ALWAYS_TAKEN_EXIT_CONDITIONS += IsExit;
-        NUM_PARTIALLY_ALWAYS_TAKEN_LATCH_CONDITIONS += IsLatch;
-      } else if (NotTakenConditions.isUniverse()) {
-        NUM_PARTIALLY_NEVER_TAKEN_CONDITIONS++;
-        NUM_PARTIALLY_NEVER_TAKEN_EXIT_CONDITIONS += IsExit;
-        NUM_PARTIALLY_NEVER_TAKEN_LATCH_CONDITIONS += IsLatch;
-      } else {
-        NUM_PARTIALLY_HOISTABLE_CONDITIONS++;
-        NUM_PARTIALLY_HOISTABLE_EXIT_CONDITIONS += IsExit;
-        NUM_PARTIALLY_HOISTABLE_LATCH_CONDITIONS += IsLatch;
-        BI->getDebugLoc().print(errs());
-      }
-    }
+  if (NotTakenSet.isEmpty()) {
+    CI.Kind = CK_ALWAYS_TAKEN;
+    return true;
   }
 
-  for (Loop *SubL : L)
-    hoistConditions(*SubL);
+  if (TakenSet.isEmpty()) {
+    CI.Kind = CK_NEVER_TAKEN;
+    return true;
+  }
 
-  return false;
+  // Only hoist conditions that are known to be valid and that do not change
+  // during the execution of the loop nest, thus if there are no parameter
+  // values for which the branch is taken in some iterations but not in others.
+  if (CI.InvalidParameters)
+    return false;
+
+  PVSet TakenParameters = TakenSet.getParameterSet();
+  PVSet BothParameters = NotTakenSet.getParameterSet();
+  BothParameters.intersect(TakenParameters);
+  if (!BothParameters.isEmpty())
+    return false;
+
+  CI.Kind = CK_HOISTABLE;
+  CI.TakenParameters = TakenParameters;
+  return true;
 }
 
-bool PolyhedralValueTransformer::hoistConditions() {
-  bool Changed = false;
-
-  for (Loop *L : LI)
-    Changed |= hoistConditions(*L);
-
-  //PVI.print(errs());
+void PolyhedralValueTransformer::foldCondition(BranchInst &BI, bool Taken) {
+  DEBUG(dbgs() << "Fold condition of " << BI << " to " << Taken << "\n");
 
-  return Changed;
-}
-
-static void collectUsers(Instruction *I, Loop &L, SmallPtrSetImpl<Instruction *> &Users) {
-  if (!I || !L.contains(I))
-    return;
-  if (!Users.insert(I).second)
-    return;
-  for (auto *User : I->users())
-    collectUsers(dyn_cast<Instruction>(User), L, Users);
+  // The now dead condition and the unreachable successor are cleaned up by
+  // later passes, e.g., SimplifyCFG, as the polyhedral value information of
+  // this function still refers to them.
+  BI.setCondition(ConstantInt::get(BI.getCondition()->getType(), Taken));
+  NUM_FOLDED_CONDITIONS++;
 }
 
-bool PolyhedralValueTransformer::checkExpressions(Loop &L) {
-
-  DenseMap<Type *, SmallVector<Instruction *, 16>> TypeInstMap;
-  DenseMap<Instruction *, SmallPtrSet<Instruction *, 16>> UserMap;
-  for (BasicBlock *BB : L.blocks()) {
-    if (LI.getLoopFor(BB) != &L)
+bool PolyhedralValueTransformer::versionLoop(Loop &L, const PVSet &CheckSet,
+                                             ValueToValueMapTy &VMap) {
+  BasicBlock *CheckBB = L.getLoopPreheader();
+  BasicBlock *ExitingBB = L.getExitingBlock();
+  BasicBlock *ExitBB = L.getExitBlock();
+  if (!CheckBB || !ExitingBB || !ExitBB || !ExitBB->getSinglePredecessor() ||
+      !L.getSubLoops().empty())
+    return false;
+
+  if (!canBuildParameterSetCondition(CheckSet, &L))
+    return false;
+
+  unsigned NumInstructions = 0;
+  for (BasicBlock *BB : L.blocks())
+    NumInstructions += BB->size();
+  if (NumInstructions > PVTVersioningThreshold)
+    return false;
+
+  DEBUG(dbgs() << "Version loop " << L.getName() << " on " << CheckSet
+               << "\n");
+
+  IRBuilder<> Builder(CheckBB->getTerminator());
+  Value *Check = buildParameterSetCondition(Builder, CheckSet);
+  assert(Check && "Parameter set condition could not be built!");
+
+  SmallVector<Instruction *, 8> DefsUsedOutside = findDefsUsedOutsideOfLoop(&L);
+
+  // Create an empty preheader for the loop and, after cloning, for the copy.
+  BasicBlock *PH = SplitBlock(CheckBB, CheckBB->getTerminator(), &DT, &LI);
+  PH->setName(L.getHeader()->getName() + ".ph");
+
+  SmallVector<BasicBlock *, 8> ClonedBlocks;
+  Loop *ClonedLoop = cloneLoopWithPreheader(PH, CheckBB, &L, VMap, ".pvt", &LI,
+                                            &DT, ClonedBlocks);
+  remapInstructionsInBlocks(ClonedBlocks, VMap);
+
+  Instruction *OrigTerm = CheckBB->getTerminator();
+  BranchInst::Create(ClonedLoop->getLoopPreheader(), L.getLoopPreheader(),
+                     Check, OrigTerm);
+  OrigTerm->eraseFromParent();
+
+  // The loops merge in the original exit block which is now dominated by the
+  // check block.
+  DT.changeImmediateDominator(ExitBB, CheckBB);
+
+  // Make sure all values defined in the loop and used outside are routed
+  // through a PHI in the exit block, then add the values of the copy.
+  PHINode *PN;
+  for (Instruction *Inst : DefsUsedOutside) {
+    for (auto I = ExitBB->begin(); (PN = dyn_cast<PHINode>(I)); ++I)
+      if (PN->getIncomingValue(0) == Inst)
+        break;
+    if (PN)
       continue;
-    for (auto &Inst : *BB)
-      if (Inst.getType()->isIntegerTy() || Inst.getType()->isPointerTy()) {
-        TypeInstMap[Inst.getType()].push_back(&Inst);
-        collectUsers(&Inst, L, UserMap[&Inst]);
-      }
-  }
 
-  for (auto &It : TypeInstMap) {
-    auto &Insts = It.second;
-    unsigned NumEntries = Insts.size();
-    errs() << "\nTYPE: " << *It.first << " [#" << NumEntries << "]\n";
-    for (unsigned u0 = 0; u0 < NumEntries; u0++) {
-      Instruction *I0 = Insts[u0];
-      const PEXP *I0PEXP = nullptr;
-      for (unsigned u1 = u0 + 1; u1 < NumEntries; u1++) {
-        Instruction *I1 = Insts[u1];
-        if (UserMap[I0].count(I1) || UserMap[I1].count(I0))
-          continue;
-        if (!I0PEXP) {
-          I0PEXP = PVI.getPEXP(I0, L.getParentLoop());
-          if (!(I0PEXP && PVI.isAffine(I0PEXP) &&// PVI.isAlwaysValid(I0PEXP) &&
-              PVI.hasScope(I0PEXP, L.getParentLoop(), false)))
-            break;
-        }
-        const PEXP *I1PEXP = PVI.getPEXP(I1, L.getParentLoop());
-        if (!(I1PEXP && PVI.isAffine(I1PEXP) && //PVI.isAlwaysValid(I1PEXP) &&
-            PVI.hasScope(I1PEXP, L.getParentLoop(), false)))
-          continue;
-        PVAff DiffAff = PVAff::createSub(I0PEXP->getPWA(), I1PEXP->getPWA());
-        DiffAff.dropUnusedParameters();
-        bool IsInt = DiffAff.isInteger();
-        bool IsCst = DiffAff.isConstant();
-        errs() << "\t Inst0: " << *I0 << "\n\t Inst1: " << *I1 << "\n";
-        errs() << "\t PEXP0: " << I0PEXP << "\n\t PEXP1: " << I1PEXP << "\n";
-        errs() << "\t Stats: [C: " << IsCst << "][I: " << IsInt << "][P: " << DiffAff.getNumParameters() << "]";
-        unsigned InvolvedDims = 0;
-        for (unsigned d = 0; d < DiffAff.getNumInputDimensions(); d++) {
-          bool InvolvesDim = DiffAff.involvesInput(d);
-          errs() << "[ID L" << d << ": " << InvolvesDim << "]";
-          InvolvedDims += InvolvesDim;
-        }
-        if (IsInt || (InvolvedDims == 1 && DiffAff.getNumParameters() == 0))
-          errs() << "\n\tGOOD DIFF: " << DiffAff << "!\n\n";
-        else
-          errs() << "\n\t Diff: " << DiffAff << "\n\n";
-
-        NUM_INT_DIFF += IsInt;
-        NUM_CST_DIFF += IsCst;
-        NUM_ONE_LOOP_DIFF += (InvolvedDims == 1 && DiffAff.getNumParameters() == 0);
-        NUM_ONE_LOOP_DIFF_ONE_PARAM += (InvolvedDims == 1 && DiffAff.getNumParameters() == 1);
-
-      }
-    }
+    PN = PHINode::Create(Inst->getType(), 2, Inst->getName() + ".pvt.lcssa",
+                         &ExitBB->front());
+    for (auto *User : Inst->users())
+      if (!L.contains(cast<Instruction>(User)->getParent()))
+        User->replaceUsesOfWith(Inst, PN);
+    PN->addIncoming(Inst, ExitingBB);
   }
 
-  for (Loop *SubL : L)
-    checkExpressions(*SubL);
+  BasicBlock *ClonedExitingBB = cast<BasicBlock>(VMap[ExitingBB]);
+  for (auto I = ExitBB->begin(); (PN = dyn_cast<PHINode>(I)); ++I) {
+    Value *Incoming = PN->getIncomingValue(0);
+    auto Mapped = VMap.find(Incoming);
+    if (Mapped != VMap.end())
+      Incoming = Mapped->second;
+    PN->addIncoming(Incoming, ClonedExitingBB);
+  }
 
-  return false;
+  return true;
 }
 
-bool PolyhedralValueTransformer::checkExpressions() {
+bool PolyhedralValueTransformer::transformConditions(
+    Loop &L, ArrayRef<ConditionInfo> CIs) {
   bool Changed = false;
 
-  for (Loop *L : LI)
-    Changed |= checkExpressions(*L);
+  // Conditions that are always valid are folded in place, also before
+  // versioning to simplify both copies.
+  PVSet InvalidParameters;
+  for (const ConditionInfo &CI : CIs) {
+    if (CI.Kind == CK_HOISTABLE)
+      continue;
+    if (!CI.InvalidParameters) {
+      foldCondition(*CI.BI, CI.Kind == CK_ALWAYS_TAKEN);
+      Changed = true;
+    } else if (InvalidParameters) {
+      InvalidParameters.unify(CI.InvalidParameters);
+    } else {
+      InvalidParameters = CI.InvalidParameters;
+    }
+  }
 
-  //PVI.print(errs());
+  // We version each loop at most once, preferably to fold the partially valid
+  // conditions in the original loop while the copy is executed for the
+  // invalid parameter values.
+  ValueToValueMapTy VMap;
+  if (InvalidParameters && versionLoop(L, InvalidParameters, VMap)) {
+    for (const ConditionInfo &CI : CIs)
+      if (CI.Kind != CK_HOISTABLE && CI.InvalidParameters)
+        foldCondition(*CI.BI, CI.Kind == CK_ALWAYS_TAKEN);
+    NUM_VERSIONED_LOOPS++;
+    return true;
+  }
+
+  // Otherwise unswitch the first hoistable condition, the copy is executed if
+  // it is taken, the original loop if it is not.
+  for (const ConditionInfo &CI : CIs) {
+    if (CI.Kind != CK_HOISTABLE)
+      continue;
+    if (!versionLoop(L, CI.TakenParameters, VMap))
+      continue;
+    foldCondition(*cast<BranchInst>(VMap[CI.BI]), true);
+    foldCondition(*CI.BI, false);
+    NUM_UNSWITCHED_LOOPS++;
+    return true;
+  }
 
   return Changed;
 }
 
-bool PolyhedralValueTransformer::checkLoopIdioms(Loop &L) {
-  const DataLayout &DL = L.getHeader()->getModule()->getDataLayout();
-  AliasSetTracker AST(AA);
-
-  DenseMap<Value *, SmallPtrSet<StoreInst *, 8>> Obj2StoresMap;
-  for (BasicBlock *BB : L.blocks()) {
-    for (Instruction &I : *BB) {
-      if (I.mayThrow()) {
-        errs() << "may throw: " << I << "\n";
-        return false;
-      }
-      if (!I.mayReadOrWriteMemory())
+bool PolyhedralValueTransformer::hoistConditions() {
+  // Analyze all conditions before the function is changed as the polyhedral
+  // representations are not updated by the transformations.
+  SmallVector<std::pair<Loop *, SmallVector<ConditionInfo, 4>>, 8> Worklist;
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    Loop *Root = L;
+    while (Root->getParentLoop())
+      Root = Root->getParentLoop();
+
+    SmallVector<ConditionInfo, 4> CIs;
+    for (BasicBlock *BB : L->blocks()) {
+      if (LI.getLoopFor(BB) != L)
         continue;
 
-      AST.add(&I);
-
-      StoreInst *SI = dyn_cast<StoreInst>(&I);
-      if (!SI || !SI->isUnordered() || SI->isVolatile())
+      auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+      if (!BI || BI->isUnconditional())
         continue;
-      if (SI->getMetadata(LLVMContext::MD_nontemporal))
+      NUM_CONDITIONS_IN_LOOP++;
+
+      bool IsExit = !L->contains(BI->getSuccessor(0)) ||
+                    !L->contains(BI->getSuccessor(1));
+      bool IsLatch = L->isLoopLatch(BB);
+      NUM_EXIT_CONDITIONS += IsExit;
+      NUM_LATCH_CONDITIONS += IsLatch;
+
+      ConditionInfo CI;
+      if (!analyzeCondition(*Root, *BI, CI))
         continue;
 
-      Value *Ptr = SI->getPointerOperand();
-      errs() << " Ptr: " << *Ptr << "\n";
-      Value *Obj = GetUnderlyingObject(Ptr, DL, 10);
-      errs() << " Obj: " << *Obj << "\n";
-      Obj2StoresMap[Obj].insert(SI);
+      DEBUG(dbgs() << "Condition of " << *BI << " [" << BB->getName()
+                   << "] is "
+                   << (CI.Kind == CK_ALWAYS_TAKEN
+                           ? "always taken"
+                           : CI.Kind == CK_NEVER_TAKEN ? "never taken"
+                                                       : "hoistable")
+                   << "\n");
+      if (CI.InvalidParameters)
+        NUM_PARTIALLY_VALID_CONDITIONS++;
+      else
+        NUM_ALWAYS_VALID_CONDITIONS++;
+      NUM_ALWAYS_TAKEN_CONDITIONS += CI.Kind == CK_ALWAYS_TAKEN;
+      NUM_NEVER_TAKEN_CONDITIONS += CI.Kind == CK_NEVER_TAKEN;
+      NUM_HOISTABLE_CONDITIONS += CI.Kind == CK_HOISTABLE;
+
+      CIs.push_back(CI);
     }
-  }
 
-  errs() << " Objects:\n";
-  for (auto &It : Obj2StoresMap) {
-    errs() << " - " << *It.first << " #" << It.second.size() << " stores\n";
-    AAMDNodes AATags;
-    AliasSet *AS = AST.getAliasSetForPointerIfExists(
-        It.first, MemoryLocation::UnknownSize, AATags);
-    if (!AS)
-      continue;
-    errs() << "AliasSet: "; AS->dump();
-    for (auto &ASIt : *AS) {
-      errs() << "\n - " << *ASIt.getValue() << "";
-    }
+    if (!CIs.empty())
+      Worklist.push_back({L, std::move(CIs)});
   }
 
-  for (Loop *SubL : L)
-    checkLoopIdioms(*SubL);
-}
-
-bool PolyhedralValueTransformer::checkLoopIdioms() {
   bool Changed = false;
-
-  for (Loop *L : LI)
-    Changed |= checkLoopIdioms(*L);
+  for (auto &It : Worklist)
+    Changed |= transformConditions(*It.first, It.second);
 
   return Changed;
 }
 
-
 void PolyhedralValueTransformer::releaseMemory() {}
 
 void PolyhedralValueTransformer::print(raw_ostream &OS) const {
@@ -345,7 +382,9 @@ void PolyhedralValueTransformerWrapperPass::getAnalysisUsage(
   AU.addRequired<PolyhedralValueInfoWrapperPass>();
   AU.addRequired<AAResultsWrapperPass>();
   AU.addRequired<LoopInfoWrapperPass>();
-  AU.setPreservesAll();
+  AU.addRequired<DominatorTreeWrapperPass>();
+  AU.addPreserved<LoopInfoWrapperPass>();
+  AU.addPreserved<DominatorTreeWrapperPass>();
 }
 
 void PolyhedralValueTransformerWrapperPass::releaseMemory() {
@@ -356,24 +395,24 @@ void PolyhedralValueTransformerWrapperPass::releaseMemory() {
 }
 
 bool PolyhedralValueTransformerWrapperPass::runOnFunction(Function &F) {
-  F.dump();
+  if (skipFunction(F))
+    return false;
 
   AliasAnalysis &AA = getAnalysis<AAResultsWrapperPass>().getAAResults();
   auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   auto &PVI = getAnalysis<PolyhedralValueInfoWrapperPass>()
                   .getPolyhedralValueInfo();
-  PVT = new PolyhedralValueTransformer(PVI, AA, LI);
-  //PVT->hoistConditions();
-  //PVT->checkExpressions();
-  PVT->checkLoopIdioms();
+  PVT = new PolyhedralValueTransformer(PVI, AA, LI, DT);
 
   this->F = &F;
-  return false;
+  return PVT->hoistConditions();
 }
 
 void PolyhedralValueTransformerWrapperPass::print(raw_ostream &OS,
                                                   const Module *M) const {
-  PVT->print(OS);
+  if (PVT)
+    PVT->print(OS);
 }
 
 FunctionPass *llvm::createPolyhedralValueTransformerWrapperPass() {
@@ -389,8 +428,29 @@ void PolyhedralValueTransformerWrapperPass::dump() const {
 INITIALIZE_PASS_BEGIN(PolyhedralValueTransformerWrapperPass,
                       "polyhedral-value-transformer", "Polyhedral vt", false,
                       false);
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass);
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass);
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass);
 INITIALIZE_PASS_DEPENDENCY(PolyhedralValueInfoWrapperPass);
 INITIALIZE_PASS_END(PolyhedralValueTransformerWrapperPass,
                     "polyhedral-value-transformer", "Polyhedral vt", false,
                     false)
+
+// ------------------------------------------------------------------------- //
+
+PreservedAnalyses
+PolyhedralValueTransformerPass::run(Function &F, FunctionAnalysisManager &AM) {
+  auto &AA = AM.getResult<AAManager>(F);
+  auto &LI = AM.getResult<LoopAnalysis>(F);
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &PVI = AM.getResult<PolyhedralValueInfoAnalysis>(F);
+
+  PolyhedralValueTransformer PVT(PVI, AA, LI, DT);
+  if (!PVT.hoistConditions())
+    return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserve<LoopAnalysis>();
+  PA.preserve<DominatorTreeAnalysis>();
+  return PA;
+}
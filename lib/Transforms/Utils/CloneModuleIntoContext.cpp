@@ -0,0 +1,1032 @@
+//===- CloneModuleIntoContext.cpp - Clone a module into another context ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the CloneModuleIntoContext interface which makes a copy
+// of an entire module in a different LLVMContext.
+//
+// The ValueMapper based cloning cannot be used across contexts as it keeps
+// everything that is not remapped (types, constants, metadata strings, ...)
+// as is. Instead, every type, constant, metadata node and attribute is
+// re-created in the destination context here. The source module is only read,
+// thus several modules that share a context can be cloned concurrently as long
+// as no other thread modifies that context in the meantime.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+using namespace llvm;
+
+namespace {
+
+/// Helper to copy a module into another context.
+class ContextModuleCloner {
+  const Module &SrcM;
+  LLVMContext &Ctx;
+  std::unique_ptr<Module> DstM;
+
+  /// Map from source to destination types.
+  DenseMap<Type *, Type *> TypeMap;
+
+  /// Map from source to destination values (globals, arguments, basic blocks,
+  /// instructions and constants).
+  DenseMap<const Value *, Value *> ValueMap;
+
+  /// Map from source to destination metadata.
+  DenseMap<const Metadata *, Metadata *> MDMap;
+
+  /// Temporary nodes that stand in for nodes which are currently mapped and
+  /// referenced from one of their (transitive) operands. A null entry marks a
+  /// node in progress that was not referenced recursively (yet).
+  DenseMap<const MDNode *, MDNode *> PendingNodes;
+
+  /// Uniqued nodes that were created unresolved, i.e., part of a cycle.
+  SmallVector<MDNode *, 8> UnresolvedNodes;
+
+  /// Placeholders for instructions used before they are defined, which can
+  /// only happen in unreachable code.
+  DenseMap<const Value *, Value *> ForwardRefs;
+
+  /// Map from source metadata kind IDs to destination kind IDs.
+  SmallVector<unsigned, 32> MDKindMap;
+
+  /// Map from source synchronization scope IDs to destination scope IDs.
+  SmallVector<SyncScope::ID, 4> SyncScopeMap;
+
+  Type *mapType(Type *Ty);
+
+  Value *mapValue(const Value *V);
+  Constant *mapConstant(const Constant *C);
+  BasicBlock *mapBlock(const BasicBlock *BB) {
+    return BB ? cast<BasicBlock>(ValueMap.lookup(BB)) : nullptr;
+  }
+
+  Metadata *mapMetadata(const Metadata *MD);
+  MDNode *mapNode(const MDNode *N) {
+    return cast_or_null<MDNode>(mapMetadata(N));
+  }
+  MDString *mapString(const MDString *S) {
+    return cast_or_null<MDString>(mapMetadata(S));
+  }
+  MDNode *createNode(const MDNode &N);
+
+  AttributeSet mapAttributeSet(AttributeSet AS);
+  AttributeList mapAttributeList(AttributeList AL);
+
+  SyncScope::ID mapSyncScope(SyncScope::ID SSID) { return SyncScopeMap[SSID]; }
+
+  void copyGlobalValueProperties(GlobalValue &Dst, const GlobalValue &Src);
+  void copyGlobalObjectMetadata(GlobalObject &Dst, const GlobalObject &Src);
+
+  void declareGlobals();
+  void defineGlobals();
+
+  void cloneFunctionBody(const Function &SrcF);
+  Instruction *cloneInstruction(const Instruction &I);
+  void mapOperandBundles(ImmutableCallSite CS,
+                         SmallVectorImpl<OperandBundleDef> &Bundles);
+
+public:
+  ContextModuleCloner(const Module &SrcM, LLVMContext &Ctx)
+      : SrcM(SrcM), Ctx(Ctx) {}
+
+  std::unique_ptr<Module> run();
+};
+
+} // end anonymous namespace
+
+Type *ContextModuleCloner::mapType(Type *Ty) {
+  Type *&Entry = TypeMap[Ty];
+  if (Entry)
+    return Entry;
+
+  Type *NewTy = nullptr;
+  switch (Ty->getTypeID()) {
+  case Type::IntegerTyID:
+    NewTy = IntegerType::get(Ctx, cast<IntegerType>(Ty)->getBitWidth());
+    break;
+  case Type::FunctionTyID: {
+    auto *FTy = cast<FunctionType>(Ty);
+    SmallVector<Type *, 8> Params;
+    for (Type *ParamTy : FTy->params())
+      Params.push_back(mapType(ParamTy));
+    NewTy = FunctionType::get(mapType(FTy->getReturnType()), Params,
+                              FTy->isVarArg());
+    break;
+  }
+  case Type::StructTyID: {
+    auto *STy = cast<StructType>(Ty);
+    if (STy->isLiteral()) {
+      SmallVector<Type *, 8> Elements;
+      for (Type *ElementTy : STy->elements())
+        Elements.push_back(mapType(ElementTy));
+      NewTy = StructType::get(Ctx, Elements, STy->isPacked());
+      break;
+    }
+
+    // Register identified structs before their body is mapped as they can be
+    // recursive.
+    StructType *NewSTy = STy->hasName()
+                             ? StructType::create(Ctx, STy->getName())
+                             : StructType::create(Ctx);
+    TypeMap[Ty] = NewSTy;
+    if (!STy->isOpaque()) {
+      SmallVector<Type *, 8> Elements;
+      for (Type *ElementTy : STy->elements())
+        Elements.push_back(mapType(ElementTy));
+      NewSTy->setBody(Elements, STy->isPacked());
+    }
+    return NewSTy;
+  }
+  case Type::ArrayTyID:
+    NewTy = ArrayType::get(mapType(Ty->getArrayElementType()),
+                           Ty->getArrayNumElements());
+    break;
+  case Type::PointerTyID:
+    NewTy = PointerType::get(mapType(Ty->getPointerElementType()),
+                             Ty->getPointerAddressSpace());
+    break;
+  case Type::VectorTyID:
+    NewTy = VectorType::get(mapType(Ty->getVectorElementType()),
+                            Ty->getVectorNumElements());
+    break;
+  default:
+    NewTy = Type::getPrimitiveType(Ctx, Ty->getTypeID());
+    break;
+  }
+
+  // The recursive calls above might have grown the map.
+  return TypeMap[Ty] = NewTy;
+}
+
+AttributeSet ContextModuleCloner::mapAttributeSet(AttributeSet AS) {
+  if (!AS.hasAttributes())
+    return AttributeSet();
+
+  SmallVector<Attribute, 8> Attrs;
+  for (Attribute A : AS) {
+    if (A.isStringAttribute())
+      Attrs.push_back(
+          Attribute::get(Ctx, A.getKindAsString(), A.getValueAsString()));
+    else if (A.isIntAttribute())
+      Attrs.push_back(
+          Attribute::get(Ctx, A.getKindAsEnum(), A.getValueAsInt()));
+    else
+      Attrs.push_back(Attribute::get(Ctx, A.getKindAsEnum()));
+  }
+  return AttributeSet::get(Ctx, Attrs);
+}
+
+AttributeList ContextModuleCloner::mapAttributeList(AttributeList AL) {
+  SmallVector<std::pair<unsigned, AttributeSet>, 8> Sets;
+  for (unsigned I = AL.index_begin(), E = AL.index_end(); I != E; ++I) {
+    AttributeSet AS = AL.getAttributes(I);
+    if (AS.hasAttributes())
+      Sets.push_back({I, mapAttributeSet(AS)});
+  }
+  return AttributeList::get(Ctx, Sets);
+}
+
+/// Copy the elements of @p CDS, which are of type @p T.
+template <typename T>
+static SmallVector<T, 16> getElements(const ConstantDataSequential *CDS) {
+  StringRef Data = CDS->getRawDataValues();
+  SmallVector<T, 16> Elements(CDS->getNumElements());
+  assert(Data.size() == Elements.size() * sizeof(T));
+  memcpy(Elements.data(), Data.data(), Data.size());
+  return Elements;
+}
+
+/// Re-create the integer ConstantDataSequential @p CDS in @p Ctx.
+template <typename T>
+static Constant *mapIntegerData(LLVMContext &Ctx,
+                                const ConstantDataSequential *CDS) {
+  SmallVector<T, 16> Elements = getElements<T>(CDS);
+  if (isa<ConstantDataArray>(CDS))
+    return ConstantDataArray::get(Ctx, Elements);
+  return ConstantDataVector::get(Ctx, Elements);
+}
+
+/// Re-create the floating point ConstantDataSequential @p CDS in @p Ctx.
+template <typename T>
+static Constant *mapFPData(LLVMContext &Ctx,
+                           const ConstantDataSequential *CDS) {
+  SmallVector<T, 16> Elements = getElements<T>(CDS);
+  if (isa<ConstantDataArray>(CDS))
+    return ConstantDataArray::getFP(Ctx, Elements);
+  return ConstantDataVector::getFP(Ctx, Elements);
+}
+
+Constant *ContextModuleCloner::mapConstant(const Constant *C) {
+  return cast_or_null<Constant>(mapValue(C));
+}
+
+Value *ContextModuleCloner::mapValue(const Value *V) {
+  if (!V)
+    return nullptr;
+
+  if (Value *NewV = ValueMap.lookup(V))
+    return NewV;
+
+  if (auto *MAV = dyn_cast<MetadataAsValue>(V))
+    return MetadataAsValue::get(Ctx, mapMetadata(MAV->getMetadata()));
+
+  if (auto *IA = dyn_cast<InlineAsm>(V))
+    return ValueMap[V] = InlineAsm::get(
+               cast<FunctionType>(mapType(IA->getFunctionType())),
+               IA->getAsmString(), IA->getConstraintString(),
+               IA->hasSideEffects(), IA->isAlignStack(), IA->getDialect());
+
+  // Instructions that are used before they are defined get a placeholder that
+  // is replaced once the instruction is cloned.
+  if (isa<Instruction>(V)) {
+    Value *&Placeholder = ForwardRefs[V];
+    if (!Placeholder)
+      Placeholder = new Argument(mapType(V->getType()));
+    return Placeholder;
+  }
+
+  // All global values, arguments and blocks are created up front.
+  auto *C = cast<Constant>(V);
+  assert(!isa<GlobalValue>(C) && "Global value was not declared");
+
+  Constant *NewC = nullptr;
+  Type *NewTy = mapType(C->getType());
+  if (auto *CI = dyn_cast<ConstantInt>(C)) {
+    NewC = ConstantInt::get(Ctx, CI->getValue());
+  } else if (auto *CFP = dyn_cast<ConstantFP>(C)) {
+    NewC = ConstantFP::get(Ctx, CFP->getValueAPF());
+  } else if (isa<ConstantPointerNull>(C)) {
+    NewC = ConstantPointerNull::get(cast<PointerType>(NewTy));
+  } else if (isa<UndefValue>(C)) {
+    NewC = UndefValue::get(NewTy);
+  } else if (isa<ConstantAggregateZero>(C)) {
+    NewC = ConstantAggregateZero::get(NewTy);
+  } else if (isa<ConstantTokenNone>(C)) {
+    NewC = ConstantTokenNone::get(Ctx);
+  } else if (auto *CDS = dyn_cast<ConstantDataSequential>(C)) {
+    Type *ElementTy = CDS->getElementType();
+    if (ElementTy->isHalfTy())
+      NewC = mapFPData<uint16_t>(Ctx, CDS);
+    else if (ElementTy->isFloatTy())
+      NewC = mapFPData<uint32_t>(Ctx, CDS);
+    else if (ElementTy->isDoubleTy())
+      NewC = mapFPData<uint64_t>(Ctx, CDS);
+    else if (ElementTy->isIntegerTy(8))
+      NewC = mapIntegerData<uint8_t>(Ctx, CDS);
+    else if (ElementTy->isIntegerTy(16))
+      NewC = mapIntegerData<uint16_t>(Ctx, CDS);
+    else if (ElementTy->isIntegerTy(32))
+      NewC = mapIntegerData<uint32_t>(Ctx, CDS);
+    else
+      NewC = mapIntegerData<uint64_t>(Ctx, CDS);
+  } else if (auto *BA = dyn_cast<BlockAddress>(C)) {
+    NewC = BlockAddress::get(cast<Function>(mapValue(BA->getFunction())),
+                             mapBlock(BA->getBasicBlock()));
+  } else {
+    SmallVector<Constant *, 8> Ops;
+    for (const Use &Op : C->operands())
+      Ops.push_back(mapConstant(cast<Constant>(Op)));
+
+    if (isa<ConstantArray>(C))
+      NewC = ConstantArray::get(cast<ArrayType>(NewTy), Ops);
+    else if (isa<ConstantStruct>(C))
+      NewC = ConstantStruct::get(cast<StructType>(NewTy), Ops);
+    else if (isa<ConstantVector>(C))
+      NewC = ConstantVector::get(Ops);
+    else if (auto *CE = dyn_cast<ConstantExpr>(C)) {
+      Type *SrcElementTy = nullptr;
+      if (auto *GEPO = dyn_cast<GEPOperator>(CE))
+        SrcElementTy = mapType(GEPO->getSourceElementType());
+      NewC = CE->getWithOperands(Ops, NewTy, false, SrcElementTy);
+    } else
+      llvm_unreachable("Unknown constant kind");
+  }
+
+  return ValueMap[V] = NewC;
+}
+
+Metadata *ContextModuleCloner::mapMetadata(const Metadata *MD) {
+  if (!MD)
+    return nullptr;
+
+  if (Metadata *NewMD = MDMap.lookup(MD))
+    return NewMD;
+
+  if (auto *S = dyn_cast<MDString>(MD))
+    return MDMap[MD] = MDString::get(Ctx, S->getString());
+  if (auto *CAM = dyn_cast<ConstantAsMetadata>(MD))
+    return MDMap[MD] = ConstantAsMetadata::get(mapConstant(CAM->getValue()));
+  if (auto *LAM = dyn_cast<LocalAsMetadata>(MD))
+    return LocalAsMetadata::get(mapValue(LAM->getValue()));
+
+  // A node that is referenced by one of its own operands is represented by a
+  // temporary node until it is created.
+  auto *N = cast<MDNode>(MD);
+  auto PendingIt = PendingNodes.find(N);
+  if (PendingIt != PendingNodes.end()) {
+    if (!PendingIt->second)
+      PendingIt->second = MDTuple::getTemporary(Ctx, None).release();
+    return PendingIt->second;
+  }
+
+  PendingNodes[N] = nullptr;
+  MDNode *NewN = createNode(*N);
+  MDNode *Temp = PendingNodes.lookup(N);
+  PendingNodes.erase(N);
+  if (Temp) {
+    Temp->replaceAllUsesWith(NewN);
+    MDNode::deleteTemporary(Temp);
+  }
+  if (NewN->isUniqued() && !NewN->isResolved())
+    UnresolvedNodes.push_back(NewN);
+
+  return MDMap[MD] = NewN;
+}
+
+#define GET_OR_DISTINCT(CLASS, ARGS)                                           \
+  (N.isDistinct() ? CLASS::getDistinct ARGS : CLASS::get ARGS)
+
+MDNode *ContextModuleCloner::createNode(const MDNode &N) {
+  switch (N.getMetadataID()) {
+  case Metadata::MDTupleKind: {
+    SmallVector<Metadata *, 8> Ops;
+    for (const MDOperand &Op : N.operands())
+      Ops.push_back(mapMetadata(Op));
+    return GET_OR_DISTINCT(MDTuple, (Ctx, Ops));
+  }
+  case Metadata::DILocationKind: {
+    auto &L = cast<DILocation>(N);
+    return GET_OR_DISTINCT(DILocation,
+                           (Ctx, L.getLine(), L.getColumn(),
+                            mapMetadata(L.getRawScope()),
+                            mapMetadata(L.getRawInlinedAt())));
+  }
+  case Metadata::DIExpressionKind:
+    return GET_OR_DISTINCT(DIExpression,
+                           (Ctx, cast<DIExpression>(N).getElements()));
+  case Metadata::DIGlobalVariableExpressionKind: {
+    auto &GVE = cast<DIGlobalVariableExpression>(N);
+    return GET_OR_DISTINCT(DIGlobalVariableExpression,
+                           (Ctx, mapMetadata(GVE.getRawVariable()),
+                            mapMetadata(GVE.getRawExpression())));
+  }
+  case Metadata::GenericDINodeKind: {
+    auto &GN = cast<GenericDINode>(N);
+    SmallVector<Metadata *, 8> Ops;
+    for (const MDOperand &Op : GN.dwarf_operands())
+      Ops.push_back(mapMetadata(Op));
+    return GET_OR_DISTINCT(GenericDINode, (Ctx, GN.getTag(),
+                                           mapString(GN.getRawHeader()), Ops));
+  }
+  case Metadata::DISubrangeKind: {
+    auto &SR = cast<DISubrange>(N);
+    return GET_OR_DISTINCT(DISubrange,
+                           (Ctx, SR.getCount(), SR.getLowerBound()));
+  }
+  case Metadata::DIEnumeratorKind: {
+    auto &E = cast<DIEnumerator>(N);
+    return GET_OR_DISTINCT(DIEnumerator,
+                           (Ctx, E.getValue(), mapString(E.getRawName())));
+  }
+  case Metadata::DIBasicTypeKind: {
+    auto &T = cast<DIBasicType>(N);
+    return GET_OR_DISTINCT(DIBasicType,
+                           (Ctx, T.getTag(), mapString(T.getRawName()),
+                            T.getSizeInBits(), T.getAlignInBits(),
+                            T.getEncoding()));
+  }
+  case Metadata::DIDerivedTypeKind: {
+    auto &T = cast<DIDerivedType>(N);
+    return GET_OR_DISTINCT(
+        DIDerivedType,
+        (Ctx, T.getTag(), mapString(T.getRawName()),
+         mapMetadata(T.getRawFile()), T.getLine(),
+         mapMetadata(T.getRawScope()), mapMetadata(T.getRawBaseType()),
+         T.getSizeInBits(), T.getAlignInBits(), T.getOffsetInBits(),
+         T.getDWARFAddressSpace(), T.getFlags(),
+         mapMetadata(T.getRawExtraData())));
+  }
+  case Metadata::DICompositeTypeKind: {
+    auto &T = cast<DICompositeType>(N);
+    // Like the bitcode reader, share the types with an identifier with the
+    // other modules of a context that uniques them by ODR.
+    if (MDString *Identifier = mapString(T.getRawIdentifier())) {
+      DICompositeType *CT =
+          DICompositeType::getODRTypeIfExists(Ctx, *Identifier);
+      if (CT && !CT->isForwardDecl())
+        return CT;
+      CT = DICompositeType::buildODRType(
+          Ctx, *Identifier, T.getTag(), mapString(T.getRawName()),
+          mapMetadata(T.getRawFile()), T.getLine(),
+          mapMetadata(T.getRawScope()), mapMetadata(T.getRawBaseType()),
+          T.getSizeInBits(), T.getAlignInBits(), T.getOffsetInBits(),
+          T.getFlags(), mapMetadata(T.getRawElements()), T.getRuntimeLang(),
+          mapMetadata(T.getRawVTableHolder()),
+          mapMetadata(T.getRawTemplateParams()));
+      if (CT)
+        return CT;
+    }
+    return GET_OR_DISTINCT(
+        DICompositeType,
+        (Ctx, T.getTag(), mapString(T.getRawName()),
+         mapMetadata(T.getRawFile()), T.getLine(),
+         mapMetadata(T.getRawScope()), mapMetadata(T.getRawBaseType()),
+         T.getSizeInBits(), T.getAlignInBits(), T.getOffsetInBits(),
+         T.getFlags(), mapMetadata(T.getRawElements()), T.getRuntimeLang(),
+         mapMetadata(T.getRawVTableHolder()),
+         mapMetadata(T.getRawTemplateParams()),
+         mapString(T.getRawIdentifier())));
+  }
+  case Metadata::DISubroutineTypeKind: {
+    auto &T = cast<DISubroutineType>(N);
+    return GET_OR_DISTINCT(DISubroutineType,
+                           (Ctx, T.getFlags(), T.getCC(),
+                            mapMetadata(T.getRawTypeArray())));
+  }
+  case Metadata::DIFileKind: {
+    auto &F = cast<DIFile>(N);
+    return GET_OR_DISTINCT(DIFile, (Ctx, mapString(F.getRawFilename()),
+                                    mapString(F.getRawDirectory()),
+                                    F.getChecksumKind(),
+                                    mapString(F.getRawChecksum())));
+  }
+  case Metadata::DICompileUnitKind: {
+    auto &CU = cast<DICompileUnit>(N);
+    return DICompileUnit::getDistinct(
+        Ctx, CU.getSourceLanguage(), mapMetadata(CU.getRawFile()),
+        mapString(CU.getRawProducer()), CU.isOptimized(),
+        mapString(CU.getRawFlags()), CU.getRuntimeVersion(),
+        mapString(CU.getRawSplitDebugFilename()), CU.getEmissionKind(),
+        mapMetadata(CU.getRawEnumTypes()),
+        mapMetadata(CU.getRawRetainedTypes()),
+        mapMetadata(CU.getRawGlobalVariables()),
+        mapMetadata(CU.getRawImportedEntities()),
+        mapMetadata(CU.getRawMacros()), CU.getDWOId(),
+        CU.getSplitDebugInlining(), CU.getDebugInfoForProfiling(),
+        CU.getGnuPubnames());
+  }
+  case Metadata::DISubprogramKind: {
+    auto &SP = cast<DISubprogram>(N);
+    return GET_OR_DISTINCT(
+        DISubprogram,
+        (Ctx, mapMetadata(SP.getRawScope()), mapString(SP.getRawName()),
+         mapString(SP.getRawLinkageName()), mapMetadata(SP.getRawFile()),
+         SP.getLine(), mapMetadata(SP.getRawType()), SP.isLocalToUnit(),
+         SP.isDefinition(), SP.getScopeLine(),
+         mapMetadata(SP.getRawContainingType()), SP.getVirtuality(),
+         SP.getVirtualIndex(), SP.getThisAdjustment(), SP.getFlags(),
+         SP.isOptimized(), mapMetadata(SP.getRawUnit()),
+         mapMetadata(SP.getRawTemplateParams()),
+         mapMetadata(SP.getRawDeclaration()),
+         mapMetadata(SP.getRawVariables()),
+         mapMetadata(SP.getRawThrownTypes())));
+  }
+  case Metadata::DILexicalBlockKind: {
+    auto &LB = cast<DILexicalBlock>(N);
+    return GET_OR_DISTINCT(DILexicalBlock,
+                           (Ctx, mapMetadata(LB.getRawScope()),
+                            mapMetadata(LB.getRawFile()), LB.getLine(),
+                            LB.getColumn()));
+  }
+  case Metadata::DILexicalBlockFileKind: {
+    auto &LBF = cast<DILexicalBlockFile>(N);
+    return GET_OR_DISTINCT(DILexicalBlockFile,
+                           (Ctx, mapMetadata(LBF.getRawScope()),
+                            mapMetadata(LBF.getRawFile()),
+                            LBF.getDiscriminator()));
+  }
+  case Metadata::DINamespaceKind: {
+    auto &NS = cast<DINamespace>(N);
+    return GET_OR_DISTINCT(DINamespace,
+                           (Ctx, mapMetadata(NS.getRawScope()),
+                            mapString(NS.getRawName()),
+                            NS.getExportSymbols()));
+  }
+  case Metadata::DIModuleKind: {
+    auto &Mod = cast<DIModule>(N);
+    return GET_OR_DISTINCT(DIModule,
+                           (Ctx, mapMetadata(Mod.getRawScope()),
+                            mapString(Mod.getRawName()),
+                            mapString(Mod.getRawConfigurationMacros()),
+                            mapString(Mod.getRawIncludePath()),
+                            mapString(Mod.getRawISysRoot())));
+  }
+  case Metadata::DITemplateTypeParameterKind: {
+    auto &TP = cast<DITemplateTypeParameter>(N);
+    return GET_OR_DISTINCT(DITemplateTypeParameter,
+                           (Ctx, mapString(TP.getRawName()),
+                            mapMetadata(TP.getRawType())));
+  }
+  case Metadata::DITemplateValueParameterKind: {
+    auto &TP = cast<DITemplateValueParameter>(N);
+    return GET_OR_DISTINCT(DITemplateValueParameter,
+                           (Ctx, TP.getTag(), mapString(TP.getRawName()),
+                            mapMetadata(TP.getRawType()),
+                            mapMetadata(TP.getValue())));
+  }
+  case Metadata::DIGlobalVariableKind: {
+    auto &GV = cast<DIGlobalVariable>(N);
+    return GET_OR_DISTINCT(
+        DIGlobalVariable,
+        (Ctx, mapMetadata(GV.getRawScope()), mapString(GV.getRawName()),
+         mapString(GV.getRawLinkageName()), mapMetadata(GV.getRawFile()),
+         GV.getLine(), mapMetadata(GV.getRawType()), GV.isLocalToUnit(),
+         GV.isDefinition(),
+         mapMetadata(GV.getRawStaticDataMemberDeclaration()),
+         GV.getAlignInBits()));
+  }
+  case Metadata::DILocalVariableKind: {
+    auto &LV = cast<DILocalVariable>(N);
+    return GET_OR_DISTINCT(DILocalVariable,
+                           (Ctx, mapMetadata(LV.getRawScope()),
+                            mapString(LV.getRawName()),
+                            mapMetadata(LV.getRawFile()), LV.getLine(),
+                            mapMetadata(LV.getRawType()), LV.getArg(),
+                            LV.getFlags(), LV.getAlignInBits()));
+  }
+  case Metadata::DIObjCPropertyKind: {
+    auto &P = cast<DIObjCProperty>(N);
+    return GET_OR_DISTINCT(DIObjCProperty,
+                           (Ctx, mapString(P.getRawName()),
+                            mapMetadata(P.getRawFile()), P.getLine(),
+                            mapString(P.getRawGetterName()),
+                            mapString(P.getRawSetterName()),
+                            P.getAttributes(), mapMetadata(P.getRawType())));
+  }
+  case Metadata::DIImportedEntityKind: {
+    auto &IE = cast<DIImportedEntity>(N);
+    return GET_OR_DISTINCT(DIImportedEntity,
+                           (Ctx, IE.getTag(), mapMetadata(IE.getRawScope()),
+                            mapMetadata(IE.getRawEntity()),
+                            mapMetadata(IE.getRawFile()), IE.getLine(),
+                            mapString(IE.getRawName())));
+  }
+  case Metadata::DIMacroKind: {
+    auto &Macro = cast<DIMacro>(N);
+    return GET_OR_DISTINCT(DIMacro, (Ctx, Macro.getMacinfoType(),
+                                     Macro.getLine(),
+                                     mapString(Macro.getRawName()),
+                                     mapString(Macro.getRawValue())));
+  }
+  case Metadata::DIMacroFileKind: {
+    auto &MF = cast<DIMacroFile>(N);
+    return GET_OR_DISTINCT(DIMacroFile,
+                           (Ctx, MF.getMacinfoType(), MF.getLine(),
+                            mapMetadata(MF.getRawFile()),
+                            mapMetadata(MF.getRawElements())));
+  }
+  default:
+    llvm_unreachable("Unknown metadata node kind");
+  }
+}
+
+#undef GET_OR_DISTINCT
+
+void ContextModuleCloner::copyGlobalValueProperties(GlobalValue &Dst,
+                                                    const GlobalValue &Src) {
+  Dst.setVisibility(Src.getVisibility());
+  Dst.setUnnamedAddr(Src.getUnnamedAddr());
+  Dst.setDLLStorageClass(Src.getDLLStorageClass());
+  Dst.setThreadLocalMode(Src.getThreadLocalMode());
+  Dst.setDSOLocal(Src.isDSOLocal());
+
+  auto *DstGO = dyn_cast<GlobalObject>(&Dst);
+  auto *SrcGO = dyn_cast<GlobalObject>(&Src);
+  if (!DstGO || !SrcGO)
+    return;
+
+  DstGO->setAlignment(SrcGO->getAlignment());
+  if (SrcGO->hasSection())
+    DstGO->setSection(SrcGO->getSection());
+  if (const Comdat *C = SrcGO->getComdat())
+    DstGO->setComdat(DstM->getOrInsertComdat(C->getName()));
+}
+
+void ContextModuleCloner::copyGlobalObjectMetadata(GlobalObject &Dst,
+                                                   const GlobalObject &Src) {
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  Src.getAllMetadata(MDs);
+  for (auto &MD : MDs)
+    Dst.addMetadata(MDKindMap[MD.first], *mapNode(MD.second));
+}
+
+void ContextModuleCloner::declareGlobals() {
+  for (const auto &Entry : SrcM.getComdatSymbolTable())
+    DstM->getOrInsertComdat(Entry.getKey())
+        ->setSelectionKind(Entry.getValue().getSelectionKind());
+
+  for (const GlobalVariable &GV : SrcM.globals()) {
+    auto *NewGV = new GlobalVariable(
+        *DstM, mapType(GV.getValueType()), GV.isConstant(), GV.getLinkage(),
+        nullptr, GV.getName(), nullptr, GV.getThreadLocalMode(),
+        GV.getType()->getAddressSpace(), GV.isExternallyInitialized());
+    copyGlobalValueProperties(*NewGV, GV);
+    NewGV->setAttributes(mapAttributeSet(GV.getAttributes()));
+    ValueMap[&GV] = NewGV;
+  }
+
+  for (const Function &F : SrcM) {
+    Function *NewF =
+        Function::Create(cast<FunctionType>(mapType(F.getValueType())),
+                         F.getLinkage(), F.getName(), DstM.get());
+    copyGlobalValueProperties(*NewF, F);
+    NewF->setCallingConv(F.getCallingConv());
+    NewF->setAttributes(mapAttributeList(F.getAttributes()));
+    if (F.hasGC())
+      NewF->setGC(F.getGC());
+    ValueMap[&F] = NewF;
+
+    if (F.isDeclaration())
+      continue;
+
+    auto NewArg = NewF->arg_begin();
+    for (const Argument &Arg : F.args()) {
+      NewArg->setName(Arg.getName());
+      ValueMap[&Arg] = &*NewArg++;
+    }
+
+    // Blocks are created up front as they can be referenced by block
+    // addresses in any constant.
+    for (const BasicBlock &BB : F)
+      ValueMap[&BB] = BasicBlock::Create(Ctx, BB.getName(), NewF);
+  }
+
+  for (const GlobalAlias &GA : SrcM.aliases()) {
+    auto *NewGA = GlobalAlias::create(mapType(GA.getValueType()),
+                                      GA.getType()->getAddressSpace(),
+                                      GA.getLinkage(), GA.getName(),
+                                      DstM.get());
+    copyGlobalValueProperties(*NewGA, GA);
+    ValueMap[&GA] = NewGA;
+  }
+
+  for (const GlobalIFunc &GI : SrcM.ifuncs()) {
+    auto *NewGI = GlobalIFunc::create(mapType(GI.getValueType()),
+                                      GI.getType()->getAddressSpace(),
+                                      GI.getLinkage(), GI.getName(), nullptr,
+                                      DstM.get());
+    copyGlobalValueProperties(*NewGI, GI);
+    ValueMap[&GI] = NewGI;
+  }
+}
+
+void ContextModuleCloner::defineGlobals() {
+  for (const GlobalVariable &GV : SrcM.globals()) {
+    auto *NewGV = cast<GlobalVariable>(ValueMap[&GV]);
+    if (GV.hasInitializer())
+      NewGV->setInitializer(mapConstant(GV.getInitializer()));
+    copyGlobalObjectMetadata(*NewGV, GV);
+  }
+
+  for (const Function &F : SrcM) {
+    auto *NewF = cast<Function>(ValueMap[&F]);
+    if (F.hasPersonalityFn())
+      NewF->setPersonalityFn(mapConstant(F.getPersonalityFn()));
+    if (F.hasPrefixData())
+      NewF->setPrefixData(mapConstant(F.getPrefixData()));
+    if (F.hasPrologueData())
+      NewF->setPrologueData(mapConstant(F.getPrologueData()));
+    copyGlobalObjectMetadata(*NewF, F);
+  }
+
+  for (const GlobalAlias &GA : SrcM.aliases())
+    cast<GlobalAlias>(ValueMap[&GA])
+        ->setAliasee(mapConstant(GA.getAliasee()));
+
+  for (const GlobalIFunc &GI : SrcM.ifuncs())
+    cast<GlobalIFunc>(ValueMap[&GI])
+        ->setResolver(mapConstant(GI.getResolver()));
+}
+
+void ContextModuleCloner::mapOperandBundles(
+    ImmutableCallSite CS, SmallVectorImpl<OperandBundleDef> &Bundles) {
+  for (unsigned I = 0, E = CS.getNumOperandBundles(); I != E; ++I) {
+    OperandBundleUse Bundle = CS.getOperandBundleAt(I);
+    std::vector<Value *> Inputs;
+    for (const Use &Input : Bundle.Inputs)
+      Inputs.push_back(mapValue(Input));
+    Bundles.emplace_back(Bundle.getTagName(), std::move(Inputs));
+  }
+}
+
+Instruction *ContextModuleCloner::cloneInstruction(const Instruction &I) {
+  auto Op = [&](unsigned Idx) { return mapValue(I.getOperand(Idx)); };
+
+  switch (I.getOpcode()) {
+  // Terminators
+  case Instruction::Ret:
+    return ReturnInst::Create(Ctx,
+                              mapValue(cast<ReturnInst>(I).getReturnValue()));
+  case Instruction::Br: {
+    auto &BI = cast<BranchInst>(I);
+    if (BI.isUnconditional())
+      return BranchInst::Create(mapBlock(BI.getSuccessor(0)));
+    return BranchInst::Create(mapBlock(BI.getSuccessor(0)),
+                              mapBlock(BI.getSuccessor(1)),
+                              mapValue(BI.getCondition()));
+  }
+  case Instruction::Switch: {
+    auto &SI = cast<SwitchInst>(I);
+    SwitchInst *NewSI =
+        SwitchInst::Create(mapValue(SI.getCondition()),
+                           mapBlock(SI.getDefaultDest()), SI.getNumCases());
+    for (auto Case : SI.cases())
+      NewSI->addCase(cast<ConstantInt>(mapConstant(Case.getCaseValue())),
+                     mapBlock(Case.getCaseSuccessor()));
+    return NewSI;
+  }
+  case Instruction::IndirectBr: {
+    auto &IBI = cast<IndirectBrInst>(I);
+    IndirectBrInst *NewIBI = IndirectBrInst::Create(
+        mapValue(IBI.getAddress()), IBI.getNumDestinations());
+    for (unsigned Idx = 0, E = IBI.getNumDestinations(); Idx != E; ++Idx)
+      NewIBI->addDestination(mapBlock(IBI.getDestination(Idx)));
+    return NewIBI;
+  }
+  case Instruction::Invoke: {
+    auto &II = cast<InvokeInst>(I);
+    SmallVector<Value *, 8> Args;
+    for (const Use &Arg : II.arg_operands())
+      Args.push_back(mapValue(Arg));
+    SmallVector<OperandBundleDef, 2> Bundles;
+    mapOperandBundles(&II, Bundles);
+    InvokeInst *NewII = InvokeInst::Create(
+        cast<FunctionType>(mapType(II.getFunctionType())),
+        mapValue(II.getCalledValue()), mapBlock(II.getNormalDest()),
+        mapBlock(II.getUnwindDest()), Args, Bundles);
+    NewII->setCallingConv(II.getCallingConv());
+    NewII->setAttributes(mapAttributeList(II.getAttributes()));
+    return NewII;
+  }
+  case Instruction::Resume:
+    return ResumeInst::Create(Op(0));
+  case Instruction::Unreachable:
+    return new UnreachableInst(Ctx);
+  case Instruction::CleanupRet: {
+    auto &CRI = cast<CleanupReturnInst>(I);
+    return CleanupReturnInst::Create(mapValue(CRI.getCleanupPad()),
+                                     mapBlock(CRI.getUnwindDest()));
+  }
+  case Instruction::CatchRet: {
+    auto &CRI = cast<CatchReturnInst>(I);
+    return CatchReturnInst::Create(mapValue(CRI.getCatchPad()),
+                                   mapBlock(CRI.getSuccessor()));
+  }
+  case Instruction::CatchSwitch: {
+    auto &CSI = cast<CatchSwitchInst>(I);
+    CatchSwitchInst *NewCSI = CatchSwitchInst::Create(
+        mapValue(CSI.getParentPad()), mapBlock(CSI.getUnwindDest()),
+        CSI.getNumHandlers());
+    for (const BasicBlock *Handler : CSI.handlers())
+      NewCSI->addHandler(mapBlock(Handler));
+    return NewCSI;
+  }
+
+  // Memory operations
+  case Instruction::Alloca: {
+    auto &AI = cast<AllocaInst>(I);
+    AllocaInst *NewAI = new AllocaInst(
+        mapType(AI.getAllocatedType()), AI.getType()->getAddressSpace(),
+        mapValue(AI.getArraySize()), AI.getAlignment());
+    NewAI->setUsedWithInAlloca(AI.isUsedWithInAlloca());
+    NewAI->setSwiftError(AI.isSwiftError());
+    return NewAI;
+  }
+  case Instruction::Load: {
+    auto &LI = cast<LoadInst>(I);
+    return new LoadInst(mapType(LI.getType()), mapValue(LI.getPointerOperand()),
+                        "", LI.isVolatile(), LI.getAlignment(),
+                        LI.getOrdering(), mapSyncScope(LI.getSyncScopeID()));
+  }
+  case Instruction::Store: {
+    auto &SI = cast<StoreInst>(I);
+    return new StoreInst(mapValue(SI.getValueOperand()),
+                         mapValue(SI.getPointerOperand()), SI.isVolatile(),
+                         SI.getAlignment(), SI.getOrdering(),
+                         mapSyncScope(SI.getSyncScopeID()));
+  }
+  case Instruction::GetElementPtr: {
+    auto &GEP = cast<GetElementPtrInst>(I);
+    SmallVector<Value *, 4> Indices;
+    for (const Use &Idx : GEP.indices())
+      Indices.push_back(mapValue(Idx));
+    return GetElementPtrInst::Create(mapType(GEP.getSourceElementType()),
+                                     mapValue(GEP.getPointerOperand()),
+                                     Indices);
+  }
+  case Instruction::Fence: {
+    auto &FI = cast<FenceInst>(I);
+    return new FenceInst(Ctx, FI.getOrdering(),
+                         mapSyncScope(FI.getSyncScopeID()));
+  }
+  case Instruction::AtomicCmpXchg: {
+    auto &CXI = cast<AtomicCmpXchgInst>(I);
+    AtomicCmpXchgInst *NewCXI = new AtomicCmpXchgInst(
+        Op(0), Op(1), Op(2), CXI.getSuccessOrdering(),
+        CXI.getFailureOrdering(), mapSyncScope(CXI.getSyncScopeID()));
+    NewCXI->setVolatile(CXI.isVolatile());
+    NewCXI->setWeak(CXI.isWeak());
+    return NewCXI;
+  }
+  case Instruction::AtomicRMW: {
+    auto &RMWI = cast<AtomicRMWInst>(I);
+    AtomicRMWInst *NewRMWI = new AtomicRMWInst(
+        RMWI.getOperation(), Op(0), Op(1), RMWI.getOrdering(),
+        mapSyncScope(RMWI.getSyncScopeID()));
+    NewRMWI->setVolatile(RMWI.isVolatile());
+    return NewRMWI;
+  }
+
+  // Other operations
+  case Instruction::ICmp:
+  case Instruction::FCmp:
+    return CmpInst::Create(cast<CmpInst>(I).getOpcode(),
+                           cast<CmpInst>(I).getPredicate(), Op(0), Op(1));
+  case Instruction::PHI:
+    // The incoming values are added once all instructions are cloned.
+    return PHINode::Create(mapType(I.getType()),
+                           cast<PHINode>(I).getNumIncomingValues());
+  case Instruction::Call: {
+    auto &CI = cast<CallInst>(I);
+    SmallVector<Value *, 8> Args;
+    for (const Use &Arg : CI.arg_operands())
+      Args.push_back(mapValue(Arg));
+    SmallVector<OperandBundleDef, 2> Bundles;
+    mapOperandBundles(&CI, Bundles);
+    CallInst *NewCI =
+        CallInst::Create(cast<FunctionType>(mapType(CI.getFunctionType())),
+                         mapValue(CI.getCalledValue()), Args, Bundles);
+    NewCI->setTailCallKind(CI.getTailCallKind());
+    NewCI->setCallingConv(CI.getCallingConv());
+    NewCI->setAttributes(mapAttributeList(CI.getAttributes()));
+    return NewCI;
+  }
+  case Instruction::Select:
+    return SelectInst::Create(Op(0), Op(1), Op(2));
+  case Instruction::VAArg:
+    return new VAArgInst(Op(0), mapType(I.getType()));
+  case Instruction::ExtractElement:
+    return ExtractElementInst::Create(Op(0), Op(1));
+  case Instruction::InsertElement:
+    return InsertElementInst::Create(Op(0), Op(1), Op(2));
+  case Instruction::ShuffleVector:
+    return new ShuffleVectorInst(Op(0), Op(1), Op(2));
+  case Instruction::ExtractValue:
+    return ExtractValueInst::Create(Op(0),
+                                    cast<ExtractValueInst>(I).getIndices());
+  case Instruction::InsertValue:
+    return InsertValueInst::Create(Op(0), Op(1),
+                                   cast<InsertValueInst>(I).getIndices());
+  case Instruction::LandingPad: {
+    auto &LPI = cast<LandingPadInst>(I);
+    LandingPadInst *NewLPI = LandingPadInst::Create(mapType(LPI.getType()),
+                                                    LPI.getNumClauses());
+    NewLPI->setCleanup(LPI.isCleanup());
+    for (unsigned Idx = 0, E = LPI.getNumClauses(); Idx != E; ++Idx)
+      NewLPI->addClause(mapConstant(LPI.getClause(Idx)));
+    return NewLPI;
+  }
+  case Instruction::CleanupPad:
+  case Instruction::CatchPad: {
+    auto &FPI = cast<FuncletPadInst>(I);
+    SmallVector<Value *, 4> Args;
+    for (unsigned Idx = 0, E = FPI.getNumArgOperands(); Idx != E; ++Idx)
+      Args.push_back(mapValue(FPI.getArgOperand(Idx)));
+    if (isa<CleanupPadInst>(FPI))
+      return CleanupPadInst::Create(mapValue(FPI.getParentPad()), Args);
+    return CatchPadInst::Create(mapValue(FPI.getParentPad()), Args);
+  }
+  default:
+    break;
+  }
+
+  if (auto *BO = dyn_cast<BinaryOperator>(&I))
+    return BinaryOperator::Create(BO->getOpcode(), Op(0), Op(1));
+  if (auto *CI = dyn_cast<CastInst>(&I))
+    return CastInst::Create(CI->getOpcode(), Op(0), mapType(CI->getType()));
+
+  report_fatal_error(Twine("Cannot clone instruction across contexts: ") +
+                     I.getOpcodeName());
+}
+
+void ContextModuleCloner::cloneFunctionBody(const Function &SrcF) {
+  // Visit the reachable blocks in reverse post order first, thus definitions
+  // are cloned before their uses except for PHI nodes. Unreachable blocks
+  // follow in their original order.
+  SmallVector<const BasicBlock *, 32> Blocks;
+  SmallPtrSet<const BasicBlock *, 32> Reachable;
+  ReversePostOrderTraversal<const Function *> RPOT(&SrcF);
+  for (const BasicBlock *BB : RPOT) {
+    Blocks.push_back(BB);
+    Reachable.insert(BB);
+  }
+  for (const BasicBlock &BB : SrcF)
+    if (!Reachable.count(&BB))
+      Blocks.push_back(&BB);
+
+  SmallVector<std::pair<const Instruction *, Instruction *>, 32> Cloned;
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  for (const BasicBlock *BB : Blocks) {
+    BasicBlock *NewBB = mapBlock(BB);
+    for (const Instruction &I : *BB) {
+      Instruction *NewI = cloneInstruction(I);
+      NewI->copyIRFlags(&I);
+      NewI->setName(I.getName());
+      NewBB->getInstList().push_back(NewI);
+      ValueMap[&I] = NewI;
+      Cloned.push_back({&I, NewI});
+
+      if (Value *Placeholder = ForwardRefs.lookup(&I)) {
+        Placeholder->replaceAllUsesWith(NewI);
+        ForwardRefs.erase(&I);
+        Placeholder->deleteValue();
+      }
+    }
+  }
+  assert(ForwardRefs.empty() && "Use of an undefined instruction");
+
+  // Now that all values are available, fill in the PHI nodes and attach the
+  // metadata.
+  for (auto &Pair : Cloned) {
+    const Instruction &I = *Pair.first;
+    Instruction *NewI = Pair.second;
+
+    if (auto *PN = dyn_cast<PHINode>(&I)) {
+      auto *NewPN = cast<PHINode>(NewI);
+      for (unsigned Idx = 0, E = PN->getNumIncomingValues(); Idx != E; ++Idx)
+        NewPN->addIncoming(mapValue(PN->getIncomingValue(Idx)),
+                           mapBlock(PN->getIncomingBlock(Idx)));
+    }
+
+    if (!I.hasMetadata())
+      continue;
+    if (const DILocation *DL = I.getDebugLoc())
+      NewI->setDebugLoc(DebugLoc(mapNode(DL)));
+    MDs.clear();
+    I.getAllMetadataOtherThanDebugLoc(MDs);
+    for (auto &MD : MDs)
+      NewI->setMetadata(MDKindMap[MD.first], mapNode(MD.second));
+  }
+}
+
+std::unique_ptr<Module> ContextModuleCloner::run() {
+  DstM = llvm::make_unique<Module>(SrcM.getModuleIdentifier(), Ctx);
+  DstM->setSourceFileName(SrcM.getSourceFileName());
+  DstM->setDataLayout(SrcM.getDataLayout());
+  DstM->setTargetTriple(SrcM.getTargetTriple());
+  DstM->setModuleInlineAsm(SrcM.getModuleInlineAsm());
+
+  // Metadata kinds and synchronization scopes are numbered per context.
+  SmallVector<StringRef, 32> Names;
+  SrcM.getMDKindNames(Names);
+  for (StringRef Name : Names)
+    MDKindMap.push_back(Ctx.getMDKindID(Name));
+  Names.clear();
+  SrcM.getContext().getSyncScopeNames(Names);
+  for (StringRef Name : Names)
+    SyncScopeMap.push_back(Ctx.getOrInsertSyncScopeID(Name));
+
+  declareGlobals();
+  defineGlobals();
+
+  for (const Function &F : SrcM)
+    if (!F.isDeclaration())
+      cloneFunctionBody(F);
+
+  for (const NamedMDNode &NMD : SrcM.named_metadata()) {
+    NamedMDNode *NewNMD = DstM->getOrInsertNamedMetadata(NMD.getName());
+    for (const MDNode *Op : NMD.operands())
+      NewNMD->addOperand(mapNode(Op));
+  }
+
+  for (MDNode *N : UnresolvedNodes)
+    if (!N->isResolved())
+      N->resolveCycles();
+
+  return std::move(DstM);
+}
+
+std::unique_ptr<Module> llvm::CloneModuleIntoContext(const Module &M,
+                                                     LLVMContext &Ctx) {
+  return ContextModuleCloner(M, Ctx).run();
+}
@@ -18,7 +18,10 @@
 #include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/Comdat.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
@@ -33,8 +36,10 @@
 #include "llvm/IR/User.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -51,6 +56,36 @@ using namespace llvm;
 
 #define DEBUG_TYPE "split-module"
 
+static cl::opt<bool> BalanceCodeGenCost(
+    "split-module-balance-cost", cl::Hidden, cl::init(false),
+    cl::desc("Balance the estimated code generation cost of the partitions "
+             "instead of the number of globals"));
+
+static cl::opt<unsigned> CodeGenBlockCost(
+    "split-module-block-cost", cl::Hidden, cl::init(4),
+    cl::desc("The estimated code generation cost of a basic block relative "
+             "to an instruction"));
+
+static cl::opt<unsigned> CodeGenInlineAsmCost(
+    "split-module-inline-asm-cost", cl::Hidden, cl::init(20),
+    cl::desc("The estimated code generation cost of an inline assembly call "
+             "relative to an instruction"));
+
+static cl::opt<unsigned> CodeGenHotFunctionWeight(
+    "split-module-hot-function-weight", cl::Hidden, cl::init(150),
+    cl::desc("Weight (in percent) of the estimated code generation cost of "
+             "functions that are hot according to the profile"));
+
+static cl::opt<unsigned> CodeGenColdFunctionWeight(
+    "split-module-cold-function-weight", cl::Hidden, cl::init(75),
+    cl::desc("Weight (in percent) of the estimated code generation cost of "
+             "functions that are cold according to the profile"));
+
+static cl::opt<bool> ReportPartitions(
+    "split-module-report", cl::Hidden, cl::init(false),
+    cl::desc("Print the estimated code generation cost and the measured code "
+             "generation time of the partitions"));
+
 namespace {
 
 using ClusterMapType = EquivalenceClasses<const GlobalValue *>;
@@ -92,17 +127,9 @@ static void addAllGlobalValueUsers(ClusterMapType &GVtoClusterMap,
   }
 }
 
-// Find partitions for module in the way that no locals need to be
-// globalized.
-// Try to balance pack those partitions into N files since this roughly equals
-// thread balancing for the backend codegen step.
-static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
-                           unsigned N) {
-  // At this point module should have the proper mix of globals and locals.
-  // As we attempt to partition this module, we must not change any
-  // locals to globals.
-  DEBUG(dbgs() << "Partition module with (" << M->size() << ")functions\n");
-  ClusterMapType GVtoClusterMap;
+// Group the globals of M that have to end up in the same partition, e.g.,
+// locals and their users or members of the same comdat group.
+static void buildClusters(Module *M, ClusterMapType &GVtoClusterMap) {
   ComdatMembersType ComdatMembers;
 
   auto recordGVSet = [&GVtoClusterMap, &ComdatMembers](GlobalValue &GV) {
@@ -147,6 +174,20 @@ static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
   llvm::for_each(M->functions(), recordGVSet);
   llvm::for_each(M->globals(), recordGVSet);
   llvm::for_each(M->aliases(), recordGVSet);
+}
+
+// Find partitions for module in the way that no locals need to be
+// globalized.
+// Try to balance pack those partitions into N files since this roughly equals
+// thread balancing for the backend codegen step.
+static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
+                           unsigned N) {
+  // At this point module should have the proper mix of globals and locals.
+  // As we attempt to partition this module, we must not change any
+  // locals to globals.
+  DEBUG(dbgs() << "Partition module with (" << M->size() << ")functions\n");
+  ClusterMapType GVtoClusterMap;
+  buildClusters(M, GVtoClusterMap);
 
   // Assigned all GVs to merged clusters while balancing number of objects in
   // each.
@@ -211,6 +252,113 @@ static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
   }
 }
 
+uint64_t llvm::estimateCodeGenCost(const Function &F,
+                                   ProfileSummaryInfo *PSI) {
+  if (F.isDeclaration())
+    return 0;
+
+  uint64_t Cost = 0;
+  for (const BasicBlock &BB : F) {
+    Cost += CodeGenBlockCost;
+    for (const Instruction &I : BB) {
+      Cost += 1;
+      if (auto CS = ImmutableCallSite(&I))
+        if (CS.isInlineAsm())
+          Cost += CodeGenInlineAsmCost;
+    }
+  }
+
+  if (PSI) {
+    if (PSI->isFunctionEntryHot(&F))
+      Cost = Cost * CodeGenHotFunctionWeight / 100;
+    else if (PSI->isFunctionEntryCold(&F))
+      Cost = Cost * CodeGenColdFunctionWeight / 100;
+  }
+  return std::max<uint64_t>(Cost, 1);
+}
+
+uint64_t llvm::estimateCodeGenCost(Module &M) {
+  ProfileSummaryInfo PSI(M);
+  uint64_t Cost = 0;
+  for (const Function &F : M)
+    Cost += estimateCodeGenCost(F, &PSI);
+  return Cost;
+}
+
+// Find partitions for module in the way that no locals need to be
+// globalized, such that the estimated code generation cost of the partitions
+// is balanced. The clusters are assigned in order of decreasing cost to the
+// partition with the lowest cost so far.
+static void findCostBalancedPartitions(Module *M,
+                                       ClusterIDMapType &ClusterIDMap,
+                                       unsigned N) {
+  DEBUG(dbgs() << "Partition module with (" << M->size()
+               << ")functions by cost\n");
+  ClusterMapType GVtoClusterMap;
+  buildClusters(M, GVtoClusterMap);
+
+  // Globals that do not need to be kept together with others form their own
+  // cluster.
+  auto insertGV = [&GVtoClusterMap](GlobalValue &GV) {
+    if (!GV.isDeclaration())
+      GVtoClusterMap.insert(&GV);
+  };
+  llvm::for_each(M->functions(), insertGV);
+  llvm::for_each(M->globals(), insertGV);
+  llvm::for_each(M->aliases(), insertGV);
+
+  ProfileSummaryInfo PSI(*M);
+  using CostType = std::pair<uint64_t, ClusterMapType::iterator>;
+  SmallVector<CostType, 64> Clusters;
+  for (ClusterMapType::iterator I = GVtoClusterMap.begin(),
+                                E = GVtoClusterMap.end(); I != E; ++I) {
+    if (!I->isLeader())
+      continue;
+    uint64_t Cost = 0;
+    for (ClusterMapType::member_iterator MI = GVtoClusterMap.member_begin(I);
+         MI != GVtoClusterMap.member_end(); ++MI)
+      if (auto *F = dyn_cast<Function>(*MI))
+        Cost += estimateCodeGenCost(*F, &PSI);
+      else
+        Cost += 1;
+    Clusters.push_back(std::make_pair(Cost, I));
+  }
+
+  // To guarantee determinism, sort by cost and then by the leader's name.
+  std::sort(Clusters.begin(), Clusters.end(),
+            [](const CostType &a, const CostType &b) {
+              if (a.first == b.first)
+                return a.second->getData()->getName() >
+                       b.second->getData()->getName();
+              return a.first > b.first;
+            });
+
+  // The partition with the lowest cost (and index) is on top.
+  using PartitionType = std::pair<uint64_t, unsigned>;
+  std::priority_queue<PartitionType, std::vector<PartitionType>,
+                      std::greater<PartitionType>>
+      Partitions;
+  for (unsigned i = 0; i < N; ++i)
+    Partitions.push(std::make_pair(0, i));
+
+  for (auto &Cluster : Clusters) {
+    PartitionType Partition = Partitions.top();
+    Partitions.pop();
+
+    DEBUG(dbgs() << "Root[" << Partition.second << "] cost(" << Partition.first
+                 << " + " << Cluster.first << ") ----> "
+                 << Cluster.second->getData()->getName() << "\n");
+
+    for (ClusterMapType::member_iterator MI =
+             GVtoClusterMap.member_begin(Cluster.second);
+         MI != GVtoClusterMap.member_end(); ++MI)
+      ClusterIDMap[*MI] = Partition.second;
+
+    Partition.first += Cluster.first;
+    Partitions.push(Partition);
+  }
+}
+
 static void externalize(GlobalValue *GV) {
   if (GV->hasLocalLinkage()) {
     GV->setLinkage(GlobalValue::ExternalLinkage);
@@ -263,7 +411,10 @@ void llvm::SplitModule(
   // This performs splitting without a need for externalization, which might not
   // always be possible.
   ClusterIDMapType ClusterIDMap;
-  findPartitions(M.get(), ClusterIDMap, N);
+  if (BalanceCodeGenCost)
+    findCostBalancedPartitions(M.get(), ClusterIDMap, N);
+  else
+    findPartitions(M.get(), ClusterIDMap, N);
 
   // FIXME: We should be able to reuse M as the last partition instead of
   // cloning it.
@@ -281,3 +432,46 @@ void llvm::SplitModule(
     ModuleCallback(std::move(MPart));
   }
 }
+
+SplitModuleReport::SplitModuleReport(unsigned N) : Partitions(N) {}
+
+bool SplitModuleReport::isEnabled() { return ReportPartitions; }
+
+void SplitModuleReport::setPredictedCost(unsigned I, Module &MPart) {
+  Partitions[I].PredictedCost = estimateCodeGenCost(MPart);
+}
+
+void SplitModuleReport::setWallTime(unsigned I, double Seconds) {
+  Partitions[I].WallTime = Seconds;
+}
+
+void SplitModuleReport::print(raw_ostream &OS) const {
+  uint64_t TotalCost = 0;
+  double TotalTime = 0;
+  for (const PartitionInfo &Info : Partitions) {
+    TotalCost += Info.PredictedCost;
+    TotalTime += Info.WallTime;
+  }
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                      Parallel code generation partitions\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "  Partition  Predicted cost  Predicted %  Wall time (s)  Actual %\n";
+  for (unsigned I = 0, E = Partitions.size(); I != E; ++I) {
+    const PartitionInfo &Info = Partitions[I];
+    double PredictedShare =
+        TotalCost ? 100.0 * Info.PredictedCost / TotalCost : 0.0;
+    double ActualShare = TotalTime > 0 ? 100.0 * Info.WallTime / TotalTime : 0.0;
+    OS << format("  %9u  %14llu  %10.1f%%  %13.4f  %7.1f%%\n", I,
+                 (unsigned long long)Info.PredictedCost, PredictedShare,
+                 Info.WallTime, ActualShare);
+  }
+  OS << "\n";
+}
+
+void SplitModuleReport::printIfEnabled() const {
+  if (!isEnabled())
+    return;
+  std::unique_ptr<raw_ostream> OS = CreateInfoOutputFile();
+  print(*OS);
+}
@@ -78,11 +78,14 @@
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/PolyhedralDependenceInfo.h"
+#include "llvm/Analysis/PolyhedralUtils.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ScalarEvolutionExpander.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Analysis/VectorUtils.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/BasicBlock.h"
@@ -252,6 +255,11 @@ static cl::opt<unsigned> PragmaVectorizeSCEVCheckThreshold(
     cl::desc("The maximum number of SCEV checks allowed with a "
              "vectorize(enable) pragma"));
 
+static cl::opt<bool> UsePolyhedralDependences(
+    "vectorize-use-polyhedral-dependences", cl::init(false), cl::Hidden,
+    cl::desc("Use the polyhedral dependence analysis to replace the runtime "
+             "pointer checks by a single guard on the loop parameters."));
+
 /// Create an analysis remark that explains why vectorization failed
 ///
 /// \p PassName is the name of the pass (e.g. can be AlwaysPrint).  \p
@@ -632,6 +640,10 @@ protected:
   /// Emit bypass checks to check any memory assumptions we may have made.
   void emitMemRuntimeChecks(Loop *L, BasicBlock *Bypass);
 
+  /// Set up the noalias metadata for the pointer checks of LoopAccessAnalysis
+  /// that hold without emitting them when the polyhedral dependences are used.
+  void prepareNoAliasMetadataForPolyhedralCheck();
+
   /// Add additional metadata to \p To that was not present on \p Orig.
   ///
   /// Currently this is used to add the noalias annotations based on the
@@ -1542,9 +1554,10 @@ public:
       const TargetTransformInfo *TTI,
       std::function<const LoopAccessInfo &(Loop &)> *GetLAA, LoopInfo *LI,
       OptimizationRemarkEmitter *ORE, LoopVectorizationRequirements *R,
-      LoopVectorizeHints *H)
+      LoopVectorizeHints *H, PolyhedralDependenceInfo *PDI)
       : TheLoop(L), PSE(PSE), TLI(TLI), TTI(TTI), DT(DT), GetLAA(GetLAA),
-        ORE(ORE), InterleaveInfo(PSE, L, DT, LI), Requirements(R), Hints(H) {}
+        ORE(ORE), InterleaveInfo(PSE, L, DT, LI), Requirements(R), Hints(H),
+        PDI(PDI) {}
 
   /// ReductionList contains the reduction descriptors for all
   /// of the reductions that were found in the loop.
@@ -1626,6 +1639,37 @@ public:
 
   const LoopAccessInfo *getLAI() const { return LAI; }
 
+  /// Returns true if runtime pointer checks are needed to vectorize the loop.
+  bool requiresRuntimePointerChecks() const {
+    return !UsesPolyhedralDependences &&
+           LAI->getRuntimePointerChecking()->Need;
+  }
+
+  /// Returns true if the polyhedral dependences replace the runtime pointer
+  /// checks of LoopAccessAnalysis.
+  bool usesPolyhedralDependences() const { return UsesPolyhedralDependences; }
+
+  /// Returns true if executing \p Width iterations in lock-step is safe
+  /// according to the polyhedral dependences, possibly guarded by a check on
+  /// the parameters that can be generated.
+  bool canUsePolyhedralCheck(unsigned Width) const;
+
+  /// Use the runtime pointer checks of LoopAccessAnalysis instead of the
+  /// polyhedral dependences. Returns false if LoopAccessAnalysis cannot
+  /// vectorize the memory accesses on its own.
+  bool dropPolyhedralDependences();
+
+  /// Returns the parameter values for which executing \p Width iterations in
+  /// lock-step is not safe according to the polyhedral dependences.
+  PVSet getPolyhedralUnsafeCondition(unsigned Width) const {
+    assert(UsesPolyhedralDependences);
+    return PDI->getUnsafeVectorWidthCondition(*TheLoop, Width);
+  }
+
+  /// Returns the maximal number of iterations that can be executed in
+  /// lock-step without any runtime check, or UINT_MAX if not restricted.
+  unsigned getMaxSafeVectorWidth() const { return MaxSafeVectorWidth; }
+
   /// \brief Check if \p Instr belongs to any interleaved access group.
   bool isAccessInterleaved(Instruction *Instr) {
     return InterleaveInfo.isInterleaved(Instr);
@@ -1718,6 +1762,11 @@ private:
   /// Returns true if the loop is vectorizable
   bool canVectorizeMemory();
 
+  /// Return true if the runtime pointer checks required by LoopAccessAnalysis,
+  /// or the dependences it could not prove safe, can be replaced by the
+  /// polyhedral dependences and a guard on the loop parameters.
+  bool canUsePolyhedralDependences();
+
   /// Return true if we can vectorize this loop using the IF-conversion
   /// transformation.
   bool canVectorizeWithIfConvert();
@@ -1833,6 +1882,16 @@ private:
   /// Used to emit an analysis of any legality issues.
   LoopVectorizeHints *Hints;
 
+  /// The polyhedral dependences, if they should be used.
+  PolyhedralDependenceInfo *PDI;
+
+  /// Flag to indicate the polyhedral dependences replace the runtime pointer
+  /// checks.
+  bool UsesPolyhedralDependences = false;
+
+  /// The maximal vector width known to be safe without runtime checks.
+  unsigned MaxSafeVectorWidth = UINT_MAX;
+
   /// While vectorizing these instructions we have to generate a
   /// call to the appropriate masked intrinsic
   SmallPtrSet<const Instruction *, 8> MaskedOp;
@@ -2532,8 +2591,13 @@ struct LoopVectorize : public FunctionPass {
     std::function<const LoopAccessInfo &(Loop &)> GetLAA =
         [&](Loop &L) -> const LoopAccessInfo & { return LAA->getInfo(&L); };
 
+    PolyhedralDependenceInfo *PDI = nullptr;
+    if (UsePolyhedralDependences)
+      PDI = &getAnalysis<PolyhedralDependenceInfoWrapperPass>()
+                 .getPolyhedralDependenceInfo();
+
     return Impl.runImpl(F, *SE, *LI, *TTI, *DT, *BFI, TLI, *DB, *AA, *AC,
-                        GetLAA, *ORE);
+                        GetLAA, *ORE, PDI);
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
@@ -2547,6 +2611,8 @@ struct LoopVectorize : public FunctionPass {
     AU.addRequired<LoopAccessLegacyAnalysis>();
     AU.addRequired<DemandedBitsWrapperPass>();
     AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+    if (UsePolyhedralDependences)
+      AU.addRequired<PolyhedralDependenceInfoWrapperPass>();
     AU.addPreserved<LoopInfoWrapperPass>();
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<BasicAAWrapperPass>();
@@ -3558,13 +3624,31 @@ void InnerLoopVectorizer::emitSCEVChecks(Loop *L, BasicBlock *Bypass) {
 void InnerLoopVectorizer::emitMemRuntimeChecks(Loop *L, BasicBlock *Bypass) {
   BasicBlock *BB = L->getLoopPreheader();
 
-  // Generate the code that checks in runtime if arrays overlap. We put the
-  // checks into a separate block to make the more common case of few elements
-  // faster.
-  Instruction *FirstCheckInst;
-  Instruction *MemRuntimeCheck;
-  std::tie(FirstCheckInst, MemRuntimeCheck) =
-      Legal->getLAI()->addRuntimeChecks(BB->getTerminator());
+  // If the polyhedral dependences are used, a single check on the parameters
+  // ensures VF * UF iterations can be executed in lock-step. It was validated
+  // for VF * UF by the legality.
+  Value *MemRuntimeCheck = nullptr;
+  bool UsesPolyhedralCheck = Legal->usesPolyhedralDependences();
+  if (UsesPolyhedralCheck) {
+    PVSet UnsafeCondition = Legal->getPolyhedralUnsafeCondition(VF * UF);
+    assert(UnsafeCondition && "Polyhedral dependences became incomplete");
+    if (!UnsafeCondition.isEmpty()) {
+      IRBuilder<> Builder(BB->getTerminator());
+      MemRuntimeCheck = buildParameterSetCondition(Builder, UnsafeCondition);
+      assert(MemRuntimeCheck && "Cannot build the validated polyhedral check");
+    }
+  } else {
+    // Generate the code that checks in runtime if arrays overlap. We put the
+    // checks into a separate block to make the more common case of few
+    // elements faster.
+    Instruction *FirstCheckInst;
+    Instruction *MemCheckInst;
+    std::tie(FirstCheckInst, MemCheckInst) =
+        Legal->getLAI()->addRuntimeChecks(BB->getTerminator());
+    MemRuntimeCheck = MemCheckInst;
+  }
+  if (UsesPolyhedralCheck)
+    prepareNoAliasMetadataForPolyhedralCheck();
   if (!MemRuntimeCheck)
     return;
 
@@ -3582,6 +3666,9 @@ void InnerLoopVectorizer::emitMemRuntimeChecks(Loop *L, BasicBlock *Bypass) {
   LoopBypassBlocks.push_back(BB);
   AddedSafetyChecks = true;
 
+  if (UsesPolyhedralCheck)
+    return;
+
   // We currently don't use LoopVersioning for the actual loop cloning but we
   // still use it to add the noalias metadata.
   LVer = llvm::make_unique<LoopVersioning>(*Legal->getLAI(), OrigLoop, LI, DT,
@@ -3589,6 +3676,43 @@ void InnerLoopVectorizer::emitMemRuntimeChecks(Loop *L, BasicBlock *Bypass) {
   LVer->prepareNoAliasMetadata();
 }
 
+void InnerLoopVectorizer::prepareNoAliasMetadataForPolyhedralCheck() {
+  // The polyhedral dependences are only used if all written base pointers are
+  // identified objects. Pointers based on distinct identified objects never
+  // alias, thus the scopes for the pointer checks between them are valid even
+  // though the checks themselves are not emitted.
+  const LoopAccessInfo &LAI = *Legal->getLAI();
+  const RuntimePointerChecking &RtPtrChecking = *LAI.getRuntimePointerChecking();
+  const DataLayout &DL = OrigLoop->getHeader()->getModule()->getDataLayout();
+  auto GetIdentifiedObject =
+      [&](const RuntimePointerChecking::CheckingPtrGroup *Group) -> Value * {
+    Value *Obj = nullptr;
+    for (unsigned Idx : Group->Members) {
+      Value *PtrObj = GetUnderlyingObject(
+          RtPtrChecking.getPointerInfo(Idx).PointerValue, DL);
+      if (!isIdentifiedObject(PtrObj) || (Obj && Obj != PtrObj))
+        return nullptr;
+      Obj = PtrObj;
+    }
+    return Obj;
+  };
+
+  SmallVector<RuntimePointerChecking::PointerCheck, 4> Checks;
+  for (const auto &Check : RtPtrChecking.getChecks()) {
+    Value *Obj0 = GetIdentifiedObject(Check.first);
+    Value *Obj1 = GetIdentifiedObject(Check.second);
+    if (Obj0 && Obj1 && Obj0 != Obj1)
+      Checks.push_back(Check);
+  }
+  if (Checks.empty())
+    return;
+
+  LVer = llvm::make_unique<LoopVersioning>(LAI, OrigLoop, LI, DT, PSE.getSE(),
+                                           /* UseLAIChecks */ false);
+  LVer->setAliasChecks(std::move(Checks));
+  LVer->prepareNoAliasMetadata();
+}
+
 BasicBlock *InnerLoopVectorizer::createVectorizedLoopSkeleton() {
   /*
    In this function we generate a new loop. The new loop will contain
@@ -5121,7 +5245,7 @@ bool LoopVectorizationLegality::canVectorize() {
   }
 
   DEBUG(dbgs() << "LV: We can vectorize this loop"
-               << (LAI->getRuntimePointerChecking()->Need
+               << (requiresRuntimePointerChecks()
                        ? " (with a runtime bound check)"
                        : "")
                << "!\n");
@@ -5817,14 +5941,23 @@ void LoopVectorizationCostModel::collectLoopUniforms(unsigned VF) {
 bool LoopVectorizationLegality::canVectorizeMemory() {
   LAI = &(*GetLAA)(*TheLoop);
   InterleaveInfo.setLAI(LAI);
+
+  // LoopAccessAnalysis gives up on dependences it cannot prove safe, e.g.,
+  // because their distance is not constant. All other requirements on the
+  // memory accesses are met in that case and the polyhedral dependences might
+  // still allow vectorization, possibly guarded by a check on the parameters.
+  if (!LAI->canVectorizeMemory() && PDI &&
+      !LAI->getDepChecker().isSafeForVectorization())
+    UsesPolyhedralDependences = canUsePolyhedralDependences();
+
   const OptimizationRemarkAnalysis *LAR = LAI->getReport();
-  if (LAR) {
+  if (LAR && !UsesPolyhedralDependences) {
     ORE->emit([&]() {
       return OptimizationRemarkAnalysis(Hints->vectorizeAnalysisPassName(),
                                         "loop not vectorized: ", *LAR);
     });
   }
-  if (!LAI->canVectorizeMemory())
+  if (!LAI->canVectorizeMemory() && !UsesPolyhedralDependences)
     return false;
 
   if (LAI->hasStoreToLoopInvariantAddress()) {
@@ -5834,12 +5967,83 @@ bool LoopVectorizationLegality::canVectorizeMemory() {
     return false;
   }
 
-  Requirements->addRuntimePointerChecks(LAI->getNumRuntimePointerChecks());
+  if (!UsesPolyhedralDependences && LAI->getRuntimePointerChecking()->Need &&
+      PDI)
+    UsesPolyhedralDependences = canUsePolyhedralDependences();
+
+  if (!UsesPolyhedralDependences)
+    Requirements->addRuntimePointerChecks(LAI->getNumRuntimePointerChecks());
   PSE.addPredicate(LAI->getPSE().getUnionPredicate());
 
   return true;
 }
 
+bool LoopVectorizationLegality::canUsePolyhedralDependences() {
+  PVAff SafeWidth;
+  if (!PDI->getParametricSafeVectorWidth(*TheLoop, SafeWidth)) {
+    DEBUG(dbgs() << "LV: Polyhedral dependences are incomplete.\n");
+    return false;
+  }
+
+  // Parameter values for which the dependences are not valid have to be
+  // excluded at runtime.
+  bool HasInvalidContext =
+      !PDI->getDependences(*TheLoop).InvalidContext.isEmpty();
+
+  // Without dependences that restrict the lock-step execution no checks are
+  // needed at all.
+  if (!SafeWidth && !HasInvalidContext) {
+    DEBUG(dbgs() << "LV: Polyhedral dependences do not restrict the vector "
+                    "width, no runtime checks required.\n");
+    return true;
+  }
+
+  // A fixed dependence distance limits the vector width statically.
+  if (SafeWidth && SafeWidth.isInteger() && !HasInvalidContext) {
+    int64_t Width = SafeWidth.getIntegerVal();
+    if (Width < 2)
+      return false;
+    MaxSafeVectorWidth = Width < UINT_MAX ? Width : UINT_MAX;
+    DEBUG(dbgs() << "LV: Polyhedral dependences restrict the vector width to "
+                 << MaxSafeVectorWidth << ".\n");
+    return true;
+  }
+
+  // Otherwise we need to check the parameters at runtime. The condition
+  // depends on the number of iterations executed in lock-step. It is checked
+  // again with the chosen one by canUsePolyhedralCheck, here we only make sure
+  // the simplest vectorization could be guarded.
+  if (!canUsePolyhedralCheck(2)) {
+    DEBUG(dbgs() << "LV: Cannot build a runtime check for the parametric "
+                    "vector width "
+                 << SafeWidth << ".\n");
+    return false;
+  }
+
+  DEBUG(dbgs() << "LV: Polyhedral dependences require a runtime check of the "
+                  "parametric vector width "
+               << SafeWidth << ".\n");
+  return true;
+}
+
+bool LoopVectorizationLegality::canUsePolyhedralCheck(unsigned Width) const {
+  assert(PDI);
+  PVSet UnsafeCondition = PDI->getUnsafeVectorWidthCondition(*TheLoop, Width);
+  return UnsafeCondition && (UnsafeCondition.isEmpty() ||
+                             canBuildParameterSetCondition(UnsafeCondition,
+                                                           TheLoop));
+}
+
+bool LoopVectorizationLegality::dropPolyhedralDependences() {
+  assert(UsesPolyhedralDependences);
+  if (!LAI->canVectorizeMemory())
+    return false;
+  UsesPolyhedralDependences = false;
+  MaxSafeVectorWidth = UINT_MAX;
+  Requirements->addRuntimePointerChecks(LAI->getNumRuntimePointerChecks());
+  return true;
+}
+
 bool LoopVectorizationLegality::isInductionPhi(const Value *V) {
   Value *In0 = const_cast<Value *>(V);
   PHINode *PN = dyn_cast_or_null<PHINode>(In0);
@@ -6232,7 +6436,7 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
     return None;
   }
 
-  if (Legal->getRuntimePointerChecking()->Need && TTI.hasBranchDivergence()) {
+  if (Legal->requiresRuntimePointerChecks() && TTI.hasBranchDivergence()) {
     // TODO: It may by useful to do since it's still likely to be dynamically
     // uniform if the target can skip.
     DEBUG(dbgs() << "LV: Not inserting runtime ptr check for divergent target");
@@ -6248,7 +6452,7 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
   if (!OptForSize) // Remaining checks deal with scalar loop when OptForSize.
     return computeFeasibleMaxVF(OptForSize, TC);
 
-  if (Legal->getRuntimePointerChecking()->Need) {
+  if (Legal->requiresRuntimePointerChecks()) {
     ORE->emit(createMissedAnalysis("CantVersionLoopWithOptForSize")
               << "runtime pointer checks needed. Enable vectorization of this "
                  "loop with '#pragma clang loop vectorize(enable)' when "
@@ -6309,6 +6513,11 @@ LoopVectorizationCostModel::computeFeasibleMaxVF(bool OptForSize,
 
   unsigned MaxVectorSize = WidestRegister / WidestType;
 
+  // The polyhedral dependences might restrict the number of iterations that
+  // can be executed in lock-step.
+  unsigned MaxSafeVectorWidth = PowerOf2Floor(Legal->getMaxSafeVectorWidth());
+  MaxVectorSize = std::min(MaxVectorSize, MaxSafeVectorWidth);
+
   DEBUG(dbgs() << "LV: The Smallest and Widest types: " << SmallestType << " / "
                << WidestType << " bits.\n");
   DEBUG(dbgs() << "LV: The Widest register safe to use is: " << WidestRegister
@@ -6335,7 +6544,8 @@ LoopVectorizationCostModel::computeFeasibleMaxVF(bool OptForSize,
     // Collect all viable vectorization factors larger than the default MaxVF
     // (i.e. MaxVectorSize).
     SmallVector<unsigned, 8> VFs;
-    unsigned NewMaxVectorSize = WidestRegister / SmallestType;
+    unsigned NewMaxVectorSize =
+        std::min(WidestRegister / SmallestType, MaxSafeVectorWidth);
     for (unsigned VS = MaxVectorSize * 2; VS <= NewMaxVectorSize; VS *= 2)
       VFs.push_back(VS);
 
@@ -6477,7 +6687,8 @@ unsigned LoopVectorizationCostModel::selectInterleaveCount(bool OptForSize,
     return 1;
 
   // We used the distance for the interleave count.
-  if (Legal->getMaxSafeDepDistBytes() != -1U)
+  if (Legal->getMaxSafeDepDistBytes() != -1U ||
+      Legal->getMaxSafeVectorWidth() != UINT_MAX)
     return 1;
 
   // Do not interleave loops with a relatively small trip count.
@@ -6553,7 +6764,7 @@ unsigned LoopVectorizationCostModel::selectInterleaveCount(bool OptForSize,
   // Note that if we've already vectorized the loop we will have done the
   // runtime check and so interleaving won't require further checks.
   bool InterleavingRequiresRuntimePointerCheck =
-      (VF == 1 && Legal->getRuntimePointerChecking()->Need);
+      (VF == 1 && Legal->requiresRuntimePointerChecks());
 
   // We want to interleave small loops in order to reduce the loop overhead and
   // potentially expose ILP opportunities.
@@ -7538,6 +7749,7 @@ INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopAccessLegacyAnalysis)
 INITIALIZE_PASS_DEPENDENCY(DemandedBitsWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PolyhedralDependenceInfoWrapperPass)
 INITIALIZE_PASS_END(LoopVectorize, LV_NAME, lv_name, false, false)
 
 namespace llvm {
@@ -8509,7 +8721,7 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   // Check if it is legal to vectorize the loop.
   LoopVectorizationRequirements Requirements(*ORE);
   LoopVectorizationLegality LVL(L, PSE, DT, TLI, AA, F, TTI, GetLAA, LI, ORE,
-                                &Requirements, &Hints);
+                                &Requirements, &Hints, PDI);
   if (!LVL.canVectorize()) {
     DEBUG(dbgs() << "LV: Not vectorizing: Cannot prove legality.\n");
     emitMissedWarning(F, L, Hints, ORE);
@@ -8642,6 +8854,22 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   // Override IC if user provided an interleave count.
   IC = UserIC > 0 ? UserIC : IC;
 
+  // The guard derived from the polyhedral dependences depends on the number
+  // of iterations executed in lock-step, which is only known now. If it cannot
+  // be built for them, fall back to the runtime pointer checks.
+  if ((VectorizeLoop || InterleaveLoop) && LVL.usesPolyhedralDependences() &&
+      !LVL.canUsePolyhedralCheck(VF.Width * IC)) {
+    DEBUG(dbgs() << "LV: Cannot check the polyhedral dependences for "
+                 << VF.Width * IC << " iterations in lock-step.\n");
+    if (!LVL.dropPolyhedralDependences() ||
+        Requirements.doesNotMeet(F, L, Hints)) {
+      DEBUG(dbgs() << "LV: Not vectorizing: polyhedral dependences cannot be "
+                      "checked.\n");
+      emitMissedWarning(F, L, Hints, ORE);
+      return false;
+    }
+  }
+
   // Emit diagnostic messages, if any.
   const char *VAPassName = Hints.vectorizeAnalysisPassName();
   if (!VectorizeLoop && !InterleaveLoop) {
@@ -8731,7 +8959,7 @@ bool LoopVectorizePass::runImpl(
     DominatorTree &DT_, BlockFrequencyInfo &BFI_, TargetLibraryInfo *TLI_,
     DemandedBits &DB_, AliasAnalysis &AA_, AssumptionCache &AC_,
     std::function<const LoopAccessInfo &(Loop &)> &GetLAA_,
-    OptimizationRemarkEmitter &ORE_) {
+    OptimizationRemarkEmitter &ORE_, PolyhedralDependenceInfo *PDI_) {
   SE = &SE_;
   LI = &LI_;
   TTI = &TTI_;
@@ -8743,6 +8971,7 @@ bool LoopVectorizePass::runImpl(
   GetLAA = &GetLAA_;
   DB = &DB_;
   ORE = &ORE_;
+  PDI = PDI_;
 
   // Don't attempt if
   // 1. the target claims to have no vector registers, and
@@ -8808,8 +9037,12 @@ PreservedAnalyses LoopVectorizePass::run(Function &F,
       LoopStandardAnalysisResults AR = {AA, AC, DT, LI, SE, TLI, TTI, nullptr};
       return LAM.getResult<LoopAccessAnalysis>(L, AR);
     };
+    PolyhedralDependenceInfo *PDI = nullptr;
+    if (UsePolyhedralDependences)
+      PDI = &AM.getResult<PolyhedralDependenceInfoAnalysis>(F);
+
     bool Changed =
-        runImpl(F, SE, LI, TTI, DT, BFI, &TLI, DB, AA, AC, GetLAA, ORE);
+        runImpl(F, SE, LI, TTI, DT, BFI, &TLI, DB, AA, AC, GetLAA, ORE, PDI);
     if (!Changed)
       return PreservedAnalyses::all();
     PreservedAnalyses PA;
@@ -0,0 +1,226 @@
+; RUN: opt -polyhedral-dependence-info -analyze < %s | FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+;    void raw_distance_1(int *A) {
+;      for (int i = 0; i < 1000; i++)
+;        A[i + 1] = A[i];
+;    }
+; CHECK-LABEL: 'raw_distance_1'
+; CHECK:      Loop: for.body
+; CHECK-NEXT:   Dependences:
+; CHECK-NEXT:    - RAW [level 1, exact]
+; CHECK-NEXT:        from: store i32 %tmp, i32* %arrayidx1, align 4
+; CHECK-NEXT:        to:   %tmp = load i32, i32* %arrayidx, align 4
+; CHECK-NEXT:        distance: { [1] }
+; CHECK-NEXT:   Max safe vector width: 1
+define void @raw_distance_1(i32* %A) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv.next
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;    void raw_distance_4(int *A) {
+;      for (int i = 0; i < 1000; i++)
+;        A[i + 4] = A[i];
+;    }
+; CHECK-LABEL: 'raw_distance_4'
+; CHECK:      Loop: for.body
+; CHECK-NEXT:   Dependences:
+; CHECK-NEXT:    - RAW [level 1, exact]
+; CHECK-NEXT:        from: store i32 %tmp, i32* %arrayidx1, align 4
+; CHECK-NEXT:        to:   %tmp = load i32, i32* %arrayidx, align 4
+; CHECK-NEXT:        distance: { [4] }
+; CHECK-NEXT:   Max safe vector width: 4
+define void @raw_distance_4(i32* %A) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %idx = add nuw nsw i64 %indvars.iv, 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %idx
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;    void war_forward(int *A) {
+;      for (int i = 0; i < 1000; i++)
+;        A[i] = A[i + 1];
+;    }
+; CHECK-LABEL: 'war_forward'
+; CHECK:      Loop: for.body
+; CHECK-NEXT:   Dependences:
+; CHECK-NEXT:    - WAR [level 1, exact]
+; CHECK-NEXT:        from: %tmp = load i32, i32* %arrayidx, align 4
+; CHECK-NEXT:        to:   store i32 %tmp, i32* %arrayidx1, align 4
+; CHECK-NEXT:        distance: { [1] }
+; CHECK-NEXT:   Max safe vector width: unlimited
+define void @war_forward(i32* %A) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %indvars.iv.next
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;    void copy(int *A, int *B) {
+;      for (int i = 0; i < 1000; i++)
+;        A[i] = B[i];
+;    }
+; CHECK-LABEL: 'copy'
+; CHECK:      Loop: for.body
+; CHECK-NEXT:   May alias: B, A
+; CHECK-NEXT:   Dependences: None
+; CHECK-NEXT:   Max safe vector width: 1
+define void @copy(i32* %A, i32* %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;    void copy_noalias(int *restrict A, int *restrict B) {
+;      for (int i = 0; i < 1000; i++)
+;        A[i] = B[i];
+;    }
+; CHECK-LABEL: 'copy_noalias'
+; CHECK:      Loop: for.body
+; CHECK-NEXT:   Dependences: None
+; CHECK-NEXT:   Max safe vector width: unlimited
+define void @copy_noalias(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;    void matrix(int A[][1024]) {
+;      for (int i = 1; i < 1000; i++)
+;        for (int j = 0; j < 1000; j++)
+;          A[i][j] = A[i - 1][j + 1];
+;    }
+; CHECK-LABEL: 'matrix'
+; CHECK:      Loop: for.i
+; CHECK-NEXT:   Dependences:
+; CHECK-NEXT:    - RAW [level 1, exact]
+; CHECK-NEXT:        from: store i32 %tmp, i32* %arrayidx1, align 4
+; CHECK-NEXT:        to:   %tmp = load i32, i32* %arrayidx, align 4
+; CHECK-NEXT:        distance: { [1, -1] }
+; CHECK:      Loop: for.j
+; CHECK-NEXT:   Dependences: None
+; CHECK-NEXT:   Max safe vector width: unlimited
+define void @matrix([1024 x i32]* %A) {
+entry:
+  br label %for.i
+
+for.i:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.i.latch ]
+  %i.prev = add nsw i64 %i, -1
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 0, %for.i ], [ %j.next, %for.j ]
+  %j.next = add nuw nsw i64 %j, 1
+  %arrayidx = getelementptr inbounds [1024 x i32], [1024 x i32]* %A, i64 %i.prev, i64 %j.next
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds [1024 x i32], [1024 x i32]* %A, i64 %i, i64 %j
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %exitcond.j = icmp eq i64 %j.next, 1000
+  br i1 %exitcond.j, label %for.i.latch, label %for.j
+
+for.i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond.i = icmp eq i64 %i.next, 1000
+  br i1 %exitcond.i, label %for.end, label %for.i
+
+for.end:
+  ret void
+}
+
+; The zero extension of n is modeled as n itself, which is only valid for
+; non-negative values of n. The dependences are only reported for them.
+;
+;    void zext_offset(int *A, unsigned n) {
+;      for (long i = 0; i < 1000; i++)
+;        A[i] = A[i + n + 1];
+;    }
+; CHECK-LABEL: 'zext_offset'
+; CHECK:      Loop: for.body
+; CHECK-NEXT:   Invalid context: [n] -> { [] : n < 0 }
+; CHECK-NEXT:   Dependences:
+; CHECK-NEXT:    - WAR [level 1, exact]
+; CHECK-NEXT:        from: %load = load i32, i32* %arrayidx.load, align 4
+; CHECK-NEXT:        to:   store i32 %load, i32* %arrayidx.store, align 4
+; CHECK-NEXT:        distance: [n] -> { [1 + n] : 0 <= n <= 998 }
+; CHECK-NEXT:   Max safe vector width: 1
+define void @zext_offset(i32* %A, i32 %n) {
+entry:
+  %n.ext = zext i32 %n to i64
+  %off = add nuw nsw i64 %n.ext, 1
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %add = add nuw nsw i64 %i, %off
+  %arrayidx.load = getelementptr inbounds i32, i32* %A, i64 %add
+  %load = load i32, i32* %arrayidx.load, align 4
+  %arrayidx.store = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 %load, i32* %arrayidx.store, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -12,6 +12,9 @@ target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
 ; CHECK: { [i0] -> [(1)] : 0 <= i0 <= 9 } [for.body]
 ; CHECK: { [i0] -> [(1)] : 0 <= i0 <= 9 } [for.inc]
 ; CHECK: { [] -> [(1)] } [for.end]
+; CHECK: ALLOCATIONS:
+; CHECK-NEXT: PEXPs allocated: {{[1-9][0-9]*}} ({{[0-9]+}} bytes in the arena)
+; CHECK-NEXT: PEXPs recycled: 0, free: 0
 define void @simple1(i32* %A) {
 entry:
   br label %for.cond
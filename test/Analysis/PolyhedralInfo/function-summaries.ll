@@ -0,0 +1,73 @@
+; RUN: opt -polyhedral-value-info -analyze < %s | FileCheck %s --check-prefix=CHECK --check-prefix=NOSUM
+; RUN: opt -polyhedral-value-info -pvi-function-summaries -analyze < %s | FileCheck %s --check-prefix=CHECK --check-prefix=SUM
+;
+; In the new pass manager the summaries have to be computed before the
+; polyhedral value analysis uses them. The default pipeline does so if they
+; are enabled. They are dropped once a transformation changed the module and
+; the polyhedral values derived from them are dropped as well.
+;
+; RUN: opt -passes='default<O2>' -pvi-function-summaries -debug-pass-manager -disable-output < %s 2>&1 | FileCheck %s --check-prefix=PIPELINE
+; RUN: opt -passes='default<O2>' -debug-pass-manager -disable-output < %s 2>&1 | FileCheck %s --check-prefix=NOPIPELINE
+; RUN: opt -passes='require<polyhedral-function-summaries>,function(require<polyhedral-value>),cgscc(function-attrs)' -pvi-function-summaries -debug-pass-manager -disable-output < %s 2>&1 | FileCheck %s --check-prefix=INVALIDATE
+; RUN: opt -passes='require<polyhedral-function-summaries>,function(require<polyhedral-value>),invalidate<polyhedral-function-summaries>' -pvi-function-summaries -debug-pass-manager -disable-output < %s 2>&1 | FileCheck %s --check-prefix=OUTER
+;
+; PIPELINE:        Running pass: RequireAnalysisPass<{{.*}}PolyhedralFunctionSummariesAnalysis
+; PIPELINE-NEXT:   Running analysis: {{.*}}PolyhedralFunctionSummariesAnalysis
+; NOPIPELINE-NOT:  PolyhedralFunctionSummariesAnalysis
+; INVALIDATE:      Running pass: {{.*}}PostOrderFunctionAttrsPass
+; INVALIDATE:      Invalidating analysis: {{.*}}PolyhedralFunctionSummariesAnalysis
+; OUTER:           Running pass: InvalidateAnalysisPass<{{.*}}PolyhedralFunctionSummariesAnalysis>
+; OUTER:           Invalidating analysis: {{.*}}PolyhedralValueInfoAnalysis on caller
+; OUTER:           Invalidating analysis: {{.*}}PolyhedralFunctionSummariesAnalysis
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+;    long max0(long x) {
+;      return x > 0 ? x : 0;
+;    }
+define i64 @max0(i64 %x) {
+entry:
+  %cmp = icmp sgt i64 %x, 0
+  %r = select i1 %cmp, i64 %x, i64 0
+  ret i64 %r
+}
+
+;    long load(long *A) {
+;      return *A;
+;    }
+define i64 @load(i64* %A) {
+entry:
+  %v = load i64, i64* %A
+  ret i64 %v
+}
+
+;    void caller(long *A, long b) {
+;      long c = max0(b);
+;      long d = load(A);
+;      for (long i = 0; i < 1000; i++)
+;        A[max0(i)] = c + d;
+;    }
+; CHECK-LABEL: 'caller'
+; NOSUM:      [c] -> { [] -> [(c)] } [c] [UNKNOWN] [Scope: <max>]
+; SUM:        [b] -> { [] -> [({{.*}})] : {{.*}} } [c] [UNKNOWN] [Scope: <max>]
+; CHECK:      [d] -> { [] -> [(d)] } [d] [UNKNOWN] [Scope: <max>]
+; NOSUM:      [idx] -> { [i0] -> [(idx)] } [idx] [UNKNOWN] [Scope: <max>]
+; SUM:        { [i0] -> [({{.*}}i0{{.*}})] {{.*}}} [idx] [UNKNOWN] [Scope: <max>]
+define void @caller(i64* %A, i64 %b) {
+entry:
+  %c = call i64 @max0(i64 %b)
+  %d = call i64 @load(i64* %A)
+  %sum = add i64 %c, %d
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %idx = call i64 @max0(i64 %i)
+  %arrayidx = getelementptr inbounds i64, i64* %A, i64 %idx
+  store i64 %sum, i64* %arrayidx
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
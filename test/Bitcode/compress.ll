@@ -0,0 +1,56 @@
+; Check that compressed bitcode is read like uncompressed bitcode, also with
+; the function blocks decoded on several threads, and that the summary of a
+; compressed module can be read.
+
+; RUN: llvm-as < %s -o %t.bc
+; RUN: llvm-as -compress-bitcode < %s -o %t.bcz
+; RUN: head -c 4 %t.bcz | FileCheck -check-prefix=MAGIC %s
+; RUN: llvm-dis < %t.bc -o %t.ll
+; RUN: llvm-dis < %t.bcz -o %t.z.ll
+; RUN: diff %t.ll %t.z.ll
+; RUN: llvm-dis -bitcode-materialize-threads=2 < %t.bcz -o %t.z.parallel.ll
+; RUN: diff %t.ll %t.z.parallel.ll
+; RUN: FileCheck %s < %t.z.ll
+
+; RUN: opt -module-summary -compress-bitcode %s -o %t.summary.bcz
+; RUN: llvm-dis < %t.summary.bcz | FileCheck %s
+; RUN: llvm-lto -thinlto -o %t.index %t.summary.bcz
+; RUN: llvm-bcanalyzer -dump %t.index.thinlto.bc | \
+; RUN:   FileCheck -check-prefix=INDEX %s
+
+; MAGIC: BCLZ
+
+; CHECK: @g = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+@g = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+; CHECK-LABEL: define i32 @first(i32 %x)
+; CHECK: %sum = add i32 %x, 42, !dbg
+define i32 @first(i32 %x) !dbg !6 {
+entry:
+  %sum = add i32 %x, 42, !dbg !8
+  store i32 %sum, i32* getelementptr inbounds ([4 x i32], [4 x i32]* @g, i64 0, i64 1)
+  ret i32 %sum
+}
+
+; CHECK-LABEL: define i32 @second(i32 %n)
+; CHECK: call i32 @first(i32 %n)
+define i32 @second(i32 %n) {
+entry:
+  %r = call i32 @first(i32 %n)
+  ret i32 %r
+}
+
+; INDEX: <GLOBALVAL_SUMMARY_BLOCK
+; INDEX: <COMBINED
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!8 = !DILocation(line: 2, column: 3, scope: !6)
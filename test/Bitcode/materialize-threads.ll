@@ -0,0 +1,80 @@
+; Check that decoding the function blocks ahead on several threads reads the
+; same module as decoding them in order, including the nested constant,
+; metadata and symbol table blocks, debug locations, use-list orders and
+; functions materialized out of order because of block addresses.
+
+; RUN: llvm-as -preserve-bc-uselistorder < %s -o %t.bc
+; RUN: llvm-dis -preserve-ll-uselistorder < %t.bc -o %t.serial.ll
+; RUN: llvm-dis -preserve-ll-uselistorder -bitcode-materialize-threads=2 \
+; RUN:   < %t.bc -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+
+; CHECK: @ba = global i8* blockaddress(@later, %target)
+@ba = global i8* blockaddress(@later, %target)
+@g = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+; CHECK-LABEL: define i32 @first(i32 %x)
+; CHECK: %sum = add i32 %x, 42, !dbg
+; CHECK: store i32 %sum, i32* getelementptr inbounds ([4 x i32], [4 x i32]* @g, i64 0, i64 1)
+; CHECK: uselistorder i32 %x, { 1, 0 }
+define i32 @first(i32 %x) !dbg !6 {
+entry:
+  %sum = add i32 %x, 42, !dbg !8
+  %prod = mul i32 %x, %sum, !dbg !9
+  store i32 %sum, i32* getelementptr inbounds ([4 x i32], [4 x i32]* @g, i64 0, i64 1)
+  ret i32 %prod
+  uselistorder i32 %x, { 1, 0 }
+}
+
+; CHECK-LABEL: define i32 @second(i32 %n)
+; CHECK: %iv = phi i32 [ 0, %entry ], [ %iv.next, %loop ]
+; CHECK: call i32 @first(i32 %iv), !prof
+define i32 @second(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %iv = phi i32 [ 0, %entry ], [ %iv.next, %loop ]
+  %r = call i32 @first(i32 %iv), !prof !10
+  %iv.next = add nuw i32 %iv, 1
+  %c = icmp ult i32 %iv.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %r
+}
+
+; CHECK-LABEL: define void @user()
+; CHECK: indirectbr i8* blockaddress(@later, %target), [label %done]
+define void @user() {
+entry:
+  indirectbr i8* blockaddress(@later, %target), [label %done]
+
+done:
+  ret void
+}
+
+; CHECK-LABEL: define void @later()
+; CHECK: target:
+define void @later() {
+entry:
+  br label %target
+
+target:
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!8 = !DILocation(line: 2, column: 3, scope: !6)
+!9 = !DILocation(line: 3, column: 5, scope: !6)
+!10 = !{!"branch_weights", i32 7}
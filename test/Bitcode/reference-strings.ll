@@ -0,0 +1,38 @@
+; Check that a module whose metadata strings refer to the input buffer reads
+; the same as a module with copies of the strings, with lazily and eagerly
+; loaded module metadata and with function metadata.
+
+; RUN: llvm-as < %s -o %t.bc
+; RUN: llvm-dis < %t.bc -o %t.copied.ll
+; RUN: llvm-dis -reference-strings < %t.bc -o %t.referenced.ll
+; RUN: diff %t.copied.ll %t.referenced.ll
+; RUN: FileCheck %s < %t.referenced.ll
+; RUN: llvm-dis -materialize-metadata -reference-strings < %t.bc \
+; RUN:   | FileCheck %s --check-prefix=METADATA
+
+; CHECK: define i64 @reg() !dbg
+; CHECK: call i64 @llvm.read_register.i64(metadata !{{[0-9]+}}), !annotation
+; CHECK-DAG: !{!"rsp"}
+; CHECK-DAG: !DIFile(filename: "reference-strings.c", directory: "/tmp")
+; CHECK-DAG: !{!"a function string"}
+; METADATA: !DIFile(filename: "reference-strings.c", directory: "/tmp")
+
+define i64 @reg() !dbg !5 {
+  %sp = call i64 @llvm.read_register.i64(metadata !7), !annotation !8
+  ret i64 %sp
+}
+
+declare i64 @llvm.read_register.i64(metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "reference-strings.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = distinct !DISubprogram(name: "reg", scope: !1, file: !1, line: 1, type: !6, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!6 = !DISubroutineType(types: !2)
+!7 = !{!"rsp"}
+!8 = !{!"a function string"}
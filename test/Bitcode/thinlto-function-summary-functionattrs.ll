@@ -1,15 +1,22 @@
 ; RUN: opt -module-summary %s -o %t.o
 ; RUN: llvm-bcanalyzer -dump %t.o | FileCheck %s
 
+; The body flags readnone, readonly, nounwind and no unknown calls are
+; encoded as 32, 64, 128 and 256.
+
 ; CHECK: <GLOBALVAL_SUMMARY_BLOCK
 ; ensure @f is marked readnone
-; CHECK:  <PERMODULE {{.*}} op0=0 {{.*}} op3=1
+; CHECK:  <PERMODULE {{.*}} op0=0 {{.*}} op3=481
 ; ensure @g is marked readonly
-; CHECK:  <PERMODULE {{.*}} op0=1 {{.*}} op3=2
+; CHECK:  <PERMODULE {{.*}} op0=1 {{.*}} op3=482
 ; ensure @h is marked norecurse
-; CHECK:  <PERMODULE {{.*}} op0=2 {{.*}} op3=4
+; CHECK:  <PERMODULE {{.*}} op0=2 {{.*}} op3=484
 ; ensure @i is marked returndoesnotalias
-; CHECK:  <PERMODULE {{.*}} op0=3 {{.*}} op3=8
+; CHECK:  <PERMODULE {{.*}} op0=3 {{.*}} op3=488
+; ensure @j is marked nounwind, the call to @f is not part of the body
+; CHECK:  <PERMODULE {{.*}} op0=4 {{.*}} op3=400
+; ensure the indirect call in @k is unknown
+; CHECK:  <PERMODULE {{.*}} op0=5 {{.*}} op3=0 op4=
 
 define void @f() readnone {
    ret void
@@ -25,3 +32,14 @@ define noalias i8* @i() {
    %r = alloca i8
    ret i8* %r
 }
+
+define void @j(i8* %p) nounwind {
+   call void @f()
+   store i8 0, i8* %p
+   ret void
+}
+
+define void @k(void ()* %fp) {
+   call void %fp()
+   ret void
+}
@@ -0,0 +1,40 @@
+; Test the polyhedral pointer argument access summaries.
+; RUN: opt -module-summary -module-summary-param-accesses %s -o %t.o
+; RUN: llvm-bcanalyzer -dump %t.o | FileCheck %s
+; RUN: opt -module-summary %s -o %t2.o
+; RUN: llvm-bcanalyzer -dump %t2.o | FileCheck %s --check-prefix=NOACC
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The argument %A (0) is written and %B (1) is read in the byte range
+; [0, 4 * N - 1] where N is the argument 2. Signed values are sign rotated.
+;
+; CHECK: <GLOBALVAL_SUMMARY_BLOCK
+; CHECK: <PARAM_ACCESSES op0=0 op1=14 op2=0 op3=0 op4=3 op5=1 op6=2 op7=8 op8=1 op9=13 op10=0 op11=0 op12=3 op13=1 op14=2 op15=8/>
+; CHECK: </GLOBALVAL_SUMMARY_BLOCK>
+;
+; NOACC-NOT: <PARAM_ACCESSES
+;
+;    void copy(int *A, int *B, long N) {
+;      for (long i = 0; i < N; i++)
+;        A[i] = B[i];
+;    }
+;
+define void @copy(i32* %A, i32* %B, i64 %N) {
+entry:
+  %cmp5 = icmp sgt i64 %N, 0
+  br i1 %cmp5, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %i
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %N
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
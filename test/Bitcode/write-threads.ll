@@ -0,0 +1,77 @@
+; Check that writing the function blocks on several threads produces the same
+; bitcode as writing them in order, including the use-list orders of values
+; used by several functions and the offsets of the function blocks.
+
+; RUN: llvm-as -preserve-bc-uselistorder < %s -o %t.serial.bc
+; RUN: llvm-as -preserve-bc-uselistorder -bitcode-write-threads=2 < %s \
+; RUN:   -o %t.parallel.bc
+; RUN: cmp %t.serial.bc %t.parallel.bc
+; RUN: llvm-dis -preserve-ll-uselistorder < %t.parallel.bc | FileCheck %s
+
+; RUN: opt -module-summary -bitcode-write-threads=3 %s -o %t.summary.bc
+; RUN: opt -module-summary %s -o %t.summary.serial.bc
+; RUN: cmp %t.summary.serial.bc %t.summary.bc
+
+@g = global i32 0
+@ba = global i8* blockaddress(@last, %target)
+
+; CHECK-LABEL: define i32 @first(i32 %x)
+; CHECK: %sum = add i32 %x, 42, !dbg
+; CHECK: uselistorder i32 %x, { 1, 0 }
+define i32 @first(i32 %x) !dbg !6 {
+entry:
+  %sum = add i32 %x, 42, !dbg !8
+  %prod = mul i32 %x, %sum, !dbg !9
+  store i32 %sum, i32* @g
+  ret i32 %prod
+  uselistorder i32 %x, { 1, 0 }
+}
+
+declare void @external()
+
+; CHECK-LABEL: define i32 @second(i32 %n)
+; CHECK: call i32 @first(i32 %iv), !prof
+define i32 @second(i32 %n) {
+entry:
+  %v = load i32, i32* @g
+  br label %loop
+
+loop:
+  %iv = phi i32 [ %v, %entry ], [ %iv.next, %loop ]
+  %r = call i32 @first(i32 %iv), !prof !10
+  call void @external()
+  %iv.next = add nuw i32 %iv, 1
+  %c = icmp ult i32 %iv.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %r
+}
+
+; CHECK-LABEL: define void @last()
+; CHECK: indirectbr i8* blockaddress(@last, %target), [label %target]
+define void @last() {
+entry:
+  store i32 1, i32* @g
+  indirectbr i8* blockaddress(@last, %target), [label %target]
+
+target:
+  ret void
+}
+
+; CHECK: uselistorder i32* @g, { 2, 0, 1 }
+uselistorder i32* @g, { 2, 0, 1 }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!8 = !DILocation(line: 2, column: 3, scope: !6)
+!9 = !DILocation(line: 3, column: 5, scope: !6)
+!10 = !{!"branch_weights", i32 7}
@@ -0,0 +1,95 @@
+; Check that parsing the regular LTO modules on link threads produces the same
+; combined module as linking them while they are parsed.
+
+; RUN: llvm-as %s -o %t1.o
+; RUN: llvm-as %p/Inputs/parallel-link.ll -o %t2.o
+; RUN: llvm-lto2 run -save-temps -o %t.serial %t1.o %t2.o \
+; RUN:  -r=%t1.o,g,px \
+; RUN:  -r=%t1.o,shared,px \
+; RUN:  -r=%t1.o,w, \
+; RUN:  -r=%t1.o,c,px \
+; RUN:  -r=%t1.o,f,px \
+; RUN:  -r=%t1.o,al,px \
+; RUN:  -r=%t1.o,other, \
+; RUN:  -r=%t2.o,shared, \
+; RUN:  -r=%t2.o,w,px \
+; RUN:  -r=%t2.o,other,px \
+; RUN:  -r=%t2.o,c,
+; RUN: llvm-lto2 run -save-temps -o %t.parallel %t1.o %t2.o \
+; RUN:  -regular-lto-link-threads=2 \
+; RUN:  -r=%t1.o,g,px \
+; RUN:  -r=%t1.o,shared,px \
+; RUN:  -r=%t1.o,w, \
+; RUN:  -r=%t1.o,c,px \
+; RUN:  -r=%t1.o,f,px \
+; RUN:  -r=%t1.o,al,px \
+; RUN:  -r=%t1.o,other, \
+; RUN:  -r=%t2.o,shared, \
+; RUN:  -r=%t2.o,w,px \
+; RUN:  -r=%t2.o,other,px \
+; RUN:  -r=%t2.o,c,
+; RUN: llvm-dis < %t.serial.0.0.preopt.bc -o %t.serial.ll
+; RUN: llvm-dis < %t.parallel.0.0.preopt.bc -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+
+; CHECK: @llvm.global_ctors = appending global [2 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor1, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @ctor2, i8* null }]
+; CHECK: @g = {{.*}}global i32 1, !dbg
+; CHECK: @c = common {{.*}}global [8 x i8] zeroinitializer, align 8
+; CHECK: @al = {{.*}}alias void (), void ()* @f
+
+; CHECK: define {{.*}}void @f()
+; CHECK: define weak_odr {{.*}}void @shared()
+; CHECK-NEXT: ret void
+; CHECK: define weak {{.*}}void @w()
+; CHECK-NEXT: call void @shared()
+; CHECK: define {{.*}}void @other()
+
+; The structure type is shared by both modules.
+; CHECK: !DICompositeType(tag: DW_TAG_structure_type, name: "S"
+; CHECK-NOT: !DICompositeType(
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor1, i8* null }]
+
+@g = global i32 1, !dbg !3
+@c = common global i32 0, align 4
+
+@al = alias void (), void ()* @f
+
+define void @f() {
+  call void @shared()
+  call void @w()
+  call void @other()
+  ret void
+}
+
+define linkonce_odr void @shared() {
+  ret void
+}
+
+define weak void @w() {
+  ret void
+}
+
+define internal void @ctor1() {
+  ret void
+}
+
+declare void @other()
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!6}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C_plus_plus, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, globals: !2)
+!1 = !DIFile(filename: "a.cpp", directory: "/")
+!2 = !{!3}
+!3 = !DIGlobalVariableExpression(var: !4, expr: !DIExpression())
+!4 = distinct !DIGlobalVariable(name: "g", scope: !0, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true)
+!5 = !DICompositeType(tag: DW_TAG_structure_type, name: "S", file: !1, line: 1, size: 32, elements: !7, identifier: "_ZTS1S")
+!6 = !{i32 2, !"Debug Info Version", i32 3}
+!7 = !{!8}
+!8 = !DIDerivedType(tag: DW_TAG_member, name: "x", scope: !5, file: !1, line: 1, baseType: !9, size: 32)
+!9 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
@@ -0,0 +1,42 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @pure(i32 %x) {
+  %r = call i32 @pure_local(i32 %x)
+  ret i32 %r
+}
+
+define internal i32 @pure_local(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @reader(i32* %p) {
+  %r = load i32, i32* %p
+  ret i32 %r
+}
+
+define void @impure() {
+  call void @unknown()
+  ret void
+}
+
+define void @rec(i32 %n) {
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %exit, label %loop
+
+loop:
+  %m = sub i32 %n, 1
+  call void @rec(i32 %m)
+  br label %exit
+
+exit:
+  ret void
+}
+
+define linkonce_odr i32 @odr(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+declare void @unknown()
@@ -0,0 +1,30 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@G = global i32* null
+
+define void @copy(i32* %A, i32* %B, i32* %C, i64 %N) {
+entry:
+  %cmp5 = icmp sgt i64 %N, 0
+  br i1 %cmp5, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %i
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %N
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The argument is captured and not read in the function itself, still it is
+; neither readnone nor readonly.
+define void @escape(i32* %A) {
+  store i32* %A, i32** @G
+  ret void
+}
@@ -43,6 +43,21 @@
 ; RUN: ls %t.cache | count 2
 ; RUN: ls %t.cache/llvmcache-* | count 2
 
+; Verify that the insertions and the hits are recorded in the index with
+; -cache-index.
+; RUN: rm -Rf %t.cache
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: ls %t.cache/llvmcache-* | count 2
+; RUN: grep -c " llvmcache-" %t.cache/llvmcache.index | FileCheck %s --check-prefix=INDEX
+; INDEX: 4
+
 ; Verify that caches with a timestamp older than the pruning interval
 ; will be pruned
 ; RUN: rm -Rf %t.cache && mkdir %t.cache
@@ -0,0 +1,97 @@
+; Check that the function attributes are propagated over the combined call
+; graph in the thin link and applied to definitions and declarations in the
+; backends.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/function-attrs-propagation.ll -o %t2.bc
+; RUN: llvm-lto2 run %t1.bc %t2.bc -o %t.o -save-temps -thinlto-funcattrs \
+; RUN:   -r=%t1.bc,caller,plx \
+; RUN:   -r=%t1.bc,caller_read,plx \
+; RUN:   -r=%t1.bc,caller_impure,plx \
+; RUN:   -r=%t1.bc,caller_odr,plx \
+; RUN:   -r=%t1.bc,pure, \
+; RUN:   -r=%t1.bc,reader, \
+; RUN:   -r=%t1.bc,impure, \
+; RUN:   -r=%t1.bc,odr, \
+; RUN:   -r=%t2.bc,pure,plx \
+; RUN:   -r=%t2.bc,reader,plx \
+; RUN:   -r=%t2.bc,impure,plx \
+; RUN:   -r=%t2.bc,rec,plx \
+; RUN:   -r=%t2.bc,odr,plx \
+; RUN:   -r=%t2.bc,unknown,
+; RUN: llvm-dis %t.o.1.1.promote.bc -o - | FileCheck %s
+; RUN: llvm-dis %t.o.2.1.promote.bc -o - | FileCheck %s --check-prefix=DEF
+
+; The propagation is only done on request.
+; RUN: llvm-lto2 run %t1.bc %t2.bc -o %t.off.o -save-temps \
+; RUN:   -r=%t1.bc,caller,plx \
+; RUN:   -r=%t1.bc,caller_read,plx \
+; RUN:   -r=%t1.bc,caller_impure,plx \
+; RUN:   -r=%t1.bc,caller_odr,plx \
+; RUN:   -r=%t1.bc,pure, \
+; RUN:   -r=%t1.bc,reader, \
+; RUN:   -r=%t1.bc,impure, \
+; RUN:   -r=%t1.bc,odr, \
+; RUN:   -r=%t2.bc,pure,plx \
+; RUN:   -r=%t2.bc,reader,plx \
+; RUN:   -r=%t2.bc,impure,plx \
+; RUN:   -r=%t2.bc,rec,plx \
+; RUN:   -r=%t2.bc,odr,plx \
+; RUN:   -r=%t2.bc,unknown,
+; RUN: llvm-dis %t.off.o.1.1.promote.bc -o - | FileCheck %s --check-prefix=OFF
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: define {{.*}}i32 @caller(i32 %x) [[PURE:#[0-9]+]]
+define i32 @caller(i32 %x) {
+  %r = call i32 @pure(i32 %x)
+  ret i32 %r
+}
+
+; CHECK: define {{.*}}i32 @caller_read(i32* %p) [[READ:#[0-9]+]]
+define i32 @caller_read(i32* %p) {
+  %r = call i32 @reader(i32* %p)
+  ret i32 %r
+}
+
+; CHECK: define {{.*}}void @caller_impure() {
+define void @caller_impure() {
+  call void @impure()
+  ret void
+}
+
+; Only the prevailing copy of @odr, the one in the other module, decides the
+; attributes of the callers.
+; CHECK: define {{.*}}i32 @caller_odr(i32 %x) [[PURE]]
+define i32 @caller_odr(i32 %x) {
+  %r = call i32 @odr(i32 %x)
+  ret i32 %r
+}
+
+define linkonce_odr i32 @odr(i32 %x) {
+  call void @impure()
+  ret i32 %x
+}
+
+; CHECK: declare {{.*}}i32 @pure(i32) [[PURE]]
+declare i32 @pure(i32)
+; CHECK: declare {{.*}}i32 @reader(i32*) [[READ]]
+declare i32 @reader(i32*)
+; CHECK: declare {{.*}}void @impure(){{$}}
+declare void @impure()
+
+; CHECK: attributes [[PURE]] = { norecurse nounwind readnone }
+; CHECK: attributes [[READ]] = { norecurse nounwind readonly }
+
+; OFF: define {{.*}}i32 @caller(i32 %x) {
+; OFF: declare {{.*}}i32 @pure(i32){{$}}
+
+; DEF: define {{.*}}i32 @pure(i32 %x) [[PURE:#[0-9]+]]
+; DEF: define {{.*}}i32 @pure_local{{.*}}(i32 %x) [[PURE]]
+; DEF: define {{.*}}i32 @reader(i32* %p) [[READ:#[0-9]+]]
+; DEF: define {{.*}}void @impure() {
+; DEF: define {{.*}}void @rec(i32 %n) [[REC:#[0-9]+]]
+; DEF: attributes [[PURE]] = { norecurse nounwind readnone }
+; DEF: attributes [[READ]] = { norecurse nounwind readonly }
+; DEF: attributes [[REC]] = { nounwind readnone }
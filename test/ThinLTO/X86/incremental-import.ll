@@ -0,0 +1,55 @@
+; REQUIRES: asserts
+; Check that an incremental link only recomputes the import lists affected by
+; the modules that changed.
+
+; RUN: opt -module-hash -module-summary %s -o %t1.bc
+; RUN: opt -module-hash -module-summary %p/Inputs/incremental-import-foo.ll -o %t2.bc
+; RUN: opt -module-hash -module-summary %p/Inputs/incremental-import-bar.ll -o %t3.bc
+
+; RUN: rm -Rf %t.cache
+; RUN: llvm-lto2 run -o %t.o %t1.bc %t2.bc %t3.bc -cache-dir %t.cache \
+; RUN:  -thinlto-incremental -debug-only=function-import \
+; RUN:  -r=%t1.bc,main,plx -r=%t1.bc,foo, -r=%t1.bc,bar, \
+; RUN:  -r=%t2.bc,foo,pl -r=%t3.bc,bar,pl 2>&1 \
+; RUN:  | FileCheck %s -DT=%t --check-prefix=FIRST
+; FIRST-DAG: Computing import for Module '[[T]]1.bc'
+; FIRST-DAG: Computing import for Module '[[T]]2.bc'
+; FIRST-DAG: Computing import for Module '[[T]]3.bc'
+
+; Nothing changed, all the import lists are reused.
+; RUN: llvm-lto2 run -o %t.o %t1.bc %t2.bc %t3.bc -cache-dir %t.cache \
+; RUN:  -thinlto-incremental -debug-only=function-import \
+; RUN:  -r=%t1.bc,main,plx -r=%t1.bc,foo, -r=%t1.bc,bar, \
+; RUN:  -r=%t2.bc,foo,pl -r=%t3.bc,bar,pl 2>&1 \
+; RUN:  | FileCheck %s -DT=%t --check-prefix=SAME
+; SAME-NOT: Computing import
+; SAME-DAG: Reusing import for Module '[[T]]1.bc'
+; SAME-DAG: Reusing import for Module '[[T]]2.bc'
+; SAME-DAG: Reusing import for Module '[[T]]3.bc'
+; SAME-NOT: Computing import
+
+; Changing the module defining @bar invalidates the import list of its
+; importer, but not the one of the module defining @foo.
+; RUN: opt -module-hash -module-summary %p/Inputs/incremental-import-bar2.ll -o %t3.bc
+; RUN: llvm-lto2 run -o %t.o %t1.bc %t2.bc %t3.bc -cache-dir %t.cache \
+; RUN:  -thinlto-incremental -debug-only=function-import \
+; RUN:  -r=%t1.bc,main,plx -r=%t1.bc,foo, -r=%t1.bc,bar, \
+; RUN:  -r=%t2.bc,foo,pl -r=%t3.bc,bar,pl -r=%t3.bc,baz,pl 2>&1 \
+; RUN:  | FileCheck %s -DT=%t --check-prefix=CHANGED
+; CHANGED-DAG: Computing import for Module '[[T]]1.bc'
+; CHANGED-DAG: Reusing import for Module '[[T]]2.bc'
+; CHANGED-DAG: Computing import for Module '[[T]]3.bc'
+; RUN: llvm-nm %t.o.1 | FileCheck %s --check-prefix=NM
+; NM: T main
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @foo()
+declare void @bar()
+
+define void @main() {
+  call void @foo()
+  call void @bar()
+  ret void
+}
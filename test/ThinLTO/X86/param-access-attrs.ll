@@ -0,0 +1,46 @@
+; Check that the summarized accesses through pointer arguments mark arguments
+; readonly or readnone in the backends, for definitions and declarations.
+
+; RUN: opt -module-summary -module-summary-param-accesses %s -o %t1.bc
+; RUN: opt -module-summary -module-summary-param-accesses \
+; RUN:   %p/Inputs/param-access-attrs.ll -o %t2.bc
+; RUN: llvm-lto2 run %t1.bc %t2.bc -o %t.o -save-temps -thinlto-funcattrs \
+; RUN:   -r=%t1.bc,caller,plx \
+; RUN:   -r=%t1.bc,copy, \
+; RUN:   -r=%t1.bc,escape, \
+; RUN:   -r=%t2.bc,copy,plx \
+; RUN:   -r=%t2.bc,escape,plx \
+; RUN:   -r=%t2.bc,G,plx
+; RUN: llvm-dis %t.o.1.1.promote.bc -o - | FileCheck %s
+; RUN: llvm-dis %t.o.2.1.promote.bc -o - | FileCheck %s --check-prefix=DEF
+
+; Without the summarized accesses the arguments are not changed.
+; RUN: opt -module-summary %s -o %t3.bc
+; RUN: opt -module-summary %p/Inputs/param-access-attrs.ll -o %t4.bc
+; RUN: llvm-lto2 run %t3.bc %t4.bc -o %t.noacc.o -save-temps -thinlto-funcattrs \
+; RUN:   -r=%t3.bc,caller,plx \
+; RUN:   -r=%t3.bc,copy, \
+; RUN:   -r=%t3.bc,escape, \
+; RUN:   -r=%t4.bc,copy,plx \
+; RUN:   -r=%t4.bc,escape,plx \
+; RUN:   -r=%t4.bc,G,plx
+; RUN: llvm-dis %t.noacc.o.1.1.promote.bc -o - | FileCheck %s --check-prefix=NOACC
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @caller(i32* %A, i32* %B, i32* %C, i64 %N) {
+  call void @copy(i32* %A, i32* %B, i32* %C, i64 %N)
+  call void @escape(i32* %A)
+  ret void
+}
+
+; CHECK: declare {{.*}}void @copy(i32*, i32* readonly, i32* readnone, i64)
+declare void @copy(i32*, i32*, i32*, i64)
+; CHECK: declare {{.*}}void @escape(i32*){{ #[0-9]+$|$}}
+declare void @escape(i32*)
+
+; DEF: define {{.*}}void @copy(i32* %A, i32* readonly %B, i32* readnone %C, i64 %N)
+; DEF: define {{.*}}void @escape(i32* %A) {{[#{]}}
+
+; NOACC: declare {{.*}}void @copy(i32*, i32*, i32*, i64)
@@ -0,0 +1,65 @@
+; Check that the phases of the link and of each backend task, with their cache
+; status, are written in the Chrome trace event format when asked to.
+
+; RUN: opt -module-hash -module-summary %s -o %t.bc
+; RUN: opt -module-hash -module-summary %p/Inputs/cache.ll -o %t2.bc
+
+; RUN: rm -Rf %t.cache %t.json
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: not ls %t.json
+
+; RUN: rm -Rf %t.cache
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache \
+; RUN:  -phase-report=%t.json -thinlto-funcattrs \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s --check-prefix=LINK < %t.json
+; RUN: FileCheck %s --check-prefix=MISS < %t.json
+
+; The second link finds both backend tasks in the cache.
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache \
+; RUN:  -phase-report=%t.json -thinlto-funcattrs \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s --check-prefix=LINK < %t.json
+; RUN: FileCheck %s --check-prefix=HIT < %t.json
+
+; LINK: {"traceEvents":[
+; LINK-NEXT: {"name":"thread_name","ph":"M","pid":0,"tid":0,"args":{"name":"task 0"}},
+; LINK-NEXT: {"name":"add","cat":"lto","ph":"X","pid":0,"tid":0,"ts":{{[0-9]+}},"dur":{{[0-9]+}},"args":{"cpu_us":{{[0-9]+}},"peak_rss_kb":{{[0-9]+}},"module":"{{.*}}phase-report.ll.tmp2.bc"}},
+; LINK-NEXT: {"name":"add",{{.*}}"module":"{{.*}}phase-report.ll.tmp.bc"}},
+; LINK-NEXT: {"name":"dead-symbols",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"link",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"opt",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"codegen",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"import-lists",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"function-attrs",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"internalize",{{.*}}"tid":0,
+; LINK-NEXT: {"name":"resolve-weak",{{.*}}"tid":0,
+; LINK: ],"displayTimeUnit":"ms"}
+
+; MISS-DAG: {"name":"thread_name","ph":"M","pid":0,"tid":1,"args":{"name":"task 1"}}
+; MISS-DAG: {"name":"backend",{{.*}}"tid":1,{{.*}}"module":"{{.*}}phase-report.ll.tmp2.bc","cache":"miss"}}
+; MISS-DAG: {"name":"import",{{.*}}"tid":1,
+; MISS-DAG: {"name":"opt",{{.*}}"tid":1,
+; MISS-DAG: {"name":"codegen",{{.*}}"tid":1,
+; MISS-DAG: {"name":"thread_name","ph":"M","pid":0,"tid":2,"args":{"name":"task 2"}}
+; MISS-DAG: {"name":"backend",{{.*}}"tid":2,{{.*}}"module":"{{.*}}phase-report.ll.tmp.bc","cache":"miss"}}
+; MISS-DAG: {"name":"codegen",{{.*}}"tid":2,
+
+; HIT-DAG: {"name":"backend",{{.*}}"tid":1,{{.*}}"cache":"hit"}}
+; HIT-DAG: {"name":"backend",{{.*}}"tid":2,{{.*}}"cache":"hit"}}
+; HIT-NOT: "name":"import"
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define void @globalfunc() {
+entry:
+  ret void
+}
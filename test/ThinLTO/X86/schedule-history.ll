@@ -0,0 +1,44 @@
+; Check that the in-process ThinLTO backend records the time of each backend
+; job in the cache directory when asked to.
+
+; RUN: opt -module-hash -module-summary %s -o %t.bc
+; RUN: opt -module-hash -module-summary %p/Inputs/cache.ll -o %t2.bc
+
+; Without -thinlto-schedule-history no history is written.
+; RUN: rm -Rf %t.cache
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: not ls %t.cache/llvmcache.backend-times
+
+; RUN: rm -Rf %t.cache
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache \
+; RUN:  -thinlto-schedule-history \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s < %t.cache/llvmcache.backend-times
+
+; Malformed lines in the history are ignored and dropped on the next link.
+; RUN: echo "garbage" >> %t.cache/llvmcache.backend-times
+; RUN: echo "-1.0	%t3.bc" >> %t.cache/llvmcache.backend-times
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache \
+; RUN:  -thinlto-schedule-history \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s < %t.cache/llvmcache.backend-times
+
+; CHECK-NOT: garbage
+; CHECK: {{^[0-9]+\.[0-9]+}}	{{.*}}schedule-history.ll.tmp.bc{{$}}
+; CHECK-NEXT: {{^[0-9]+\.[0-9]+}}	{{.*}}schedule-history.ll.tmp2.bc{{$}}
+; CHECK-NOT: tmp3
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define void @globalfunc() #0 {
+entry:
+  ret void
+}
@@ -0,0 +1,27 @@
+@globalvar = global i32 1, align 4
+@staticvar = internal global i32 1, align 4
+
+@analias = alias void (), void ()* @globalfunc
+
+define void @globalfunc() #0 {
+entry:
+  ret void
+}
+
+define void @callstaticfunc() #0 {
+entry:
+  call void @staticfunc()
+  ret void
+}
+
+define internal void @staticfunc() #0 {
+entry:
+  %0 = load i32, i32* @staticvar, align 4
+  store i32 %0, i32* @globalvar, align 4
+  ret void
+}
+
+define void @notimported() #0 {
+entry:
+  ret void
+}
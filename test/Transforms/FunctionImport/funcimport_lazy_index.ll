@@ -0,0 +1,43 @@
+; Check that the summaries of a combined index with an index of the summaries
+; are decoded on demand by the importer.
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: opt -module-summary %p/Inputs/funcimport_lazy_index.ll -o %t2.bc
+; RUN: llvm-lto -thinlto -bitcode-summary-index-threshold=0 -o %t3 %t.bc %t2.bc
+; RUN: llvm-bcanalyzer -dump %t3.thinlto.bc | FileCheck %s --check-prefix=BCAN
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -S | FileCheck %s
+
+; Without the index the summaries are decoded eagerly, with the same result.
+; RUN: llvm-lto -thinlto -o %t4 %t.bc %t2.bc
+; RUN: llvm-bcanalyzer -dump %t4.thinlto.bc | FileCheck %s --check-prefix=NOINDEX
+; RUN: opt -function-import -summary-file %t4.thinlto.bc %t.bc -S | FileCheck %s
+
+; The summaries of a compressed combined index are decoded on demand as well,
+; from the decompressed bytes kept alive by the summary loader.
+; RUN: llvm-lto -thinlto -compress-bitcode -bitcode-summary-index-threshold=0 \
+; RUN:   -o %t5 %t.bc %t2.bc
+; RUN: head -c 4 %t5.thinlto.bc | FileCheck %s --check-prefix=MAGIC
+; RUN: opt -function-import -summary-file %t5.thinlto.bc %t.bc -S | FileCheck %s
+
+; MAGIC: BCLZ
+
+; BCAN: <GLOBALVAL_SUMMARY_BLOCK
+; BCAN: <COMBINED_INDEX_OFFSET
+; BCAN: <COMBINED_INDEX
+; BCAN: </GLOBALVAL_SUMMARY_BLOCK>
+
+; NOINDEX-NOT: COMBINED_INDEX
+
+define i32 @main() #0 {
+entry:
+  call void @analias()
+  call void @callstaticfunc()
+  ret i32 0
+}
+
+declare void @analias() #1
+declare void @callstaticfunc() #1
+
+; CHECK-DAG: define available_externally void @callstaticfunc()
+; CHECK-DAG: define available_externally hidden void @staticfunc.llvm.
+; CHECK-DAG: define available_externally void @analias()
+; CHECK-NOT: @notimported
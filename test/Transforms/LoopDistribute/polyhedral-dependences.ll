@@ -0,0 +1,96 @@
+; RUN: opt -basicaa -loop-distribute -enable-loop-distribute -verify-loop-info \
+; RUN:   -verify-dom-info -S < %s | FileCheck %s --check-prefix=LAA
+; RUN: opt -basicaa -loop-distribute -enable-loop-distribute -verify-loop-info \
+; RUN:   -verify-dom-info -loop-distribute-use-polyhedral-dependences -S < %s \
+; RUN:   | FileCheck %s --check-prefix=POLY
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The loop access analysis cannot compute the distance of the dependence
+; between the accesses to A and gives up on the loop. The polyhedral
+; dependences are exact, thus the accesses to A are isolated in a cyclic
+; partition and the accesses to B and C are distributed into a second loop.
+;
+;    void f(int *restrict A, int *restrict B, int *restrict C, long n) {
+;      for (long i = 0; i < 1000; i++) {
+;        A[i + n + 1] = A[i];
+;        C[i] = B[i] * 2;
+;      }
+;    }
+;
+; LAA-LABEL: @f(
+; LAA-NOT:   for.body.ldist1:
+; LAA:       for.body:
+; LAA-NOT:   for.body.ldist1:
+;
+; POLY-LABEL: @f(
+; POLY:       for.body.ldist1:
+; POLY:         store i32 %loadA.ldist1, i32* %arrayidx.A.ldist1
+; POLY:       for.body:
+; POLY-NOT:     store i32 %loadA
+; POLY:         store i32 %mul, i32* %arrayidx.C
+define void @f(i32* noalias %A, i32* noalias %B, i32* noalias %C, i64 %n) {
+entry:
+  %off = add nsw i64 %n, 1
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A.load = getelementptr inbounds i32, i32* %A, i64 %i
+  %loadA = load i32, i32* %arrayidx.A.load, align 4
+  %add = add nsw i64 %i, %off
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %add
+  store i32 %loadA, i32* %arrayidx.A, align 4
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %i
+  %loadB = load i32, i32* %arrayidx.B, align 4
+  %mul = shl nsw i32 %loadB, 1
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i64 %i
+  store i32 %mul, i32* %arrayidx.C, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The same loop with an unsigned n. The zero extended n is described as if it
+; was a signed value, thus the polyhedral dependences only hold for n >= 0.
+; They have a non-empty invalid context and are not used for distribution.
+;
+;    void g(int *restrict A, int *restrict B, int *restrict C, unsigned n) {
+;      for (long i = 0; i < 1000; i++) {
+;        A[i + n + 1] = A[i];
+;        C[i] = B[i] * 2;
+;      }
+;    }
+;
+; POLY-LABEL: @g(
+; POLY-NOT:   for.body.ldist1:
+; POLY:       for.body:
+; POLY-NOT:   for.body.ldist1:
+define void @g(i32* noalias %A, i32* noalias %B, i32* noalias %C, i32 %n) {
+entry:
+  %n.ext = zext i32 %n to i64
+  %off = add nsw i64 %n.ext, 1
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A.load = getelementptr inbounds i32, i32* %A, i64 %i
+  %loadA = load i32, i32* %arrayidx.A.load, align 4
+  %add = add nsw i64 %i, %off
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %add
+  store i32 %loadA, i32* %arrayidx.A, align 4
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %i
+  %loadB = load i32, i32* %arrayidx.B, align 4
+  %mul = shl nsw i32 %loadB, 1
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i64 %i
+  store i32 %mul, i32* %arrayidx.C, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
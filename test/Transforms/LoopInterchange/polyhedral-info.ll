@@ -0,0 +1,57 @@
+; RUN: opt < %s -basicaa -loop-interchange -pass-remarks=loop-interchange \
+; RUN:   -pass-remarks-missed=loop-interchange -S -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=SCEV
+; RUN: opt < %s -basicaa -loop-interchange -loop-interchange-use-polyhedral-info \
+; RUN:   -pass-remarks=loop-interchange -pass-remarks-missed=loop-interchange \
+; RUN:   -S -o /dev/null 2>&1 | FileCheck %s --check-prefix=POLY
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The array is accessed column-wise through a linearized subscript with the
+; parametric row size N. The induction variables are not separate GEP indices,
+; thus the dependence analysis cannot prove the interchange legal, while the
+; polyhedral dependences show it is and that the outer loop is the stride-1
+; loop.
+;
+;    void scale(float *A, long N, long M) {
+;      for (long i = 0; i < N; i++)
+;        for (long j = 0; j < M; j++)
+;          A[j * N + i] *= 2;
+;    }
+;
+; SCEV: Cannot interchange loops due to dependences.
+; SCEV-NOT: Loop interchanged with enclosing loop.
+; POLY-NOT: Cannot interchange loops due to dependences.
+; POLY: Loop interchanged with enclosing loop.
+define void @scale(float* %A, i64 %N, i64 %M) {
+entry:
+  %cmp.N = icmp sgt i64 %N, 0
+  %cmp.M = icmp sgt i64 %M, 0
+  %cmp = and i1 %cmp.N, %cmp.M
+  br i1 %cmp, label %for.i, label %exit
+
+for.i:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.i.inc ]
+  br label %for.j
+
+for.j:
+  %j = phi i64 [ 0, %for.i ], [ %j.next, %for.j ]
+  %mul = mul nsw i64 %j, %N
+  %idx = add nsw i64 %mul, %i
+  %arrayidx = getelementptr inbounds float, float* %A, i64 %idx
+  %val = load float, float* %arrayidx, align 4
+  %scaled = fmul float %val, 2.000000e+00
+  store float %scaled, float* %arrayidx, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %exitcond.j = icmp eq i64 %j.next, %M
+  br i1 %exitcond.j, label %for.i.inc, label %for.j
+
+for.i.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond.i = icmp eq i64 %i.next, %N
+  br i1 %exitcond.i, label %exit, label %for.i
+
+exit:
+  ret void
+}
@@ -0,0 +1,122 @@
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=1 -force-vector-width=4 -S | FileCheck %s --check-prefix=CHECK --check-prefix=LAA
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=1 -force-vector-width=4 -vectorize-use-polyhedral-dependences -S | FileCheck %s --check-prefix=CHECK --check-prefix=POLY
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=2 -force-vector-width=4 -vectorize-use-polyhedral-dependences -S | FileCheck %s --check-prefix=UF2
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The dependence distance is the parameter N, thus vectorization with width 4
+; is only unsafe for 1 <= N < 4. Instead of comparing the accessed address
+; ranges of the load and the store we check the parameter N.
+;
+;    void stencil(int *A, long N) {
+;      for (long i = 0; i < 1000; i++)
+;        A[i + N] = A[i];
+;    }
+;
+; CHECK-LABEL: @stencil(
+; CHECK:       vector.memcheck:
+; LAA:         %bound0 =
+; LAA:         %memcheck.conflict =
+; POLY-NOT:    %bound0
+; POLY:        icmp sge i64 %{{.*}}, 0
+; POLY:        icmp sge i64 %{{.*}}, 0
+; POLY-NOT:    %bound0
+; CHECK:       br i1 %{{.*}}, label %scalar.ph, label %vector.ph
+; CHECK:       vector.body:
+; CHECK:       load <4 x i32>
+; CHECK:       store <4 x i32>
+;
+; With an interleave count of 2, eight iterations are executed in lock-step
+; and the check has to exclude 1 <= N < 8.
+;
+; UF2-LABEL: @stencil(
+; UF2:       vector.memcheck:
+; UF2:       add i64 %{{.*}}, 7
+; UF2:       br i1 %{{.*}}, label %scalar.ph, label %vector.ph
+define void @stencil(i32* %A, i64 %N) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %add = add nsw i64 %indvars.iv, %N
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %add
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Accesses to different base pointers that might alias are not resolved by the
+; polyhedral dependences, the pointer checks are kept.
+;
+;    void copy(int *A, int *B) {
+;      for (long i = 0; i < 1000; i++)
+;        A[i] = B[i];
+;    }
+;
+; CHECK-LABEL: @copy(
+; CHECK:       vector.memcheck:
+; CHECK:       %bound0 =
+; CHECK:       %memcheck.conflict =
+; CHECK:       vector.body:
+; CHECK:       load <4 x i32>
+define void @copy(i32* %A, i32* %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The zero extension of n is only modeled for non-negative values of n, the
+; dependences are unknown otherwise. The check excludes these values as well.
+;
+;    void stencil_zext(int *A, unsigned n) {
+;      for (long i = 0; i < 1000; i++)
+;        A[i + n] = A[i];
+;    }
+;
+; CHECK-LABEL: @stencil_zext(
+; CHECK:       vector.memcheck:
+; POLY-NOT:    %bound0
+; POLY:        sext i32 %n to i64
+; POLY:        or i1
+; POLY-NOT:    %bound0
+; CHECK:       br i1 %{{.*}}, label %scalar.ph, label %vector.ph
+; CHECK:       vector.body:
+; CHECK:       load <4 x i32>
+define void @stencil_zext(i32* %A, i32 %n) {
+entry:
+  %N = zext i32 %n to i64
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx, align 4
+  %add = add nsw i64 %indvars.iv, %N
+  %arrayidx1 = getelementptr inbounds i32, i32* %A, i64 %add
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
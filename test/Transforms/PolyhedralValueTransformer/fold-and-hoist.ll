@@ -0,0 +1,140 @@
+; RUN: opt -polyhedral-value-transformer -S < %s | FileCheck %s
+; RUN: opt -passes=polyhedral-value-transformer -S < %s | FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+;    void always_taken(int *A) {
+;      for (long i = 0; i < 100; i++)
+;        if (i >= 0)
+;          A[i] = 1;
+;    }
+;
+; CHECK-LABEL: @always_taken(
+; CHECK:       for.body:
+; CHECK:         br i1 true, label %if.then, label %for.inc
+; CHECK:       for.inc:
+; CHECK:         br i1 %exitcond, label %for.end, label %for.body
+define void @always_taken(i32* %A) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp sge i64 %i, 0
+  br i1 %cmp, label %if.then, label %for.inc
+
+if.then:
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 1, i32* %arrayidx, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 100
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;    void never_taken(int *A) {
+;      for (long i = 0; i < 100; i++)
+;        if (i > 200)
+;          A[i] = 1;
+;    }
+;
+; CHECK-LABEL: @never_taken(
+; CHECK:       for.body:
+; CHECK:         br i1 false, label %if.then, label %for.inc
+define void @never_taken(i32* %A) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp sgt i64 %i, 200
+  br i1 %cmp, label %if.then, label %for.inc
+
+if.then:
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 1, i32* %arrayidx, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 100
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The condition only depends on the parameter c, the loop is unswitched.
+;
+;    void hoist(int *A, long c) {
+;      for (long i = 0; i < 100; i++)
+;        A[i] = c > 5 ? 0 : 1;
+;    }
+;
+; CHECK-LABEL: @hoist(
+; CHECK:       entry:
+; CHECK:         br i1 %{{.*}}, label %for.body.ph.pvt, label %for.body.ph
+; CHECK:       for.body.pvt:
+; CHECK:         br i1 true, label %if.then.pvt, label %if.else.pvt
+; CHECK:       for.body:
+; CHECK:         br i1 false, label %if.then, label %if.else
+; CHECK:       for.end:
+; CHECK-NEXT:    ret void
+define void @hoist(i32* %A, i64 %c) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.inc ]
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %i
+  %cmp = icmp sgt i64 %c, 5
+  br i1 %cmp, label %if.then, label %if.else
+
+if.then:
+  store i32 0, i32* %arrayidx, align 4
+  br label %for.inc
+
+if.else:
+  store i32 1, i32* %arrayidx, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 100
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The condition depends on the loop iteration, nothing is changed.
+;
+; CHECK-LABEL: @not_invariant(
+; CHECK:       for.body:
+; CHECK:         br i1 %cmp, label %if.then, label %for.inc
+define void @not_invariant(i32* %A, i64 %N) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i64 %i, %N
+  br i1 %cmp, label %if.then, label %for.inc
+
+if.then:
+  %arrayidx = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 1, i32* %arrayidx, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 100
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
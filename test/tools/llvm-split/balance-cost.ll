@@ -0,0 +1,67 @@
+; Balance the partitions by the estimated code generation cost. The large
+; function is put in its own partition, the small ones share the other one.
+
+; RUN: llvm-split -j=2 -split-module-balance-cost -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; CHECK0: define i32 @big
+; CHECK0: declare i32 @small0
+; CHECK0: declare i32 @small1
+; CHECK0: declare i32 @small2
+; CHECK0: declare i32 @small3
+
+; CHECK1: declare i32 @big
+; CHECK1: define i32 @small0
+; CHECK1: define i32 @small1
+; CHECK1: define i32 @small2
+; CHECK1: define i32 @small3
+
+define i32 @big(i32 %v0) {
+entry:
+  %v1 = mul i32 %v0, %v0
+  %v2 = mul i32 %v1, %v1
+  %v3 = mul i32 %v2, %v2
+  %v4 = mul i32 %v3, %v3
+  %v5 = mul i32 %v4, %v4
+  %v6 = mul i32 %v5, %v5
+  %v7 = mul i32 %v6, %v6
+  %v8 = mul i32 %v7, %v7
+  %v9 = mul i32 %v8, %v8
+  %v10 = mul i32 %v9, %v9
+  %v11 = mul i32 %v10, %v10
+  %v12 = mul i32 %v11, %v11
+  %v13 = mul i32 %v12, %v12
+  %v14 = mul i32 %v13, %v13
+  %v15 = mul i32 %v14, %v14
+  %v16 = mul i32 %v15, %v15
+  %v17 = mul i32 %v16, %v16
+  %v18 = mul i32 %v17, %v17
+  %v19 = mul i32 %v18, %v18
+  %v20 = mul i32 %v19, %v19
+  %v21 = mul i32 %v20, %v20
+  %v22 = mul i32 %v21, %v21
+  %v23 = mul i32 %v22, %v22
+  %v24 = mul i32 %v23, %v23
+  ret i32 %v24
+}
+
+define i32 @small0(i32 %a) {
+entry:
+  ret i32 %a
+}
+
+define i32 @small1(i32 %a) {
+entry:
+  ret i32 %a
+}
+
+define i32 @small2(i32 %a) {
+entry:
+  ret i32 %a
+}
+
+define i32 @small3(i32 %a) {
+entry:
+  ret i32 %a
+}
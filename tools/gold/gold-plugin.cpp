@@ -177,6 +177,23 @@ namespace options {
   static std::string cache_dir;
   // Optional pruning policy for ThinLTO caches.
   static std::string cache_policy;
+  // Record the cache hits and insertions in an index, so the cache can be
+  // pruned without walking the cache directory.
+  static bool cache_index = false;
+  // Record the ThinLTO backend times in the cache directory and use them to
+  // start the most expensive modules first.
+  static bool thinlto_schedule_history = false;
+  // Keep the ThinLTO import lists in the cache directory and only recompute
+  // the ones affected by changed modules.
+  static bool thinlto_incremental = false;
+  // Propagate function attributes over the combined call graph in the
+  // ThinLTO thin link.
+  static bool thinlto_funcattrs = false;
+  // Parse the regular LTO modules on this many threads before linking them.
+  static unsigned regular_lto_link_threads = 0;
+  // Optional path to a file receiving the time and memory of the phases of
+  // the link, in the Chrome trace event format.
+  static std::string phase_report;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -227,6 +244,21 @@ namespace options {
                 "thinlto-object-suffix-replace expects 'old;new' format");
     } else if (opt.startswith("cache-dir=")) {
       cache_dir = opt.substr(strlen("cache-dir="));
+    } else if (opt == "cache-index") {
+      cache_index = true;
+    } else if (opt == "thinlto-schedule-history") {
+      thinlto_schedule_history = true;
+    } else if (opt == "thinlto-incremental") {
+      thinlto_incremental = true;
+    } else if (opt == "thinlto-funcattrs") {
+      thinlto_funcattrs = true;
+    } else if (opt.startswith("regular-lto-link-threads=")) {
+      if (opt.substr(strlen("regular-lto-link-threads="))
+              .getAsInteger(10, regular_lto_link_threads))
+        message(LDPL_FATAL, "Invalid regular LTO link threads: %s",
+                opt_ + strlen("regular-lto-link-threads="));
+    } else if (opt.startswith("phase-report=")) {
+      phase_report = opt.substr(strlen("phase-report="));
     } else if (opt.startswith("cache-policy=")) {
       cache_policy = opt.substr(strlen("cache-policy="));
     } else if (opt.size() == 2 && opt[0] == 'O') {
@@ -816,6 +848,21 @@ static std::unique_ptr<LTO> createLTO() {
   // Use new pass manager if set in driver
   Conf.UseNewPM = options::new_pass_manager;
 
+  if (options::thinlto_schedule_history && !options::cache_dir.empty()) {
+    SmallString<128> TimesFile(options::cache_dir);
+    sys::path::append(TimesFile, "llvmcache.backend-times");
+    Conf.ThinLTOBackendTimesFile = TimesFile.str();
+  }
+  if (options::thinlto_incremental && !options::cache_dir.empty()) {
+    SmallString<128> ImportListsFile(options::cache_dir);
+    sys::path::append(ImportListsFile, "llvmcache.import-lists");
+    Conf.ThinLTOImportListsFile = ImportListsFile.str();
+  }
+  Conf.ThinLTOPropagateFunctionAttrs = options::thinlto_funcattrs;
+
+  Conf.PhaseReportFile = options::phase_report;
+  Conf.RegularLTOLinkThreads = options::regular_lto_link_threads;
+
   return llvm::make_unique<LTO>(std::move(Conf), Backend,
                                 options::ParallelCodeGenParallelismLevel);
 }
@@ -928,7 +975,8 @@ static ld_plugin_status allSymbolsReadHook() {
 
   NativeObjectCache Cache;
   if (!options::cache_dir.empty())
-    Cache = check(localCache(options::cache_dir, AddBuffer));
+    Cache = check(
+        localCache(options::cache_dir, AddBuffer, options::cache_index));
 
   check(Lto->run(AddStream, Cache));
 
@@ -0,0 +1,123 @@
+//===- llvm-bc-compress-bench.cpp - Benchmark for compressed bitcode ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program compresses bitcode files as -compress-bitcode does and compares
+// the compressed files with the uncompressed ones. For each file one line with
+// the sizes, the compression throughput and the time to read the file is
+// printed, both for a complete read and for a lazy read, which decompresses
+// only the segments needed before the functions are materialized. All times
+// are the minimum over the repetitions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFilenames(cl::Positional, cl::OneOrMore,
+                                            cl::desc("<input bitcode files>"));
+
+static cl::opt<unsigned> Repetitions("repetitions", cl::init(5),
+                                     cl::desc("Runs per measurement"));
+
+static void check(Error E, const Twine &Msg) {
+  if (!E)
+    return;
+  handleAllErrors(std::move(E), [&](ErrorInfoBase &EIB) {
+    errs() << "llvm-bc-compress-bench: " << Msg << ": " << EIB.message()
+           << '\n';
+  });
+  exit(1);
+}
+
+/// Return the minimal wall time of \p Fn over all repetitions in seconds.
+static double measure(function_ref<void()> Fn) {
+  double Min = std::numeric_limits<double>::max();
+  for (unsigned r = 0; r < std::max(1u, unsigned(Repetitions)); r++) {
+    auto Start = std::chrono::steady_clock::now();
+    Fn();
+    std::chrono::duration<double> Time =
+        std::chrono::steady_clock::now() - Start;
+    Min = std::min(Min, Time.count());
+  }
+  return Min;
+}
+
+/// Return the time to read \p Buffer completely, or lazily if \p Lazy.
+static double measureRead(MemoryBufferRef Buffer, bool Lazy) {
+  return measure([&]() {
+    LLVMContext Ctx;
+    Expected<std::unique_ptr<Module>> MOrErr = Lazy
+        ? getLazyBitcodeModule(Buffer, Ctx)
+        : parseBitcodeFile(Buffer, Ctx);
+    check(MOrErr.takeError(), "cannot read " + Buffer.getBufferIdentifier());
+  });
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "compressed bitcode benchmark\n");
+  llvm_shutdown_obj Y;
+
+  outs() << "   raw [KB]  compr. [KB]  ratio  compr. [MB/s]"
+            "   read [ms]  compr. read [ms]   lazy [ms]  compr. lazy [ms]"
+            "  file\n";
+
+  for (const std::string &Filename : InputFilenames) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << "error: cannot open " << Filename << ": " << EC.message()
+             << '\n';
+      return 1;
+    }
+    MemoryBufferRef Raw = (*BufferOrErr)->getMemBufferRef();
+    const unsigned char *Begin = Raw.getBuffer().bytes_begin();
+    const unsigned char *End = Raw.getBuffer().bytes_end();
+    if (!isBitcode(Begin, End) || isCompressedBitcode(Begin, End)) {
+      errs() << "error: " << Filename << " is not uncompressed bitcode\n";
+      return 1;
+    }
+
+    SmallVector<char, 0> Compressed;
+    double CompressTime =
+        measure([&]() { compressBitcode(Raw.getBuffer(), Compressed); });
+    MemoryBufferRef CompressedRef(StringRef(Compressed.data(),
+                                            Compressed.size()),
+                                  Filename);
+
+    double RawSize = Raw.getBufferSize();
+    outs() << format("%11.1f %12.1f %6.2f %14.1f %11.3f %17.3f %11.3f %17.3f",
+                     RawSize / 1024, Compressed.size() / 1024.0,
+                     RawSize / Compressed.size(),
+                     RawSize / (1024 * 1024) / CompressTime,
+                     measureRead(Raw, false) * 1000,
+                     measureRead(CompressedRef, false) * 1000,
+                     measureRead(Raw, true) * 1000,
+                     measureRead(CompressedRef, true) * 1000)
+           << "  " << sys::path::filename(Filename) << '\n';
+  }
+  return 0;
+}
@@ -322,6 +322,9 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
       STRINGIFY_CODE(FS, VALUE_GUID)
       STRINGIFY_CODE(FS, CFI_FUNCTION_DEFS)
       STRINGIFY_CODE(FS, CFI_FUNCTION_DECLS)
+      STRINGIFY_CODE(FS, PARAM_ACCESSES)
+      STRINGIFY_CODE(FS, COMBINED_INDEX_OFFSET)
+      STRINGIFY_CODE(FS, COMBINED_INDEX)
     }
   case bitc::METADATA_ATTACHMENT_ID:
     switch(CodeID) {
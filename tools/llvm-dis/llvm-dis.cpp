@@ -69,6 +69,12 @@ static cl::opt<bool>
                         cl::desc("Load module without materializing metadata, "
                                  "then materialize only the metadata"));
 
+static cl::opt<bool>
+    ReferenceStrings("reference-strings",
+                     cl::desc("Let the metadata strings refer to the input "
+                              "buffer instead of copying them"),
+                     cl::Hidden);
+
 namespace {
 
 static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
@@ -151,9 +157,15 @@ static ExitOnError ExitOnErr;
 static std::unique_ptr<Module> openInputFile(LLVMContext &Context) {
   std::unique_ptr<MemoryBuffer> MB =
       ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFilename)));
-  std::unique_ptr<Module> M = ExitOnErr(getOwningLazyBitcodeModule(
-      std::move(MB), Context,
-      /*ShouldLazyLoadMetadata=*/true, SetImporting));
+  std::unique_ptr<Module> M;
+  if (ReferenceStrings)
+    M = ExitOnErr(getContextOwnedLazyBitcodeModule(
+        std::move(MB), Context,
+        /*ShouldLazyLoadMetadata=*/true, SetImporting));
+  else
+    M = ExitOnErr(getOwningLazyBitcodeModule(
+        std::move(MB), Context,
+        /*ShouldLazyLoadMetadata=*/true, SetImporting));
   if (MaterializeMetadata)
     ExitOnErr(M->materializeMetadata());
   else
@@ -0,0 +1,256 @@
+//===- llvm-lto-link-bench.cpp - Throughput benchmark for regular LTO links ==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program generates sets of bitcode modules with the IRBuilder and
+// measures how fast the regular LTO link combines them, for varying numbers of
+// link threads. Each module defines external functions that call functions of
+// the next module and linkonce_odr helpers that every module defines, as the
+// inline functions of C++ headers are. Only the parsing, symbol resolution and
+// linking of the inputs is measured, the link stops before the optimization.
+// For each configuration one line with the minimal wall time and CPU time of
+// the linking thread over all repetitions is printed. The latter bounds the
+// wall time on a machine with enough cores for the link threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/LTO/LTO.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+
+using namespace llvm;
+
+static cl::list<unsigned>
+    Threads("threads", cl::CommaSeparated,
+            cl::desc("Numbers of link threads, 0 links serially "
+                     "(default: 0,1,2,4,8)"));
+
+static cl::list<unsigned>
+    NumModules("modules", cl::CommaSeparated,
+               cl::desc("Numbers of modules to link (default: 64,256)"));
+
+static cl::opt<unsigned> NumFunctions("functions", cl::init(32),
+                                      cl::desc("External functions per module"));
+
+static cl::opt<unsigned> NumHelpers("helpers", cl::init(16),
+                                    cl::desc("linkonce_odr helpers defined in "
+                                             "every module"));
+
+static cl::opt<unsigned> NumInstructions("instructions", cl::init(32),
+                                         cl::desc("Instructions per function"));
+
+static cl::opt<unsigned> Repetitions("repetitions", cl::init(3),
+                                     cl::desc("Runs per configuration"));
+
+static void check(Error E, const Twine &Msg) {
+  if (!E)
+    return;
+  handleAllErrors(std::move(E), [&](ErrorInfoBase &EIB) {
+    errs() << "llvm-lto-link-bench: " << Msg << ": " << EIB.message() << '\n';
+  });
+  exit(1);
+}
+
+template <typename T> static T check(Expected<T> E, const Twine &Msg) {
+  if (E)
+    return std::move(*E);
+  check(E.takeError(), Msg);
+  return T();
+}
+
+/// Emit a chain of @p NumInstructions loads and additions from @p Data into
+/// @p F, which returns their sum plus the results of @p Callees.
+static void generateBody(Function *F, GlobalVariable *Data,
+                         ArrayRef<Function *> Callees) {
+  LLVMContext &Ctx = F->getContext();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", F));
+
+  Value *Sum = &*F->arg_begin();
+  for (unsigned i = 0; i < NumInstructions / 2; i++) {
+    Value *Ptr = Builder.CreateConstInBoundsGEP2_32(Data->getValueType(), Data,
+                                                    0, i % 64);
+    Sum = Builder.CreateAdd(Sum, Builder.CreateLoad(Int32Ty, Ptr));
+  }
+  for (Function *Callee : Callees)
+    Sum = Builder.CreateAdd(Sum, Builder.CreateCall(Callee, Sum));
+  Builder.CreateRet(Sum);
+}
+
+/// Generate the module @p Idx of a set of @p Count modules.
+static std::unique_ptr<Module> generateModule(LLVMContext &Ctx, unsigned Idx,
+                                              unsigned Count) {
+  auto M = make_unique<Module>(("lto-link-bench." + Twine(Idx)).str(), Ctx);
+  M->setDataLayout("e-m:e-i64:64-f80:128-n8:16:32:64-S128");
+  M->setTargetTriple("x86_64-unknown-linux-gnu");
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  auto *FTy = FunctionType::get(Int32Ty, Int32Ty, false);
+  auto *DataTy = ArrayType::get(Int32Ty, 64);
+
+  auto *Data = new GlobalVariable(*M, DataTy, false,
+                                  GlobalValue::ExternalLinkage,
+                                  ConstantAggregateZero::get(DataTy),
+                                  "data." + Twine(Idx));
+  auto *SharedData = new GlobalVariable(*M, DataTy, false,
+                                        GlobalValue::LinkOnceODRLinkage,
+                                        ConstantAggregateZero::get(DataTy),
+                                        "shared.data");
+
+  SmallVector<Function *, 16> Helpers;
+  for (unsigned h = 0; h < NumHelpers; h++) {
+    auto *F = Function::Create(FTy, GlobalValue::LinkOnceODRLinkage,
+                               "helper." + Twine(h), M.get());
+    generateBody(F, SharedData, None);
+    Helpers.push_back(F);
+  }
+
+  unsigned Next = (Idx + 1) % Count;
+  for (unsigned f = 0; f < NumFunctions; f++) {
+    auto *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                               "f." + Twine(Idx) + "." + Twine(f), M.get());
+    SmallVector<Function *, 2> Callees;
+    if (!Helpers.empty())
+      Callees.push_back(Helpers[f % Helpers.size()]);
+    if (Next != Idx)
+      Callees.push_back(cast<Function>(M->getOrInsertFunction(
+          ("f." + Twine(Next) + "." + Twine(f)).str(), FTy)));
+    generateBody(F, Data, Callees);
+  }
+  return M;
+}
+
+/// The cost of one link.
+struct Measurement {
+  /// The wall time in seconds.
+  double WallTime;
+  /// The CPU time of the thread running the link in seconds. The link threads
+  /// are not included, thus this is the serial part of the link.
+  double SerialTime;
+};
+
+/// Link @p Inputs with @p NumThreads link threads.
+static Measurement link(ArrayRef<SmallVector<char, 0>> Inputs,
+                        unsigned NumThreads) {
+  lto::Config Conf;
+  Conf.RegularLTOLinkThreads = NumThreads;
+  Conf.DiagHandler = [](const DiagnosticInfo &DI) {
+    DiagnosticPrinterRawOStream DP(errs());
+    DI.print(DP);
+    errs() << '\n';
+  };
+  // Stop after the link.
+  Conf.PreOptModuleHook = [](unsigned Task, const Module &M) { return false; };
+
+  auto Start = std::chrono::steady_clock::now();
+  std::chrono::nanoseconds StartCPUTime = sys::Process::GetThreadCPUTime();
+  lto::LTO Lto(std::move(Conf));
+  StringSet<> Defined;
+  for (unsigned i = 0; i < Inputs.size(); i++) {
+    MemoryBufferRef Buffer(
+        StringRef(Inputs[i].data(), Inputs[i].size()),
+        "lto-link-bench." + std::to_string(i) + ".bc");
+    std::unique_ptr<lto::InputFile> Input =
+        check(lto::InputFile::create(Buffer), "cannot read the input");
+
+    // The first definition of a symbol prevails, none is referenced outside of
+    // the LTO unit.
+    std::vector<lto::SymbolResolution> Res;
+    for (const lto::InputFile::Symbol &Sym : Input->symbols()) {
+      lto::SymbolResolution R;
+      if (!Sym.isUndefined()) {
+        R.Prevailing = Defined.insert(Sym.getName()).second;
+        R.FinalDefinitionInLinkageUnit = true;
+      }
+      Res.push_back(R);
+    }
+    check(Lto.add(std::move(Input), Res), "cannot add the input");
+  }
+  check(Lto.run([](unsigned Task) -> std::unique_ptr<lto::NativeObjectStream> {
+          llvm_unreachable("the link stops before the code generation");
+        }),
+        "the link failed");
+  std::chrono::duration<double> WallTime =
+      std::chrono::steady_clock::now() - Start;
+  std::chrono::duration<double> SerialTime =
+      sys::Process::GetThreadCPUTime() - StartCPUTime;
+  return {WallTime.count(), SerialTime.count()};
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv,
+                              "regular LTO link throughput benchmark\n");
+  llvm_shutdown_obj Y;
+
+  SmallVector<unsigned, 8> ThreadValues(Threads.begin(), Threads.end());
+  if (ThreadValues.empty())
+    ThreadValues = {0, 1, 2, 4, 8};
+  SmallVector<unsigned, 8> ModuleValues(NumModules.begin(), NumModules.end());
+  if (ModuleValues.empty())
+    ModuleValues = {64, 256};
+
+  outs() << "modules threads   input [KB]    link [ms]  serial [ms]  speedup\n";
+
+  for (unsigned Count : ModuleValues) {
+    if (!Count) {
+      errs() << "error: the number of modules has to be positive\n";
+      return 1;
+    }
+
+    // The inputs are generated once and shared by all thread counts.
+    std::vector<SmallVector<char, 0>> Inputs(Count);
+    size_t InputSize = 0;
+    for (unsigned i = 0; i < Count; i++) {
+      LLVMContext Ctx;
+      std::unique_ptr<Module> M = generateModule(Ctx, i, Count);
+      if (verifyModule(*M, &errs())) {
+        errs() << "error: generated an invalid module\n";
+        return 1;
+      }
+      raw_svector_ostream OS(Inputs[i]);
+      WriteBitcodeToFile(M.get(), OS);
+      InputSize += Inputs[i].size();
+    }
+
+    double Baseline = 0;
+    for (unsigned NumThreads : ThreadValues) {
+      Measurement Min = {std::numeric_limits<double>::max(),
+                         std::numeric_limits<double>::max()};
+      for (unsigned r = 0; r < std::max(1u, unsigned(Repetitions)); r++) {
+        Measurement M = link(Inputs, NumThreads);
+        Min.WallTime = std::min(Min.WallTime, M.WallTime);
+        Min.SerialTime = std::min(Min.SerialTime, M.SerialTime);
+      }
+      if (!Baseline)
+        Baseline = Min.WallTime;
+      outs() << format("%7u %7u %12zu %12.3f %12.3f %8.2f\n", Count,
+                       NumThreads, InputSize / 1024, Min.WallTime * 1000,
+                       Min.SerialTime * 1000, Baseline / Min.WallTime);
+    }
+  }
+  return 0;
+}
@@ -23,6 +23,7 @@
 #include "llvm/LTO/LTO.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Threading.h"
 
@@ -49,6 +50,32 @@ static cl::opt<std::string> OutputFilename("o", cl::Required,
 static cl::opt<std::string> CacheDir("cache-dir", cl::desc("Cache Directory"),
                                      cl::value_desc("directory"));
 
+static cl::opt<bool>
+    CacheIndex("cache-index",
+               cl::desc("Record the cache hits and insertions in an index in "
+                        "the cache directory"));
+
+static cl::opt<bool> ThinLTOScheduleHistory(
+    "thinlto-schedule-history",
+    cl::desc("Record the ThinLTO backend times in the cache directory and use "
+             "them to schedule the most expensive modules first"));
+
+static cl::opt<bool> ThinLTOIncremental(
+    "thinlto-incremental",
+    cl::desc("Keep the ThinLTO import lists in the cache directory and only "
+             "recompute the ones affected by changed modules"));
+
+static cl::opt<bool> ThinLTOFuncAttrs(
+    "thinlto-funcattrs",
+    cl::desc("Propagate function attributes over the combined call graph in "
+             "the thin link"));
+
+static cl::opt<std::string> PhaseReportFile(
+    "phase-report",
+    cl::desc("Write the time and memory of the phases of the link to this "
+             "file, in the Chrome trace event format"),
+    cl::value_desc("filename"));
+
 static cl::opt<std::string> OptPipeline("opt-pipeline",
                                         cl::desc("Optimizer Pipeline"),
                                         cl::value_desc("pipeline"));
@@ -68,6 +95,11 @@ static cl::opt<bool>
 static cl::opt<int> Threads("thinlto-threads",
                             cl::init(llvm::heavyweight_hardware_concurrency()));
 
+static cl::opt<unsigned> RegularLTOLinkThreads(
+    "regular-lto-link-threads", cl::init(0),
+    cl::desc("Parse the regular LTO modules on this many threads before "
+             "linking them (default = 0, parse them while linking)"));
+
 static cl::list<std::string> SymbolResolutions(
     "r",
     cl::desc("Specify a symbol resolution: filename,symbolname,resolution\n"
@@ -201,6 +233,21 @@ static int run(int argc, char **argv) {
 
   Conf.DebugPassManager = DebugPassManager;
 
+  if (ThinLTOScheduleHistory && !CacheDir.empty()) {
+    SmallString<128> TimesFile(CacheDir);
+    sys::path::append(TimesFile, "llvmcache.backend-times");
+    Conf.ThinLTOBackendTimesFile = TimesFile.str();
+  }
+  if (ThinLTOIncremental && !CacheDir.empty()) {
+    SmallString<128> ImportListsFile(CacheDir);
+    sys::path::append(ImportListsFile, "llvmcache.import-lists");
+    Conf.ThinLTOImportListsFile = ImportListsFile.str();
+  }
+  Conf.ThinLTOPropagateFunctionAttrs = ThinLTOFuncAttrs;
+
+  Conf.PhaseReportFile = PhaseReportFile;
+  Conf.RegularLTOLinkThreads = RegularLTOLinkThreads;
+
   if (SaveTemps)
     check(Conf.addSaveTemps(OutputFilename + "."),
           "Config::addSaveTemps failed");
@@ -303,7 +350,8 @@ static int run(int argc, char **argv) {
 
   NativeObjectCache Cache;
   if (!CacheDir.empty())
-    Cache = check(localCache(CacheDir, AddBuffer), "failed to create cache");
+    Cache = check(localCache(CacheDir, AddBuffer, CacheIndex),
+                  "failed to create cache");
 
   check(Lto.run(AddStream, Cache), "LTO::run failed");
   return 0;
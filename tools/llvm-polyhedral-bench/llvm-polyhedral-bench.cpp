@@ -0,0 +1,323 @@
+//===- llvm-polyhedral-bench.cpp - Scaling benchmark for polyhedral analyses =//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program generates loop nests of varying depth, number of parameters and
+// number of accesses with the IRBuilder and measures the cost of the
+// polyhedral value, access and dependence analyses on them. For each
+// configuration one line with the minimal wall time and isl operations over all
+// repetitions is printed. With -polyhedral-stats the detailed statistics of the
+// last run, e.g., cache hit rates and pieces per expression, are printed too.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PolyhedralAccessInfo.h"
+#include "llvm/Analysis/PolyhedralDependenceInfo.h"
+#include "llvm/Analysis/PolyhedralStats.h"
+#include "llvm/Analysis/PolyhedralValueInfo.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+using namespace llvm;
+
+static cl::list<unsigned>
+    Depths("depth", cl::CommaSeparated,
+           cl::desc("Loop nest depths to benchmark (default: 1,2,3,4)"));
+
+static cl::list<unsigned>
+    NumParams("params", cl::CommaSeparated,
+              cl::desc("Numbers of size parameters (default: 1,2)"));
+
+static cl::list<unsigned>
+    NumAccesses("accesses", cl::CommaSeparated,
+                cl::desc("Numbers of accesses in the innermost loop "
+                         "(default: 2,8)"));
+
+static cl::opt<unsigned> Repetitions("repetitions", cl::init(3),
+                                     cl::desc("Runs per configuration"));
+
+static cl::opt<unsigned> Seed("seed", cl::init(0),
+                              cl::desc("Seed for the generated subscripts"));
+
+static cl::opt<bool> PrintIR("print-ir", cl::init(false),
+                             cl::desc("Print the generated functions"));
+
+namespace {
+
+/// A simple deterministic random number generator, the results do not depend
+/// on the host standard library.
+class Random {
+  uint64_t State;
+
+public:
+  Random(uint64_t Seed) : State(Seed * 6364136223846793005ULL + 1) {}
+
+  /// Return a random number in [0, Bound).
+  unsigned operator()(unsigned Bound) {
+    State = State * 6364136223846793005ULL + 1442695040888963407ULL;
+    return unsigned(State >> 33) % Bound;
+  }
+};
+
+/// The parameters of a generated loop nest.
+struct Configuration {
+  unsigned Depth;
+  unsigned NumParams;
+  unsigned NumAccesses;
+};
+
+/// The cost of the analyses for one configuration.
+struct Measurement {
+  double WallTime[PolyhedralStats::AK_NUM_ANALYSES];
+  unsigned long Operations[PolyhedralStats::AK_NUM_ANALYSES];
+};
+
+} // end anonymous namespace
+
+/// Generate a function with a perfect loop nest described by @p Config.
+///
+///   void kernel(i32 *A, i64 P0, ..., i64 Pn-1)
+///
+/// Loop d iterates from 0 to P(d mod n), or to 128 without parameters. The
+/// innermost loop accesses A through linearized subscripts of the form
+/// ((i0 + o0) * S1 + (i1 + o1)) * S2 + ..., where the induction variables
+/// might be permuted, the offsets o are in [-1, 1] and the sizes S are the loop
+/// bounds. Every other access is a store of the sum of the loaded values.
+static Function *generateLoopNest(Module &M, const Configuration &Config,
+                                  Random &R) {
+  LLVMContext &Ctx = M.getContext();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+
+  SmallVector<Type *, 8> ArgTys(1, Int32Ty->getPointerTo());
+  ArgTys.append(Config.NumParams, Int64Ty);
+  auto *FTy = FunctionType::get(Type::getVoidTy(Ctx), ArgTys, false);
+  auto *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "kernel", &M);
+
+  auto ArgIt = F->arg_begin();
+  Value *A = &*ArgIt++;
+  A->setName("A");
+  SmallVector<Value *, 8> Sizes;
+  for (unsigned p = 0; p < Config.NumParams; p++, ArgIt++) {
+    ArgIt->setName("P" + Twine(p));
+    Sizes.push_back(&*ArgIt);
+  }
+  if (Sizes.empty())
+    Sizes.push_back(ConstantInt::get(Int64Ty, 128));
+
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", F);
+  BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", F);
+  SmallVector<BasicBlock *, 8> Headers, Latches;
+  for (unsigned d = 0; d < Config.Depth; d++) {
+    Headers.push_back(BasicBlock::Create(Ctx, "header." + Twine(d), F));
+    Latches.push_back(BasicBlock::Create(Ctx, "latch." + Twine(d), F));
+  }
+  Exit->moveAfter(Latches.front());
+
+  // Only enter the loop nest if all loop bounds are positive.
+  IRBuilder<> Builder(Entry);
+  Value *Guard = Builder.getTrue();
+  for (Value *Size : Sizes)
+    Guard = Builder.CreateAnd(
+        Guard, Builder.CreateICmpSGT(Size, ConstantInt::get(Int64Ty, 0)));
+  Builder.CreateCondBr(Guard, Headers.front(), Exit);
+
+  SmallVector<PHINode *, 8> IVs;
+  for (unsigned d = 0; d < Config.Depth; d++) {
+    Builder.SetInsertPoint(Headers[d]);
+    PHINode *IV = Builder.CreatePHI(Int64Ty, 2, "i" + Twine(d));
+    IV->addIncoming(ConstantInt::get(Int64Ty, 0),
+                    d ? Headers[d - 1] : Entry);
+    IVs.push_back(IV);
+    if (d + 1 < Config.Depth)
+      Builder.CreateBr(Headers[d + 1]);
+  }
+
+  // The accesses in the innermost loop.
+  Value *Sum = Builder.getInt32(0);
+  for (unsigned a = 0; a < Config.NumAccesses; a++) {
+    SmallVector<unsigned, 8> Dims;
+    for (unsigned d = 0; d < Config.Depth; d++)
+      Dims.push_back(d);
+    if (Config.Depth > 1 && R(2)) {
+      unsigned D0 = R(Config.Depth);
+      unsigned D1 = R(Config.Depth);
+      std::swap(Dims[D0], Dims[D1]);
+    }
+
+    Value *Idx = nullptr;
+    for (unsigned d = 0; d < Config.Depth; d++) {
+      int64_t Offset = int64_t(R(3)) - 1;
+      Value *Subscript = Builder.CreateAdd(
+          IVs[Dims[d]], ConstantInt::get(Int64Ty, Offset), "", false, true);
+      if (!Idx) {
+        Idx = Subscript;
+        continue;
+      }
+      Value *Size = Sizes[d % Sizes.size()];
+      Idx = Builder.CreateAdd(Builder.CreateMul(Idx, Size, "", false, true),
+                              Subscript, "idx", false, true);
+    }
+
+    Value *Ptr = Builder.CreateInBoundsGEP(Int32Ty, A, Idx);
+    if (a % 2)
+      Builder.CreateStore(Sum, Ptr);
+    else
+      Sum = Builder.CreateAdd(Sum, Builder.CreateLoad(Int32Ty, Ptr));
+  }
+  Builder.CreateBr(Latches.back());
+
+  for (unsigned d = Config.Depth; d-- > 0;) {
+    Builder.SetInsertPoint(Latches[d]);
+    Value *Next = Builder.CreateAdd(IVs[d], ConstantInt::get(Int64Ty, 1),
+                                    "i" + Twine(d) + ".next", true, true);
+    IVs[d]->addIncoming(Next, Latches[d]);
+    Value *Done = Builder.CreateICmpEQ(Next, Sizes[d % Sizes.size()]);
+    Builder.CreateCondBr(Done, d ? Latches[d - 1] : Exit, Headers[d]);
+  }
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRetVoid();
+  return F;
+}
+
+/// Run the analyses @p Repetitions times on @p F and return the minimal cost.
+static Measurement measure(Function &F) {
+  Measurement Min;
+  std::fill(std::begin(Min.WallTime), std::end(Min.WallTime),
+            std::numeric_limits<double>::max());
+  std::fill(std::begin(Min.Operations), std::end(Min.Operations),
+            std::numeric_limits<unsigned long>::max());
+
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  PVCtx Ctx;
+
+  auto Record = [&](PolyhedralStats::AnalysisKind Kind) {
+    Min.WallTime[Kind] =
+        std::min(Min.WallTime[Kind], PolyhedralStats::getWallTime(Kind));
+    Min.Operations[Kind] =
+        std::min(Min.Operations[Kind], PolyhedralStats::getNumOperations(Kind));
+  };
+
+  for (unsigned r = 0; r < std::max(1u, unsigned(Repetitions)); r++) {
+    // Each analysis is measured with cold caches. The cost of an analysis
+    // includes the queries it issues to the analyses it is built on.
+    {
+      PolyhedralStats::reset();
+      PolyhedralValueInfo PVI(Ctx, LI);
+      for (BasicBlock &BB : F)
+        for (Loop *Scope = LI.getLoopFor(&BB);;
+             Scope = Scope->getParentLoop()) {
+          PVI.getDomainFor(&BB, Scope);
+          for (Instruction &I : BB)
+            if (!I.getType()->isVoidTy())
+              PVI.getPEXP(&I, Scope);
+          if (!Scope)
+            break;
+        }
+      Record(PolyhedralStats::AK_VALUE);
+    }
+    {
+      PolyhedralStats::reset();
+      PolyhedralValueInfo PVI(Ctx, LI);
+      PolyhedralAccessInfo PAI(PVI, LI);
+      delete PAI.getAccessSummary(F, PACCSummary::SSK_COMPLETE);
+      Record(PolyhedralStats::AK_ACCESS);
+    }
+    {
+      PolyhedralStats::reset();
+      PolyhedralValueInfo PVI(Ctx, LI);
+      PolyhedralAccessInfo PAI(PVI, LI);
+      PolyhedralDependenceInfo PDI(PAI, LI);
+      for (Loop *L : LI)
+        PDI.getDependences(*L);
+      Record(PolyhedralStats::AK_DEPENDENCE);
+    }
+  }
+
+  return Min;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv,
+                              "polyhedral analyses scaling benchmark\n");
+  llvm_shutdown_obj Y;
+
+  // The detailed statistics of the last run are only printed on request.
+  bool PrintStats = PolyhedralStats::isEnabled();
+  PolyhedralStats::setEnabled(true);
+
+  SmallVector<unsigned, 8> DepthValues(Depths.begin(), Depths.end());
+  if (DepthValues.empty())
+    DepthValues = {1, 2, 3, 4};
+  SmallVector<unsigned, 8> ParamValues(NumParams.begin(), NumParams.end());
+  if (ParamValues.empty())
+    ParamValues = {1, 2};
+  SmallVector<unsigned, 8> AccessValues(NumAccesses.begin(),
+                                        NumAccesses.end());
+  if (AccessValues.empty())
+    AccessValues = {2, 8};
+
+  outs() << "depth params accesses   value [ms]  access [ms]     dep [ms]"
+            "   value ops  access ops     dep ops\n";
+
+  for (unsigned Depth : DepthValues)
+    for (unsigned Params : ParamValues)
+      for (unsigned Accesses : AccessValues) {
+        if (!Depth) {
+          errs() << "error: the loop nest depth has to be positive\n";
+          return 1;
+        }
+
+        Configuration Config = {Depth, Params, Accesses};
+        Random R(Seed);
+        LLVMContext Ctx;
+        Module M("polyhedral-bench", Ctx);
+        Function *F = generateLoopNest(M, Config, R);
+        if (verifyFunction(*F, &errs())) {
+          errs() << "error: generated an invalid function\n";
+          return 1;
+        }
+        if (PrintIR)
+          F->print(outs());
+
+        Measurement Result = measure(*F);
+        outs() << format("%5u %6u %8u", Depth, Params, Accesses);
+        for (double WallTime : Result.WallTime)
+          outs() << format(" %12.3f", WallTime * 1000);
+        for (unsigned long Operations : Result.Operations)
+          outs() << format(" %11lu", Operations);
+        outs() << "\n";
+      }
+
+  if (!PrintStats)
+    PolyhedralStats::reset();
+  return 0;
+}
@@ -10,6 +10,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/PolyhedralExpressionBuilder.h"
 #include "llvm/Analysis/PolyhedralValueInfo.h"
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Constants.h"
@@ -122,5 +123,134 @@ TEST_F(PolyhedrealValueInfoTest, PEXPUnknownRAUW) {
 #endif
 }
 
+TEST_F(PolyhedrealValueInfoTest, MaxOperationsGuard) {
+  PVAff Sum(Ctx, 0);
+  {
+    PVMaxOperationsGuard Guard(Ctx, 10);
+    EXPECT_TRUE(Guard.isActive());
+
+    // Nested guards do not change the budget of the outermost one.
+    PVMaxOperationsGuard NestedGuard(Ctx, 1000);
+    EXPECT_FALSE(NestedGuard.isActive());
+
+    for (unsigned u = 0; u < 100 && Sum; u++)
+      Sum.add(PVAff(Ctx, 1));
+
+    EXPECT_TRUE(Guard.hasQuotaExceeded());
+    EXPECT_TRUE(Guard.hasFailed());
+
+    // All operations fail until the guard is gone.
+    EXPECT_FALSE(PVAff(Ctx, 1));
+  }
+
+  // A new guard does not inherit the errors of the previous one.
+  {
+    PVMaxOperationsGuard Guard(Ctx, 10);
+    EXPECT_TRUE(Guard.isActive());
+    EXPECT_FALSE(Guard.hasFailed());
+  }
+
+  // Once the guard is gone the context is usable without limit again.
+  Sum = PVAff(Ctx, 0);
+  for (unsigned u = 0; u < 100; u++)
+    Sum.add(PVAff(Ctx, 1));
+  ASSERT_TRUE(Sum.isInteger());
+  EXPECT_EQ(Sum.getIntegerVal(), 100);
+}
+
+TEST_F(PolyhedrealValueInfoTest, IndependentMaxOperationsGuard) {
+  PVMaxOperationsGuard Guard(Ctx, 10);
+  PVAff Sum(Ctx, 0);
+  for (unsigned u = 0; u < 100 && !Guard.hasFailed(); u++)
+    Sum.add(PVAff(Ctx, 1));
+  EXPECT_TRUE(Guard.hasQuotaExceeded());
+
+  // An independent guard suspends the exhausted one.
+  {
+    PVMaxOperationsGuard IndependentGuard(Ctx, 1000, /* Independent */ true);
+    EXPECT_TRUE(IndependentGuard.isActive());
+    EXPECT_FALSE(IndependentGuard.hasFailed());
+    EXPECT_TRUE(PVAff(Ctx, 1));
+  }
+
+  // Afterwards the enclosing guard is still exhausted.
+  EXPECT_TRUE(Guard.hasQuotaExceeded());
+  EXPECT_FALSE(PVAff(Ctx, 1));
+}
+
+TEST_F(PolyhedrealValueInfoTest, ForgetLoop) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> Mod = parseAssemblyString(
+      "define void @f(i64 %N) {\n"
+      "entry:\n"
+      "  br label %preheader\n"
+      "preheader:\n"
+      "  br label %loop\n"
+      "loop:\n"
+      "  %iv = phi i64 [ 0, %preheader ], [ %iv.next, %loop ]\n"
+      "  %iv.next = add nsw i64 %iv, 1\n"
+      "  %cmp = icmp slt i64 %iv.next, %N\n"
+      "  br i1 %cmp, label %loop, label %exit\n"
+      "exit:\n"
+      "  %lcssa = phi i64 [ %iv.next, %loop ]\n"
+      "  br label %end\n"
+      "end:\n"
+      "  ret void\n"
+      "}\n",
+      Err, Context);
+  ASSERT_TRUE(Mod);
+  Function *F = Mod->getFunction("f");
+  PolyhedralValueInfo PVI = buildSE(*F);
+  auto &PVIC =
+      PVI.getPolyhedralExpressionBuilder().getPolyhedralValueInfoCache();
+
+  Loop *L = *LI->begin();
+  BasicBlock *Entry = &F->getEntryBlock();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Exit = L->getExitBlock();
+  BasicBlock *End = Exit->getSingleSuccessor();
+  Value *IV = &Header->front();
+  Value *LCSSA = &Exit->front();
+  Argument *N = &*F->arg_begin();
+
+  EXPECT_TRUE(PVI.isAffine(PVI.getPEXP(IV, L)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getPEXP(IV)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getPEXP(LCSSA)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getDomainFor(Entry)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getDomainFor(Preheader)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getDomainFor(Header)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getDomainFor(End)));
+  EXPECT_TRUE(PVI.isAffine(PVI.getPEXP(N)));
+  EXPECT_NE(PVIC.lookup(*IV, L), nullptr);
+  EXPECT_NE(PVIC.lookup(*Header, nullptr), nullptr);
+  EXPECT_NE(PVIC.lookup(*LCSSA, nullptr), nullptr);
+
+  // Only the information about the loop, its preheader and its exit block is
+  // forgotten.
+  PVI.forgetLoop(*L);
+  EXPECT_EQ(PVIC.lookup(*IV, L), nullptr);
+  EXPECT_EQ(PVIC.lookup(*IV, nullptr), nullptr);
+  EXPECT_EQ(PVIC.lookup(*Header, nullptr), nullptr);
+  EXPECT_EQ(PVIC.lookup(*L, nullptr), nullptr);
+  EXPECT_EQ(PVIC.lookup(*Preheader, nullptr), nullptr);
+  EXPECT_EQ(PVIC.lookup(*Exit, nullptr), nullptr);
+  EXPECT_EQ(PVIC.lookup(*LCSSA, nullptr), nullptr);
+  EXPECT_NE(PVIC.lookup(*Entry, nullptr), nullptr);
+  EXPECT_NE(PVIC.lookup(*End, nullptr), nullptr);
+  EXPECT_NE(PVIC.lookup(*N, nullptr), nullptr);
+
+  // Forgotten information is recomputed on demand, reusing the memory of the
+  // forgotten PEXPs.
+  EXPECT_TRUE(PVI.isAffine(PVI.getPEXP(IV, L)));
+  EXPECT_NE(PVIC.lookup(*IV, L), nullptr);
+
+  std::string Stats;
+  raw_string_ostream OS(Stats);
+  PVI.printAllocationStatistics(OS);
+  EXPECT_NE(OS.str().find("PEXPs recycled: "), std::string::npos);
+  EXPECT_EQ(OS.str().find("PEXPs recycled: 0,"), std::string::npos);
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -9,13 +9,16 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitCodes.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
@@ -191,4 +194,117 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// Tests that modules lazily loaded for importing through a shared import cache
+// get the same metadata as the ones loaded without the cache.
+TEST(BitReaderTest, ImportCacheSharesMetadataIndex) {
+  // The metadata index is only emitted for modules with enough metadata.
+  std::string Assembly = "@ext = external global i32, !custom !0\n"
+                         "define void @f() !custom !1 {\n"
+                         "  ret void, !custom !2\n"
+                         "}\n"
+                         "!named = !{!3, !4}\n";
+  for (unsigned I = 0; I != 64; ++I)
+    Assembly += "!" + utostr(I) + " = !{!\"node" + utostr(I) + "\", !" +
+                utostr(I + 1) + "}\n";
+  Assembly += "!64 = !{!\"last\"}\n";
+
+  SmallString<1024> Mem;
+  {
+    LLVMContext Context;
+    writeModuleToBuffer(parseAssembly(Context, Assembly.c_str()), Mem);
+  }
+  Expected<std::vector<BitcodeModule>> Mods =
+      getBitcodeModuleList(MemoryBufferRef(Mem.str(), "test"));
+  ASSERT_TRUE(bool(Mods));
+  ASSERT_EQ(1u, Mods->size());
+  BitcodeModule &BM = (*Mods)[0];
+
+  auto LoadForImport = [&](LLVMContext &Context,
+                           BitcodeImportCache *ImportCache) {
+    Expected<std::unique_ptr<Module>> MOrErr = BM.getLazyModule(
+        Context, /*ShouldLazyLoadMetadata=*/true, /*IsImporting=*/true,
+        ImportCache);
+    if (!MOrErr)
+      report_fatal_error("Could not parse bitcode module");
+    std::unique_ptr<Module> M = std::move(*MOrErr);
+    EXPECT_FALSE(M->materializeAll());
+    EXPECT_FALSE(verifyModule(*M, &dbgs()));
+    std::string Str;
+    raw_string_ostream OS(Str);
+    M->print(OS, nullptr);
+    return OS.str();
+  };
+
+  LLVMContext ExpectedContext;
+  std::string ExpectedIR = LoadForImport(ExpectedContext, nullptr);
+  EXPECT_NE(std::string::npos, ExpectedIR.find("!named = !{!"));
+  EXPECT_NE(std::string::npos,
+            ExpectedIR.find("@ext = external global i32, !custom"));
+
+  BitcodeImportCache ImportCache;
+  for (unsigned I = 0; I != 2; ++I) {
+    LLVMContext Context;
+    EXPECT_EQ(ExpectedIR, LoadForImport(Context, &ImportCache));
+  }
+}
+
+// Tests that compressed bitcode is read like the bitcode it contains, also
+// lazily, when the function blocks are decompressed as they are materialized.
+TEST(BitReaderTest, CompressedBitcode) {
+  // The function blocks are only compressed on their own if they are large.
+  std::string Assembly = "@g = global i32 0\n";
+  for (unsigned F = 0; F != 4; ++F) {
+    Assembly += "define i32 @f" + utostr(F) + "(i32 %x0) {\n";
+    for (unsigned I = 0; I != 512; ++I)
+      Assembly += "  %x" + utostr(I + 1) + " = add i32 %x" + utostr(I) +
+                  ", " + utostr(F * 1000 + I) + "\n";
+    Assembly += "  store i32 %x512, i32* @g\n"
+                "  ret i32 %x512\n"
+                "}\n";
+  }
+
+  SmallString<1024> Mem;
+  std::string ExpectedIR;
+  {
+    LLVMContext Context;
+    std::unique_ptr<Module> M = parseAssembly(Context, Assembly.c_str());
+    M->setModuleIdentifier("test");
+    raw_string_ostream OS(ExpectedIR);
+    M->print(OS, nullptr);
+    OS.flush();
+    writeModuleToBuffer(std::move(M), Mem);
+  }
+  SmallVector<char, 0> Compressed;
+  compressBitcode(Mem.str(), Compressed);
+  StringRef CompressedStr(Compressed.data(), Compressed.size());
+  EXPECT_LT(Compressed.size(), Mem.size());
+  EXPECT_TRUE(
+      isBitcode(CompressedStr.bytes_begin(), CompressedStr.bytes_end()));
+  EXPECT_LT(4u, support::endian::read32le(&Compressed[BCZ_NumSegmentsField]));
+
+  auto Print = [](Module &M) {
+    std::string Str;
+    raw_string_ostream OS(Str);
+    M.print(OS, nullptr);
+    return OS.str();
+  };
+
+  LLVMContext Context;
+  Expected<std::unique_ptr<Module>> MOrErr =
+      parseBitcodeFile(MemoryBufferRef(CompressedStr, "test"), Context);
+  ASSERT_TRUE(bool(MOrErr));
+  EXPECT_EQ(ExpectedIR, Print(**MOrErr));
+
+  MOrErr =
+      getLazyBitcodeModule(MemoryBufferRef(CompressedStr, "test"), Context);
+  ASSERT_TRUE(bool(MOrErr));
+  Module &M = **MOrErr;
+  EXPECT_FALSE(M.getFunction("f2")->materialize());
+  EXPECT_FALSE(M.getFunction("f0")->materialize());
+  EXPECT_TRUE(M.getFunction("f1")->empty());
+  EXPECT_FALSE(M.materializeAll());
+  EXPECT_FALSE(verifyModule(M, &dbgs()));
+  EXPECT_EQ(ExpectedIR, Print(M));
+}
+
 } // end namespace
@@ -19,6 +19,7 @@
 #include "llvm/IR/ModuleSlotTracker.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 using namespace llvm;
@@ -168,6 +169,30 @@ TEST_F(MDStringTest, PrintingComplex) {
   EXPECT_STREQ("!\"\\00\\0A\\22\\5C\\FF\"", oss.str().c_str());
 }
 
+// Test that an external MDString refers to the characters of the retained
+// buffer, that it is uniqued with the copied strings, and that a string that
+// exists already is not replaced.
+TEST_F(MDStringTest, External) {
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBufferCopy("externalcopied", "buffer");
+  StringRef External = Buffer->getBuffer().substr(0, 8);
+  StringRef Copied = Buffer->getBuffer().substr(8);
+  EXPECT_FALSE(Context.isInRetainedBuffer(External));
+  Context.retainBuffer(std::move(Buffer));
+  EXPECT_TRUE(Context.isInRetainedBuffer(External));
+  EXPECT_FALSE(Context.isInRetainedBuffer("external"));
+
+  MDString *s1 = MDString::getExternal(Context, External);
+  EXPECT_EQ(External.data(), s1->getString().data());
+  EXPECT_EQ("external", s1->getString());
+  EXPECT_EQ(s1, MDString::get(Context, "external"));
+
+  MDString *s2 = MDString::get(Context, "copied");
+  EXPECT_EQ(s2, MDString::getExternal(Context, Copied));
+  EXPECT_NE(Copied.data(), s2->getString().data());
+  EXPECT_EQ('\0', *s2->end());
+}
+
 typedef MetadataTest MDNodeTest;
 
 // Test the two constructors, and containing other Constants.
@@ -9,6 +9,10 @@
 
 #include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -71,6 +75,10 @@ TEST(CachePruningPolicyParser, Multiple) {
   EXPECT_EQ(std::chrono::seconds(1200), P->Interval);
   EXPECT_EQ(std::chrono::seconds(1), P->Expiration);
   EXPECT_EQ(50u, P->MaxSizePercentageOfAvailableSpace);
+  P = parseCachePruningPolicy("cache_size_files=10:index_walk_interval=1h");
+  ASSERT_TRUE(bool(P));
+  EXPECT_EQ(10u, P->MaxSizeFiles);
+  EXPECT_EQ(std::chrono::seconds(3600), P->IndexWalkInterval);
 }
 
 TEST(CachePruningPolicyParser, Errors) {
@@ -95,3 +103,75 @@ TEST(CachePruningPolicyParser, Errors) {
   EXPECT_EQ("Unknown key: 'foo'",
             toString(parseCachePruningPolicy("foo=bar").takeError()));
 }
+
+TEST(CachePruning, Index) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("cache-pruning-test", CacheDir));
+
+  auto CreateEntry = [&](StringRef Name, size_t Size) {
+    SmallString<128> EntryPath(CacheDir);
+    sys::path::append(EntryPath, Name);
+    std::error_code EC;
+    raw_fd_ostream OS(EntryPath, EC, sys::fs::F_None);
+    ASSERT_FALSE(EC);
+    OS << std::string(Size, 'x');
+  };
+  auto Exists = [&](StringRef Name) {
+    SmallString<128> EntryPath(CacheDir);
+    sys::path::append(EntryPath, Name);
+    return sys::fs::exists(EntryPath);
+  };
+
+  CreateEntry("llvmcache-small", 10);
+  CreateEntry("llvmcache-medium", 20);
+  CreateEntry("llvmcache-large", 30);
+  CreateEntry("llvmcache-unindexed", 40);
+  recordCacheAccess(CacheDir, "llvmcache-small", 10);
+  recordCacheAccess(CacheDir, "llvmcache-medium", 20);
+  recordCacheAccess(CacheDir, "llvmcache-large", 30);
+  recordCacheAccess(CacheDir, "llvmcache-small", 10);
+
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.Expiration = std::chrono::seconds(0);
+  Policy.MaxSizePercentageOfAvailableSpace = 0;
+  Policy.MaxSizeFiles = 3;
+
+  // The directory was never walked, thus the entry missing from the index is
+  // found and pruned.
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_TRUE(Exists("llvmcache-small"));
+  EXPECT_TRUE(Exists("llvmcache-medium"));
+  EXPECT_TRUE(Exists("llvmcache-large"));
+  EXPECT_FALSE(Exists("llvmcache-unindexed"));
+
+  // Until the walk interval passes, entries not in the index are invisible
+  // to the pruner.
+  CreateEntry("llvmcache-unindexed", 40);
+  Policy.MaxSizeFiles = 2;
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_TRUE(Exists("llvmcache-small"));
+  EXPECT_TRUE(Exists("llvmcache-medium"));
+  EXPECT_FALSE(Exists("llvmcache-large"));
+  EXPECT_TRUE(Exists("llvmcache-unindexed"));
+
+  Policy.IndexWalkInterval = std::chrono::seconds(0);
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_TRUE(Exists("llvmcache-small"));
+  EXPECT_TRUE(Exists("llvmcache-medium"));
+  EXPECT_FALSE(Exists("llvmcache-unindexed"));
+
+  // The index was compacted to one line per remaining entry.
+  SmallString<128> IndexPath(CacheDir);
+  sys::path::append(IndexPath, "llvmcache.index");
+  ErrorOr<std::unique_ptr<MemoryBuffer>> IndexOrErr =
+      MemoryBuffer::getFile(IndexPath);
+  ASSERT_TRUE(bool(IndexOrErr));
+  SmallVector<StringRef, 4> Lines;
+  (*IndexOrErr)->getBuffer().split(Lines, '\n', -1, false);
+  ASSERT_EQ(2u, Lines.size());
+  EXPECT_TRUE(Lines[0].endswith(" 20 llvmcache-medium"));
+  EXPECT_TRUE(Lines[1].endswith(" 10 llvmcache-small"));
+
+  ASSERT_FALSE(sys::fs::remove_directories(CacheDir));
+}
@@ -74,4 +74,56 @@ TEST(CompressionTest, ZlibCRC32) {
 
 #endif
 
+void TestLZ4Compression(StringRef Input) {
+  SmallString<32> Compressed;
+  SmallString<32> Uncompressed;
+
+  lz4::compress(Input, Compressed);
+  Error E = lz4::uncompress(Compressed, Uncompressed, Input.size());
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+  EXPECT_EQ(Input, Uncompressed);
+
+  // Uncompression fails if the expected length is wrong.
+  E = lz4::uncompress(Compressed, Uncompressed, Input.size() + 1);
+  EXPECT_TRUE(bool(E));
+  consumeError(std::move(E));
+  if (Input.size() > 0) {
+    E = lz4::uncompress(Compressed, Uncompressed, Input.size() - 1);
+    EXPECT_EQ("lz4 error: output too small", llvm::toString(std::move(E)));
+  }
+}
+
+TEST(CompressionTest, LZ4) {
+  TestLZ4Compression("");
+  TestLZ4Compression("hello, world!");
+  TestLZ4Compression("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+
+  const size_t kSize = 1 << 18;
+  std::string Data;
+  for (size_t i = 0; i < kSize; ++i)
+    Data.push_back(char((i * 7) % 251 ^ (i >> 9)));
+  TestLZ4Compression(Data);
+
+  // Runs of every length around the token limits, with overlapping matches.
+  std::string Runs;
+  for (unsigned Length = 1; Length < 600; Length += 7)
+    Runs += std::string(Length, char('a' + Length % 26)) + "xyz";
+  TestLZ4Compression(Runs);
+
+  SmallString<32> Compressed;
+  lz4::compress(Runs, Compressed);
+  EXPECT_LT(Compressed.size(), Runs.size() / 4);
+}
+
+TEST(CompressionTest, LZ4Malformed) {
+  SmallString<32> Uncompressed;
+  // A match before the start of the output.
+  const char Input[] = {'\x14', 'a', '\x02', '\x00', '\x00'};
+  Error E = lz4::uncompress(StringRef(Input, 4), Uncompressed, 6);
+  EXPECT_EQ("lz4 error: invalid match distance", llvm::toString(std::move(E)));
+  E = lz4::uncompress(StringRef(Input, 1), Uncompressed, 1);
+  EXPECT_EQ("lz4 error: truncated input", llvm::toString(std::move(E)));
+}
+
 }
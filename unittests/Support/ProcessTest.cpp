@@ -26,6 +26,24 @@ TEST(ProcessTest, GetRandomNumberTest) {
   EXPECT_NE((r1 | r2), 0u);
 }
 
+#if defined(__linux__) || defined(LLVM_ON_WIN32)
+TEST(ProcessTest, GetPeakMemoryUsage) {
+  // The peak resident set size never decreases.
+  size_t Peak = Process::GetPeakMemoryUsage();
+  EXPECT_NE(Peak, 0u);
+  EXPECT_GE(Process::GetPeakMemoryUsage(), Peak);
+}
+
+TEST(ProcessTest, GetThreadCPUTime) {
+  std::chrono::nanoseconds Start = Process::GetThreadCPUTime();
+  volatile unsigned Sum = 0;
+  while (Process::GetThreadCPUTime() == Start)
+    for (unsigned I = 0; I != 100000; ++I)
+      Sum += I;
+  EXPECT_GT(Process::GetThreadCPUTime(), Start);
+}
+#endif
+
 #ifdef _MSC_VER
 #define setenv(name, var, ignore) _putenv_s(name, var)
 #endif
@@ -10,6 +10,7 @@
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/DIBuilder.h"
@@ -22,6 +23,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -614,4 +616,93 @@ TEST_F(CloneModule, Comdat) {
   Function *NewF = NewM->getFunction("f");
   EXPECT_EQ(CD, NewF->getComdat());
 }
+
+TEST(CloneModuleIntoContext, Identical) {
+  LLVMContext C;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> OldM = parseAssemblyString(R"(
+    %list = type { %list*, i32 }
+    %opaque = type opaque
+
+    $comdat = comdat any
+
+    @str = private unnamed_addr constant [4 x i8] c"abc\00", align 1
+    @vec = global <2 x float> <float 1.0, float 2.0>, section "data"
+    @head = global %list { %list* @head, i32 7 }, comdat($comdat)
+    @ptr = global i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str, i64 0, i64 1)
+    @addr = global i8* blockaddress(@f, %target)
+    @ext = external global %opaque
+    @alias = alias %list, %list* @head
+
+    declare i32 @personality(...)
+    declare void @g(i32* nocapture, double) #0
+    declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+    define i32 @f(i32 %n, i32* %p) personality i32 (...)* @personality !dbg !5 {
+    entry:
+      switch i32 %n, label %loop [ i32 0, label %exit
+                                   i32 1, label %target ]
+    loop:
+      %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+      %i.next = add nsw i32 %i, 1, !dbg !9
+      call void @llvm.dbg.value(metadata i32 %i, i64 0, metadata !10, metadata !DIExpression()), !dbg !9
+      %cmp = icmp slt i32 %i.next, %n
+      br i1 %cmp, label %loop, label %exit, !llvm.loop !12
+    target:
+      %old = atomicrmw add i32* %p, i32 1 syncscope("agent") seq_cst
+      fence syncscope("singlethread") acquire
+      invoke void @g(i32* %p, double 1.5) to label %exit unwind label %lpad
+    lpad:
+      %lp = landingpad { i8*, i32 } cleanup
+      resume { i8*, i32 } %lp
+    exit:
+      %r = phi i32 [ 0, %entry ], [ %i.next, %loop ], [ %old, %target ]
+      %l = load volatile i32, i32* %p, align 4, !custom !13
+      ret i32 %r
+    dead1:
+      %a = add i32 %b, 1
+      ret i32 %a
+    dead2:
+      %b = mul i32 %a, 2
+      br label %dead1
+    }
+
+    attributes #0 = { nounwind "custom-attr"="value" }
+
+    !llvm.dbg.cu = !{!0}
+    !llvm.module.flags = !{!3, !4}
+
+    !0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+    !1 = !DIFile(filename: "f.c", directory: "/dir")
+    !2 = !{}
+    !3 = !{i32 2, !"Dwarf Version", i32 4}
+    !4 = !{i32 2, !"Debug Info Version", i32 3}
+    !5 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !6, isLocalToUnit: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+    !6 = !DISubroutineType(types: !7)
+    !7 = !{!8, !8}
+    !8 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+    !9 = !DILocation(line: 2, column: 3, scope: !5)
+    !10 = !DILocalVariable(name: "i", scope: !5, file: !1, line: 2, type: !8)
+    !12 = distinct !{!12, !14}
+    !13 = !{!"custom", !13}
+    !14 = !{!"llvm.loop.unroll.disable"}
+  )", Err, C);
+  ASSERT_TRUE(OldM);
+
+  LLVMContext NewC;
+  std::unique_ptr<Module> NewM = CloneModuleIntoContext(*OldM, NewC);
+  ASSERT_TRUE(NewM);
+  EXPECT_EQ(&NewC, &NewM->getContext());
+  EXPECT_FALSE(verifyModule(*NewM, &errs()));
+
+  std::string OldIR, NewIR;
+  raw_string_ostream OldOS(OldIR), NewOS(NewIR);
+  OldM->print(OldOS, nullptr);
+  NewM->print(NewOS, nullptr);
+  EXPECT_EQ(OldOS.str(), NewOS.str());
+
+  // The original module is left untouched and can be deleted independently.
+  OldM.reset();
+  EXPECT_FALSE(verifyModule(*NewM, &errs()));
+}
 }